@@ -0,0 +1,252 @@
+/**
+ * @file comms_cases.c
+ * @brief Message mixes for the parsing and formatting hot paths, see comms_cases.h
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include "comms_cases.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+
+#include "../include/comms.h"
+#include "../include/main.h"
+#include "../include/mtrbox.h"
+
+#define SEQ_START           1000        // two-byte varints, as on a connection that has been up a while
+#define RSSI                -60
+#define SNR                 9
+
+// not in comms.h: only comm_run() sends control frames
+void msgTx(STATE *state, char *out);
+
+typedef enum GS_FRAME {
+    GS_ACK,                 // bare ACK
+    GS_ACK_SACK,            // bare ACK with a gap
+    GS_CMD,                 // $CMD for core 0
+    GS_AGG                  // $MTR and $CMD packed together
+} GS_FRAME;
+
+// what the ground station sends, in proportion
+static const GS_FRAME gs_mix[] = { GS_ACK, GS_CMD, GS_ACK_SACK, GS_AGG, GS_ACK, GS_CMD, GS_ACK, GS_AGG };
+
+#define GS_MIX              (sizeof(gs_mix) / sizeof(gs_mix[0]))
+
+// what the SBC sends over USB, in proportion
+static const char *const usb_mix[] = {
+    "$MTR 1 50 0 25\n",
+    "$MTR V 120 -120\n",
+    "$MTR 0 100 1 100\n",
+    "$MTR V 0 0\n",
+    "$TX 28.6024274 -81.2000599\n",
+    "$MTX 1 2 3 4\n",       // not a command
+};
+
+#define USB_MIX             (sizeof(usb_mix) / sizeof(usb_mix[0]))
+
+static const char *const control_mix[] = { "ACK", "ACK", "ACK", "SYN", "ACK", "FIN" };
+
+#define CONTROL_MIX         (sizeof(control_mix) / sizeof(control_mix[0]))
+
+static STATE link;              // protocol(): established, nothing of the rover's in flight
+static STATE control;           // msgTx()
+static int gs_seq = SEQ_START;  // the ground station's next data frame, for protocol()
+static int mix_seq = SEQ_START; // the same for the parse-only cases
+static unsigned next;           // position in whichever mix is being prepared
+
+/**
+ * @brief Formats one ground station frame as the module delivers it: "+RCV=<address>,<length>,<data>,<rssi>,<snr>"
+ *
+ * @param out destination, COMMS_CASE_SIZE bytes
+ * @param kind which frame
+ * @param seq the ground station's sequence number; advanced past a data frame
+ * @param ack the rover's next sequence number
+ * @param rcv false for the bare stuffed payload parseData() takes
+ */
+static void gs_frame(char *out, GS_FRAME kind, int *seq, int ack, bool rcv)
+{
+    char payload[LORA_SIZE];
+    char agg[ARQ_DATA_SIZE];
+    int len = 0;
+
+    switch (kind)
+    {
+        case GS_ACK:
+            len = formatFrame(payload, sizeof(payload), *seq, ack, 0, "ACK", NULL, 0);
+            break;
+        case GS_ACK_SACK:
+            len = formatFrame(payload, sizeof(payload), *seq, ack, 0x5, "ACK", NULL, 0);
+            break;
+        case GS_CMD:
+            len = formatFrame(payload, sizeof(payload), (*seq)++, ack, 0, "$CMD", "GOTO 28.6024274 -81.2000599", 27);
+            break;
+        case GS_AGG:
+            len = aggAppend(agg, sizeof(agg), 0, "$MTR", "1 50 1 50");
+            len = aggAppend(agg, sizeof(agg), (size_t)len, "$CMD", "HOLD 30");
+            len = formatFrame(payload, sizeof(payload), (*seq)++, ack, 0, "AGG", agg, (size_t)len);
+            break;
+    }
+
+    if (rcv)
+        snprintf(out, COMMS_CASE_SIZE, "+RCV=%d,%d,%s,%d,%d", GS_ADDRESS, len, payload, RSSI, SNR);
+    else
+        snprintf(out, COMMS_CASE_SIZE, "%s", payload);
+}
+
+static void prepare_rcv(comms_input_t *in, int n)
+{
+    for (int i = 0; i < n; i++)
+        gs_frame(in[i], gs_mix[next++ % GS_MIX], &mix_seq, SEQ_START, true);
+}
+
+static void prepare_payload(comms_input_t *in, int n)
+{
+    for (int i = 0; i < n; i++)
+        gs_frame(in[i], gs_mix[next++ % GS_MIX], &mix_seq, SEQ_START, false);
+}
+
+// in sequence, so every data frame is delivered rather than held or dropped
+static void prepare_protocol(comms_input_t *in, int n)
+{
+    for (int i = 0; i < n; i++)
+    {
+        GS_FRAME kind = gs_mix[next++ % GS_MIX];
+        // the rover has nothing in flight: a gap in the sack would be bogus
+        gs_frame(in[i], kind == GS_ACK_SACK ? GS_ACK : kind, &gs_seq, link.seq, true);
+    }
+}
+
+static void prepare_control(comms_input_t *in, int n)
+{
+    for (int i = 0; i < n; i++)
+        snprintf(in[i], COMMS_CASE_SIZE, "%s", control_mix[next++ % CONTROL_MIX]);
+}
+
+// the rover's telemetry: as many items as aggregateQueue() packs into a frame
+static void prepare_telemetry(comms_input_t *in, int n)
+{
+    char item[64];
+    int len;
+
+    for (int i = 0; i < n; i++)
+    {
+        len = 0;
+        for (int k = 0; k < 4; k++)
+        {
+            unsigned j = next++;
+            snprintf(item, sizeof(item), "$FIX 286024274 %d 1 9 110 %u 0 %u", -812000599 - (int)(j % 777), j % 200, j);
+            len = aggAppend(in[i], ARQ_DATA_SIZE, (size_t)len, "ACK", item);
+        }
+    }
+}
+
+static void prepare_usb(comms_input_t *in, int n)
+{
+    for (int i = 0; i < n; i++)
+        snprintf(in[i], COMMS_CASE_SIZE, "%s", usb_mix[next++ % USB_MIX]);
+}
+
+static volatile int sink;
+
+static void run_parse_message(char *in)
+{
+    sink += parseMessage(in);
+}
+
+static void run_parse_data(char *in)
+{
+    FRAME frame;
+
+    sink += parseData(&frame, in) + frame.seq;
+}
+
+static void run_protocol(char *in)
+{
+    char out[LORA_SIZE];
+    char *item;
+    size_t len;
+
+    protocol(&link, in, out);
+    // core 0's side: take the $CMDs, so deliver() always finds room
+    while ((item = msg_receive(&receive_queue, &len)))
+        msg_release(&receive_queue, item);
+}
+
+static void run_msg_tx(char *in)
+{
+    msgTx(&control, in);
+    // the module takes it at once: keep the AT queue from filling up
+    lora_modem.head = lora_modem.tail;
+}
+
+static void run_format_frame(char *in)
+{
+    char out[LORA_SIZE];
+
+    sink += formatFrame(out, sizeof(out), SEQ_START, SEQ_START, 0x3, "AGG", in, strlen(in));
+}
+
+static void run_handle_input(char *in)
+{
+    TX_CLASS cls;
+    char *item;
+    size_t len;
+
+    sink += handle_input(in);
+    // core 1's side: take the $TX, so handle_tx() always finds room
+    while ((item = tx_receive(&transmit_queue, &cls, &len)))
+        tx_release(&transmit_queue, cls, item);
+}
+
+const comms_case_t comms_cases[] = {
+    { "parseMessage", "+RCV lines: ACK, ACK+SACK, $CMD, AGG", prepare_rcv, run_parse_message },
+    { "parseData",    "their payloads",                        prepare_payload, run_parse_data },
+    { "protocol",     "+RCV lines, established, in sequence",  prepare_protocol, run_protocol },
+    { "msgTx",        "ACK, SYN, FIN into AT+SEND",            prepare_control, run_msg_tx },
+    { "formatFrame",  "AGG of 4 telemetry items",              prepare_telemetry, run_format_frame },
+    { "handle_input", "$MTR PWM and V, $TX, a bad tag",        prepare_usb, run_handle_input },
+};
+
+const size_t comms_case_count = sizeof(comms_cases) / sizeof(comms_cases[0]);
+
+/**
+ * @brief Sets up what the cases touch: the inter-core channels, the AT engine,
+ *        the motor mailbox and an established connection
+ */
+void comms_cases_init(void)
+{
+    framer_init(&lora_framer, 0);
+    tx_ring_init(&lora_tx, UART_ID_LORA);
+    at_init(&lora_modem, &lora_tx, &lora_framer, NULL, NULL);
+    msg_channel_init(&receive_queue);
+    msg_channel_init(&error_queue);
+    tx_sched_init(&transmit_queue);
+    frag_tx_init(&txr_queue);
+    mtrbox_init(&motor_mailbox);
+
+    link.state = ESTABLISHED;
+    link.seq = SEQ_START;
+    link.ack = SEQ_START;
+    arq_rtt_reset(&link);
+    arq_start(&link, ARQ_WINDOW);
+
+    control.state = ESTABLISHED;
+    control.seq = SEQ_START;
+    control.ack = SEQ_START;
+}
+
+const comms_case_t *comms_case_find(const char *name)
+{
+    for (size_t i = 0; i < comms_case_count; i++)
+    {
+        if (strcmp(comms_cases[i].name, name) == 0)
+            return &comms_cases[i];
+    }
+    return NULL;
+}
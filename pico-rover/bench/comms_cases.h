@@ -0,0 +1,48 @@
+/**
+ * @file comms_cases.h
+ * @brief Message mixes for the parsing and formatting hot paths, shared by the host and on-target benches
+ *
+ * Each case turns one prepared message into work for one firmware entry point:
+ * parseMessage() and parseData() on what the ground station sends, protocol()
+ * on an established connection, msgTx() for control frames, formatFrame() for
+ * the rover's telemetry aggregates, and handle_input() on the SBC's USB lines.
+ * prepare() writes a batch of inputs outside the timing, since several of the
+ * functions work in place; run() handles one of them. Both have to be called
+ * in order: protocol()'s inputs carry the sequence numbers the connection
+ * expects next.
+ *
+ * host/bench/bench_comms.c reports ns, allocations and instructions per
+ * message; bench/comms_cycles.c reports RP2040 cycles per message.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef COMMS_CASES_H
+#define COMMS_CASES_H
+
+#include <stddef.h>
+
+#define COMMS_CASE_SIZE     300     // FRAMER_LINE_SIZE: a +RCV line with a full payload
+
+typedef char comms_input_t[COMMS_CASE_SIZE];
+
+typedef struct comms_case
+{
+    const char *name;
+    const char *mix;                // what the inputs are, for the report
+    void (*prepare)(comms_input_t *in, int n);
+    void (*run)(char *in);
+} comms_case_t;
+
+extern const comms_case_t comms_cases[];
+extern const size_t comms_case_count;
+
+// function prototypes
+void comms_cases_init(void);
+const comms_case_t *comms_case_find(const char *name);
+
+#endif
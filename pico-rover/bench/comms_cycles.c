@@ -0,0 +1,102 @@
+/**
+ * @file comms_cycles.c
+ * @brief RP2040 cycle counts for the parsing and formatting hot paths, per message
+ *
+ * Flash bench_comms_cycles.uf2 and read the results on USB stdio. Runs the
+ * cases of comms_cases.c, the same mixes host/bench/bench_comms.c times on
+ * the host, and counts each message with SysTick on the processor clock.
+ * Inputs are prepared a batch at a time outside the count.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <stdio.h>
+
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include "hardware/structs/systick.h"
+
+#include "comms_cases.h"
+
+#define BATCH           32
+#define ROUNDS          (BATCH * 32)
+
+static comms_input_t inputs[BATCH];
+
+static inline uint32_t cycles(void)
+{
+    return systick_hw->cvr;
+}
+
+static void systick_start(void)
+{
+    systick_hw->rvr = 0x00FFFFFF;
+    systick_hw->cvr = 0;
+    systick_hw->csr = 0x5;      // enable, processor clock, no interrupt
+}
+
+// SysTick counts down and is 24 bits wide
+static inline uint32_t elapsed(uint32_t start, uint32_t end)
+{
+    return (start - end) & 0x00FFFFFF;
+}
+
+typedef struct cost
+{
+    uint32_t min, max;
+    uint64_t sum;
+} cost_t;
+
+static void cost_add(cost_t *c, uint32_t n)
+{
+    if (n < c->min)
+        c->min = n;
+    if (n > c->max)
+        c->max = n;
+    c->sum += n;
+}
+
+static void cost_print(const comms_case_t *cs, const cost_t *c)
+{
+    printf("%-14s %-40s min %6lu  mean %8.1f  max %6lu cycles\n", cs->name, cs->mix, (unsigned long)c->min,
+           (double)c->sum / ROUNDS, (unsigned long)c->max);
+}
+
+static void run_case(const comms_case_t *cs)
+{
+    cost_t cost = { UINT32_MAX };
+    uint32_t t0, t1;
+
+    for (int round = 0; round < ROUNDS; round += BATCH)
+    {
+        cs->prepare(inputs, BATCH);
+        for (int i = 0; i < BATCH; i++)
+        {
+            t0 = cycles();
+            cs->run(inputs[i]);
+            t1 = cycles();
+            cost_add(&cost, elapsed(t0, t1));
+        }
+    }
+    cost_print(cs, &cost);
+}
+
+int main()
+{
+    stdio_init_all();
+    sleep_ms(2000);
+    systick_start();
+    comms_cases_init();
+
+    while (1)
+    {
+        printf("\nclk_sys %lu Hz\n", (unsigned long)clock_get_hz(clk_sys));
+        for (size_t i = 0; i < comms_case_count; i++)
+            run_case(&comms_cases[i]);
+        sleep_ms(5000);
+    }
+}
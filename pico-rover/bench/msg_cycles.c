@@ -0,0 +1,191 @@
+/**
+ * @file msg_cycles.c
+ * @brief RP2040 cycle counts: queue_t copies of LORA_SIZE items vs the zero-copy msgring channel
+ *
+ * Flash bench_msg_cycles.uf2 and read the results on USB stdio. Single-core
+ * costs are measured with SysTick on the processor clock; the cross-core run
+ * streams messages from core 0 to a consumer on core 1 and reports cycles per
+ * message from time_us_64() and clk_sys.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "pico/util/queue.h"
+#include "hardware/clocks.h"
+#include "hardware/structs/systick.h"
+
+#include "../include/msgring.h"
+
+#define ITEM_SIZE       240     // LORA_SIZE
+#define ROUNDS          1000
+#define STREAM          100000
+
+static queue_t queue;
+static msg_channel_t channel;
+static volatile uint32_t sink;
+
+static inline uint32_t cycles(void)
+{
+    return systick_hw->cvr;
+}
+
+static void systick_start(void)
+{
+    systick_hw->rvr = 0x00FFFFFF;
+    systick_hw->cvr = 0;
+    systick_hw->csr = 0x5;      // enable, processor clock, no interrupt
+}
+
+// SysTick counts down and is 24 bits wide
+static inline uint32_t elapsed(uint32_t start, uint32_t end)
+{
+    return (start - end) & 0x00FFFFFF;
+}
+
+typedef struct cost
+{
+    uint32_t min, max;
+    uint64_t sum;
+} cost_t;
+
+static void cost_add(cost_t *c, uint32_t n)
+{
+    if (n < c->min)
+        c->min = n;
+    if (n > c->max)
+        c->max = n;
+    c->sum += n;
+}
+
+static void cost_print(const char *what, const cost_t *c)
+{
+    printf("%-34s min %5lu  mean %7.1f  max %5lu cycles\n", what, (unsigned long)c->min,
+           (double)c->sum / ROUNDS, (unsigned long)c->max);
+}
+
+static void single_core(void)
+{
+    static char item[ITEM_SIZE] = "$FIX 286024274 -812000599 1 9 110 0 0 50520000";
+    static char out[ITEM_SIZE];
+    cost_t add = { UINT32_MAX }, remove = { UINT32_MAX };
+    cost_t alloc = { UINT32_MAX }, receive = { UINT32_MAX };
+    uint32_t t0, t1;
+    char *buf;
+    size_t len;
+
+    for (int i = 0; i < ROUNDS; i++)
+    {
+        t0 = cycles();
+        queue_try_add(&queue, item);
+        t1 = cycles();
+        cost_add(&add, elapsed(t0, t1));
+
+        t0 = cycles();
+        queue_try_remove(&queue, out);
+        t1 = cycles();
+        cost_add(&remove, elapsed(t0, t1));
+        sink += out[i & 15];
+
+        // the producer writes its message into the buffer either way; only the handoff is timed
+        t0 = cycles();
+        buf = msg_alloc(&channel);
+        msg_send(&channel, buf, 48);
+        t1 = cycles();
+        cost_add(&alloc, elapsed(t0, t1));
+
+        t0 = cycles();
+        buf = msg_receive(&channel, &len);
+        msg_release(&channel, buf);
+        t1 = cycles();
+        cost_add(&receive, elapsed(t0, t1));
+        sink += len;
+    }
+
+    cost_print("queue_try_add (240 B copy)", &add);
+    cost_print("queue_try_remove (240 B copy)", &remove);
+    cost_print("msg_alloc + msg_send", &alloc);
+    cost_print("msg_receive + msg_release", &receive);
+}
+
+static void queue_consumer(void)
+{
+    static char out[ITEM_SIZE];
+
+    for (int i = 0; i < STREAM; i++)
+    {
+        queue_remove_blocking(&queue, out);
+        sink += out[0];
+    }
+    multicore_fifo_push_blocking(0);
+}
+
+static void channel_consumer(void)
+{
+    size_t len;
+    char *buf;
+
+    for (int i = 0; i < STREAM; i++)
+    {
+        while (!(buf = msg_receive(&channel, &len)))
+            tight_loop_contents();
+        sink += buf[0];
+        msg_release(&channel, buf);
+    }
+    multicore_fifo_push_blocking(0);
+}
+
+static void cross_core(void)
+{
+    static char item[ITEM_SIZE] = "$FIX 286024274 -812000599 1 9 110 0 0 50520000";
+    double mhz = clock_get_hz(clk_sys) / 1e6;
+    uint64_t start;
+    char *buf;
+
+    start = time_us_64();
+    multicore_launch_core1(queue_consumer);
+    for (int i = 0; i < STREAM; i++)
+        queue_add_blocking(&queue, item);
+    multicore_fifo_pop_blocking();
+    printf("core 0 -> core 1, queue_t:  %.1f cycles/message\n", (time_us_64() - start) * mhz / STREAM);
+    multicore_reset_core1();
+
+    start = time_us_64();
+    multicore_launch_core1(channel_consumer);
+    for (int i = 0; i < STREAM; i++)
+    {
+        while (!(buf = msg_alloc(&channel)))
+            tight_loop_contents();
+        buf[0] = item[i & 15];
+        msg_send(&channel, buf, 48);
+    }
+    multicore_fifo_pop_blocking();
+    printf("core 0 -> core 1, msgring:  %.1f cycles/message\n", (time_us_64() - start) * mhz / STREAM);
+    multicore_reset_core1();
+}
+
+int main()
+{
+    stdio_init_all();
+    sleep_ms(2000);
+    systick_start();
+    // the depth core 0 and core 1 used
+    queue_init(&queue, ITEM_SIZE, 5);
+    msg_channel_init(&channel);
+
+    while (1)
+    {
+        printf("\nclk_sys %lu Hz\n", (unsigned long)clock_get_hz(clk_sys));
+        single_core();
+        cross_core();
+        sleep_ms(5000);
+    }
+}
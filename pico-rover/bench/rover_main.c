@@ -0,0 +1,18 @@
+/**
+ * @file rover_main.c
+ * @brief The firmware's main.c with its main() renamed rover_main(), for on-target benches
+ *
+ * Benches that call into main.c (handle_input(), the shared channels) bring
+ * their own main(). The host build renames it with a per-file compile
+ * definition; the firmware build compiles main.c as it is for rover_peri, so
+ * the benches compile it again through here instead.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#define main rover_main
+#include "../src/main.c"
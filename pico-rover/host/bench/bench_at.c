@@ -0,0 +1,277 @@
+/**
+ * @file bench_at.c
+ * @brief The asynchronous AT-command engine against a scripted fake LoRa module
+ *
+ *     ./bench_at [commands]
+ *
+ * The engine runs on the main thread the way comm_run() drives it: at_poll(),
+ * then WFE until a byte arrives or the command's deadline. The fake module
+ * answers on its own thread. Checks that frames received while a command is
+ * outstanding are delivered at once, that "+ERR=<n>" and a silent module
+ * complete the command with the right result, then measures commands/s and
+ * the CPU the engine's thread uses while it waits for a slow answer, against
+ * polling the way lora_read() used to.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pico/stdlib.h"
+#include "comms.h"
+#include "config.h"
+#include "main.h"
+#include "atmodem.h"
+#include "fake_modem.h"
+#define BENCH_CHECK_OUT stdout
+#include "bench_check.h"
+
+#define SEND_DELAY_US       200000      // AT+SEND answered after its airtime
+#define RCV_PERIOD_US       10000
+#define RCV_COUNT           15
+#define SILENT_TIMEOUT_MS   300
+#define SLOW_DELAY_US       500000
+
+typedef struct outcome
+{
+    volatile bool done;
+    AT_RESULT result;
+    int error;
+    absolute_time_t at;
+} outcome_t;
+
+typedef struct lines
+{
+    uint32_t count[AT_LINE_OTHER + 1];
+    uint32_t during_command;    // arrived while a command was outstanding
+    const at_engine_t *at;
+} lines_t;
+
+static fake_modem_t modem;
+static double thread_cpu_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void on_done(const at_command_t *cmd, AT_RESULT result, int error)
+{
+    outcome_t *o = cmd->ctx;
+
+    o->result = result;
+    o->error = error;
+    o->at = get_absolute_time();
+    o->done = true;
+}
+
+static void on_line(AT_LINE type, const char *line, size_t len, void *ctx)
+{
+    lines_t *l = ctx;
+
+    l->count[type]++;
+    if (at_busy(l->at))
+        l->during_command++;
+}
+
+// drives the engine as comm_run() does until flag is set
+static void run_until(at_engine_t *at, volatile bool *flag, uint32_t timeout_ms)
+{
+    absolute_time_t end = make_timeout_time_ms(timeout_ms);
+    absolute_time_t wake;
+
+    while (!*flag && !time_reached(end))
+    {
+        if (at_poll(at) || *flag)
+            continue;
+        wake = at_deadline(at);
+        best_effort_wfe_or_timeout(absolute_time_diff_us(wake, end) < 0 ? end : wake);
+    }
+}
+
+static void start(at_engine_t *at, lines_t *lines, const fake_modem_rule_t *script, size_t rules)
+{
+    memset(lines, 0, sizeof(*lines));
+    lines->at = at;
+    framer_init(&lora_framer, 0);
+    tx_ring_init(&lora_tx, UART_ID_LORA);
+    at_init(at, &lora_tx, &lora_framer, on_line, lines);
+    fake_modem_init(&modem, UART_ID_LORA, script, rules, NULL, NULL);
+    fake_modem_start(&modem);
+}
+
+static void *inject_frames(void *arg)
+{
+    for (int i = 0; i < RCV_COUNT; i++)
+    {
+        sleep_us(RCV_PERIOD_US);
+        fake_modem_receive(&modem, GS_ADDRESS, "\x01\x05\x07", -40, 10);
+    }
+    return NULL;
+}
+
+static void classify(void)
+{
+    int error;
+
+    printf("at_classify\n");
+    check(at_classify("+OK", &error) == AT_LINE_OK, "+OK");
+    check(at_classify("+ERR=12", &error) == AT_LINE_ERR && error == 12, "+ERR=12");
+    check(at_classify("+RCV=101,3,abc,-40,10", &error) == AT_LINE_RCV, "+RCV=...");
+    check(at_classify("+READY", &error) == AT_LINE_READY, "+READY");
+    check(at_classify("+ADDRESS=102", &error) == AT_LINE_OTHER, "query answer");
+}
+
+static void overlap(void)
+{
+    static const fake_modem_rule_t script[] = {
+        { "AT+SEND=", "+OK", SEND_DELAY_US },
+    };
+    at_engine_t at;
+    lines_t lines;
+    outcome_t sent = {0};
+    pthread_t injector;
+    char msg[64];
+
+    printf("reception while an AT+SEND is outstanding (answer after %d ms, +RCV every %d ms)\n",
+           SEND_DELAY_US / 1000, RCV_PERIOD_US / 1000);
+    start(&at, &lines, script, 1);
+    snprintf(msg, sizeof(msg), "AT+SEND=%d,4,ping", GS_ADDRESS);
+    absolute_time_t t0 = get_absolute_time();
+    at_submit(&at, msg, LORA_SEND_TIMEOUT_MS, on_done, &sent);
+    pthread_create(&injector, NULL, inject_frames, NULL);
+    run_until(&at, &sent.done, 2000);
+    pthread_join(injector, NULL);
+    fake_modem_stop(&modem);
+    // whatever is still in the framer
+    while (at_poll(&at))
+        ;
+
+    printf("  +OK after %lld ms; %u of %u frames arrived meanwhile\n", absolute_time_diff_us(t0, sent.at) / 1000,
+           lines.during_command, lines.count[AT_LINE_RCV]);
+    check(sent.done && sent.result == AT_RESULT_OK, "AT+SEND completes with +OK");
+    check(lines.count[AT_LINE_RCV] == RCV_COUNT, "every +RCV delivered");
+    check(lines.during_command == RCV_COUNT, "all of them before the +OK");
+}
+
+static void errors(void)
+{
+    static const fake_modem_rule_t script[] = {
+        { "AT+PARAMETER=", "+ERR=4", 0 },
+        { "AT+MODE=", NULL, 0 },
+        { NULL, "+OK", 0 },
+    };
+    at_engine_t at;
+    lines_t lines;
+    outcome_t bad = {0}, silent = {0}, after = {0};
+
+    printf("failures\n");
+    start(&at, &lines, script, 3);
+    at_submit(&at, "AT+PARAMETER=12,7,1,4", AT_CONFIG_TIMEOUT_MS, on_done, &bad);
+    at_submit(&at, "AT+MODE=0", SILENT_TIMEOUT_MS, on_done, &silent);
+    at_submit(&at, "AT+ADDRESS=102", AT_CONFIG_TIMEOUT_MS, on_done, &after);
+    absolute_time_t t0 = get_absolute_time();
+    run_until(&at, &after.done, 3000);
+    fake_modem_stop(&modem);
+
+    check(bad.done && bad.result == AT_RESULT_ERR && bad.error == 4, "+ERR=4 reaches the callback");
+    check(silent.done && silent.result == AT_RESULT_TIMEOUT, "silent module: AT_RESULT_TIMEOUT");
+    printf("  timeout after %lld ms (limit %d ms)\n", absolute_time_diff_us(t0, silent.at) / 1000,
+           SILENT_TIMEOUT_MS);
+    check(after.done && after.result == AT_RESULT_OK, "the queue moves on after a timeout");
+    check(at.errors == 1 && at.timeouts == 1 && at.ok == 1, "statistics");
+}
+
+static uint32_t completed;
+
+static void count_done(const at_command_t *cmd, AT_RESULT result, int error)
+{
+    completed += result == AT_RESULT_OK;
+}
+
+static void throughput(long n)
+{
+    static const fake_modem_rule_t script[] = {
+        { NULL, "+OK", 0 },
+    };
+    at_engine_t at;
+    lines_t lines;
+    char msg[AT_COMMAND_SIZE];
+    long submitted = 0;
+
+    printf("throughput, module answers at once\n");
+    start(&at, &lines, script, 1);
+    completed = 0;
+    snprintf(msg, sizeof(msg), "AT+SEND=%d,48,%048d", GS_ADDRESS, 0);
+    absolute_time_t t0 = get_absolute_time();
+    while (at.commands < n)
+    {
+        while (submitted < n && at_free(&at))
+            submitted += at_submit(&at, msg, LORA_SEND_TIMEOUT_MS, count_done, NULL);
+        if (!at_poll(&at) && at_busy(&at))
+            best_effort_wfe_or_timeout(at_deadline(&at));
+    }
+    double s = absolute_time_diff_us(t0, get_absolute_time()) / 1e6;
+    fake_modem_stop(&modem);
+
+    printf("  %ld commands in %.2f s: %.0f commands/s\n", n, s, n / s);
+    check(completed == n, "all answered +OK");
+}
+
+static void idle_cpu(void)
+{
+    static const fake_modem_rule_t script[] = {
+        { NULL, "+OK", SLOW_DELAY_US },
+    };
+    at_engine_t at;
+    lines_t lines;
+    outcome_t wfe = {0}, poll = {0};
+    double cpu;
+
+    printf("CPU while waiting %d ms for an answer\n", SLOW_DELAY_US / 1000);
+    start(&at, &lines, script, 1);
+
+    cpu = thread_cpu_s();
+    at_submit(&at, "AT+ADDRESS=102", AT_CONFIG_TIMEOUT_MS, on_done, &wfe);
+    run_until(&at, &wfe.done, 2000);
+    double wfe_cpu = thread_cpu_s() - cpu;
+
+    // the old way: poll for a line until something turns up
+    cpu = thread_cpu_s();
+    at_submit(&at, "AT+ADDRESS=102", AT_CONFIG_TIMEOUT_MS, on_done, &poll);
+    while (!poll.done)
+    {
+        at_poll(&at);
+        tight_loop_contents();
+    }
+    double poll_cpu = thread_cpu_s() - cpu;
+    fake_modem_stop(&modem);
+
+    printf("  at_poll + WFE: %.2f ms CPU; polling: %.2f ms CPU\n", wfe_cpu * 1000, poll_cpu * 1000);
+    check(wfe.done && wfe.result == AT_RESULT_OK, "answered");
+    check(wfe_cpu < 0.01 * SLOW_DELAY_US / 1e6, "under 1% of the wait");
+}
+
+int main(int argc, char **argv)
+{
+    long n = argc > 1 ? atol(argv[1]) : 20000;
+
+    // as core 1 does in comm_run()
+    configure_UART_IRQ(UART_ID_LORA, on_UART_LORA_irq);
+
+    classify();
+    overlap();
+    errors();
+    throughput(n);
+    idle_cpu();
+
+    return check_summary();
+}
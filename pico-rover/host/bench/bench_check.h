@@ -0,0 +1,42 @@
+/**
+ * @file bench_check.h
+ * @brief Pass/fail lines shared by the benches: check() for each, check_summary() for the exit status
+ *
+ * Results go to stderr, as firmware output takes stdout; a bench whose stdout
+ * is its own defines BENCH_CHECK_OUT as stdout before including this.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef BENCH_CHECK_H
+#define BENCH_CHECK_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifndef BENCH_CHECK_OUT
+#define BENCH_CHECK_OUT stderr
+#endif
+
+static int failures;
+
+static inline void check(bool ok, const char *what)
+{
+    fprintf(BENCH_CHECK_OUT, "  %-58s %s\n", what, ok ? "ok" : "FAILED");
+    if (!ok)
+        failures++;
+}
+
+// the verdict line, and the bench's exit status
+static inline int check_summary(void)
+{
+    fprintf(BENCH_CHECK_OUT, "\n%s\n", failures ? "FAILED" : "all checks passed");
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+#endif
@@ -0,0 +1,177 @@
+/**
+ * @file bench_comms.c
+ * @brief Parsing and formatting hot paths: ns, allocations and instructions per message
+ *
+ *     ./bench_comms [messages] [case] > /dev/null
+ *     perf stat -e instructions,cycles ./bench_comms 1000000 parseData > /dev/null
+ *
+ * Runs each case of bench/comms_cases.c over its message mix: parseMessage(),
+ * parseData(), protocol(), msgTx(), formatFrame() and handle_input(). Inputs
+ * are written in batches of BATCH outside the timing, then handled back to
+ * back; only that part is timed and counted. Allocations are the firmware's
+ * own malloc/calloc/realloc calls (the link wraps them; libc's internal
+ * buffers aren't seen). Instructions are retired user-mode instructions from
+ * the CPU's counter via perf_event_open(), where the kernel allows it; for
+ * one case alone, with its setup included, run it under perf stat as above
+ * and divide by messages. These are host numbers: bench/comms_cycles.c runs
+ * the same cases on the RP2040 and counts cycles with SysTick. Firmware output
+ * goes to stdout, results go to stderr.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <linux/perf_event.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "pico/stdlib.h"
+#include "comms_cases.h"
+
+#define BATCH               256
+
+// the firmware's allocations, counted while a batch runs
+static volatile bool counting;
+static uint64_t allocations;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *p, size_t size);
+
+void *__wrap_malloc(size_t size)
+{
+    allocations += counting;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size)
+{
+    allocations += counting;
+    return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *p, size_t size)
+{
+    allocations += counting;
+    return __real_realloc(p, size);
+}
+
+static comms_input_t inputs[BATCH];
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// retired user-mode instructions of this thread; -1 if the kernel won't count them
+static int instructions_open(void)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+typedef struct result
+{
+    long messages;
+    double ns;
+    double allocs;
+    double instructions;    // < 0: not available
+} result_t;
+
+static result_t run_case(const comms_case_t *c, long messages, int counter)
+{
+    result_t r = { 0 };
+    uint64_t ns = 0;
+    uint64_t instructions = 0;
+
+    // warm up caches and branch predictors on one batch
+    c->prepare(inputs, BATCH);
+    for (int i = 0; i < BATCH; i++)
+        c->run(inputs[i]);
+
+    allocations = 0;
+    if (counter >= 0)
+        ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+
+    while (r.messages < messages)
+    {
+        c->prepare(inputs, BATCH);
+
+        counting = true;
+        if (counter >= 0)
+            ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+        uint64_t t0 = now_ns();
+        for (int i = 0; i < BATCH; i++)
+            c->run(inputs[i]);
+        ns += now_ns() - t0;
+        if (counter >= 0)
+            ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+        counting = false;
+
+        r.messages += BATCH;
+    }
+
+    if (counter < 0 || read(counter, &instructions, sizeof(instructions)) != sizeof(instructions))
+        r.instructions = -1;
+    else
+        r.instructions = (double)instructions / r.messages;
+    r.ns = (double)ns / r.messages;
+    r.allocs = (double)allocations / r.messages;
+    return r;
+}
+
+int main(int argc, char **argv)
+{
+    long messages = argc > 1 ? atol(argv[1]) : 200000;
+    const comms_case_t *only = NULL;
+    int counter = instructions_open();
+
+    if (argc > 2 && !(only = comms_case_find(argv[2])))
+    {
+        fprintf(stderr, "no case \"%s\"; cases:", argv[2]);
+        for (size_t i = 0; i < comms_case_count; i++)
+            fprintf(stderr, " %s", comms_cases[i].name);
+        fprintf(stderr, "\n");
+        return EXIT_FAILURE;
+    }
+
+    comms_cases_init();
+
+    fprintf(stderr, "%-14s %-40s %9s %9s %11s %10s\n", "", "mix", "messages", "ns/msg", "allocs/msg", "instr/msg");
+    for (size_t i = 0; i < comms_case_count; i++)
+    {
+        const comms_case_t *c = &comms_cases[i];
+
+        if (only && only != c)
+            continue;
+        result_t r = run_case(c, messages, counter);
+        fprintf(stderr, "%-14s %-40s %9ld %9.1f %11.2f ", c->name, c->mix, r.messages, r.ns, r.allocs);
+        if (r.instructions < 0)
+            fprintf(stderr, "%10s\n", "-");
+        else
+            fprintf(stderr, "%10.0f\n", r.instructions);
+    }
+    if (counter < 0)
+        fprintf(stderr, "\ninstruction counter not available here (perf_event_paranoid, or a VM without a PMU)\n");
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,133 @@
+/**
+ * @file bench_dispatch.c
+ * @brief Messages/second of the command parser: the old strtok/strcmp chain vs parse_command()
+ *
+ *     ./bench_dispatch [iterations]
+ *
+ * Both sides only parse (no printf/set_PWM), so the numbers are the cost of
+ * getting from a received line to a typed command. The old parser needs a
+ * fresh copy of the line each time because strtok() writes into it; that copy
+ * is part of what the table-driven parser removes, so it is counted.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "commands.h"
+
+static const char *message_mix[] = {
+    "$MTR 1 50 0 25\n",
+    "$MTR 0 100 1 100\n",
+    "$ACK 42\n",
+    "$CMD forward 10\n",
+    "$MTR 1 75 1 75\n",
+    "$REQ STATS\n",
+    "$TXR hello ground station\n",
+    "$MTR 0 0 0 0\n",
+};
+
+#define MIX_SIZE (sizeof(message_mix) / sizeof(message_mix[0]))
+
+// the parsing half of handle_input() before the dispatch table
+static int legacy_parse(char *in, command_t *cmd)
+{
+    char *delim = " ";
+    char *token = strtok(in, delim);
+
+    if (strcmp(token, "$ACK") == 0)
+    {
+        cmd->tag = MSG_ACK;
+        token = strtok(NULL, delim);
+        cmd->ack.seq = atoi(token);
+        return EXIT_SUCCESS;
+    }
+    else if (strcmp(token, "$CMD") == 0)
+    {
+        cmd->tag = MSG_CMD;
+        token = strtok(NULL, "");
+        cmd->text.text = token;
+        cmd->text.len = strlen(token);
+        return EXIT_SUCCESS;
+    }
+    else if (strcmp(token, "$MTR") == 0)
+    {
+        cmd->tag = MSG_MOTORS;
+        cmd->mtr.velocity = false;
+        token = strtok(NULL, delim);
+        cmd->mtr.dir1 = (strcmp(token, "0") != 0);
+        token = strtok(NULL, delim);
+        cmd->mtr.pwm1 = atoi(token);
+        token = strtok(NULL, delim);
+        cmd->mtr.dir2 = (strcmp(token, "0") != 0);
+        token = strtok(NULL, delim);
+        cmd->mtr.pwm2 = atoi(token);
+        return EXIT_SUCCESS;
+    }
+    else if (strcmp(token, "$REQ") == 0)
+    {
+        cmd->tag = MSG_REQ;
+        return EXIT_SUCCESS;
+    }
+    else if (strcmp(token, "$TXR") == 0)
+    {
+        cmd->tag = MSG_TX;
+        return EXIT_SUCCESS;
+    }
+
+    return EXIT_FAILURE;
+}
+
+static volatile uint32_t sink;
+
+static double run_legacy(long iterations)
+{
+    char in[255];
+    command_t cmd;
+
+    absolute_time_t start = get_absolute_time();
+    for (long i = 0; i < iterations; i++)
+    {
+        strcpy(in, message_mix[i % MIX_SIZE]);
+        if (!legacy_parse(in, &cmd))
+            sink += cmd.tag;
+    }
+    return (double)iterations * 1e6 / (double)absolute_time_diff_us(start, get_absolute_time());
+}
+
+static double run_table(long iterations)
+{
+    command_t cmd;
+
+    absolute_time_t start = get_absolute_time();
+    for (long i = 0; i < iterations; i++)
+    {
+        if (!parse_command(message_mix[i % MIX_SIZE], &cmd))
+            sink += cmd.tag;
+    }
+    return (double)iterations * 1e6 / (double)absolute_time_diff_us(start, get_absolute_time());
+}
+
+int main(int argc, char **argv)
+{
+    long iterations = argc > 1 ? atol(argv[1]) : 5000000;
+
+    // warm up caches and the branch predictor on both paths
+    run_legacy(iterations / 10);
+    run_table(iterations / 10);
+
+    double before = run_legacy(iterations);
+    double after = run_table(iterations);
+
+    printf("strtok/strcmp chain: %12.0f messages/s\n", before);
+    printf("dispatch table:      %12.0f messages/s (%.2fx)\n", after, after / before);
+
+    return EXIT_SUCCESS;
+}
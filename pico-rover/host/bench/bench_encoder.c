@@ -0,0 +1,261 @@
+/**
+ * @file bench_encoder.c
+ * @brief Quadrature decoder and M/T velocity estimator over synthetic edge streams
+ *
+ *     ./bench_encoder [seconds per speed]
+ *
+ * Edge streams are generated on a simulated clock, so the check runs as fast as
+ * the host can and is repeatable: for each wheel speed from 1 RPM to past
+ * WHEEL_MAX_RPM, in both directions, a quadrature signal with an unevenly
+ * spaced A/B phase (as real encoder discs are) and per-edge jitter is fed
+ * through encoder_edge() while encoder_update() runs every CORE0_TICK_MS. The
+ * count must be exact and the estimate must track the true speed. The stream
+ * starts just before time_us_32() wraps. Then the wheel stops and the estimate
+ * must reach 0 within ENC_STOP_US; bounces and a missed edge are checked too.
+ * Last, the interrupt cost: ns per edge for encoder_edge() and for the whole
+ * GPIO callback path, against the budget for 1% of a core with both wheels at
+ * WHEEL_MAX_RPM.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pico/stdlib.h"
+#include "host_hal.h"
+#include "encoder.h"
+#include "motors.h"
+#define BENCH_CHECK_OUT stdout
+#include "bench_check.h"
+
+#define TICK_US             20000       // CORE0_TICK_MS
+#define SETTLE_US           200000      // estimates before this, or before the first whole line, are not scored
+#define PHASE_ERROR         0.15        // A/B edges up to 15% off their ideal quarter-period spacing
+#define JITTER_US           3.0
+#define TIMING_EDGES        20000000L
+#define CALLBACK_EDGES      2000000L
+#define ISR_BUDGET          0.01        // share of a core for both wheels' edges at WHEEL_MAX_RPM
+#define RP2040_SLOWDOWN     40          // assumed cost of the same code on a 125 MHz Cortex-M0+ vs this host
+
+static const uint8_t gray[4] = { 0, 2, 3, 1 };      // A/B levels forward: A leads B
+static const double phase[4] = { +PHASE_ERROR, -PHASE_ERROR, +PHASE_ERROR / 2, -PHASE_ERROR / 2 };
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint32_t pins_for(const encoder_t *e, uint8_t state)
+{
+    return (uint32_t)(state >> 1) << e->pin_a | (uint32_t)(state & 1) << e->pin_b;
+}
+
+static double rpm_of(const encoder_t *e)
+{
+    return e->velocity * (60.0 / (1 << ENC_VEL_SHIFT)) / ENC_COUNTS_PER_REV;
+}
+
+typedef struct run
+{
+    double mean_err;                    // of the scored estimates, relative
+    double max_err;
+    bool exact;                         // count matches the edges fed
+    double stop_ms;                     // from the last edge to a 0 estimate
+} run_t;
+
+/**
+ * @brief Drives one encoder at a constant speed for a while, then stops it
+ */
+static run_t run_speed(double rpm, double seconds, uint32_t t0)
+{
+    encoder_t e;
+    run_t r = {0};
+    double counts_per_s = fabs(rpm) * ENC_COUNTS_PER_REV / 60.0;
+    double period_us = 1e6 / counts_per_s;
+    int dir = rpm < 0 ? -1 : 1;
+    double end_us = seconds * 1e6;
+    double edge_us = 0, tick_us = TICK_US;
+    double settle_us = fmax(SETTLE_US, 4 * period_us + TICK_US);
+    double err_sum = 0;
+    long scored = 0, edges = 0;
+    int pos = 0;
+
+    encoder_init(&e, ENC_RIGHT_A_PIN, ENC_RIGHT_B_PIN, 0);
+
+    for (;;)
+    {
+        // each edge lands at its ideal time, moved by the disc's phase error and some jitter
+        int next = (pos + dir) & 3;
+        double at = (edges + 1) * period_us + phase[next] * period_us + ((rand() / (double)RAND_MAX) * 2 - 1) * JITTER_US;
+
+        while (tick_us <= at && tick_us <= end_us)
+        {
+            encoder_update(&e, t0 + (uint32_t)tick_us);
+            if (tick_us >= settle_us)
+            {
+                double err = fabs(rpm_of(&e) - rpm) / fabs(rpm);
+                err_sum += err;
+                scored++;
+                if (err > r.max_err)
+                    r.max_err = err;
+            }
+            tick_us += TICK_US;
+        }
+        if (at > end_us)
+            break;
+
+        pos = next;
+        encoder_edge(&e, pins_for(&e, gray[pos]), t0 + (uint32_t)at);
+        edge_us = at;
+        edges++;
+    }
+
+    int32_t count;
+    uint32_t last;
+    encoder_read(&e, &count, &last);
+    r.exact = count == dir * edges && e.errors == 0;
+    r.mean_err = scored ? err_sum / scored : 1;
+
+    // stopped: the estimate has to fall to 0 on its own
+    r.stop_ms = -1;
+    for (; tick_us < end_us + 2 * ENC_STOP_US; tick_us += TICK_US)
+    {
+        encoder_update(&e, t0 + (uint32_t)tick_us);
+        if (e.velocity == 0)
+        {
+            r.stop_ms = (tick_us - edge_us) / 1000;
+            break;
+        }
+    }
+    return r;
+}
+
+/**
+ * @brief Bounces, a missed edge and reversal through the decoder
+ */
+static void check_decoder(void)
+{
+    encoder_t e;
+    int32_t count;
+    uint32_t edge_us;
+
+    encoder_init(&e, ENC_RIGHT_A_PIN, ENC_RIGHT_B_PIN, 0);
+
+    // a bounce on A: up and down again before B moves
+    encoder_edge(&e, pins_for(&e, 2), 10);
+    encoder_edge(&e, pins_for(&e, 0), 11);
+    encoder_edge(&e, pins_for(&e, 2), 12);
+    encoder_read(&e, &count, &edge_us);
+    check(count == 1 && e.errors == 0, "bounce on one channel nets out");
+
+    // 10 -> 01: both changed, an edge was missed
+    encoder_edge(&e, pins_for(&e, 1), 13);
+    encoder_read(&e, &count, &edge_us);
+    check(count == 1 && e.errors == 1 && edge_us == 12, "skipped state counted as an error, not a step");
+
+    // forward a whole cycle, then back two
+    encoder_init(&e, ENC_RIGHT_A_PIN, ENC_RIGHT_B_PIN, 0);
+    for (int i = 1; i <= 4; i++)
+        encoder_edge(&e, pins_for(&e, gray[i & 3]), (uint32_t)i);
+    encoder_edge(&e, pins_for(&e, gray[3]), 5);
+    encoder_edge(&e, pins_for(&e, gray[2]), 6);
+    encoder_read(&e, &count, &edge_us);
+    check(count == 2 && e.errors == 0, "forward 4, reverse 2");
+}
+
+/**
+ * @brief Host cost of encoder_edge() alone and of the GPIO callback path
+ */
+static void check_isr_cost(void)
+{
+    encoder_t e;
+    uint32_t pins[4];
+    double t, edge_ns, callback_ns;
+
+    encoder_init(&e, ENC_RIGHT_A_PIN, ENC_RIGHT_B_PIN, 0);
+    for (int i = 0; i < 4; i++)
+        pins[i] = pins_for(&e, gray[i]);
+
+    t = now_s();
+    for (long i = 1; i <= TIMING_EDGES; i++)
+        encoder_edge(&e, pins[i & 3], (uint32_t)i);
+    edge_ns = (now_s() - t) * 1e9 / TIMING_EDGES;
+    check(e.count == TIMING_EDGES, "timed stream counted exactly");
+
+    // the firmware path: GPIO interrupt -> enc_callback() -> gpio_get_all() + time_us_32()
+    configure_encoders();
+    t = now_s();
+    for (long i = 1; i <= CALLBACK_EDGES; i++)
+    {
+        uint8_t s = gray[i & 3];
+        if ((s >> 1) != gpio_get(ENC_LEFT_A_PIN))
+            host_gpio_set_in(ENC_LEFT_A_PIN, s >> 1);
+        else
+            host_gpio_set_in(ENC_LEFT_B_PIN, s & 1);
+    }
+    callback_ns = (now_s() - t) * 1e9 / CALLBACK_EDGES;
+
+    double edges_per_s = 2.0 * WHEEL_MAX_RPM * ENC_COUNTS_PER_REV / 60;
+    double budget_ns = ISR_BUDGET * 1e9 / edges_per_s;
+
+    printf("\n%-36s %10s\n", "", "ns/edge");
+    printf("%-36s %10.1f\n", "encoder_edge()", edge_ns);
+    printf("%-36s %10.1f\n", "GPIO callback path (host shim)", callback_ns);
+    printf("both wheels at %d RPM: %.0f edges/s, %.0f ns/edge for %.0f%% of a core\n", WHEEL_MAX_RPM, edges_per_s,
+           budget_ns, ISR_BUDGET * 100);
+    printf("encoder_edge() x%d for the RP2040: %.0f ns/edge, %.3f%% of a core\n", RP2040_SLOWDOWN,
+           edge_ns * RP2040_SLOWDOWN, edge_ns * RP2040_SLOWDOWN * edges_per_s / 1e7);
+    check(edge_ns * RP2040_SLOWDOWN < budget_ns, "ISR within budget at twice WHEEL_MAX_RPM edges");
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = argc > 1 ? atof(argv[1]) : 3;
+    static const double speeds[] = { 1, 5, 10, 30, 60, 120, 200, WHEEL_MAX_RPM, WHEEL_MAX_RPM * 1.5 };
+    bool exact = true, tracked = true, stopped = true, low = true;
+
+    srand(1);
+    printf("%d counts/rev, update every %d ms, phase error %.0f%%, jitter %.0f us\n", ENC_COUNTS_PER_REV,
+           TICK_US / 1000, PHASE_ERROR * 100, JITTER_US);
+    printf("%8s %10s %12s %12s %10s\n", "RPM", "edges/s", "mean err %", "max err %", "stop ms");
+
+    for (size_t i = 0; i < sizeof(speeds) / sizeof(speeds[0]); i++)
+    {
+        for (int dir = 1; dir >= -1; dir -= 2)
+        {
+            double rpm = dir * speeds[i];
+            // 1 s before time_us_32() wraps
+            run_t r = run_speed(rpm, seconds, UINT32_MAX - 1000000u);
+
+            printf("%8.0f %10.0f %12.2f %12.2f %10.1f\n", rpm, fabs(rpm) * ENC_COUNTS_PER_REV / 60, r.mean_err * 100,
+                   r.max_err * 100, r.stop_ms);
+            exact &= r.exact;
+            stopped &= r.stop_ms >= 0 && r.stop_ms <= (ENC_STOP_US + TICK_US) / 1000.0;
+            // below 4 counts per update the estimate is a line period, up to a tick old
+            if (speeds[i] * ENC_COUNTS_PER_REV / 60 * TICK_US / 1e6 >= 4)
+                tracked &= r.mean_err < 0.01 && r.max_err < 0.05;
+            else
+                low &= r.mean_err < 0.01 && r.max_err < PHASE_ERROR;
+        }
+    }
+
+    printf("\n");
+    check(exact, "counts exact in both directions, across the wrap");
+    check(tracked, "4+ edges per update: mean error < 1%, max < 5%");
+    check(low, "fewer: mean error < 1%, max within the disc's phase error");
+    check(stopped, "estimate 0 within ENC_STOP_US of the last edge");
+    check_decoder();
+    check_isr_cost();
+
+    return check_summary();
+}
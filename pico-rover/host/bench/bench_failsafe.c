@@ -0,0 +1,173 @@
+/**
+ * @file bench_failsafe.c
+ * @brief Command timeout failsafe: time from the last $MTR until both wheels are at 0
+ *
+ *     ./bench_failsafe > /dev/null
+ *
+ * The firmware's main() runs against the host HAL. For each command timeout and
+ * both motor modes, one $MTR goes in on USB stdin and then nothing more; the PWM
+ * levels are sampled every millisecond. The wheels must hold until the timeout,
+ * ramp down over several levels rather than cut out, and be at 0 within
+ * timeout + MOTOR_STOP_RAMP_MS + 2 control periods of the command. A stream of
+ * commands faster than the timeout must keep them going, and the control loop
+ * must have fed the watchdog on time throughout. Firmware output goes to
+ * stdout, results go to stderr.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "host_hal.h"
+#include "motors.h"
+#include "bench_check.h"
+
+#define BOOT_MS             2500        // main() sleeps 2 s before it starts
+#define SLACK_MS            20          // USB line to set_PWM(), and host scheduling
+#define MIN_RAMP_LEVELS     10
+#define KEEPALIVE_ROUNDS    6
+
+int rover_main(void);
+
+static void send_line(const char *line)
+{
+    host_stdin_push(line, strlen(line));
+}
+
+static uint16_t peak_level(void)
+{
+    uint16_t left = host_pwm_get_gpio_level(PWM_1_PIN);
+    uint16_t right = host_pwm_get_gpio_level(PWM_2_PIN);
+
+    return left > right ? left : right;
+}
+
+typedef struct stop
+{
+    double ramp_ms;                     // from the command to the first lower level
+    double stop_ms;                     // from the command to both at 0
+    int levels;                         // distinct peak levels seen on the way down
+} stop_t;
+
+/**
+ * @brief Sends one command, goes quiet, and times the wheels coming to a stop
+ */
+static stop_t time_stop(const char *line, uint timeout_ms)
+{
+    stop_t s = { -1, -1, 0 };
+    uint16_t last = 0;
+
+    absolute_time_t sent = get_absolute_time();
+    send_line(line);
+    absolute_time_t end = delayed_by_ms(sent, timeout_ms + MOTOR_STOP_RAMP_MS + 500);
+
+    // the first levels written: the PID winds up towards PWM_WRAP with nothing turning the encoders
+    while (!time_reached(end) && !(last = peak_level()))
+        sleep_us(200);
+
+    while (!time_reached(end))
+    {
+        uint16_t level = peak_level();
+        double ms = absolute_time_diff_us(sent, get_absolute_time()) / 1000.0;
+
+        if (level < last)
+        {
+            if (s.ramp_ms < 0)
+                s.ramp_ms = ms;
+            s.levels++;
+        }
+        if (level > last && s.ramp_ms >= 0)
+            s.levels = -1000;           // went back up during the ramp
+        last = level;
+        if (!level)
+        {
+            s.stop_ms = ms;
+            break;
+        }
+        sleep_us(1000);
+    }
+    return s;
+}
+
+static void *core0(void *arg)
+{
+    rover_main();
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    static const uint timeouts[] = { 200, MOTOR_CMD_TIMEOUT_MS, 1000 };
+    static const char *const commands[] = { "$MTR 1 80 0 60\n", "$MTR V 200 -150\n" };
+    static const char *const modes[] = { "PWM", "velocity" };
+    double period_ms = 1000.0 / MOTOR_CTL_HZ;
+    motor_ctl_stats_t stats;
+    pthread_t thread;
+    char line[32];
+    int runs = 0;
+    bool held = true, bounded = true, gradual = true;
+
+    pthread_create(&thread, NULL, core0, NULL);
+    sleep_ms(BOOT_MS);
+    get_motor_ctl_stats(&stats);
+
+    fprintf(stderr, "control loop %d Hz, ramp %d ms, bound = timeout + ramp + 2 periods + %d ms slack\n",
+            MOTOR_CTL_HZ, MOTOR_STOP_RAMP_MS, SLACK_MS);
+    fprintf(stderr, "%10s %10s %10s %10s %10s %8s\n", "mode", "timeout", "ramp ms", "stop ms", "bound ms", "levels");
+
+    for (size_t t = 0; t < sizeof(timeouts) / sizeof(timeouts[0]); t++)
+    {
+        snprintf(line, sizeof(line), "$REQ WDT %u\n", timeouts[t]);
+        send_line(line);
+        sleep_ms(20);
+
+        for (size_t m = 0; m < sizeof(commands) / sizeof(commands[0]); m++)
+        {
+            stop_t s = time_stop(commands[m], timeouts[t]);
+            double bound = timeouts[t] + MOTOR_STOP_RAMP_MS + 2 * period_ms + SLACK_MS;
+
+            fprintf(stderr, "%10s %10u %10.1f %10.1f %10.1f %8d\n", modes[m], timeouts[t], s.ramp_ms, s.stop_ms,
+                    bound, s.levels);
+            held &= s.ramp_ms >= timeouts[t];
+            bounded &= s.stop_ms >= 0 && s.stop_ms <= bound;
+            gradual &= s.levels >= MIN_RAMP_LEVELS;
+            runs++;
+        }
+    }
+    fprintf(stderr, "\n");
+    check(held, "wheels held until the timeout");
+    check(bounded, "both at 0 within timeout + ramp + 2 periods");
+    check(gradual, "ramped down, never back up on the way");
+
+    // commands at half the timeout: the failsafe must never start
+    bool kept = true;
+    for (int i = 0; i < KEEPALIVE_ROUNDS; i++)
+    {
+        send_line(commands[0]);
+        for (int ms = 0; ms < 500; ms++)
+        {
+            kept &= !i || peak_level() == 80 * (PWM_WRAP / 100);
+            sleep_ms(1);
+        }
+    }
+    check(kept, "commands faster than the timeout keep the wheels going");
+    sleep_ms(1000 + MOTOR_STOP_RAMP_MS + 50);
+    check(!peak_level(), "and they stop once the commands do");
+    runs++;
+
+    get_motor_ctl_stats(&stats);
+    fprintf(stderr, "failsafes %lu, watchdog resets %lu\n", (unsigned long)stats.failsafes,
+            (unsigned long)host_watchdog_resets());
+    check(stats.failsafes == (uint32_t)runs, "each silence counted once as a failsafe");
+    check(!host_watchdog_resets(), "control loop fed the watchdog within MOTOR_WATCHDOG_MS");
+
+    return check_summary();
+}
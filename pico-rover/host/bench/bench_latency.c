@@ -0,0 +1,104 @@
+/**
+ * @file bench_latency.c
+ * @brief Command-in to PWM-update latency of the core 0 main loop
+ *
+ *     ./bench_latency [commands] > /dev/null
+ *
+ * Runs the firmware's main() on its own thread against the host HAL, sends
+ * "$MTR" lines on USB stdin at random moments and times each one until
+ * set_PWM() writes the new levels. Also reports how much CPU the core 0 thread
+ * used meanwhile. Firmware output goes to stdout, results go to stderr.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pico/stdlib.h"
+#include "hardware/pwm.h"
+#include "host_hal.h"
+#include "motors.h"
+
+#define BOOT_MS         2500        // main() sleeps 2 s before it starts
+#define GAP_MAX_US      40000       // commands arrive at random within this
+#define TIMEOUT_US      1000000
+
+int rover_main(void);
+
+static void *core0(void *arg)
+{
+    rover_main();
+    return NULL;
+}
+
+static double thread_cpu_s(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int by_value(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv)
+{
+    long n = argc > 1 ? atol(argv[1]) : 500;
+    uint32_t *latency = malloc(sizeof(latency[0]) * n);
+    uint slice = pwm_gpio_to_slice_num(PWM_1_PIN);
+    pthread_t thread;
+    clockid_t clock;
+    char line[32];
+    long lost = 0;
+
+    pthread_create(&thread, NULL, core0, NULL);
+    pthread_getcpuclockid(thread, &clock);
+    sleep_ms(BOOT_MS);
+    srand(3);
+
+    double cpu = thread_cpu_s(clock);
+    absolute_time_t start = get_absolute_time();
+    for (long i = 0; i < n; i++)
+    {
+        uint32_t writes = host_pwm_get_slice(slice).writes;
+
+        sleep_us(rand() % GAP_MAX_US);
+        // a different level every time so every command shows up as a write
+        snprintf(line, sizeof(line), "$MTR 1 %ld 0 %ld\n", 1 + i % 99, 99 - i % 99);
+        absolute_time_t sent = get_absolute_time();
+        host_stdin_push(line, strlen(line));
+
+        while (host_pwm_get_slice(slice).writes == writes && absolute_time_diff_us(sent, get_absolute_time()) < TIMEOUT_US)
+            sleep_us(20);
+        host_pwm_slice_t s = host_pwm_get_slice(slice);
+        if (s.writes == writes)
+        {
+            lost++;
+            latency[i] = TIMEOUT_US;
+            continue;
+        }
+        latency[i] = (uint32_t)absolute_time_diff_us(sent, s.updated);
+    }
+    double wall = absolute_time_diff_us(start, get_absolute_time()) / 1e6;
+    cpu = thread_cpu_s(clock) - cpu;
+
+    qsort(latency, n, sizeof(latency[0]), by_value);
+    fprintf(stderr, "$MTR -> PWM: %ld commands, p50 %u us, p99 %u us, max %u us, %ld lost\n", n,
+            latency[n / 2], latency[n * 99 / 100], latency[n - 1], lost);
+    fprintf(stderr, "core 0 CPU: %.2f%% of %.1f s\n", cpu / wall * 100, wall);
+
+    free(latency);
+    // main() never returns
+    exit(EXIT_SUCCESS);
+}
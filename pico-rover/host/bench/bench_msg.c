@@ -0,0 +1,225 @@
+/**
+ * @file bench_msg.c
+ * @brief Inter-core messaging: queue_t copies of LORA_SIZE items vs the zero-copy msgring channel
+ *
+ *     ./bench_msg [messages]
+ *
+ * A producer thread formats a ~50 B telemetry line per message and a consumer
+ * thread takes it and reads it, as core 0 and core 1 do; a side that finds
+ * the queue full/empty yields, so this also runs on a single host CPU. queue_t is the host
+ * stand-in (mutex-backed rather than the SDK's spinlock), so its absolute cost
+ * differs from the RP2040's; see pico-rover/bench/msg_cycles.c for cycle counts on target.
+ * Reports messages/s end to end and the latency of each successful enqueue
+ * (queue_try_add vs msg_alloc + write + msg_send).
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pico/stdlib.h"
+#include "pico/util/queue.h"
+#include "comms.h"
+#include "msgring.h"
+
+typedef struct result
+{
+    double rate;            // messages/s
+    double mean_ns;         // enqueue latency
+    uint32_t p99_ns;
+    uint32_t max_ns;
+    uint64_t checksum;      // consumer's view of the data, to check both paths moved the same bytes
+} result_t;
+
+static long messages;
+static uint32_t *latency;
+static queue_t queue;
+static msg_channel_t channel;
+static volatile uint64_t checksum;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static int format(char *out, long i)
+{
+    return snprintf(out, LORA_SIZE, "$FIX 286024274 %ld 1 9 110 %ld 0 %ld", -812000599 - i % 777, i % 200, i);
+}
+
+static void *queue_consumer(void *arg)
+{
+    char item[LORA_SIZE];
+    uint64_t sum = 0;
+
+    for (long i = 0; i < messages; i++)
+    {
+        while (!queue_try_remove(&queue, item))
+            sched_yield();
+        sum += (uint8_t)item[16] + strlen(item);
+    }
+    checksum = sum;
+    return NULL;
+}
+
+static void *channel_consumer(void *arg)
+{
+    uint64_t sum = 0;
+    size_t len;
+    char *item;
+
+    for (long i = 0; i < messages; i++)
+    {
+        while (!(item = msg_receive(&channel, &len)))
+            sched_yield();
+        sum += (uint8_t)item[16] + len;
+        msg_release(&channel, item);
+    }
+    checksum = sum;
+    return NULL;
+}
+
+static int by_value(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static result_t summarize(uint64_t elapsed)
+{
+    result_t r = { .rate = messages * 1e9 / elapsed, .checksum = checksum };
+    double sum = 0;
+
+    for (long i = 0; i < messages; i++)
+    {
+        sum += latency[i];
+        if (latency[i] > r.max_ns)
+            r.max_ns = latency[i];
+    }
+    r.mean_ns = sum / messages;
+    qsort(latency, messages, sizeof(latency[0]), by_value);
+    r.p99_ns = latency[messages * 99 / 100];
+    return r;
+}
+
+static result_t run_queue(void)
+{
+    pthread_t consumer;
+    char item[LORA_SIZE];
+
+    // the depth core 0 and core 1 used
+    queue_init(&queue, LORA_SIZE, 5);
+    pthread_create(&consumer, NULL, queue_consumer, NULL);
+
+    uint64_t start = now_ns();
+    for (long i = 0; i < messages; i++)
+    {
+        uint64_t t;
+        while (t = now_ns(), format(item, i), !queue_try_add(&queue, item))
+            sched_yield();
+        latency[i] = (uint32_t)(now_ns() - t);
+    }
+    pthread_join(consumer, NULL);
+    uint64_t elapsed = now_ns() - start;
+
+    queue_free(&queue);
+    return summarize(elapsed);
+}
+
+static result_t run_channel(void)
+{
+    pthread_t consumer;
+    char *item;
+
+    msg_channel_init(&channel);
+    pthread_create(&consumer, NULL, channel_consumer, NULL);
+
+    uint64_t start = now_ns();
+    for (long i = 0; i < messages; i++)
+    {
+        uint64_t t;
+        while (t = now_ns(), !(item = msg_alloc(&channel)))
+            sched_yield();
+        msg_send(&channel, item, format(item, i));
+        latency[i] = (uint32_t)(now_ns() - t);
+    }
+    pthread_join(consumer, NULL);
+    uint64_t elapsed = now_ns() - start;
+
+    return summarize(elapsed);
+}
+
+// one thread, no contention: the handoff itself, item already formatted
+static void uncontended(long n)
+{
+    char item[LORA_SIZE];
+    char out[LORA_SIZE];
+    char *buf;
+    size_t len;
+    uint64_t sum = 0;
+
+    queue_init(&queue, LORA_SIZE, 5);
+    format(item, 0);
+    uint64_t start = now_ns();
+    for (long i = 0; i < n; i++)
+    {
+        queue_try_add(&queue, item);
+        queue_try_remove(&queue, out);
+        sum += (uint8_t)out[i & 15];
+    }
+    double queue_ns = (double)(now_ns() - start) / n;
+    queue_free(&queue);
+
+    msg_channel_init(&channel);
+    start = now_ns();
+    for (long i = 0; i < n; i++)
+    {
+        buf = msg_alloc(&channel);
+        buf[i & 15] = item[i & 15];
+        msg_send(&channel, buf, 50);
+        buf = msg_receive(&channel, &len);
+        sum += (uint8_t)buf[i & 15];
+        msg_release(&channel, buf);
+    }
+    double channel_ns = (double)(now_ns() - start) / n;
+
+    checksum = sum;
+    printf("uncontended handoff: queue_t add+remove %.1f ns, msgring alloc+send+receive+release %.1f ns\n\n",
+           queue_ns, channel_ns);
+}
+
+static void report(const char *what, result_t r)
+{
+    printf("%-28s %12.0f msg/s %8.1f ns mean %7u ns p99 %9u ns max  (checksum %llu)\n", what, r.rate, r.mean_ns,
+           r.p99_ns, r.max_ns, (unsigned long long)r.checksum);
+}
+
+int main(int argc, char **argv)
+{
+    messages = argc > 1 ? atol(argv[1]) : 2000000;
+    latency = malloc(sizeof(latency[0]) * messages);
+    if (!latency)
+        return EXIT_FAILURE;
+
+    printf("%ld messages, producer and consumer on separate threads\n", messages);
+    uncontended(messages);
+    printf("enqueue = format + queue_try_add / msg_alloc + format in place + msg_send\n");
+    report("queue_t, 5 x 240 B copies", run_queue());
+    char what[32];
+    snprintf(what, sizeof(what), "msgring, %d x 240 B pool", MSG_POOL_SIZE);
+    report(what, run_channel());
+
+    free(latency);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,213 @@
+/**
+ * @file bench_mtrbox.c
+ * @brief Latest-wins motor command mailbox: coalescing, staleness, source priority, torn reads
+ *
+ *     ./bench_mtrbox > /dev/null
+ *
+ * First the mailbox on its own: a burst from one source applies once, an old
+ * command is dropped, the ground station shuts the SBC out for MTRBOX_HOLD_MS,
+ * every posted command is accounted for exactly once, and one posted after
+ * the caller read the clock is not taken for stale. Then a writer thread
+ * posts as fast as it can while the main thread takes, checking that no command
+ * is ever torn or older than one already applied. Last, the firmware's main()
+ * runs against the host HAL and gets a burst of $MTR lines on USB stdin in
+ * one go: the motors must end on the last one after far fewer PWM updates.
+ * Firmware output goes to stdout, results go to stderr.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "hardware/pwm.h"
+#include "host_hal.h"
+#include "motors.h"
+#include "mtrbox.h"
+#include "bench_check.h"
+
+#define BURST               100
+#define RACE_MS             1000
+#define BOOT_MS             2500        // main() sleeps 2 s before it starts
+
+int rover_main(void);
+
+static mtr_cmd_t velocity(int rpm)
+{
+    return (mtr_cmd_t){ .velocity = true, .rpm1 = (int16_t)rpm, .rpm2 = (int16_t)-rpm };
+}
+
+// every command posted is applied, coalesced, stale or preempted, once
+static bool balanced(const mtrbox_t *box)
+{
+    mtrbox_stats_t s;
+
+    for (int src = 0; src < MTR_SOURCES; src++)
+    {
+        mtrbox_get_stats(box, (MTR_SOURCE)src, &s);
+        if (s.posted != s.applied + s.coalesced + s.stale + s.preempted)
+            return false;
+    }
+    return true;
+}
+
+static void check_rules(void)
+{
+    mtrbox_t box;
+    mtrbox_stats_t usb, lora;
+    mtr_cmd_t cmd, got;
+    MTR_SOURCE src;
+
+    mtrbox_init(&box);
+    for (int i = 1; i <= BURST; i++)
+    {
+        cmd = velocity(i);
+        mtrbox_post(&box, MTR_SOURCE_USB, &cmd);
+    }
+    check(mtrbox_take(&box, time_us_32(), &got, &src) && got.rpm1 == BURST && src == MTR_SOURCE_USB,
+          "burst of 100 applies the last one");
+    check(!mtrbox_take(&box, time_us_32(), &got, &src), "and nothing after it");
+    mtrbox_get_stats(&box, MTR_SOURCE_USB, &usb);
+    check(usb.applied == 1 && usb.coalesced == BURST - 1, "99 counted as coalesced");
+
+    cmd = velocity(7);
+    mtrbox_post(&box, MTR_SOURCE_USB, &cmd);
+    sleep_ms(MTRBOX_STALE_MS + 20);
+    check(!mtrbox_take(&box, time_us_32(), &got, &src), "command older than MTRBOX_STALE_MS dropped");
+    mtrbox_get_stats(&box, MTR_SOURCE_USB, &usb);
+    check(usb.stale == 1, "counted as stale");
+
+    // both in one pass: the ground station wins
+    cmd = velocity(30);
+    mtrbox_post(&box, MTR_SOURCE_LORA, &cmd);
+    cmd = velocity(40);
+    mtrbox_post(&box, MTR_SOURCE_USB, &cmd);
+    check(mtrbox_take(&box, time_us_32(), &got, &src) && src == MTR_SOURCE_LORA && got.rpm1 == 30,
+          "ground station outranks the SBC in the same pass");
+    mtrbox_post(&box, MTR_SOURCE_USB, &cmd);
+    check(!mtrbox_take(&box, time_us_32(), &got, &src), "SBC shut out within MTRBOX_HOLD_MS");
+    mtrbox_get_stats(&box, MTR_SOURCE_USB, &usb);
+    check(usb.preempted == 2, "both counted as preempted");
+
+    sleep_ms(MTRBOX_HOLD_MS + 20);
+    mtrbox_post(&box, MTR_SOURCE_USB, &cmd);
+    check(mtrbox_take(&box, time_us_32(), &got, &src) && src == MTR_SOURCE_USB, "SBC back in control after it");
+    mtrbox_get_stats(&box, MTR_SOURCE_LORA, &lora);
+    check(lora.applied == 1 && balanced(&box), "every posted command accounted for once");
+
+    // the clock read before core 1 posts, as apply_motor_commands() can
+    uint32_t now = time_us_32();
+    sleep_ms(1);
+    cmd = velocity(50);
+    mtrbox_post(&box, MTR_SOURCE_LORA, &cmd);
+    check(mtrbox_take(&box, now, &got, &src) && src == MTR_SOURCE_LORA && got.rpm1 == 50,
+          "command posted after now_us applied, not stale");
+}
+
+static mtrbox_t race_box;
+static volatile bool racing;
+static volatile long race_posts;
+
+// core 1 posting ground station commands flat out
+static void *writer(void *arg)
+{
+    mtr_cmd_t cmd;
+
+    for (int i = 1; racing; i++)
+    {
+        cmd = velocity(i & 0x7fff);
+        cmd.pwm1 = (int8_t)(i & 0x7f);
+        mtrbox_post(&race_box, MTR_SOURCE_LORA, &cmd);
+        race_posts++;
+        if (!(i & 63))
+            sched_yield();
+    }
+    return NULL;
+}
+
+static void check_race(void)
+{
+    pthread_t thread;
+    mtr_cmd_t got;
+    MTR_SOURCE src;
+    long takes = 0, torn = 0, backwards = 0;
+    int last = 0;
+
+    mtrbox_init(&race_box);
+    racing = true;
+    pthread_create(&thread, NULL, writer, NULL);
+
+    absolute_time_t end = make_timeout_time_ms(RACE_MS);
+    while (!time_reached(end))
+    {
+        if (!mtrbox_take(&race_box, time_us_32(), &got, &src))
+        {
+            sched_yield();
+            continue;
+        }
+        takes++;
+        torn += got.rpm2 != -got.rpm1 || got.pwm1 != (got.rpm1 & 0x7f);
+        // rpm1 counts posts modulo 2^15
+        int ahead = (got.rpm1 - last) & 0x7fff;
+        backwards += ahead == 0 || ahead > 0x4000;
+        last = got.rpm1;
+    }
+    racing = false;
+    pthread_join(thread, NULL);
+    mtrbox_take(&race_box, time_us_32(), &got, &src);
+
+    fprintf(stderr, "\nwriter and taker racing for %d ms: %ld posts, %ld applied\n", RACE_MS, race_posts, takes);
+    check(!torn, "no torn command");
+    check(!backwards, "never older than one already applied");
+    check(balanced(&race_box), "every posted command accounted for once");
+}
+
+static void *core0(void *arg)
+{
+    rover_main();
+    return NULL;
+}
+
+static void check_firmware(void)
+{
+    pthread_t thread;
+    char burst[BURST * 24];
+    size_t len = 0;
+    mtrbox_stats_t usb;
+    uint slice = pwm_gpio_to_slice_num(PWM_1_PIN);
+
+    pthread_create(&thread, NULL, core0, NULL);
+    sleep_ms(BOOT_MS);
+
+    uint32_t writes = host_pwm_get_slice(slice).writes;
+    for (int i = 1; i <= BURST; i++)
+        len += (size_t)snprintf(burst + len, sizeof(burst) - len, "$MTR 1 %d 0 %d\n", i % 100, 100 - i % 100);
+    host_stdin_push(burst, len);
+    sleep_ms(200);
+
+    writes = host_pwm_get_slice(slice).writes - writes;
+    mtrbox_get_stats(&motor_mailbox, MTR_SOURCE_USB, &usb);
+    fprintf(stderr, "\nfirmware, %d $MTR lines in one USB read: %u PWM updates, %lu applied, %lu coalesced\n", BURST,
+            writes / 2, (unsigned long)usb.applied, (unsigned long)usb.coalesced);
+    check(host_pwm_get_gpio_level(PWM_1_PIN) == (BURST % 100) * (PWM_WRAP / 100) &&
+          host_pwm_get_gpio_level(PWM_2_PIN) == (100 - BURST % 100) * (PWM_WRAP / 100),
+          "motors end on the last command");
+    check(usb.posted == BURST && usb.applied < BURST / 4 && usb.applied + usb.coalesced == BURST,
+          "the burst coalesced");
+}
+
+int main(int argc, char **argv)
+{
+    check_rules();
+    check_race();
+    check_firmware();
+    return check_summary();
+}
@@ -0,0 +1,119 @@
+/**
+ * @file bench_nmea.c
+ * @brief NMEA decoder throughput and USB output saved by sending $FIX instead of raw $GPS sentences
+ *
+ *     ./bench_nmea [corpus.nmea] [passes]
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "nmea.h"
+
+static char *load(const char *path, size_t *size)
+{
+    FILE *f = fopen(path, "rb");
+    char *data;
+
+    if (!f)
+        return NULL;
+
+    fseek(f, 0, SEEK_END);
+    *size = (size_t)ftell(f);
+    fseek(f, 0, SEEK_SET);
+    data = malloc(*size);
+    if (data && fread(data, 1, *size, f) != *size)
+    {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    return data;
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = argc > 1 ? argv[1] : NMEA_CORPUS;
+    long passes = argc > 2 ? atol(argv[2]) : 200;
+    size_t size;
+    char *corpus = load(path, &size);
+    nmea_decoder_t decoder;
+
+    if (!corpus)
+    {
+        fprintf(stderr, "can't read %s\n", path);
+        return EXIT_FAILURE;
+    }
+
+    // decode throughput
+    nmea_init(&decoder);
+    absolute_time_t start = get_absolute_time();
+    for (long pass = 0; pass < passes; pass++)
+    {
+        for (size_t i = 0; i < size; i++)
+            nmea_feed(&decoder, corpus[i]);
+    }
+    double seconds = (double)absolute_time_diff_us(start, get_absolute_time()) / 1e6;
+
+    printf("corpus:   %zu bytes, %lu valid sentences, %lu rejected per pass\n", size,
+           (unsigned long)(decoder.sentences / passes), (unsigned long)(decoder.rejected / passes));
+    printf("decode:   %.0f sentences/s, %.1f MB/s\n",
+           (double)(decoder.sentences + decoder.rejected) / seconds, (double)size * passes / seconds / 1e6);
+
+    // USB output: raw "$GPS <sentence>\n" for every line vs. $FIX on change/heartbeat,
+    // using the GPS time of day as the clock
+    gps_fix_register_t reg = {0};
+    gps_fix_t fix, published = {0};
+    uint32_t published_version = 0;
+    uint32_t heartbeat_ms = 0;
+    size_t raw_bytes = 0, fix_bytes = 0, fixes = 0, line_start = 0;
+    char out[96];
+
+    nmea_init(&decoder);
+    for (size_t i = 0; i < size; i++)
+    {
+        if (corpus[i] == '\n')
+        {
+            // "$GPS " + sentence without CRLF + "\n"
+            size_t len = i - line_start;
+            if (len && corpus[i - 1] == '\r')
+                len--;
+            raw_bytes += 5 + len + 1;
+            line_start = i + 1;
+        }
+
+        NMEA_SENTENCE type = nmea_feed(&decoder, corpus[i]);
+        if (type == NMEA_NONE || type == NMEA_OTHER)
+            continue;
+
+        gps_fix_store(&reg, &decoder.fix);
+
+        uint32_t version = gps_fix_load(&reg, &fix);
+        if (version == published_version)
+            continue;
+        published_version = version;
+
+        if (!gps_fix_differs(&fix, &published) && fix.time_ms < heartbeat_ms)
+            continue;
+
+        fix_bytes += (size_t)gps_fix_format(&fix, out, sizeof(out));
+        fixes++;
+        published = fix;
+        heartbeat_ms = fix.time_ms + GPS_FIX_HEARTBEAT_MS;
+    }
+
+    printf("USB out:  raw $GPS %zu bytes, $FIX %zu bytes in %zu fixes (%.1f%% saved)\n",
+           raw_bytes, fix_bytes, fixes, 100.0 * (1.0 - (double)fix_bytes / (double)raw_bytes));
+    printf("last fix: %s", out);
+
+    free(corpus);
+    return EXIT_SUCCESS;
+}
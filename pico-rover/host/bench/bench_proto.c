@@ -0,0 +1,220 @@
+/**
+ * @file bench_proto.c
+ * @brief Binary COBS/CRC framing vs. the ASCII text path on the USB link
+ *
+ *     ./bench_proto [iterations]
+ *
+ * Each path is measured end to end on one CPU: the sender formats/encodes, the
+ * receiver reassembles byte by byte (line framer vs. frame decoder) and parses
+ * into the typed form. Also reports how many random single-bit errors each
+ * path lets through as a valid but different message.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "binproto.h"
+#include "commands.h"
+#include "framer.h"
+#include "nmea.h"
+
+typedef struct result
+{
+    double ns;          // per message
+    double bytes;       // on the wire, per message
+} result_t;
+
+static volatile uint32_t sink;
+
+static void make_mtr(long i, mtr_cmd_t *mtr)
+{
+    mtr->dir1 = i & 1;
+    mtr->pwm1 = (int8_t)(i % 101);
+    mtr->dir2 = (i >> 1) & 1;
+    mtr->pwm2 = (int8_t)((i * 7) % 101);
+}
+
+static result_t text_commands(long n)
+{
+    static line_framer_t framer;
+    char wire[64];
+    const char *line;
+    size_t len, bytes = 0;
+    command_t cmd;
+    mtr_cmd_t mtr;
+
+    framer_init(&framer, 0);
+    absolute_time_t start = get_absolute_time();
+    for (long i = 0; i < n; i++)
+    {
+        make_mtr(i, &mtr);
+        int w = snprintf(wire, sizeof(wire), "$MTR %d %d %d %d\n", mtr.dir1, mtr.pwm1, mtr.dir2, mtr.pwm2);
+        bytes += (size_t)w;
+
+        for (int b = 0; b < w; b++)
+            framer_push(&framer, (uint8_t)wire[b]);
+        while (framer_poll(&framer, &line, &len) == FRAMER_LINE)
+        {
+            if (!parse_command(line, &cmd))
+                sink += (uint32_t)cmd.mtr.pwm1;
+        }
+    }
+    int64_t us = absolute_time_diff_us(start, get_absolute_time());
+    return (result_t){ us * 1000.0 / n, (double)bytes / n };
+}
+
+static result_t binary_commands(long n)
+{
+    static bin_decoder_t decoder;
+    uint8_t wire[BIN_MAX_WIRE];
+    uint8_t payload[4];
+    size_t bytes = 0;
+    bin_frame_t frame;
+    command_t cmd;
+    mtr_cmd_t mtr;
+
+    bin_decoder_init(&decoder);
+    absolute_time_t start = get_absolute_time();
+    for (long i = 0; i < n; i++)
+    {
+        make_mtr(i, &mtr);
+        payload[0] = mtr.dir1;
+        payload[1] = (uint8_t)mtr.pwm1;
+        payload[2] = mtr.dir2;
+        payload[3] = (uint8_t)mtr.pwm2;
+        size_t w = bin_encode(BIN_MSG_MOTORS, payload, sizeof(payload), wire);
+        bytes += w;
+
+        for (size_t b = 0; b < w; b++)
+        {
+            if (bin_decoder_push(&decoder, wire[b], &frame) == BIN_FRAME && !parse_frame(&frame, &cmd))
+                sink += (uint32_t)cmd.mtr.pwm1;
+        }
+    }
+    int64_t us = absolute_time_diff_us(start, get_absolute_time());
+    return (result_t){ us * 1000.0 / n, (double)bytes / n };
+}
+
+static void make_fix(long i, gps_fix_t *fix)
+{
+    memset(fix, 0, sizeof(*fix));
+    fix->lat = 286024274 + (int32_t)(i % 1000);
+    fix->lon = -812000599 - (int32_t)(i % 777);
+    fix->time_ms = (uint32_t)(50520000 + i * 1000);
+    fix->hdop = 110;
+    fix->speed = (uint16_t)(i % 200);
+    fix->course = (uint16_t)(i % 36000);
+    fix->quality = 1;
+    fix->sats = 9;
+}
+
+static result_t text_fixes(long n)
+{
+    char wire[96];
+    size_t bytes = 0;
+    gps_fix_t fix;
+    long lat, lon;
+    unsigned q, sats, hdop, speed, course;
+    unsigned long t;
+
+    absolute_time_t start = get_absolute_time();
+    for (long i = 0; i < n; i++)
+    {
+        make_fix(i, &fix);
+        bytes += (size_t)gps_fix_format(&fix, wire, sizeof(wire));
+        // what the SBC has to do with it
+        if (sscanf(wire, "$FIX %ld %ld %u %u %u %u %u %lu", &lat, &lon, &q, &sats, &hdop, &speed, &course, &t) == 8)
+            sink += (uint32_t)lat;
+    }
+    int64_t us = absolute_time_diff_us(start, get_absolute_time());
+    return (result_t){ us * 1000.0 / n, (double)bytes / n };
+}
+
+static result_t binary_fixes(long n)
+{
+    static bin_decoder_t decoder;
+    uint8_t wire[BIN_MAX_WIRE];
+    size_t bytes = 0;
+    bin_frame_t frame;
+    gps_fix_t fix, rx;
+
+    bin_decoder_init(&decoder);
+    absolute_time_t start = get_absolute_time();
+    for (long i = 0; i < n; i++)
+    {
+        make_fix(i, &fix);
+        size_t w = bin_encode(BIN_MSG_FIX, &fix, sizeof(fix), wire);
+        bytes += w;
+
+        for (size_t b = 0; b < w; b++)
+        {
+            if (bin_decoder_push(&decoder, wire[b], &frame) == BIN_FRAME && frame.len == sizeof(rx))
+            {
+                memcpy(&rx, frame.payload, sizeof(rx));
+                sink += (uint32_t)rx.lat;
+            }
+        }
+    }
+    int64_t us = absolute_time_diff_us(start, get_absolute_time());
+    return (result_t){ us * 1000.0 / n, (double)bytes / n };
+}
+
+// flips one random bit per message; counts messages that still parse but say something else
+static void integrity(long n)
+{
+    static bin_decoder_t decoder;
+    char text[64];
+    uint8_t wire[BIN_MAX_WIRE];
+    uint8_t payload[4] = { 1, 50, 0, 25 };
+    command_t cmd;
+    bin_frame_t frame;
+    long text_bad = 0, bin_bad = 0;
+
+    srand(1);
+    for (long i = 0; i < n; i++)
+    {
+        int w = snprintf(text, sizeof(text), "$MTR 1 50 0 25");
+        text[rand() % w] ^= (char)(1 << (rand() % 7));
+        if (!parse_command(text, &cmd) && cmd.tag == MSG_MOTORS &&
+            (cmd.mtr.pwm1 != 50 || cmd.mtr.pwm2 != 25 || !cmd.mtr.dir1 || cmd.mtr.dir2))
+            text_bad++;
+
+        bin_decoder_init(&decoder);
+        size_t b = bin_encode(BIN_MSG_MOTORS, payload, sizeof(payload), wire);
+        wire[rand() % (b - 1)] ^= (uint8_t)(1 << (rand() % 8));
+        for (size_t k = 0; k < b; k++)
+        {
+            if (bin_decoder_push(&decoder, wire[k], &frame) == BIN_FRAME && !parse_frame(&frame, &cmd) &&
+                (cmd.tag != MSG_MOTORS || cmd.mtr.pwm1 != 50 || cmd.mtr.pwm2 != 25 || !cmd.mtr.dir1 || cmd.mtr.dir2))
+                bin_bad++;
+        }
+    }
+
+    printf("bit errors accepted as a wrong $MTR: text %ld/%ld, binary %ld/%ld\n", text_bad, n, bin_bad, n);
+}
+
+static void report(const char *what, result_t text, result_t bin)
+{
+    printf("%-18s text   %8.1f ns/msg %10.0f msg/s %5.1f B/msg\n", what, text.ns, 1e9 / text.ns, text.bytes);
+    printf("%-18s binary %8.1f ns/msg %10.0f msg/s %5.1f B/msg (%.2fx)\n", "", bin.ns, 1e9 / bin.ns, bin.bytes,
+           text.ns / bin.ns);
+}
+
+int main(int argc, char **argv)
+{
+    long n = argc > 1 ? atol(argv[1]) : 1000000;
+
+    report("SBC->Pico $MTR", text_commands(n), binary_commands(n));
+    report("Pico->SBC $FIX", text_fixes(n), binary_fixes(n));
+    integrity(100000);
+
+    return EXIT_SUCCESS;
+}
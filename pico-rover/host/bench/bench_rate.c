@@ -0,0 +1,282 @@
+/**
+ * @file bench_rate.c
+ * @brief Adaptive LoRa data rate over the simulated link: bytes/s at each rate, and how it follows the SNR
+ *
+ *     ./bench_rate > /dev/null
+ *
+ * comm_run() runs unchanged on core 1 against sim_lora with its LoRa air:
+ * airtime from the rate both ends are set to, frames lost as the SNR nears
+ * that rate's floor. The bench is the SBC and core 0, keeping the link busy
+ * with 4 KB $TXR messages, while the SNR goes through three phases:
+ *
+ *   - climb: a strong signal; the rate should go up the ladder to the top
+ *   - fade: the SNR sinks to a few dB over the top rate's floor; the link
+ *     should step down while frames still get through, without falling back
+ *   - drop: the SNR falls below the floor of where the link is; nothing gets
+ *     through, so both ends should fall back to the base rate and carry on
+ *
+ * The bytes the ground station took while at each rate, over the time it
+ * spent there, are that rate's throughput; the rate the link was at when the
+ * signal dropped is charged the silence before the fallback too. The ceiling
+ * is full fragments sent back to back, with no acks. The run is in a process
+ * of its own. Firmware output goes to stdout, results go to stderr.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "host_hal.h"
+#include "sim_lora.h"
+#include "commands.h"
+#include "comms.h"
+#include "linkq.h"
+#include "stats.h"
+#include "txring.h"
+#include "bench_check.h"
+
+#define LATENCY_US          2000
+#define SNR_CLIMB           20          // dB at 125 kHz: clear of every floor
+#define SNR_FADE            1           // a little over the top rate's floor, under its step-down margin
+#define SNR_DROP            -12         // under SF7's floor, over the base rate's
+#define MESSAGE_SIZE        4096
+#define PIECE_SIZE          200
+#define SETUP_LIMIT_MS      30000
+#define CLIMB_LIMIT_MS      150000
+#define FADE_LIMIT_MS       60000
+#define DROP_LIMIT_MS       90000
+#define DWELL_MS            10000       // at each phase's rate before the next one
+#define CHILD_LIMIT_S       600
+
+typedef struct result
+{
+    bool up;
+    bool climbed;               // both ends reached the top rate
+    double climb_s;             // connection up to there
+    bool faded;                 // stepped down from the top without a fallback
+    uint32_t fade_rate;
+    bool dropped;               // both ends fell back to the base rate
+    double drop_s;              // SNR drop to both ends at the base rate
+    uint64_t bytes_after_drop;  // delivered from then on
+    bool agree;                 // both ends at the same rate at the end
+    uint32_t rover_ups;
+    uint32_t rover_downs;
+    uint32_t rover_fallbacks;
+    uint32_t gs_fallbacks;
+    uint32_t resets;
+    uint32_t ignored;
+    uint32_t messages;
+    uint64_t rate_bytes[LORA_RATES];
+    uint64_t rate_us[LORA_RATES];
+} result_t;
+
+static char message[MESSAGE_SIZE];
+
+// the SBC: one message of "$TXR + <piece>" lines whenever core 1 has room for another
+static void feed(void)
+{
+    char line[FRAMER_LINE_SIZE];
+    command_t cmd;
+    size_t piece;
+
+    if (frag_pending(&txr_queue) > FRAG_TX_SIZE / 2)
+        return;
+    for (size_t sent = 0; sent < MESSAGE_SIZE; sent += piece)
+    {
+        piece = MESSAGE_SIZE - sent < PIECE_SIZE ? MESSAGE_SIZE - sent : PIECE_SIZE;
+        snprintf(line, sizeof(line), "$TXR %s %.*s", sent + piece < MESSAGE_SIZE ? "+" : ".", (int)piece,
+                 message + sent);
+        if (!parse_command(line, &cmd))
+            dispatch_command(&cmd);
+    }
+}
+
+// keeps the link busy until done() or limit_ms
+static bool run_until(sim_lora_t *sim, sim_lora_stats_t *s, bool (*done)(const sim_lora_stats_t *), uint32_t limit_ms)
+{
+    absolute_time_t end = make_timeout_time_ms(limit_ms);
+
+    do
+    {
+        sleep_ms(5);
+        feed();
+        sim_lora_get_stats(sim, s);
+        if (done && done(s))
+            return true;
+    } while (!time_reached(end));
+    return false;
+}
+
+static bool connected(const sim_lora_stats_t *s)
+{
+    return s->handshakes > 0;
+}
+
+static bool at_top(const sim_lora_stats_t *s)
+{
+    return s->link.rate == LORA_RATES - 1 && lora_link_stats.rate == LORA_RATES - 1;
+}
+
+static bool stepped_down(const sim_lora_stats_t *s)
+{
+    return s->link.rate < LORA_RATES - 1 && lora_link_stats.rate == s->link.rate;
+}
+
+static bool fell_back(const sim_lora_stats_t *s)
+{
+    return s->link.fallbacks && lora_link_stats.fallbacks && s->link.rate == LORA_RATE_BASE &&
+           lora_link_stats.rate == LORA_RATE_BASE;
+}
+
+static result_t run(const sim_channel_t *channel)
+{
+    sim_lora_t sim;
+    sim_lora_stats_t s;
+    result_t r = { 0 };
+    absolute_time_t start;
+    uint64_t bytes;
+
+    framer_init(&lora_framer, 0);
+    tx_ring_init(&lora_tx, UART_ID_LORA);
+    msg_channel_init(&receive_queue);
+    msg_channel_init(&error_queue);
+    tx_sched_init(&transmit_queue);
+    frag_tx_init(&txr_queue);
+    memset(message, 'r', sizeof(message));
+
+    sim_lora_init(&sim, UART_ID_LORA, channel);
+    sim_lora_start(&sim);
+    multicore_launch_core1(comm_run);
+
+    if (!(r.up = run_until(&sim, &s, connected, SETUP_LIMIT_MS)))
+        return r;
+
+    // climb
+    start = get_absolute_time();
+    r.climbed = run_until(&sim, &s, at_top, CLIMB_LIMIT_MS);
+    r.climb_s = absolute_time_diff_us(start, get_absolute_time()) / 1e6;
+    run_until(&sim, &s, NULL, DWELL_MS);
+
+    // fade
+    sim_lora_set_snr(&sim, SNR_FADE);
+    r.faded = r.climbed && run_until(&sim, &s, stepped_down, FADE_LIMIT_MS) && !s.link.fallbacks &&
+              !lora_link_stats.fallbacks;
+    r.fade_rate = s.link.rate;
+    run_until(&sim, &s, NULL, DWELL_MS);
+
+    // drop
+    sim_lora_set_snr(&sim, SNR_DROP);
+    start = get_absolute_time();
+    r.dropped = run_until(&sim, &s, fell_back, DROP_LIMIT_MS);
+    r.drop_s = absolute_time_diff_us(start, get_absolute_time()) / 1e6;
+    bytes = s.rate_bytes[LORA_RATE_BASE];
+    run_until(&sim, &s, NULL, 2 * DWELL_MS);
+    r.bytes_after_drop = s.rate_bytes[LORA_RATE_BASE] - bytes;
+
+    r.agree = s.link.rate == lora_link_stats.rate;
+    r.rover_ups = lora_link_stats.rate_ups;
+    r.rover_downs = lora_link_stats.rate_downs;
+    r.rover_fallbacks = lora_link_stats.fallbacks;
+    r.gs_fallbacks = s.link.fallbacks;
+    r.resets = lora_link_stats.resets;
+    r.ignored = s.rate_ignored;
+    r.messages = s.txr_messages;
+    memcpy(r.rate_bytes, s.rate_bytes, sizeof(r.rate_bytes));
+    memcpy(r.rate_us, s.link.rate_us, sizeof(r.rate_us));
+    return r;
+}
+
+// in a child process: comm_run() never returns, and its state is static
+// in a process of its own, see sim_run_child()
+static void run_child(const void *channel, void *r)
+{
+    *(result_t *)r = run(channel);
+}
+
+// the air a full fragment takes: ARQ_DATA_SIZE - 1 bytes behind a header with small sequence numbers
+static size_t full_frame(void)
+{
+    char header[LORA_SIZE];
+
+    return ARQ_DATA_SIZE - 1 + (size_t)formatFrame(header, sizeof(header), 100, 100, 0, "FRG", NULL, 0);
+}
+
+// full fragments back to back
+static double ceiling(int rate)
+{
+    return (ARQ_DATA_SIZE - 1) / (lora_airtime_us(&lora_rates[rate], full_frame()) / 1e6);
+}
+
+static double throughput(const result_t *r, int rate)
+{
+    return r->rate_us[rate] ? r->rate_bytes[rate] / (r->rate_us[rate] / 1e6) : 0;
+}
+
+int main(int argc, char **argv)
+{
+    sim_channel_t channel = {
+        .latency_us = LATENCY_US,
+        .rssi = -90,
+        .snr = SNR_CLIMB,
+        .phy = true,
+        .seed = 1,
+    };
+    // Semtech's calculator: SF7, 125 kHz, 4/5, 8 symbols of preamble, 10 bytes: 41.22 ms
+    lora_rate_t reference = { 7, 7, 1, 8, 0 };
+    uint32_t airtime = lora_airtime_us(&reference, 10);
+    result_t r;
+    bool ran;
+
+    fprintf(stderr, "rate  SF  BW kHz  floor dB  %zu B frame  ceiling\n", full_frame());
+    for (int i = 0; i < LORA_RATES; i++)
+    {
+        fprintf(stderr, "%4d  %2u  %6u  %8.1f  %7.0f ms  %5.0f B/s\n", i, lora_rates[i].sf,
+                lora_rates[i].bw == 9 ? 500 : lora_rates[i].bw == 8 ? 250 : 125, lora_rates[i].snr_floor / 10.0,
+                lora_airtime_us(&lora_rates[i], full_frame()) / 1e3, ceiling(i));
+    }
+    fprintf(stderr, "\nSNR %d dB, then %d, then %d; %d B $TXR messages from the SBC\n\n", SNR_CLIMB, SNR_FADE, SNR_DROP,
+            MESSAGE_SIZE);
+
+    ran = sim_run_child(run_child, &channel, &r, sizeof(r), CHILD_LIMIT_S) && r.up;
+    if (ran)
+    {
+        fprintf(stderr, "climb: %s in %.1f s\n", r.climbed ? "top rate" : "NOT at the top rate", r.climb_s);
+        fprintf(stderr, "fade: %s, to rate %lu\n", r.faded ? "stepped down" : "NOT stepped down",
+                (unsigned long)r.fade_rate);
+        fprintf(stderr, "drop: %s in %.1f s, then %llu B at the base rate\n", r.dropped ? "fell back" : "NOT fallen back",
+                r.drop_s, (unsigned long long)r.bytes_after_drop);
+        fprintf(stderr, "rover: %lu up, %lu down, %lu fallbacks, %lu connections dropped; ground station: %lu fallbacks, "
+                "%lu changes ignored; %lu messages\n\n", (unsigned long)r.rover_ups, (unsigned long)r.rover_downs,
+                (unsigned long)r.rover_fallbacks, (unsigned long)r.resets, (unsigned long)r.gs_fallbacks,
+                (unsigned long)r.ignored, (unsigned long)r.messages);
+        fprintf(stderr, "rate  time at it  delivered  throughput  of the ceiling\n");
+        for (int i = 0; i < LORA_RATES; i++)
+        {
+            fprintf(stderr, "%4d  %8.1f s  %7llu B  %6.0f B/s  %5.0f%%\n", i, r.rate_us[i] / 1e6,
+                    (unsigned long long)r.rate_bytes[i], throughput(&r, i), throughput(&r, i) / ceiling(i) * 100);
+        }
+        fprintf(stderr, "\n");
+    }
+
+    check(airtime > 41216 * 0.99 && airtime < 41216 * 1.01, "airtime as Semtech's calculator has it");
+    check(ran, "connected and finished");
+    if (ran)
+    {
+        check(r.climbed, "a strong signal takes the link to the top rate");
+        check(throughput(&r, LORA_RATES - 1) > 4 * throughput(&r, LORA_RATE_BASE), "the top rate carries 4x the base");
+        check(r.faded, "a fading signal steps the rate down, no fallback");
+        check(r.dropped, "a lost signal sends both ends back to the base rate");
+        check(r.bytes_after_drop > 0, "and the link carries on there");
+        check(r.agree, "both ends at the same rate at the end");
+    }
+
+    return check_summary();
+}
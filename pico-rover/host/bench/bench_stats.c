@@ -0,0 +1,183 @@
+/**
+ * @file bench_stats.c
+ * @brief "$REQ STATS" snapshot against known load: GPS rate, parse errors, loop period and idle time
+ *
+ *     ./bench_stats > /dev/null
+ *
+ * The firmware's main() runs against the host HAL with a scripted LoRa module
+ * and a ground station that completes the handshake and acknowledges the
+ * rover's frames. A 10 Hz GPS receiver sends an RMC and a GGA sentence every
+ * 100 ms, and the ground station sends a few frames that don't parse. Each
+ * snapshot must show them: the sentence rate, the parse errors, core 0's tick
+ * at CORE0_TICK_MS, and both cores mostly idle. Last, the cost of a snapshot
+ * and of the counting itself. Firmware output goes to stdout, results go to
+ * stderr.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "host_hal.h"
+#include "fake_modem.h"
+#include "comms.h"
+#include "config.h"
+#include "definitions.h"
+#include "stats.h"
+#include "bench_check.h"
+
+#define BOOT_MS             2500        // main() sleeps 2 s before it starts
+#define TICK_MS             20          // CORE0_TICK_MS
+#define GPS_PERIOD_MS       100
+#define SENTENCES_PER_FIX   2
+#define BAD_FRAMES          5
+#define INTERVAL_MS         2000
+#define TIMING_RUNS         100000L
+
+static const char *const gps_burst =
+    "$GNRMC,140200.00,A,2836.14564,N,08112.00359,W,0.000,,171026,,,A*70\r\n"
+    "$GNGGA,140200.00,2836.14564,N,08112.00359,W,1,09,1.10,27.4,M,-31.2,M,,*4A\r\n";
+
+int rover_main(void);
+
+// the ground station: answers the SYN and acknowledges every data frame
+static volatile bool connected;
+static volatile uint32_t tlm_frames;
+
+static void gs_answer(fake_modem_t *m, const char *line, void *ctx)
+{
+    static int ack;
+    char payload[LORA_SIZE];
+    FRAME frame;
+
+    // AT+SEND=<address>,<length>,<stuffed frame>
+    if (strncmp(line, "AT+SEND=", 8) != 0)
+        return;
+    snprintf(payload, sizeof(payload), "%s", strchr(strchr(line, ',') + 1, ',') + 1);
+    if (parseData(&frame, payload))
+        return;
+
+    if (strcmp(frame.flag, "SYN") == 0)
+    {
+        ack = frame.seq + 1;
+        formatFrame(payload, sizeof(payload), 0, ack, 0, "SYN", NULL, 0);
+        connected = true;
+    }
+    else if (frame.data)
+    {
+        tlm_frames += strcmp(frame.flag, "TLM") == 0;
+        ack += frame.seq == ack;
+        formatFrame(payload, sizeof(payload), 1, ack, 0, "ACK", NULL, 0);
+    }
+    else
+    {
+        return;
+    }
+    fake_modem_receive(m, GS_ADDRESS, payload, -40, 10);
+}
+
+static const fake_modem_rule_t modem_script[] = {
+    { NULL, "+OK", 0 },
+};
+
+static volatile bool gps_running;
+
+static void *gps(void *arg)
+{
+    absolute_time_t next = get_absolute_time();
+
+    while (gps_running)
+    {
+        host_uart_rx_push(UART_ID_GPS, gps_burst, strlen(gps_burst));
+        next = delayed_by_ms(next, GPS_PERIOD_MS);
+        sleep_until(next);
+    }
+    return NULL;
+}
+
+static void *core0(void *arg)
+{
+    rover_main();
+    return NULL;
+}
+
+static void print(const rover_stats_t *s)
+{
+    fprintf(stderr, "over %lu ms: queues rx %u/%lu/%lu tx %u/%lu/%lu, link %lu/%lu/%lu, gps %u/s, overruns %lu/%lu/%lu\n",
+            (unsigned long)s->interval_ms, s->rx_depth, (unsigned long)s->rx_sent, (unsigned long)s->rx_dropped,
+            s->tx_depth, (unsigned long)s->tx_sent, (unsigned long)s->tx_dropped, (unsigned long)s->parse_errors,
+            (unsigned long)s->retransmits, (unsigned long)s->resets, s->gps_per_s, (unsigned long)s->overruns[0],
+            (unsigned long)s->overruns[1], (unsigned long)s->overruns[2]);
+    for (int core = 0; core < STATS_CORES; core++)
+    {
+        fprintf(stderr, "  core %d: %u%% idle, %lu passes/s, tick every %lu us, late %lu us mean %lu max\n", core,
+                s->core[core].idle_pct, (unsigned long)s->core[core].passes_per_s,
+                (unsigned long)s->core[core].tick_period_us, (unsigned long)s->core[core].late_mean_us,
+                (unsigned long)s->core[core].late_max_us);
+    }
+    for (int cls = 0; cls < TX_CLASSES; cls++)
+    {
+        fprintf(stderr, "  tx %-7s: %u waiting, %lu sent, %lu dropped, delay %lu us mean %lu max\n",
+                tx_class_names[cls], s->tx[cls].depth, (unsigned long)s->tx[cls].sent,
+                (unsigned long)s->tx[cls].dropped, (unsigned long)s->tx[cls].delay_mean_us,
+                (unsigned long)s->tx[cls].delay_max_us);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    fake_modem_t modem;
+    pthread_t core0_thread, gps_thread;
+    rover_stats_t s;
+    uint32_t per_s = 1000 / GPS_PERIOD_MS * SENTENCES_PER_FIX;
+
+    fake_modem_init(&modem, UART_ID_LORA, modem_script, 1, gs_answer, NULL);
+    fake_modem_start(&modem);
+    pthread_create(&core0_thread, NULL, core0, NULL);
+    sleep_ms(BOOT_MS);
+    for (int i = 0; i < 100 && !connected; i++)
+        sleep_ms(10);
+    check(connected, "rover connected to the ground station");
+
+    gps_running = true;
+    pthread_create(&gps_thread, NULL, gps, NULL);
+    for (int i = 0; i < BAD_FRAMES; i++)
+        fake_modem_receive(&modem, GS_ADDRESS, "7", -40, 10);     // frame kind 7: there is none
+
+    // the first snapshot covers everything since boot; the next one just the interval
+    sleep_ms(200);
+    stats_snapshot(&s);
+    uint32_t tlm_before = tlm_frames;
+    sleep_ms(INTERVAL_MS);
+    stats_snapshot(&s);
+    print(&s);
+
+    check(s.interval_ms >= INTERVAL_MS && s.interval_ms < INTERVAL_MS + 100, "interval since the previous snapshot");
+    check(s.gps_per_s >= per_s * 8 / 10 && s.gps_per_s <= per_s * 12 / 10, "GPS sentences per second");
+    check(s.parse_errors == BAD_FRAMES && !s.resets, "bad frames counted as parse errors, link kept");
+    check(s.core[0].tick_period_us >= TICK_MS * 900 && s.core[0].tick_period_us <= TICK_MS * 1100,
+          "core 0 tick period within 10% of CORE0_TICK_MS");
+    check(s.core[0].late_mean_us < 1000 && s.core[0].late_max_us >= s.core[0].late_mean_us, "tick lateness");
+    check(s.core[0].idle_pct >= 50 && s.core[1].idle_pct >= 50, "both cores mostly idle");
+    check(tlm_frames > tlm_before && !s.tx_dropped && !s.overruns[0] && !s.overruns[1] && !s.overruns[2],
+          "telemetry frames flowing, nothing dropped");
+
+    gps_running = false;
+    pthread_join(gps_thread, NULL);
+
+    absolute_time_t t = get_absolute_time();
+    for (long i = 0; i < TIMING_RUNS; i++)
+        stats_snapshot(&s);
+    fprintf(stderr, "\nstats_snapshot(): %.0f ns on the host\n",
+            absolute_time_diff_us(t, get_absolute_time()) * 1000.0 / TIMING_RUNS);
+
+    return check_summary();
+}
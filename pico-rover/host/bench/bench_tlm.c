@@ -0,0 +1,288 @@
+/**
+ * @file bench_tlm.c
+ * @brief LoRa bytes and airtime per GPS telemetry frame: text header + $FIX vs binary header + delta snapshot
+ *
+ *     ./bench_tlm [corpus.nmea] [passes] [loss,loss,...]
+ *
+ * The corpus is decoded into one snapshot per GGA. Each snapshot goes from a
+ * rover STATE to a ground station STATE through arq_queue_bytes()/arq_poll()/
+ * parseData(), one frame per second, with the ground station's acks reaching
+ * the rover one frame late and frames lost at the given rate. The ground
+ * station decodes every TLM frame and compares it with the source snapshot.
+ * Frame sizes are as on the air, stuffing included; airtime is
+ * preamble + per-byte time as in sim_arq.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "comms.h"
+#include "nmea.h"
+#include "telemetry.h"
+
+#define AIRTIME_BASE_MS     60.0
+#define AIRTIME_BYTE_MS     4.5
+#define DUTY_BUDGET_MS      36000.0     // 1% duty cycle, per hour
+#define STEP_US             1000000     // one fix per second
+#define TRUTH_SIZE          256
+
+typedef struct result
+{
+    long fixes;
+    long frames;                // TLM frames put on the air, retransmissions included
+    double text_bytes;          // per first transmission, each encoding
+    double hybrid_bytes;
+    double tlm_bytes;
+    long keyframes;
+    long decoded;
+    long mismatches;
+    long decode_errors;
+    long resets;
+} result_t;
+
+static volatile uint32_t sink;
+
+static char *load(const char *path, size_t *size)
+{
+    FILE *f = fopen(path, "rb");
+    char *data;
+
+    if (!f)
+        return NULL;
+
+    fseek(f, 0, SEEK_END);
+    *size = (size_t)ftell(f);
+    fseek(f, 0, SEEK_SET);
+    data = malloc(*size + 1);
+    if (data && fread(data, 1, *size, f) != *size)
+    {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    if (data)
+        data[*size] = '\0';
+    return data;
+}
+
+// one snapshot per GGA, i.e. per epoch of the receiver
+static telemetry_t *snapshots(const char *corpus, size_t size, long *count)
+{
+    nmea_decoder_t decoder;
+    telemetry_t *out = calloc(size / 32 + 1, sizeof(telemetry_t));     // the GPS fields only
+    long n = 0;
+
+    nmea_init(&decoder);
+    for (size_t i = 0; i < size; i++)
+    {
+        if (nmea_feed(&decoder, corpus[i]) == NMEA_GGA)
+            tlm_from_fix(&decoder.fix, &out[n++]);
+    }
+    *count = n;
+    return out;
+}
+
+static void fix_text(const telemetry_t *tlm, char *out, size_t size)
+{
+    gps_fix_t fix = {
+        .lat = tlm->field[TLM_LAT],
+        .lon = tlm->field[TLM_LON],
+        .time_ms = (uint32_t)tlm->field[TLM_TIME],
+        .hdop = (uint16_t)tlm->field[TLM_HDOP],
+        .speed = (uint16_t)tlm->field[TLM_SPEED],
+        .course = (uint16_t)tlm->field[TLM_COURSE],
+        .quality = (uint8_t)tlm->field[TLM_QUALITY],
+        .sats = (uint8_t)tlm->field[TLM_SATS],
+    };
+    int n = gps_fix_format(&fix, out, size);
+
+    // no line ending inside a LoRa payload
+    if (n > 0 && out[n - 1] == '\n')
+        out[n - 1] = '\0';
+}
+
+static void reset(STATE *rover, STATE *gs, tlm_encoder_t *enc, tlm_decoder_t *dec)
+{
+    memset(rover, 0, sizeof(*rover));
+    memset(gs, 0, sizeof(*gs));
+    rover->state = ESTABLISHED;
+    gs->state = ESTABLISHED;
+    arq_rtt_reset(rover);
+    arq_rtt_reset(gs);
+    arq_start(rover, ARQ_WINDOW);
+    arq_start(gs, ARQ_WINDOW);
+    tlm_encoder_init(enc);
+    tlm_decoder_init(dec);
+}
+
+static result_t run(const telemetry_t *snaps, long count, long passes, double loss)
+{
+    static STATE rover, gs;
+    static telemetry_t truth[TRUTH_SIZE];
+    tlm_encoder_t enc;
+    tlm_decoder_t dec;
+    result_t r = {0};
+    char frame[LORA_SIZE];
+    char ack[LORA_SIZE] = "";
+    char text[LORA_SIZE];
+    uint8_t data[TLM_MAX_SIZE];
+    absolute_time_t now = 0;
+    FRAME parsed;
+    telemetry_t got;
+    const ARQ_SLOT *slot;
+
+    reset(&rover, &gs, &enc, &dec);
+    srand(11);
+
+    for (long i = 0; i < count * passes; i++, now += STEP_US)
+    {
+        const telemetry_t *tlm = &snaps[i % count];
+        ARQ_EVENT event;
+
+        // the ground station's ack from the previous second
+        if (*ack)
+        {
+            if (!parseData(&parsed, ack))
+                arq_receive(&rover, &parsed, now);
+            *ack = '\0';
+        }
+
+        if (!arq_window_full(&rover))
+        {
+            int seq = rover.seq;
+            size_t n = tlm_encode(&enc, &rover, tlm, data);
+
+            truth[seq % TRUTH_SIZE] = *tlm;
+            arq_queue_bytes(&rover, "TLM", data, n);
+            r.fixes++;
+
+            r.tlm_bytes += formatFrame(frame, sizeof(frame), seq, rover.ack, 0, "TLM", data, n);
+            fix_text(tlm, text, sizeof(text));
+            r.hybrid_bytes += formatFrame(frame, sizeof(frame), seq, rover.ack, 0, "ACK", text, strlen(text));
+            r.text_bytes += snprintf(frame, sizeof(frame), "%d %d %lx ACK %s", seq, rover.ack, 0ul, text);
+        }
+
+        // everything due goes out now: retransmissions, then the new frame
+        while ((event = arq_poll(&rover, now, frame, sizeof(frame))) == ARQ_SEND)
+        {
+            r.frames++;
+            if ((double)rand() / RAND_MAX < loss || parseData(&parsed, frame))
+                continue;
+            arq_receive(&gs, &parsed, now);
+        }
+        if (event == ARQ_FAILED)
+        {
+            r.resets++;
+            reset(&rover, &gs, &enc, &dec);
+            continue;
+        }
+
+        while ((slot = arq_peek(&gs)))
+        {
+            if (!tlm_decode(&dec, gs.ack, slot->data, slot->len, &got))
+            {
+                r.decoded++;
+                if (memcmp(&got, &truth[gs.ack % TRUTH_SIZE], sizeof(got)))
+                    r.mismatches++;
+            }
+            arq_pop(&gs);
+        }
+
+        if (arq_poll(&gs, delayed_by_ms(now, ARQ_ACK_DELAY_MS), ack, sizeof(ack)) != ARQ_SEND ||
+            (double)rand() / RAND_MAX < loss)
+            *ack = '\0';
+    }
+
+    r.text_bytes /= r.fixes;
+    r.hybrid_bytes /= r.fixes;
+    r.tlm_bytes /= r.fixes;
+    r.keyframes = enc.keyframes;
+    r.decode_errors = dec.errors;
+    return r;
+}
+
+static double airtime(double bytes)
+{
+    return AIRTIME_BASE_MS + bytes * AIRTIME_BYTE_MS;
+}
+
+static void codec_speed(const telemetry_t *snaps, long count, long iterations)
+{
+    static STATE state;
+    tlm_encoder_t enc;
+    tlm_decoder_t dec;
+    uint8_t data[TLM_MAX_SIZE];
+    telemetry_t got;
+
+    memset(&state, 0, sizeof(state));
+    arq_start(&state, ARQ_MAX_WINDOW);
+    tlm_encoder_init(&enc);
+    tlm_decoder_init(&dec);
+
+    absolute_time_t start = get_absolute_time();
+    for (long i = 0; i < iterations; i++)
+    {
+        size_t n = tlm_encode(&enc, &state, &snaps[i % count], data);
+        tlm_decode(&dec, state.seq, data, n, &got);
+        sink += (uint32_t)got.field[TLM_LAT];
+        // acknowledged straight away
+        state.seq++;
+        state.base = state.seq;
+    }
+    int64_t us = absolute_time_diff_us(start, get_absolute_time());
+    printf("encode+decode: %.1f ns/snapshot (%u decode errors)\n\n", us * 1000.0 / iterations, dec.errors);
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = argc > 1 ? argv[1] : NMEA_CORPUS;
+    long passes = argc > 2 ? atol(argv[2]) : 20;
+    const char *losses = argc > 3 ? argv[3] : "0,0.1,0.3";
+    size_t size;
+    long count;
+    char *corpus = load(path, &size);
+    telemetry_t *snaps;
+
+    if (!corpus)
+    {
+        fprintf(stderr, "can't read %s\n", path);
+        return EXIT_FAILURE;
+    }
+    snaps = snapshots(corpus, size, &count);
+    if (!count)
+    {
+        fprintf(stderr, "no GGA sentences in %s\n", path);
+        return EXIT_FAILURE;
+    }
+
+    printf("%ld fixes x %ld passes, airtime %.0f ms + %.1f ms/B, 1%% duty cycle\n\n", count, passes,
+           AIRTIME_BASE_MS, AIRTIME_BYTE_MS);
+    codec_speed(snaps, count, 1000000);
+
+    printf(" loss  encoding                 B/frame  airtime ms  frames/h  keyframes  decoded  mismatches  errors  resets\n");
+    for (const char *p = losses; p && *p; p = strchr(p, ','), p = p ? p + 1 : NULL)
+    {
+        double loss = atof(p);
+        result_t r = run(snaps, count, passes, loss);
+
+        printf("%4.0f%%  %-22s %8.1f %11.0f %9.0f\n", loss * 100, "text header + $FIX", r.text_bytes,
+               airtime(r.text_bytes), DUTY_BUDGET_MS / airtime(r.text_bytes));
+        printf("%5s  %-22s %8.1f %11.0f %9.0f\n", "", "binary header + $FIX", r.hybrid_bytes,
+               airtime(r.hybrid_bytes), DUTY_BUDGET_MS / airtime(r.hybrid_bytes));
+        printf("%5s  %-22s %8.1f %11.0f %9.0f %10ld %8ld %11ld %7ld %7ld\n\n", "", "binary header + delta",
+               r.tlm_bytes, airtime(r.tlm_bytes), DUTY_BUDGET_MS / airtime(r.tlm_bytes), r.keyframes, r.decoded,
+               r.mismatches, r.decode_errors, r.resets);
+    }
+
+    free(snaps);
+    free(corpus);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,410 @@
+/**
+ * @file bench_tlmreg.c
+ * @brief Telemetry registers vs a telemetry item every core 0 tick: airtime, drops, staleness, fault latency
+ *
+ *     ./bench_tlmreg [seconds] > /dev/null
+ *
+ * A drive in simulated time: standing, driving, a command timeout that ramps
+ * the wheels down, standing, driving in velocity mode. Then a quiet spell with
+ * the GPS silent, so everything settles. Core 0 writes the wheel speeds,
+ * battery and status every CORE0_TICK_MS as main.c does, and the GPS fix
+ * once a second. Core 1 sends them to a ground station over one half-duplex
+ * SF9-like channel, the acks included, through the real ARQ:
+ *
+ *   - fifo: what core 0 used to do, one item per tick into an 8-deep queue,
+ *     packed into AGG frames by aggregateQueue()'s rules. The items are a text
+ *     snapshot of every field, what "data" would have to carry to say as much
+ *   - registers: tlm_collect() every TLM_POLL_MS, then tlm_encode()
+ *
+ * Age is from a value's snapshot being taken (the item being queued) to the
+ * ground station having it. Fault latency is from the failsafe starting to
+ * the ground station seeing TLM_STATUS_FAILSAFE; it lasts MOTOR_STOP_RAMP_MS.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "comms.h"
+#include "nmea.h"
+#include "telemetry.h"
+#include "tlmreg.h"
+#include "bench_check.h"
+
+#define AIRTIME_BASE_US     60000       // as bench_tlm
+#define AIRTIME_BYTE_US     4500
+#define STEP_US             1000
+#define TICK_US             20000       // CORE0_TICK_MS
+#define GPS_PERIOD_US       1000000
+#define FIFO_DEPTH          MSG_POOL_SIZE
+#define FAILSAFE_AT_S       150
+#define FAILSAFE_US         500000      // MOTOR_STOP_RAMP_MS
+#define QUIET_S             30
+#define SEQS                256
+#define ITEMS_PER_FRAME     8
+
+typedef struct result
+{
+    double air;                 // share of the time the air was busy, acks included
+    double bytes;               // rover frames on the air, B/s
+    double frames;              // rover frames, 1/s
+    double offered;             // items, 1/s
+    double dropped;             // items refused by a full queue, 1/s
+    double age_ms;              // mean age of what the ground station got
+    double age_max_ms;
+    double failsafe_ms;         // -1: the ground station never saw it
+    long decode_errors;
+    bool settled;               // the ground station ends with every register's newest value
+} result_t;
+
+static uint32_t rng = 2463534242u;
+
+static int32_t noise(int32_t amplitude)
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return (int32_t)(rng % (uint32_t)(2 * amplitude + 1)) - amplitude;
+}
+
+// the truth at time t: what core 0's tick writes, as main.c's tlm_update() does
+static void core0_tick(absolute_time_t now, uint32_t seconds)
+{
+    static int32_t battery_avg = -1;
+    double t = now / 1e6;
+    int32_t wheels[TLM_REG_SIZE] = { 0 };
+    int32_t value[TLM_REG_SIZE] = { 0 };
+    uint32_t status = 0;
+    double run = seconds;
+
+    if (t >= 30 && t < FAILSAFE_AT_S)
+    {
+        wheels[0] = 600 + noise(5);
+        wheels[1] = 600 + noise(5);
+        status = TLM_STATUS_DRIVING;
+    }
+    else if (t >= FAILSAFE_AT_S && t < FAILSAFE_AT_S + FAILSAFE_US / 1e6)
+    {
+        int32_t level = (int32_t)(600 * (1 - (t - FAILSAFE_AT_S) / (FAILSAFE_US / 1e6)));
+        wheels[0] = wheels[1] = level;
+        status = TLM_STATUS_FAILSAFE;
+    }
+    else if (t >= 200 && t < run)
+    {
+        wheels[0] = 400 + noise(5);
+        wheels[1] = 300 + noise(5);
+        status = TLM_STATUS_DRIVING | TLM_STATUS_VELOCITY;
+    }
+    tlm_reg_store(&tlm_wheels, wheels);
+
+    // a 1-cell pack sagging from 4.1 V, with ADC noise, filtered and rounded as tlm_update() does
+    int32_t raw = (int32_t)((4100 - 200 * (t < run ? t : run) / run + noise(15)) * 4096 / (3300 * 3));
+    if (battery_avg < 0)
+        battery_avg = raw << 4;
+    battery_avg += raw - (battery_avg >> 4);
+    value[0] = (int32_t)((int64_t)battery_avg * 3300 * 3 / (4096 << 4));
+    value[0] = (value[0] + TLM_BATTERY_STEP_MV / 2) / TLM_BATTERY_STEP_MV * TLM_BATTERY_STEP_MV;
+    tlm_reg_store(&tlm_battery, value);
+
+    value[0] = (int32_t)status;
+    tlm_reg_store(&tlm_status, value);
+}
+
+static void gps_tick(absolute_time_t now)
+{
+    static gps_fix_t fix = { .lat = 286024274, .lon = -812000599, .quality = 1, .sats = 9, .hdop = 110 };
+    int32_t wheels[TLM_REG_SIZE];
+
+    tlm_reg_load(&tlm_wheels, wheels);
+    fix.time_ms = (uint32_t)(now / 1000);
+    fix.speed = (uint16_t)((wheels[0] + wheels[1]) / 24);   // cm/s on 0.2 m wheels, near enough
+    fix.lat += fix.speed * 9 / 10;
+    fix.lon += fix.speed / 2;
+    fix.course = fix.speed ? 3020 : fix.course;
+    gps_fix_store(&gps_latest_fix, &fix);
+}
+
+// the truth as one snapshot, for the fifo items and the final comparison
+static void truth(telemetry_t *tlm)
+{
+    int32_t value[TLM_REG_SIZE];
+    gps_fix_t fix;
+
+    memset(tlm, 0, sizeof(*tlm));
+    if (gps_fix_load(&gps_latest_fix, &fix))
+        tlm_from_fix(&fix, tlm);
+    tlm_reg_load(&tlm_wheels, value);
+    tlm->field[TLM_VEL_LEFT] = value[0];
+    tlm->field[TLM_VEL_RIGHT] = value[1];
+    tlm_reg_load(&tlm_battery, value);
+    tlm->field[TLM_BATTERY] = value[0];
+    tlm_reg_load(&tlm_status, value);
+    tlm->field[TLM_STATUS] = value[0];
+}
+
+static void item_text(const telemetry_t *tlm, char *out, size_t size)
+{
+    int n = 0;
+
+    for (int f = 0; f < TLM_FIELDS && n < (int)size; f++)
+        n += snprintf(out + n, size - n, f ? " %ld" : "%ld", (long)tlm->field[f]);
+}
+
+static int item_parse(const char *in, telemetry_t *tlm)
+{
+    char *end;
+
+    for (int f = 0; f < TLM_FIELDS; f++)
+    {
+        tlm->field[f] = (int32_t)strtol(in, &end, 10);
+        if (end == in)
+            return EXIT_FAILURE;
+        in = end;
+    }
+    return EXIT_SUCCESS;
+}
+
+typedef struct fifo
+{
+    char item[FIFO_DEPTH][LORA_SIZE];
+    absolute_time_t queued[FIFO_DEPTH];
+    unsigned head, tail;
+} fifo_t;
+
+// what each rover frame carried, by sequence number: when its snapshots were taken
+typedef struct carried
+{
+    int n;
+    absolute_time_t taken[ITEMS_PER_FRAME];
+} carried_t;
+
+// aggregateQueue()'s packing: items in order while the frame stays within ARQ_DATA_SIZE on the air
+static void fifo_pack(STATE *rover, fifo_t *q, carried_t *carried)
+{
+    char agg[ARQ_DATA_SIZE];
+    carried_t *c = &carried[(unsigned)rover->seq % SEQS];
+    int len = 0, next;
+
+    c->n = 0;
+    while (q->head != q->tail && c->n < ITEMS_PER_FRAME)
+    {
+        next = aggAppend(agg, sizeof(agg), (size_t)len, "ACK", q->item[q->tail % FIFO_DEPTH]);
+        if (next < 0 || loraStuffedSize(agg, (size_t)next) >= ARQ_DATA_SIZE)
+            break;
+        len = next;
+        c->taken[c->n++] = q->queued[q->tail % FIFO_DEPTH];
+        q->tail++;
+    }
+    if (c->n == 1)
+        arq_queue(rover, "ACK", q->item[(q->tail - 1) % FIFO_DEPTH]);
+    else if (c->n > 1)
+        arq_queue(rover, "AGG", agg);
+}
+
+static uint32_t airtime(const char *frame)
+{
+    return AIRTIME_BASE_US + (uint32_t)strlen(frame) * AIRTIME_BYTE_US;
+}
+
+static result_t run(bool registers, uint32_t seconds)
+{
+    static STATE rover, gs;
+    static fifo_t q;
+    static carried_t carried[SEQS];
+    tlm_publisher_t pub;
+    tlm_encoder_t enc;
+    tlm_decoder_t dec;
+    telemetry_t tlm, got, view = { 0 }, now_truth;
+    uint8_t data[TLM_MAX_SIZE];
+    char frame[LORA_SIZE], air_frame[LORA_SIZE];
+    STATE *air_to = NULL;
+    absolute_time_t air_free = 0, end = (absolute_time_t)(seconds + QUIET_S) * 1000000;
+    double age_sum = 0;
+    long ages = 0, offered = 0, dropped = 0, frames = 0, bytes = 0;
+    uint64_t air_us = 0;
+    result_t r = { .failsafe_ms = -1 };
+    const ARQ_SLOT *slot;
+    FRAME parsed;
+
+    memset(&rover, 0, sizeof(rover));
+    memset(&gs, 0, sizeof(gs));
+    memset(&q, 0, sizeof(q));
+    memset(&gps_latest_fix, 0, sizeof(gps_latest_fix));
+    memset(&tlm_wheels, 0, sizeof(tlm_wheels));
+    memset(&tlm_battery, 0, sizeof(tlm_battery));
+    memset(&tlm_status, 0, sizeof(tlm_status));
+    rover.state = gs.state = ESTABLISHED;
+    arq_rtt_reset(&rover);
+    arq_rtt_reset(&gs);
+    arq_start(&rover, ARQ_WINDOW);
+    arq_start(&gs, ARQ_WINDOW);
+    tlm_publisher_init(&pub);
+    tlm_encoder_init(&enc);
+    tlm_decoder_init(&dec);
+    rng = 2463534242u;
+
+    for (absolute_time_t now = 0; now < end; now += STEP_US)
+    {
+        // core 0
+        if (now % TICK_US == 0)
+        {
+            core0_tick(now, seconds);
+            if (!registers)
+            {
+                offered++;
+                truth(&now_truth);
+                if (q.head - q.tail == FIFO_DEPTH)
+                {
+                    dropped++;
+                }
+                else
+                {
+                    item_text(&now_truth, q.item[q.head % FIFO_DEPTH], LORA_SIZE);
+                    q.queued[q.head % FIFO_DEPTH] = now;
+                    q.head++;
+                }
+            }
+        }
+        if (now % GPS_PERIOD_US == 0 && now < (absolute_time_t)seconds * 1000000)
+            gps_tick(now);
+
+        // the air: a frame arrives
+        if (air_to && now >= air_free)
+        {
+            if (!parseData(&parsed, air_frame))
+                arq_receive(air_to, &parsed, now);
+            air_to = NULL;
+
+            // the ground station takes what is in order
+            while ((slot = arq_peek(&gs)))
+            {
+                carried_t *c = &carried[(unsigned)gs.ack % SEQS];
+                const char *cursor = slot->data;
+                char flag[FLAG_SIZE];
+                char item[LORA_SIZE];
+                bool failsafe_seen = false;
+
+                if (registers)
+                {
+                    if (tlm_decode(&dec, gs.ack, slot->data, slot->len, &got) == EXIT_SUCCESS)
+                        view = got;
+                }
+                else if (strcmp(slot->flag, "AGG") == 0)
+                {
+                    while (aggNext(&cursor, flag, item, sizeof(item)) == EXIT_SUCCESS)
+                    {
+                        if (item_parse(item, &got) == EXIT_SUCCESS)
+                            view = got;
+                        if (view.field[TLM_STATUS] & TLM_STATUS_FAILSAFE)
+                            failsafe_seen = true;
+                    }
+                }
+                else if (item_parse(slot->data, &got) == EXIT_SUCCESS)
+                {
+                    view = got;
+                }
+
+                if ((failsafe_seen || view.field[TLM_STATUS] & TLM_STATUS_FAILSAFE) && r.failsafe_ms < 0)
+                    r.failsafe_ms = (now - (absolute_time_t)FAILSAFE_AT_S * 1000000) / 1000.0;
+                for (int i = 0; i < c->n; i++)
+                {
+                    double age = (now - c->taken[i]) / 1000.0;
+                    age_sum += age;
+                    ages++;
+                    if (age > r.age_max_ms)
+                        r.age_max_ms = age;
+                }
+                c->n = 0;
+                arq_pop(&gs);
+            }
+        }
+
+        // core 1
+        if (registers && now % (TLM_POLL_MS * 1000) == 0 && !arq_window_full(&rover) && !arq_unsent(&rover) &&
+            tlm_collect(&pub, now, &tlm))
+        {
+            carried_t *c = &carried[(unsigned)rover.seq % SEQS];
+            size_t n = tlm_encode(&enc, &rover, &tlm, data);
+
+            c->n = 1;
+            c->taken[0] = now;
+            arq_queue_bytes(&rover, "TLM", data, n);
+        }
+        if (!registers && !arq_window_full(&rover) && !arq_unsent(&rover) && now >= air_free)
+            fifo_pack(&rover, &q, carried);
+
+        // the air is free: the ground station's ack first, then the rover
+        if (!air_to && now >= air_free)
+        {
+            if (arq_poll(&gs, now, frame, sizeof(frame)) == ARQ_SEND)
+            {
+                air_to = &rover;
+            }
+            else if (arq_poll(&rover, now, frame, sizeof(frame)) == ARQ_SEND)
+            {
+                air_to = &gs;
+                frames++;
+                bytes += (long)strlen(frame);
+            }
+            if (air_to)
+            {
+                strcpy(air_frame, frame);
+                air_free = now + airtime(frame);
+                air_us += airtime(frame);
+            }
+        }
+    }
+
+    truth(&now_truth);
+    double elapsed = end / 1e6;
+    r.air = air_us / 1e6 / elapsed;
+    r.bytes = bytes / elapsed;
+    r.frames = frames / elapsed;
+    r.offered = offered / elapsed;
+    r.dropped = dropped / elapsed;
+    r.age_ms = ages ? age_sum / ages : 0;
+    r.decode_errors = dec.errors;
+    r.settled = memcmp(&view, &now_truth, sizeof(view)) == 0;
+    return r;
+}
+
+static void print(const char *name, const result_t *r)
+{
+    fprintf(stderr, "%-10s %5.0f%% %7.1f %7.2f %8.1f %8.1f %9.0f %9.0f %9.0f %8s\n", name, r->air * 100, r->bytes,
+            r->frames, r->offered, r->dropped, r->age_ms, r->age_max_ms, r->failsafe_ms, r->settled ? "yes" : "no");
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t seconds = argc > 1 ? (uint32_t)atoi(argv[1]) : 300;
+    result_t fifo, reg;
+
+    if (seconds < FAILSAFE_AT_S + 60)
+        seconds = FAILSAFE_AT_S + 60;
+
+    fprintf(stderr, "%u s drive + %d s quiet, air %d us + %d us/B, a core 0 tick every %d ms\n\n", seconds, QUIET_S,
+            AIRTIME_BASE_US, AIRTIME_BYTE_US, TICK_US / 1000);
+    fprintf(stderr, "%-10s %6s %7s %7s %8s %8s %9s %9s %9s %8s\n", "", "air", "B/s", "frm/s", "items/s", "drops/s",
+            "age ms", "max ms", "fault ms", "settled");
+
+    fifo = run(false, seconds);
+    reg = run(true, seconds);
+    print("fifo", &fifo);
+    print("registers", &reg);
+    fprintf(stderr, "\n");
+
+    check(reg.air < fifo.air / 2, "less than half the airtime");
+    check(reg.age_ms < fifo.age_ms / 2, "values reach the ground station fresher");
+    check(reg.failsafe_ms >= 0 && (fifo.failsafe_ms < 0 || reg.failsafe_ms < fifo.failsafe_ms),
+          "the failsafe reaches the ground station, sooner");
+    check(!reg.decode_errors && reg.settled, "ground station ends with every newest value");
+
+    return check_summary();
+}
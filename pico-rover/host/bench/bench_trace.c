@@ -0,0 +1,269 @@
+/**
+ * @file bench_trace.c
+ * @brief Trace ring checks, then a traced run of the firmware for trace_hist
+ *
+ *     ./bench_trace [commands per link] | ./trace_hist
+ *
+ * First the rings on their own: a lapped ring returns its newest records and
+ * counts the rest as lost, a writer on core 1 racing the reader never yields a
+ * torn or out-of-order record, and the cost of one trace point. Then the
+ * firmware's main() runs against the host HAL with a scripted LoRa module: the
+ * ground station completes the handshake, acknowledges the rover's frames and
+ * sends $MTR items and the odd $CMD at random moments, then the SBC sends $MTR lines on USB
+ * stdin. "$REQ TRACE" drains the rings every few commands, so the $TRC dump
+ * lines go to stdout with the rest of the firmware output. Results go to stderr.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "host_hal.h"
+#include "fake_modem.h"
+#include "comms.h"
+#include "config.h"
+#include "mtrbox.h"
+#include "trace.h"
+#include "bench_check.h"
+
+#define BOOT_MS             2500        // main() sleeps 2 s before it starts
+#define RACE_MS             500
+#define TIMING_EVENTS       10000000L
+#define GAP_MAX_US          30000       // commands arrive at random within this
+#define DUMP_EVERY          10          // commands between "$REQ TRACE"; well within a ring per core
+#define CMD_EVERY           5           // ground station $MTR items per $CMD frame
+
+int rover_main(void);
+
+static void check_lapped(void)
+{
+    static trace_record_t out[TRACE_RING_SIZE];
+    const long written = 4 * TRACE_RING_SIZE + 7;
+    bool ordered = true;
+    size_t n;
+
+    trace_init();
+    for (long i = 0; i < written; i++)
+        trace_event(TRACE_MTR_POST, (uint32_t)i);
+    n = trace_read(0, out, TRACE_RING_SIZE);
+    for (size_t i = 0; i < n; i++)
+        ordered &= out[i].arg == (uint32_t)(written - (long)n + (long)i) && out[i].core == 0;
+
+    check(n == TRACE_RING_SIZE - 1 && ordered, "lapped ring returns its newest records in order");
+    check(trace_rings[0].lost == (uint32_t)(written - (long)n), "the rest counted as lost");
+    check(!trace_read(0, out, TRACE_RING_SIZE), "and it is drained");
+}
+
+static volatile bool racing;
+static volatile long race_written;
+
+// the LoRa core tracing flat out; arg counts, the event follows from it
+static void writer(void)
+{
+    for (uint32_t i = 0; racing; i++)
+    {
+        trace_event((TRACE_EVENT)(i % TRACE_EVENTS), i);
+        race_written = i + 1;
+    }
+}
+
+static void check_race(void)
+{
+    static trace_record_t out[64];
+    long read = 0, torn = 0, backwards = 0;
+    uint32_t last = 0;
+    size_t n;
+
+    trace_init();
+    racing = true;
+    multicore_launch_core1(writer);
+
+    absolute_time_t end = make_timeout_time_ms(RACE_MS);
+    while (!time_reached(end))
+    {
+        n = trace_read(1, out, sizeof(out) / sizeof(out[0]));
+        for (size_t i = 0; i < n; i++)
+        {
+            torn += out[i].event != out[i].arg % TRACE_EVENTS || out[i].core != 1;
+            backwards += read && out[i].arg <= last;
+            last = out[i].arg;
+            read++;
+        }
+    }
+    racing = false;
+    sleep_ms(10);
+    while ((n = trace_read(1, out, sizeof(out) / sizeof(out[0]))))
+        read += (long)n;
+
+    fprintf(stderr, "\nwriter on core 1 and reader racing for %d ms: %ld written, %ld read, %lu lost\n", RACE_MS,
+            race_written, read, (unsigned long)trace_rings[1].lost);
+    check(!torn, "no torn record");
+    check(!backwards, "never out of order");
+    check(read + (long)trace_rings[1].lost == race_written, "every record read or counted as lost");
+}
+
+static void check_cost(void)
+{
+    trace_init();
+    absolute_time_t t = get_absolute_time();
+    for (long i = 0; i < TIMING_EVENTS; i++)
+        TRACE(TRACE_MTR_TAKE, i);
+    double ns = absolute_time_diff_us(t, get_absolute_time()) * 1000.0 / TIMING_EVENTS;
+    fprintf(stderr, "\nTRACE(): %.1f ns per event on the host (ROVER_TRACE=%d)\n", ns, ROVER_TRACE);
+}
+
+/*
+ * the ground station, behind the fake module
+ */
+
+static pthread_mutex_t gs_lock = PTHREAD_MUTEX_INITIALIZER;
+static int gs_seq;                      // next data frame's sequence number
+static int gs_ack;                      // next rover frame expected
+static volatile bool gs_connected;
+
+static void gs_answer(fake_modem_t *m, const char *line, void *ctx)
+{
+    char payload[LORA_SIZE];
+    FRAME frame;
+
+    // AT+SEND=<address>,<length>,<stuffed frame>
+    if (strncmp(line, "AT+SEND=", 8) != 0)
+        return;
+    snprintf(payload, sizeof(payload), "%s", strchr(strchr(line, ',') + 1, ',') + 1);
+    if (parseData(&frame, payload))
+        return;
+
+    pthread_mutex_lock(&gs_lock);
+    if (strcmp(frame.flag, "SYN") == 0)
+    {
+        gs_seq = 0;
+        gs_ack = frame.seq + 1;
+        formatFrame(payload, sizeof(payload), gs_seq++, gs_ack, 0, "SYN", NULL, 0);
+        gs_connected = true;
+    }
+    else if (frame.data)
+    {
+        if (frame.seq == gs_ack)
+            gs_ack++;
+        formatFrame(payload, sizeof(payload), gs_seq, gs_ack, 0, "ACK", NULL, 0);
+    }
+    else
+    {
+        *payload = '\0';
+    }
+    pthread_mutex_unlock(&gs_lock);
+
+    if (*payload)
+        fake_modem_receive(m, GS_ADDRESS, payload, -40, 10);
+}
+
+static void gs_send_cmd(fake_modem_t *m, const char *text)
+{
+    char payload[LORA_SIZE];
+
+    pthread_mutex_lock(&gs_lock);
+    formatFrame(payload, sizeof(payload), gs_seq++, gs_ack, 0, "$CMD", text, strlen(text));
+    pthread_mutex_unlock(&gs_lock);
+    fake_modem_receive(m, GS_ADDRESS, payload, -40, 10);
+}
+
+static void gs_send_mtr(fake_modem_t *m, int left, int right)
+{
+    char item[32];
+    char agg[LORA_SIZE];
+    char payload[LORA_SIZE];
+    int len;
+
+    snprintf(item, sizeof(item), "1 %d 0 %d", left, right);
+    len = aggAppend(agg, sizeof(agg), 0, "$MTR", item);
+    pthread_mutex_lock(&gs_lock);
+    formatFrame(payload, sizeof(payload), gs_seq++, gs_ack, 0, "AGG", agg, (size_t)len);
+    pthread_mutex_unlock(&gs_lock);
+    fake_modem_receive(m, GS_ADDRESS, payload, -40, 10);
+}
+
+static const fake_modem_rule_t modem_script[] = {
+    { NULL, "+OK", 0 },
+};
+
+static void *core0(void *arg)
+{
+    rover_main();
+    return NULL;
+}
+
+static void dump(void)
+{
+    host_stdin_push("$REQ TRACE\n", 11);
+}
+
+static void run_firmware(long n)
+{
+    fake_modem_t modem;
+    pthread_t thread;
+    char line[32];
+
+    fake_modem_init(&modem, UART_ID_LORA, modem_script, 1, gs_answer, NULL);
+    fake_modem_start(&modem);
+    pthread_create(&thread, NULL, core0, NULL);
+    sleep_ms(BOOT_MS);
+
+    for (int i = 0; i < 100 && !gs_connected; i++)
+        sleep_ms(10);
+    check(gs_connected, "rover connected to the ground station");
+    sleep_ms(100);
+    dump();
+
+    for (long i = 1; i <= n; i++)
+    {
+        sleep_us(1000 + rand() % GAP_MAX_US);
+        gs_send_mtr(&modem, (int)(i % 100), (int)(100 - i % 100));
+        if (!(i % CMD_EVERY))
+        {
+            sleep_us(1000 + rand() % GAP_MAX_US);
+            gs_send_cmd(&modem, "forward 10");
+        }
+        if (!(i % DUMP_EVERY))
+            dump();
+    }
+    // the ground station holds the wheels for MTRBOX_HOLD_MS after its last command
+    sleep_ms(MTRBOX_HOLD_MS + 100);
+    dump();
+
+    for (long i = 1; i <= n; i++)
+    {
+        sleep_us(1000 + rand() % GAP_MAX_US);
+        snprintf(line, sizeof(line), "$MTR 1 %ld 0 %ld\n", i % 100, 100 - i % 100);
+        host_stdin_push(line, strlen(line));
+        if (!(i % DUMP_EVERY))
+            dump();
+    }
+    sleep_ms(100);
+    dump();
+    sleep_ms(200);
+    fflush(stdout);
+
+    fprintf(stderr, "\nfirmware: %ld $MTR and %ld $CMD over LoRa, then %ld $MTR over USB; %u frames injected\n", n,
+            n / CMD_EVERY, n, modem.injected);
+}
+
+int main(int argc, char **argv)
+{
+    long n = argc > 1 ? atol(argv[1]) : 200;
+
+    srand(1);
+    check_lapped();
+    check_race();
+    check_cost();
+    run_firmware(n);
+    return check_summary();
+}
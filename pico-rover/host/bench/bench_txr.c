@@ -0,0 +1,279 @@
+/**
+ * @file bench_txr.c
+ * @brief Long $TXR messages over the simulated link: effective bytes/s for 1 KB to 16 KB, and intact reassembly
+ *
+ *     ./bench_txr > /dev/null
+ *
+ * comm_run() runs unchanged on core 1 against sim_lora, as in sim_link. The
+ * bench is the SBC and core 0: it sends each message as "$TXR + <piece>"
+ * lines of PIECE_SIZE bytes through the command dispatcher, as fast as they
+ * parse, and waits for the ground station to put it back together. Each size
+ * goes once over a clean channel and once with LOSS of the frames lost, each
+ * channel in a process of its own.
+ *
+ * Effective bytes/s is the message length over the time from its first piece
+ * to the ground station having all of it. The ceiling is what the air carries
+ * if every frame were a full fragment sent back to back, with no acks. Last,
+ * the reassembly buffers on their own: a partial message expiring, and one
+ * evicted by more messages than there are buffers. Firmware output goes to
+ * stdout, results go to stderr.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "host_hal.h"
+#include "sim_lora.h"
+#include "binproto.h"
+#include "commands.h"
+#include "comms.h"
+#include "stats.h"
+#include "txring.h"
+#include "varint.h"
+#include "bench_check.h"
+
+#define AIR_BASE_US         10000       // sim_link's fast air
+#define AIR_BYTE_US         250
+#define LATENCY_US          2000
+#define LOSS                0.05
+#define PIECE_SIZE          200         // SBC line: "$TXR + " and this much, within FRAMER_LINE_SIZE
+#define SIZES               5
+#define SETUP_LIMIT_MS      60000
+#define MESSAGE_LIMIT_MS    120000
+#define CHILD_LIMIT_S       600
+
+static const size_t sizes[SIZES] = { 1024, 2048, 4096, 8192, 16384 };
+
+typedef struct result
+{
+    bool up;
+    bool delivered[SIZES];
+    bool intact[SIZES];         // the ground station's CRC matches
+    double seconds[SIZES];
+    uint32_t fragments;
+    uint32_t refused;
+    uint32_t gs_errors;
+    uint32_t retransmits;
+} result_t;
+
+static uint8_t message[FRAG_MAX_MESSAGE];
+
+// printable text, with the ',' and '=' the modem can't carry as they come
+static void make_message(size_t len, uint32_t seed)
+{
+    uint32_t x = seed * 2654435761u + 1;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        message[i] = (uint8_t)(' ' + x % 95);
+    }
+}
+
+// the SBC: one $TXR line per piece, through the same parser and dispatcher as USB input
+static bool send_message(size_t len)
+{
+    char line[FRAMER_LINE_SIZE];
+    command_t cmd;
+    size_t piece;
+
+    for (size_t sent = 0; sent < len; sent += piece)
+    {
+        piece = len - sent < PIECE_SIZE ? len - sent : PIECE_SIZE;
+        snprintf(line, sizeof(line), "$TXR %s %.*s", sent + piece < len ? "+" : ".", (int)piece,
+                 (const char *)message + sent);
+        if (parse_command(line, &cmd) || dispatch_command(&cmd))
+            return false;
+    }
+    return true;
+}
+
+// a fragment of message as the rover cuts them, HALF bytes at offset
+#define HALF                100
+
+static size_t fragment(uint8_t *out, uint32_t id, uint32_t offset)
+{
+    size_t len = varint_put(id, out);
+
+    len += varint_put(offset, out + len);
+    len += varint_put(2 * HALF, out + len);
+    memcpy(out + len, message + offset, HALF);
+    return len + HALF;
+}
+
+// the reassembly buffers directly, in simulated time
+static void check_buffers(void)
+{
+    static frag_rx_t rx;
+    uint8_t frg[ARQ_DATA_SIZE];
+    const uint8_t *got;
+    size_t size, n;
+    absolute_time_t t = 0;
+    bool ok;
+
+    make_message(2 * HALF, 99);
+    frag_rx_init(&rx);
+
+    // the second half comes too late: its start has been dropped
+    n = fragment(frg, 1, 0);
+    frag_receive(&rx, frg, n, t, &got, &size);
+    t += (FRAG_TIMEOUT_MS + 1) * 1000ull;
+    n = fragment(frg, 1, HALF);
+    ok = frag_receive(&rx, frg, n, t, &got, &size) == FRAG_ERROR && rx.expired == 1;
+    check(ok, "a partial message expires after FRAG_TIMEOUT_MS");
+
+    // one more message started than there are buffers: the one idle longest goes
+    for (uint32_t id = 10; id <= 10 + FRAG_SLOTS; id++, t += 1000)
+    {
+        n = fragment(frg, id, 0);
+        frag_receive(&rx, frg, n, t, &got, &size);
+    }
+    n = fragment(frg, 10, HALF);
+    ok = frag_receive(&rx, frg, n, t, &got, &size) == FRAG_ERROR && rx.evicted == 1;
+    n = fragment(frg, 10 + FRAG_SLOTS, HALF);
+    ok = ok && frag_receive(&rx, frg, n, t, &got, &size) == FRAG_MESSAGE && size == 2 * HALF &&
+         memcmp(got, message, size) == 0;
+    check(ok, "a new message with every buffer in use evicts the oldest");
+}
+
+static result_t run(const sim_channel_t *channel)
+{
+    sim_lora_t sim;
+    sim_lora_stats_t s;
+    result_t r = { 0 };
+    absolute_time_t start, end;
+    uint32_t before;
+
+    framer_init(&lora_framer, 0);
+    tx_ring_init(&lora_tx, UART_ID_LORA);
+    msg_channel_init(&receive_queue);
+    msg_channel_init(&error_queue);
+    tx_sched_init(&transmit_queue);
+    frag_tx_init(&txr_queue);
+
+    sim_lora_init(&sim, UART_ID_LORA, channel);
+    sim_lora_start(&sim);
+    multicore_launch_core1(comm_run);
+
+    end = make_timeout_time_ms(SETUP_LIMIT_MS);
+    do
+    {
+        sleep_ms(1);
+        sim_lora_get_stats(&sim, &s);
+    } while (!s.handshakes && !time_reached(end));
+    if (!(r.up = s.handshakes > 0))
+        return r;
+
+    for (int i = 0; i < SIZES; i++)
+    {
+        make_message(sizes[i], (uint32_t)i + 1);
+        before = s.txr_messages;
+        start = get_absolute_time();
+        if (!send_message(sizes[i]))
+            continue;
+
+        end = make_timeout_time_ms(MESSAGE_LIMIT_MS);
+        do
+        {
+            sleep_ms(1);
+            sim_lora_get_stats(&sim, &s);
+        } while (s.txr_messages == before && !time_reached(end));
+
+        r.delivered[i] = s.txr_messages == before + 1;
+        r.intact[i] = r.delivered[i] && s.txr_crc == crc16_ccitt(message, sizes[i], 0xFFFF);
+        r.seconds[i] = absolute_time_diff_us(start, s.txr_last) / 1e6;
+    }
+
+    r.fragments = txr_queue.fragments;
+    r.refused = txr_queue.refused;
+    r.gs_errors = s.txr_errors;
+    r.retransmits = lora_link_stats.retransmits;
+    return r;
+}
+
+// each channel in a child process: comm_run() never returns, and its state is static
+// in a process of its own, see sim_run_child()
+static void run_child(const void *channel, void *r)
+{
+    *(result_t *)r = run(channel);
+}
+
+static void print(const char *name, const result_t *r, double ceiling)
+{
+    fprintf(stderr, "%s: %lu fragments, %lu retransmitted, %lu refused, %lu dropped at the ground station\n", name,
+            (unsigned long)r->fragments, (unsigned long)r->retransmits, (unsigned long)r->refused,
+            (unsigned long)r->gs_errors);
+    for (int i = 0; i < SIZES; i++)
+    {
+        if (!r->delivered[i])
+        {
+            fprintf(stderr, "  %6zu B  not delivered\n", sizes[i]);
+            continue;
+        }
+        fprintf(stderr, "  %6zu B  %7.2f s  %6.0f B/s  %3.0f%% of the ceiling  %s\n", sizes[i], r->seconds[i],
+                sizes[i] / r->seconds[i], sizes[i] / r->seconds[i] / ceiling * 100, r->intact[i] ? "intact" : "CORRUPT");
+    }
+}
+
+static bool all(const bool *ok)
+{
+    for (int i = 0; i < SIZES; i++)
+    {
+        if (!ok[i])
+            return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    sim_channel_t clean = {
+        .airtime_base_us = AIR_BASE_US,
+        .airtime_byte_us = AIR_BYTE_US,
+        .latency_us = LATENCY_US,
+        .rssi = -60,
+        .snr = 9,
+        .seed = 1,
+    };
+    sim_channel_t lossy = clean;
+    result_t r_clean, r_lossy;
+    bool ran_clean, ran_lossy;
+    // a full fragment carries about ARQ_DATA_SIZE bytes of message in a LORA_SIZE frame
+    double ceiling = ARQ_DATA_SIZE / (sim_lora_airtime_us(&clean, LORA_SIZE) / 1e6);
+
+    lossy.loss = LOSS;
+    fprintf(stderr, "air %u us + %u us/B, %d B $TXR pieces from the SBC, ceiling %.0f B/s\n\n", clean.airtime_base_us,
+            clean.airtime_byte_us, PIECE_SIZE, ceiling);
+
+    ran_clean = sim_run_child(run_child, &clean, &r_clean, sizeof(r_clean), CHILD_LIMIT_S) && r_clean.up;
+    ran_lossy = sim_run_child(run_child, &lossy, &r_lossy, sizeof(r_lossy), CHILD_LIMIT_S) && r_lossy.up;
+    if (ran_clean)
+        print("clean", &r_clean, ceiling);
+    if (ran_lossy)
+        print("5% loss", &r_lossy, ceiling);
+    fprintf(stderr, "\n");
+
+    check(ran_clean && ran_lossy, "both runs connected and finished");
+    if (ran_clean && ran_lossy)
+    {
+        check(all(r_clean.delivered) && all(r_lossy.delivered), "every message reassembled");
+        check(all(r_clean.intact) && all(r_lossy.intact), "byte for byte");
+        check(!r_clean.refused && !r_lossy.refused && !r_clean.gs_errors && !r_lossy.gs_errors,
+              "nothing refused or dropped");
+        check(sizes[SIZES - 1] / r_clean.seconds[SIZES - 1] >= ceiling / 2, "16 KB at half the ceiling or better");
+    }
+    check_buffers();
+
+    return check_summary();
+}
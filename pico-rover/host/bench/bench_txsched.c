@@ -0,0 +1,230 @@
+/**
+ * @file bench_txsched.c
+ * @brief Outbound scheduler under load: per-class queueing delay and drops against one FIFO
+ *
+ *     ./bench_txsched [seconds] > /dev/null
+ *
+ * comm_run() runs unchanged on core 1 against sim_lora, as in sim_link. The
+ * bench is core 0 and offers more than the air carries: a STATUS_SIZE $TX
+ * from the SBC every CORE0_TICK_MS and a fault report every
+ * CONTROL_PERIOD_MS. Two runs, each in a process of its own:
+ *
+ *   - fifo: every item in one class, like the single transmit_queue before
+ *     the scheduler; a fault report waits behind whatever $TX got in first,
+ *     and is refused with them when the queue is full
+ *   - classes: each item in its own class
+ *
+ * A last case runs the scheduler alone: a fault report queued between
+ * tx_peek() and taking the item peeked at, as aggregateQueue() can meet it.
+ *
+ * Queueing delay is from tx_send() to the item being taken into a frame, as
+ * "$REQ STATS" reports it, over the run. Firmware output goes to stdout,
+ * results go to stderr.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "host_hal.h"
+#include "sim_lora.h"
+#include "comms.h"
+#include "stats.h"
+#include "txring.h"
+#include "bench_check.h"
+
+#define AIR_BASE_US         10000       // sim_link's fast air
+#define AIR_BYTE_US         250
+#define LATENCY_US          2000
+#define CORE0_TICK_MS       20          // as main.c
+#define STATUS_SIZE         64
+#define CONTROL_PERIOD_MS   1000
+#define SETUP_LIMIT_MS      60000
+#define CHILD_LIMIT_S       300
+
+typedef struct result
+{
+    bool up;
+    double offered;             // B/s core 0 tried to queue
+    double goodput;             // B/s delivered to the ground station
+    uint32_t offered_items[TX_CLASSES];
+    stats_tx_t tx[TX_CLASSES];
+} result_t;
+
+static char status[STATUS_SIZE + 1];
+
+// core 0: whatever is due, into its own class, or all into one
+static void produce(bool classes, uint32_t now_ms, uint32_t *due, result_t *r)
+{
+    static const uint32_t period[TX_CLASSES] = { CONTROL_PERIOD_MS, CORE0_TICK_MS };
+    const char *text[TX_CLASSES] = { "$ERR Command timeout: motors stopped", status };
+
+    for (int cls = 0; cls < TX_CLASSES; cls++)
+    {
+        if ((int32_t)(now_ms - due[cls]) < 0)
+            continue;
+        due[cls] += period[cls];
+        r->offered_items[cls]++;
+        r->offered += strlen(text[cls]);
+        tx_send_text(&transmit_queue, classes ? (TX_CLASS)cls : TX_STATUS, text[cls]);
+    }
+}
+
+static result_t run(bool classes, const sim_channel_t *channel, uint32_t seconds)
+{
+    sim_lora_t sim;
+    sim_lora_stats_t s, before;
+    result_t r = { 0 };
+    rover_stats_t snap;
+    uint32_t due[TX_CLASSES];
+    absolute_time_t start, end;
+
+    framer_init(&lora_framer, 0);
+    tx_ring_init(&lora_tx, UART_ID_LORA);
+    msg_channel_init(&receive_queue);
+    msg_channel_init(&error_queue);
+    tx_sched_init(&transmit_queue);
+
+    sim_lora_init(&sim, UART_ID_LORA, channel);
+    sim_lora_start(&sim);
+    multicore_launch_core1(comm_run);
+
+    end = make_timeout_time_ms(SETUP_LIMIT_MS);
+    do
+    {
+        sleep_ms(1);
+        sim_lora_get_stats(&sim, &s);
+    } while (!s.handshakes && !time_reached(end));
+    if (!(r.up = s.handshakes > 0))
+        return r;
+
+    // the counters start here
+    stats_snapshot(&snap);
+    sim_lora_get_stats(&sim, &before);
+    start = get_absolute_time();
+    end = make_timeout_time_ms(seconds * 1000);
+    for (int cls = 0; cls < TX_CLASSES; cls++)
+        due[cls] = to_ms_since_boot(start);
+    while (!time_reached(end))
+    {
+        produce(classes, to_ms_since_boot(get_absolute_time()), due, &r);
+        sleep_ms(1);
+    }
+    stats_snapshot(&snap);
+    sim_lora_get_stats(&sim, &s);
+
+    double elapsed = absolute_time_diff_us(start, get_absolute_time()) / 1e6;
+    r.offered /= elapsed;
+    r.goodput = (s.bytes - before.bytes) / elapsed;
+    memcpy(r.tx, snap.tx, sizeof(r.tx));
+    return r;
+}
+
+typedef struct job
+{
+    bool classes;
+    const sim_channel_t *channel;
+    uint32_t seconds;
+} job_t;
+
+// in a process of its own, see sim_run_child()
+static void run_child(const void *arg, void *r)
+{
+    const job_t *job = arg;
+
+    *(result_t *)r = run(job->classes, job->channel, job->seconds);
+}
+
+// core 0 queues a fault report while core 1 is packing the item it peeked at
+static void peek_race(void)
+{
+    static tx_sched_t sched;
+    const char *peeked;
+    char *taken;
+    TX_CLASS cls;
+    size_t len;
+
+    tx_sched_init(&sched);
+    tx_send_text(&sched, TX_STATUS, "status");
+    peeked = tx_peek(&sched, &cls, &len);
+    tx_send_text(&sched, TX_CONTROL, "control");
+    taken = tx_take(&sched, cls, &len);
+    check(taken == peeked && cls == TX_STATUS, "peek, fault report, take: the peeked item is taken");
+    tx_release(&sched, cls, taken);
+
+    peeked = tx_peek(&sched, &cls, &len);
+    check(peeked && cls == TX_CONTROL && !strcmp(peeked, "control") && tx_level(&sched) == 1,
+          "the fault report is still queued, once");
+}
+
+static void print(const char *mode, const result_t *r)
+{
+    fprintf(stderr, "%s: offered %.0f B/s, delivered %.0f B/s\n", mode, r->offered, r->goodput);
+    for (int cls = 0; cls < TX_CLASSES; cls++)
+    {
+        const stats_tx_t *t = &r->tx[cls];
+
+        if (!t->sent && !t->dropped)
+            continue;
+        fprintf(stderr, "  %-8s %6lu sent %6lu dropped   delay %7.1f ms mean %7.1f ms max\n",
+                tx_class_names[cls], (unsigned long)t->sent, (unsigned long)t->dropped,
+                t->delay_mean_us / 1000.0, t->delay_max_us / 1000.0);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t seconds = argc > 1 ? (uint32_t)atoi(argv[1]) : 10;
+    sim_channel_t channel = {
+        .airtime_base_us = AIR_BASE_US,
+        .airtime_byte_us = AIR_BYTE_US,
+        .latency_us = LATENCY_US,
+        .rssi = -60,
+        .snr = 9,
+        .seed = 1,
+    };
+    result_t fifo, classes;
+    bool ran_fifo, ran_classes;
+
+    memset(status, 's', STATUS_SIZE);
+
+    fprintf(stderr, "air %u us + %u us/B (%.0f ms for a full frame); %d B $TX every %d ms, a fault every %d ms; "
+            "%u s per run\n\n", channel.airtime_base_us, channel.airtime_byte_us,
+            sim_lora_airtime_us(&channel, LORA_SIZE) / 1000.0, STATUS_SIZE, CORE0_TICK_MS, CONTROL_PERIOD_MS,
+            seconds);
+
+    job_t job = { false, &channel, seconds };
+
+    ran_fifo = sim_run_child(run_child, &job, &fifo, sizeof(fifo), CHILD_LIMIT_S) && fifo.up;
+    job.classes = true;
+    ran_classes = sim_run_child(run_child, &job, &classes, sizeof(classes), CHILD_LIMIT_S) && classes.up;
+    if (ran_fifo)
+        print("one FIFO", &fifo);
+    if (ran_classes)
+        print("classes", &classes);
+    fprintf(stderr, "\n");
+
+    check(ran_fifo && ran_classes, "both runs connected and finished");
+    if (ran_fifo && ran_classes)
+    {
+        const stats_tx_t *control = &classes.tx[TX_CONTROL];
+        const stats_tx_t *all = &fifo.tx[TX_STATUS];
+
+        check(!control->dropped && control->sent == classes.offered_items[TX_CONTROL],
+              "every fault report queued");
+        check(classes.tx[TX_STATUS].dropped > 0, "$TX past the air's rate refused at tx_alloc()");
+        check(control->delay_max_us < all->delay_mean_us, "worst fault delay below the FIFO's mean");
+        check(classes.goodput >= fifo.goodput * 0.9, "no throughput lost to the scheduling");
+    }
+    peek_race();
+
+    return check_summary();
+}
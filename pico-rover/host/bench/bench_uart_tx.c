@@ -0,0 +1,160 @@
+/**
+ * @file bench_uart_tx.c
+ * @brief Time core 1 spends handing an AT+SEND to the LoRa UART: blocking writes vs the TX ring
+ *
+ *     ./bench_uart_tx [commands]
+ *
+ * A wire thread takes bytes out of the simulated UART at BAUD_RATE_LORA (10 bits
+ * a byte) behind the RP2040's 32-byte TX FIFO. Each full-size AT+SEND is written
+ * the way lora_write() did (uart_tx_wait_blocking() + uart_puts()) and then through
+ * tx_ring_write() with the TX interrupt draining the ring; the time inside the
+ * call is time the protocol core can't look at received lines. A last run
+ * writes commands back to back to show the ring's backpressure: refused writes,
+ * stall time and high-water mark.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "hardware/uart.h"
+#include "host_hal.h"
+#include "comms.h"
+#include "config.h"
+#include "main.h"
+#include "txring.h"
+
+#define BYTE_US             (10e6 / BAUD_RATE_LORA)
+#define BURST_MS            2000
+
+static volatile bool wire_running;
+static volatile uint64_t wire_bytes;
+
+// the far end of the TX pin: one byte per character time
+static void *wire(void *arg)
+{
+    absolute_time_t start = get_absolute_time();
+    uint8_t buf[64];
+
+    while (wire_running)
+    {
+        uint64_t due = (uint64_t)(absolute_time_diff_us(start, get_absolute_time()) / BYTE_US);
+
+        if (due <= wire_bytes)
+        {
+            sleep_us(200);
+            continue;
+        }
+        size_t max = due - wire_bytes < sizeof(buf) ? (size_t)(due - wire_bytes) : sizeof(buf);
+        size_t n = host_uart_tx_pop(UART_ID_LORA, buf, max, 1000);
+        wire_bytes += n;
+        // an idle line isn't owed the time it sat idle
+        if (!n)
+            start = delayed_by_us(start, 1000);
+    }
+    return NULL;
+}
+
+typedef struct calls
+{
+    double sum_us;
+    double max_us;
+    long n;
+} calls_t;
+
+static void calls_add(calls_t *c, int64_t us)
+{
+    c->sum_us += (double)us;
+    if (us > c->max_us)
+        c->max_us = (double)us;
+    c->n++;
+}
+
+static void wait_sent(void)
+{
+    while (tx_ring_level(&lora_tx))
+        sleep_us(500);
+    uart_tx_wait_blocking(UART_ID_LORA);
+}
+
+int main(int argc, char **argv)
+{
+    long n = argc > 1 ? atol(argv[1]) : 40;
+    char payload[LORA_SIZE + 1];
+    char cmd[AT_COMMAND_SIZE];
+    calls_t blocking = {0}, ring = {0};
+    pthread_t thread;
+    int len;
+
+    memset(payload, 'x', LORA_SIZE);
+    payload[LORA_SIZE] = '\0';
+    len = snprintf(cmd, sizeof(cmd), "AT+SEND=%d,%d,%s\r\n", GS_ADDRESS, LORA_SIZE, payload);
+
+    framer_init(&lora_framer, 0);
+    tx_ring_init(&lora_tx, UART_ID_LORA);
+    configure_UART_IRQ(UART_ID_LORA, on_UART_LORA_irq);
+
+    wire_running = true;
+    pthread_create(&thread, NULL, wire, NULL);
+
+    printf("%ld x %d B AT+SEND at %d baud (%.1f us/B, %.1f ms on the wire each)\n", n, len, BAUD_RATE_LORA,
+           BYTE_US, len * BYTE_US / 1000);
+
+    for (long i = 0; i < n; i++)
+    {
+        absolute_time_t t0 = get_absolute_time();
+        uart_tx_wait_blocking(UART_ID_LORA);
+        uart_puts(UART_ID_LORA, cmd);
+        calls_add(&blocking, absolute_time_diff_us(t0, get_absolute_time()));
+        wait_sent();
+    }
+
+    for (long i = 0; i < n; i++)
+    {
+        absolute_time_t t0 = get_absolute_time();
+        tx_ring_write(&lora_tx, cmd, (size_t)len);
+        calls_add(&ring, absolute_time_diff_us(t0, get_absolute_time()));
+        wait_sent();
+    }
+
+    printf("%-36s %10s %10s\n", "", "mean us", "max us");
+    printf("%-36s %10.1f %10.1f\n", "uart_tx_wait_blocking + uart_puts", blocking.sum_us / blocking.n,
+           blocking.max_us);
+    printf("%-36s %10.1f %10.1f\n", "tx_ring_write", ring.sum_us / ring.n, ring.max_us);
+    printf("ring high-water %u B, %u refused, %.1f ms stalled\n\n", lora_tx.high_water, lora_tx.rejected,
+           lora_tx.stall_us / 1000.0);
+
+    // back to back: the producer offers the next command as soon as the ring takes it
+    tx_ring_init(&lora_tx, UART_ID_LORA);
+    uint64_t bytes = wire_bytes;
+    long accepted = 0, offers = 0;
+    absolute_time_t t0 = get_absolute_time();
+    absolute_time_t end = make_timeout_time_ms(BURST_MS);
+    while (!time_reached(end))
+    {
+        offers++;
+        if (tx_ring_write(&lora_tx, cmd, (size_t)len))
+            accepted++;
+        else
+            sleep_us(1000);     // the protocol loop doing other work meanwhile
+    }
+    double s = absolute_time_diff_us(t0, get_absolute_time()) / 1e6;
+    bytes = wire_bytes - bytes;
+    wait_sent();
+    printf("back to back for %d ms: %ld of %ld writes accepted, wire at %.0f B/s (line rate %.0f B/s)\n", BURST_MS,
+           accepted, offers, bytes / s, 1e6 / BYTE_US);
+    printf("ring high-water %u B, %u refused, %.1f ms stalled\n", lora_tx.high_water, lora_tx.rejected,
+           lora_tx.stall_us / 1000.0);
+
+    wire_running = false;
+    pthread_join(thread, NULL);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,140 @@
+/**
+ * @file rover_profile.c
+ * @brief Host profiling driver for handle_input(), protocol() and comm_run()
+ *
+ * Runs each hot path in a loop against the host HAL so it can be profiled with
+ * perf/valgrind. Firmware output goes to stdout, results go to stderr:
+ *
+ *     ./rover_profile [iterations] > /dev/null
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "main.h"
+#include "comms.h"
+#include "motors.h"
+#include "host_hal.h"
+#include "fake_modem.h"
+
+static const char *input_mix[] = {
+    "$MTR 1 50 0 25\n",
+    "$ACK 42\n",
+    "$CMD forward 10\n",
+    "$MTR 0 100 1 100\n",
+    "$REQ\n",
+};
+
+static double elapsed_ns(absolute_time_t start, long n)
+{
+    return (double)absolute_time_diff_us(start, get_absolute_time()) * 1000.0 / (double)n;
+}
+
+static void profile_handle_input(long iterations)
+{
+    size_t mix = sizeof(input_mix) / sizeof(input_mix[0]);
+
+    absolute_time_t start = get_absolute_time();
+    for (long i = 0; i < iterations; i++)
+        handle_input(input_mix[i % mix]);
+    fprintf(stderr, "handle_input: %ld messages, %.1f ns/message\n", iterations, elapsed_ns(start, iterations));
+}
+
+static void profile_protocol(long iterations)
+{
+    char in[LORA_SIZE];
+    char out[LORA_SIZE];
+    char frame[LORA_SIZE];
+    static STATE state = {ESTABLISHED, 0, 0};
+
+    arq_start(&state, ARQ_WINDOW);
+
+    // rover sends one telemetry frame, the ground station acknowledges it
+    absolute_time_t start = get_absolute_time();
+    for (long i = 0; i < iterations; i++)
+    {
+        arq_queue(&state, "ACK", "data");
+        arq_poll(&state, get_absolute_time(), out, sizeof(out));
+        int len = formatFrame(frame, sizeof(frame), (int)i, state.seq, 0, "ACK", NULL, 0);
+        snprintf(in, sizeof(in), "+RCV=101,%d,%s,-40,10\r\n", len, frame);
+        protocol(&state, in, out);
+    }
+    fprintf(stderr, "protocol:     %ld frames, %.1f ns/frame\n", iterations, elapsed_ns(start, iterations));
+}
+
+// a module that takes every command
+static const fake_modem_rule_t modem_script[] = {
+    { NULL, "+OK", 0 },
+};
+
+static void profile_comm_run(long exchanges)
+{
+    char payload[LORA_SIZE];
+    const char *line;
+    fake_modem_t modem;
+    int gs_seq = 0;
+    long done = 0;
+    absolute_time_t start = 0;
+
+    fake_modem_init(&modem, UART_ID_LORA, modem_script, 1, NULL, NULL);
+    multicore_launch_core1(comm_run);
+
+    while (done < exchanges && (line = fake_modem_step(&modem, 5000000)))
+    {
+        tx_send_text(&transmit_queue, TX_STATUS, "data");
+
+        // AT+NETWORKID / AT+ADDRESS
+        if (strncmp(line, "AT+SEND=", 8) != 0)
+            continue;
+
+        if (!start)
+            start = get_absolute_time();
+
+        // AT+SEND=<address>,<length>,<stuffed frame>
+        FRAME frame;
+        snprintf(payload, sizeof(payload), "%s", strchr(strchr(line, ',') + 1, ',') + 1);
+        if (parseData(&frame, payload))
+            continue;
+
+        if (strcmp(frame.flag, "SYN") == 0)
+            formatFrame(payload, sizeof(payload), gs_seq, frame.seq + 1, 0, "SYN", NULL, 0);
+        else if (frame.data)
+            formatFrame(payload, sizeof(payload), gs_seq + 1, frame.seq + 1, 0, "ACK", NULL, 0);
+        else
+            continue;   // bare ACK
+
+        fake_modem_receive(&modem, GS_ADDRESS, payload, -40, 10);
+        done++;
+    }
+
+    if (done)
+        fprintf(stderr, "comm_run:     %ld exchanges, %.1f us/exchange\n",
+                done, elapsed_ns(start, done) / 1000.0);
+    else
+        fprintf(stderr, "comm_run:     no traffic from core 1\n");
+}
+
+int main(int argc, char **argv)
+{
+    long iterations = argc > 1 ? atol(argv[1]) : 100000;
+
+    framer_init(&lora_framer, 0);
+    tx_ring_init(&lora_tx, UART_ID_LORA);
+    msg_channel_init(&receive_queue);
+    msg_channel_init(&error_queue);
+    tx_sched_init(&transmit_queue);
+    configure_PWM();
+
+    profile_handle_input(iterations);
+    profile_protocol(iterations);
+    profile_comm_run(iterations / 1000 + 10);
+
+    return EXIT_SUCCESS;
+}
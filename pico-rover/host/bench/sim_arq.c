@@ -0,0 +1,283 @@
+/**
+ * @file sim_arq.c
+ * @brief Goodput of the LoRa selective-repeat ARQ against window size over a simulated lossy link
+ *
+ *     ./sim_arq [seconds] [loss,loss,...]
+ *
+ * Rover and ground station both run arq.c on simulated time. Frames go through
+ * formatFrame()/parseData() as on the air. The channel is half duplex: one
+ * frame at a time, airtime = preamble + per-byte time (SF9/BW125-like), plus a
+ * fixed modem latency, and each frame is lost with the given probability.
+ * The ground station sends a $CMD every 2 s. A frame that runs out of tries
+ * drops the connection, which costs a handshake before data flows again.
+ *
+ * First table: the rover always has a full frame of telemetry to send.
+ * Second table: small telemetry items arrive at a fixed rate into a
+ * MSG_POOL_SIZE-deep channel, sent one per frame or packed with aggregateQueue().
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "comms.h"
+
+#define STEP_US             1000
+#define AIRTIME_BASE_US     60000       // preamble + header
+#define AIRTIME_BYTE_US     4500
+#define LATENCY_US          20000       // UART + modem processing
+#define CMD_PERIOD_US       2000000
+#define TELEMETRY_SIZE      180
+#define ITEM_SIZE           24
+
+typedef struct load
+{
+    double item_rate;           // items/s; 0: always a full TELEMETRY_SIZE frame waiting
+    bool aggregate;
+} load_t;
+
+typedef struct node
+{
+    STATE state;
+    absolute_time_t next_cmd;
+    uint64_t bytes;             // payload delivered to this node
+    uint64_t items;
+} node_t;
+
+typedef struct flight
+{
+    node_t *to;
+    absolute_time_t arrive;
+    bool lost;
+    char data[LORA_SIZE];
+} flight_t;
+
+typedef struct result
+{
+    double goodput;             // payload bytes/s delivered to the ground station
+    double frames;              // telemetry frames/s
+    uint32_t sent;
+    uint32_t retransmits;
+    uint32_t acks;
+    uint32_t resets;
+    uint32_t srtt_ms;           // rover's estimate at the end
+    uint32_t rto_ms;
+    double items;               // items/s delivered to the ground station
+    uint32_t dropped;           // items that found the rover's queue full
+    double airtime;             // share of time the channel was busy
+    double per_frame;           // items per rover data frame
+} result_t;
+
+static void link_up(node_t *rover, node_t *gs, int window)
+{
+    rover->state.seq = 0;
+    rover->state.ack = 0;
+    gs->state.seq = 0;
+    gs->state.ack = 0;
+    arq_rtt_reset(&rover->state);
+    arq_rtt_reset(&gs->state);
+    arq_start(&rover->state, window);
+    arq_start(&gs->state, window);
+}
+
+static void receive(node_t *node, char *data, absolute_time_t now)
+{
+    FRAME frame;
+    const ARQ_SLOT *slot;
+
+    if (parseData(&frame, data))
+        return;
+    arq_receive(&node->state, &frame, now);
+
+    while ((slot = arq_peek(&node->state)))
+    {
+        if (strcmp(slot->flag, "AGG") == 0)
+        {
+            const char *cursor = slot->data;
+            char flag[FLAG_SIZE];
+            char item[LORA_SIZE];
+
+            while (aggNext(&cursor, flag, item, sizeof(item)) == EXIT_SUCCESS)
+            {
+                node->bytes += strlen(item);
+                node->items++;
+            }
+        }
+        else
+        {
+            node->bytes += slot->len;
+            node->items++;
+        }
+        arq_pop(&node->state);
+    }
+}
+
+static result_t simulate(int window, double loss, double seconds, load_t load)
+{
+    static node_t rover, gs;
+    static tx_sched_t queue;            // status class: kept in full, like the old FIFO
+    flight_t flight = {0};
+    char telemetry[TELEMETRY_SIZE + 1];
+    char item[LORA_SIZE];
+    absolute_time_t end = (absolute_time_t)(seconds * 1e6);
+    absolute_time_t channel_free = 0;
+    absolute_time_t next_item = 0;
+    absolute_time_t busy = 0;
+    uint32_t resets = 0, dropped = 0;
+    int turn = 0;
+
+    memset(&rover, 0, sizeof(rover));
+    memset(&gs, 0, sizeof(gs));
+    link_up(&rover, &gs, window);
+    memset(telemetry, 'T', TELEMETRY_SIZE);
+    telemetry[TELEMETRY_SIZE] = '\0';
+    memset(item, 'i', ITEM_SIZE);
+    item[ITEM_SIZE] = '\0';
+    tx_sched_init(&queue);
+    srand(7);
+
+    for (absolute_time_t now = 0; now < end; now += STEP_US)
+    {
+        if (flight.to && now >= flight.arrive)
+        {
+            if (!flight.lost)
+                receive(flight.to, flight.data, now);
+            flight.to = NULL;
+        }
+
+        // applications
+        if (load.item_rate == 0)
+        {
+            while (!arq_window_full(&rover.state))
+                arq_queue(&rover.state, "ACK", telemetry);
+        }
+        else
+        {
+            if (now >= next_item)
+            {
+                if (!tx_send_text(&queue, TX_STATUS, item))
+                    dropped++;
+                next_item = now + (absolute_time_t)(1e6 / load.item_rate);
+            }
+            if (!load.aggregate)
+            {
+                TX_CLASS cls;
+                char *next;
+                size_t len;
+                while (!arq_window_full(&rover.state) && (next = tx_receive(&queue, &cls, &len)))
+                {
+                    arq_queue(&rover.state, "ACK", next);
+                    tx_release(&queue, cls, next);
+                }
+            }
+            else if (now >= channel_free && !arq_unsent(&rover.state))
+            {
+                // as comm_run(): pack whatever waited while the radio was busy
+                aggregateQueue(&rover.state, &queue, "ACK");
+            }
+        }
+        if (now >= gs.next_cmd && !arq_window_full(&gs.state))
+        {
+            arq_queue(&gs.state, "$CMD", "$MTR 1 50 1 50");
+            gs.next_cmd = now + CMD_PERIOD_US;
+        }
+
+        if (now < channel_free)
+            continue;
+
+        // whoever has something to send takes the free channel; alternate who asks first
+        for (int i = 0; i < 2; i++)
+        {
+            node_t *from = (turn + i) & 1 ? &gs : &rover;
+            node_t *to = from == &rover ? &gs : &rover;
+            ARQ_EVENT event = arq_poll(&from->state, now, flight.data, sizeof(flight.data));
+
+            if (event == ARQ_FAILED)
+            {
+                // SYN, SYN, ACK before data flows again
+                resets++;
+                channel_free = now + 3 * (AIRTIME_BASE_US + 12 * AIRTIME_BYTE_US + LATENCY_US);
+                flight.to = NULL;
+                link_up(&rover, &gs, window);
+                break;
+            }
+            if (event == ARQ_SEND)
+            {
+                absolute_time_t airtime = AIRTIME_BASE_US + strlen(flight.data) * AIRTIME_BYTE_US;
+                flight.to = to;
+                flight.arrive = now + airtime + LATENCY_US;
+                flight.lost = (double)rand() / RAND_MAX < loss;
+                channel_free = flight.arrive;
+                busy += airtime;
+                break;
+            }
+        }
+        turn ^= 1;
+    }
+
+    result_t r = {
+        .goodput = (double)gs.bytes / seconds,
+        .frames = (double)gs.bytes / TELEMETRY_SIZE / seconds,
+        .sent = rover.state.stats.sent + gs.state.stats.sent,
+        .retransmits = rover.state.stats.retransmits + gs.state.stats.retransmits,
+        .acks = rover.state.stats.acks + gs.state.stats.acks,
+        .resets = resets,
+        .srtt_ms = rover.state.srtt_us / 1000,
+        .rto_ms = arq_rto(&rover.state) / 1000,
+        .items = (double)gs.items / seconds,
+        .dropped = dropped,
+        .airtime = (double)busy / (double)end,
+        .per_frame = (double)gs.items / (rover.state.stats.sent - rover.state.stats.retransmits),
+    };
+    return r;
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = argc > 1 ? atof(argv[1]) : 1800;
+    const char *losses = argc > 2 ? argv[2] : "0,0.05,0.1,0.2,0.3";
+    static const int windows[] = {1, 2, 4, 8, 16};
+
+    printf("%.0f s simulated, %d B telemetry frames, airtime %d ms + %.1f ms/B, RTO %d..%d ms\n\n",
+           seconds, TELEMETRY_SIZE, AIRTIME_BASE_US / 1000, AIRTIME_BYTE_US / 1000.0, ARQ_RTO_MIN_MS, ARQ_RTO_MAX_MS);
+    printf(" loss window  goodput B/s  frames/s   data+retx   bare acks  resets   srtt    rto\n");
+
+    for (const char *p = losses; p && *p; p = strchr(p, ','), p = p ? p + 1 : NULL)
+    {
+        double loss = atof(p);
+        for (size_t w = 0; w < sizeof(windows) / sizeof(windows[0]); w++)
+        {
+            result_t r = simulate(windows[w], loss, seconds, (load_t){0, false});
+            printf("%4.0f%% %6d %12.1f %9.3f %6u+%-6u %9u %7u %6u %6u\n", loss * 100, windows[w], r.goodput,
+                   r.frames, r.sent - r.retransmits, r.retransmits, r.acks, r.resets, r.srtt_ms, r.rto_ms);
+        }
+        printf("\n");
+    }
+
+    static const double rates[] = {1, 2, 4, 8};
+
+    printf("%d B items into a %d-deep channel, window %d\n\n", ITEM_SIZE, MSG_POOL_SIZE, ARQ_WINDOW);
+    printf(" loss items/s  one per frame: delivered dropped airtime   aggregated: delivered dropped airtime items/frame\n");
+    for (const char *p = losses; p && *p; p = strchr(p, ','), p = p ? p + 1 : NULL)
+    {
+        double loss = atof(p);
+        for (size_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++)
+        {
+            result_t one = simulate(ARQ_WINDOW, loss, seconds, (load_t){rates[i], false});
+            result_t agg = simulate(ARQ_WINDOW, loss, seconds, (load_t){rates[i], true});
+            printf("%4.0f%% %8.0f %24.2f %7u %6.0f%% %22.2f %7u %6.0f%% %11.2f\n", loss * 100, rates[i],
+                   one.items, one.dropped, one.airtime * 100, agg.items, agg.dropped, agg.airtime * 100,
+                   agg.per_frame);
+        }
+        printf("\n");
+    }
+
+    return EXIT_SUCCESS;
+}
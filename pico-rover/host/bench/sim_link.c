@@ -0,0 +1,345 @@
+/**
+ * @file sim_link.c
+ * @brief End to end LoRa link: comm_run() against a simulated module, channel and ground station
+ *
+ *     ./sim_link [seconds] [sf9] > /dev/null
+ *
+ * comm_run() runs unchanged on core 1, talking AT to sim_lora, which plays the
+ * RYLR896, the air and a ground station running arq.c, in real time. The
+ * bench is core 0: it keeps transmit_queue full of ITEM_SIZE status items,
+ * which are never shed, and drains the ground station's $CMDs from
+ * receive_queue. Each scenario runs
+ * in a process of its own, so every one starts from a freshly booted rover:
+ *
+ *   - setup: comm_run() starting to the connection being up at the ground
+ *     station, and the handshake alone (first SYN the ground station heard to
+ *     the rover's ACK); a lost SYN costs the rover's ARQ_RTO_INIT_MS
+ *   - goodput: telemetry bytes delivered in order to the ground station over
+ *     [seconds], against what the air could carry
+ *   - recovery: after a SHORT_OUTAGE_MS outage, from its end to the next
+ *     delivery; the ARQ retransmits what was lost
+ *   - reconnect (one scenario): after a LONG_OUTAGE_MS outage, long enough
+ *     for the rover to give up on the connection, to the next delivery over a
+ *     new one
+ *   - teardown: the ground station's FIN to the rover's FIN
+ *
+ * The default air is fast (FAST_* below) so a run takes a couple of minutes;
+ * "sf9" uses SF9/BW125-like timing, as sim_arq does, and wants more seconds.
+ * The UART itself isn't paced, see bench_uart_tx for that. Firmware output
+ * goes to stdout, results go to stderr.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "host_hal.h"
+#include "sim_lora.h"
+#include "comms.h"
+#include "stats.h"
+#include "txring.h"
+#include "bench_check.h"
+
+#define FAST_BASE_US        10000       // preamble + header
+#define FAST_BYTE_US        250
+#define SF9_BASE_US         60000
+#define SF9_BYTE_US         4500
+#define LATENCY_US          2000
+#define CMD_PERIOD_MS       2000
+#define ITEM_SIZE           48
+#define SHORT_OUTAGE_MS     2000
+#define LONG_OUTAGE_MS      20000       // past the rover's ARQ_MAX_TRIES backoffs at the fast airtime
+#define SETUP_LIMIT_MS      60000       // longest wait for a connection
+#define RECOVER_LIMIT_MS    60000
+#define TEARDOWN_LIMIT_MS   20000
+#define CHILD_LIMIT_S       600
+
+typedef struct scenario
+{
+    const char *name;
+    double loss;
+    uint32_t jitter_us;
+    double reorder;
+    bool long_outage;
+} scenario_t;
+
+static const scenario_t scenarios[] = {
+    { "clean",              0.00, 0,      0.00, false },
+    { "10% loss",           0.10, 0,      0.00, false },
+    { "30% loss",           0.30, 0,      0.00, false },
+    { "jitter + reorder",   0.05, 0,      0.10, false },    // jitter_us filled in from the airtime
+    { "link lost",          0.00, 0,      0.00, true  },
+};
+
+#define SCENARIOS           (sizeof(scenarios) / sizeof(scenarios[0]))
+
+typedef struct result
+{
+    bool up;
+    double boot_ms;             // comm_run() start to connected
+    double setup_ms;            // handshake alone
+    double goodput;             // bytes/s delivered in order to the ground station
+    double items;               // items/s
+    double air;                 // share of time the air was busy
+    double recover_ms;          // short outage end to the next delivery; -1: never
+    double reconnect_ms;        // long outage end to the next delivery; -1: never, 0: not run
+    uint32_t rover_resets;      // connections the rover gave up on
+    uint32_t handshakes;
+    uint32_t frames;            // both ways
+    uint32_t lost;
+    uint32_t retransmits;       // the rover's
+    uint32_t cmds;              // $CMDs that reached core 0
+    uint32_t cmds_sent;
+    double teardown_ms;         // -1: no FIN back
+} result_t;
+
+static char item[ITEM_SIZE + 1];
+static uint32_t cmds_received;
+
+// core 0: telemetry for as long as there is room, and the ground station's commands taken off the queue
+static void pump(void)
+{
+    char *buf;
+    size_t len;
+
+    while (msg_level(&transmit_queue.channel[TX_STATUS]) < TX_STATUS_DEPTH &&
+           tx_send_text(&transmit_queue, TX_STATUS, item))
+        ;
+    while ((buf = msg_receive(&receive_queue, &len)))
+    {
+        cmds_received++;
+        msg_release(&receive_queue, buf);
+    }
+}
+
+static void run_for(uint32_t ms)
+{
+    absolute_time_t end = make_timeout_time_ms(ms);
+
+    while (!time_reached(end))
+    {
+        pump();
+        sleep_ms(1);
+    }
+}
+
+/**
+ * @brief Waits, pumping, until the ground station delivers something after since
+ * @return double ms from since to that delivery; -1 if none within limit_ms
+ */
+static double wait_delivery(sim_lora_t *sim, absolute_time_t since, uint32_t limit_ms)
+{
+    absolute_time_t end = make_timeout_time_ms(limit_ms);
+    sim_lora_stats_t s;
+
+    while (!time_reached(end))
+    {
+        pump();
+        sleep_ms(1);
+        sim_lora_get_stats(sim, &s);
+        if (s.last_delivery > since)
+            return absolute_time_diff_us(since, s.last_delivery) / 1000.0;
+    }
+    return -1;
+}
+
+// the most the air carries: AGG frames as full as aggregateQueue() makes them, back to back, nothing else on it
+static double payload_ceiling(const sim_channel_t *channel)
+{
+    char agg[ARQ_DATA_SIZE];
+    char frame[LORA_SIZE];
+    int len = 0, next, items = 0;
+
+    while ((next = aggAppend(agg, sizeof(agg), (size_t)len, "ACK", item)) >= 0 &&
+           loraStuffedSize(agg, (size_t)next) < ARQ_DATA_SIZE)
+    {
+        len = next;
+        items++;
+    }
+    agg[len] = '\0';
+    len = formatFrame(frame, sizeof(frame), 1000, 1000, 0, "AGG", agg, (size_t)len);
+    return items * ITEM_SIZE * 1e6 / sim_lora_airtime_us(channel, (size_t)len);
+}
+
+static result_t run_scenario(const scenario_t *sc, const sim_channel_t *channel, uint32_t seconds)
+{
+    sim_lora_t sim;
+    sim_lora_stats_t s, before;
+    result_t r = { .recover_ms = -1, .teardown_ms = -1 };
+    absolute_time_t start, end;
+    sim_channel_t ch = *channel;
+
+    ch.loss = sc->loss;
+    ch.reorder = sc->reorder;
+    if (sc->reorder > 0)
+    {
+        // enough for a frame to be overtaken by the next one
+        ch.jitter_us = sim_lora_airtime_us(&ch, LORA_SIZE) / 2;
+        ch.reorder_us = 2 * sim_lora_airtime_us(&ch, LORA_SIZE);
+    }
+
+    framer_init(&lora_framer, 0);
+    tx_ring_init(&lora_tx, UART_ID_LORA);
+    msg_channel_init(&receive_queue);
+    msg_channel_init(&error_queue);
+    tx_sched_init(&transmit_queue);
+
+    sim_lora_init(&sim, UART_ID_LORA, &ch);
+    sim_lora_start(&sim);
+    start = get_absolute_time();
+    multicore_launch_core1(comm_run);
+
+    // setup
+    end = make_timeout_time_ms(SETUP_LIMIT_MS);
+    do
+    {
+        pump();
+        sleep_ms(1);
+        sim_lora_get_stats(&sim, &s);
+    } while (!s.handshakes && !time_reached(end));
+    if (!(r.up = s.handshakes > 0))
+        return r;
+    r.boot_ms = absolute_time_diff_us(start, s.established) / 1000.0;
+    r.setup_ms = s.setup_us / 1000.0;
+
+    // goodput
+    sim_lora_get_stats(&sim, &before);
+    start = get_absolute_time();
+    run_for(seconds * 1000);
+    sim_lora_get_stats(&sim, &s);
+    double elapsed = absolute_time_diff_us(start, get_absolute_time()) / 1e6;
+    r.goodput = (s.bytes - before.bytes) / elapsed;
+    r.items = (s.items - before.items) / elapsed;
+    r.air = (s.air_us - before.air_us) / 1e6 / elapsed;
+
+    // a short outage: the ARQ retransmits through it
+    sim_lora_outage(&sim, SHORT_OUTAGE_MS);
+    run_for(SHORT_OUTAGE_MS);
+    r.recover_ms = wait_delivery(&sim, get_absolute_time(), RECOVER_LIMIT_MS);
+
+    // a long one: the rover gives up and connects again
+    if (sc->long_outage)
+    {
+        sim_lora_outage(&sim, LONG_OUTAGE_MS);
+        run_for(LONG_OUTAGE_MS);
+        r.reconnect_ms = wait_delivery(&sim, get_absolute_time(), RECOVER_LIMIT_MS);
+    }
+
+    // teardown
+    sim_lora_close(&sim);
+    end = make_timeout_time_ms(TEARDOWN_LIMIT_MS);
+    do
+    {
+        pump();
+        sleep_ms(1);
+        sim_lora_get_stats(&sim, &s);
+    } while (s.teardown_us < 0 && !time_reached(end));
+    r.teardown_ms = s.teardown_us < 0 ? -1 : s.teardown_us / 1000.0;
+
+    r.rover_resets = lora_link_stats.resets;
+    r.handshakes = s.handshakes;
+    r.frames = s.frames[0] + s.frames[1];
+    r.lost = s.lost[0] + s.lost[1];
+    r.retransmits = lora_link_stats.retransmits;
+    r.cmds = cmds_received;
+    r.cmds_sent = s.cmds;
+    return r;
+}
+
+// each scenario in a child process: comm_run() never returns, and its state is static
+typedef struct job
+{
+    const scenario_t *sc;
+    const sim_channel_t *channel;
+    uint32_t seconds;
+} job_t;
+
+// in a process of its own, see sim_run_child()
+static void run_child(const void *arg, void *r)
+{
+    const job_t *job = arg;
+
+    *(result_t *)r = run_scenario(job->sc, job->channel, job->seconds);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t seconds = argc > 1 ? (uint32_t)atoi(argv[1]) : 10;
+    bool sf9 = argc > 2 && strcmp(argv[2], "sf9") == 0;
+    sim_channel_t channel = {
+        .airtime_base_us = sf9 ? SF9_BASE_US : FAST_BASE_US,
+        .airtime_byte_us = sf9 ? SF9_BYTE_US : FAST_BYTE_US,
+        .latency_us = LATENCY_US,
+        .rssi = -60,
+        .snr = 9,
+        .cmd_period_ms = CMD_PERIOD_MS,
+        .seed = 1,
+    };
+    result_t results[SCENARIOS];
+    bool ran[SCENARIOS];
+    double ceiling;
+
+    memset(item, 'x', ITEM_SIZE);
+    ceiling = payload_ceiling(&channel);
+
+    fprintf(stderr, "air %u us + %u us/B (%.0f ms for a full frame), %d B items, window %d, %u s per scenario\n",
+            channel.airtime_base_us, channel.airtime_byte_us, sim_lora_airtime_us(&channel, LORA_SIZE) / 1000.0,
+            ITEM_SIZE, ARQ_WINDOW, seconds);
+    fprintf(stderr, "payload ceiling %.0f B/s: full AGG frames back to back\n\n", ceiling);
+    fprintf(stderr, "%-18s %8s %8s %9s %7s %5s %10s %10s %9s %7s %7s %6s\n", "", "boot ms", "setup ms", "goodput",
+            "items/s", "air", "recover ms", "reconn ms", "close ms", "lost", "retx", "$CMD");
+
+    for (size_t i = 0; i < SCENARIOS; i++)
+    {
+        result_t *r = &results[i];
+        job_t job = { &scenarios[i], &channel, seconds };
+
+        ran[i] = sim_run_child(run_child, &job, r, sizeof(*r), CHILD_LIMIT_S);
+        if (!ran[i])
+        {
+            fprintf(stderr, "%-18s did not finish\n", scenarios[i].name);
+            continue;
+        }
+        if (!r->up)
+        {
+            fprintf(stderr, "%-18s no connection\n", scenarios[i].name);
+            continue;
+        }
+        fprintf(stderr, "%-18s %8.0f %8.0f %9.0f %7.1f %4.0f%% %10.0f %10.0f %9.0f %3u/%-3u %7u %3u/%-3u\n",
+                scenarios[i].name, r->boot_ms, r->setup_ms, r->goodput, r->items, r->air * 100, r->recover_ms,
+                r->reconnect_ms, r->teardown_ms, r->lost, r->frames, r->retransmits, r->cmds, r->cmds_sent);
+    }
+
+    fprintf(stderr, "\n");
+    bool up = true, recovered = true, closed = true;
+    for (size_t i = 0; i < SCENARIOS; i++)
+    {
+        up &= ran[i] && results[i].up;
+        recovered &= ran[i] && results[i].recover_ms >= 0;
+    }
+    check(up, "every scenario connects");
+    check(recovered, "delivery resumes after a short outage in every scenario");
+
+    const result_t *clean = &results[0];
+    const result_t *lossy = &results[2];
+    const result_t *lost = &results[SCENARIOS - 1];
+    check(ran[0] && clean->goodput > ceiling / 4, "clean link: goodput at least 1/4 of the payload ceiling");
+    check(ran[0] && ran[2] && clean->goodput > lossy->goodput, "30% loss costs goodput");
+    check(ran[0] && !clean->rover_resets && clean->handshakes == 1, "clean link: one connection throughout");
+    // the last one may still be in flight when the FIN goes out
+    check(ran[0] && clean->cmds && clean->cmds + 1 >= clean->cmds_sent, "clean link: every $CMD reaches core 0");
+    check(ran[SCENARIOS - 1] && lost->rover_resets && lost->handshakes >= 2 && lost->reconnect_ms >= 0,
+          "long outage: the rover gives up, then connects again");
+    closed = ran[0] && clean->teardown_ms >= 0 && ran[SCENARIOS - 1] && lost->teardown_ms >= 0;
+    check(closed, "FIN answered on a clean link");
+
+    return check_summary();
+}
@@ -0,0 +1,304 @@
+/**
+ * @file sim_motor.c
+ * @brief Wheel speed control loop against a DC motor plant model, for tuning the PID gains
+ *
+ *     ./sim_motor [kp ki kff kstatic]
+ *
+ * Gains are in PWM levels per count/s (ki per second) and default to the
+ * firmware's wheel_gains. One wheel is simulated on a 10 us clock: a
+ * first-order DC motor whose free speed scales with battery voltage, with
+ * Coulomb friction and a load, turning an encoder whose edges go through
+ * encoder_edge() at the times they happen. The loop runs encoder_update() and
+ * pid_step() the way the firmware's control_tick() does, at each rate with
+ * timer jitter. A fixed script steps the setpoint, adds a hill, sags the
+ * battery, reverses and crawls, and each segment is scored on the true wheel
+ * speed: steady-state error, overshoot and 10-90% rise time. Open loop
+ * (feed-forward only, what set_PWM() amounts to) is run for comparison. Last,
+ * the real control loop runs on the host timer for a second to show the
+ * jitter and execution-time statistics $REQ CTL reports.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "encoder.h"
+#include "motors.h"
+#include "pid.h"
+#define BENCH_CHECK_OUT stdout
+#include "bench_check.h"
+
+#define SIM_STEP_US         10
+#define TIMER_JITTER_US     20
+#define V_NOMINAL           12.0
+#define FREE_RPM            330.0       // full PWM at V_NOMINAL, unloaded
+#define TAU_S               0.08        // mechanical time constant
+#define FRICTION_RPM        6.0         // Coulomb friction, as the speed it would cost
+#define SCORE_MS            300         // steady state is the end of each segment
+#define CPS(rpm)            ((rpm) * ENC_COUNTS_PER_REV / 60.0)
+
+typedef struct segment
+{
+    double start_s;
+    double rpm;                         // setpoint
+    double load_rpm;                    // load torque, as the speed it would cost
+    double volts;
+    const char *what;
+} segment_t;
+
+static const segment_t script[] = {
+    { 0.0,  100, 0,  12.6, "start to 100" },
+    { 1.0,  250, 0,  12.6, "100 to 250" },
+    { 2.0,  250, 40, 12.6, "hill" },
+    { 3.0,  250, 40, 10.8, "battery sag" },
+    { 4.0, -150, 40, 10.8, "reverse" },
+    { 5.0,   20, 0,  10.8, "crawl" },
+    { 6.0,    0, 0,  10.8, "stop" },
+};
+#define SEGMENTS            (sizeof(script) / sizeof(script[0]))
+#define END_S               7.0
+
+static const uint8_t gray[4] = { 0, 2, 3, 1 };      // A leads B forward
+
+typedef struct score
+{
+    double ss_err;                      // mean |error| at the end of the segment, % of setpoint
+    double overshoot;                   // % of the step; after a disturbance, worst error in % of setpoint
+    double rise_ms;                     // 10-90% of the step, -1 if never
+    double final_rpm;
+} score_t;
+
+typedef struct plant
+{
+    double w;                           // counts/s
+    double pos;                         // counts
+    long edge;                          // encoder position
+} plant_t;
+
+/**
+ * @brief Advances the motor by one step at a signed PWM level
+ */
+static void plant_step(plant_t *m, const segment_t *seg, int32_t level, encoder_t *enc, uint32_t now_us)
+{
+    double dt = SIM_STEP_US / 1e6;
+    double drive = CPS(FREE_RPM) * seg->volts / V_NOMINAL * level / PWM_WRAP;
+    double load = CPS(seg->load_rpm);
+    double friction;
+    double before = m->pos;
+    double w;
+
+    // the load is a hill, pulling backwards whichever way the wheel turns; friction holds a
+    // stopped wheel until the rest beats it
+    if (m->w == 0)
+    {
+        if (fabs(drive - load) <= CPS(FRICTION_RPM))
+            return;
+        friction = drive - load > 0 ? CPS(FRICTION_RPM) : -CPS(FRICTION_RPM);
+    }
+    else
+    {
+        friction = m->w > 0 ? CPS(FRICTION_RPM) : -CPS(FRICTION_RPM);
+    }
+    w = m->w + (drive - load - friction - m->w) / TAU_S * dt;
+    if ((m->w > 0 && w < 0) || (m->w < 0 && w > 0))
+        w = 0;
+    m->w = w;
+    m->pos += w * dt;
+
+    // an edge at each whole count crossed, stamped when it was crossed
+    while (floor(m->pos) != m->edge)
+    {
+        long next = m->pos > before ? m->edge + 1 : m->edge - 1;
+        double boundary = m->pos > before ? (double)next : (double)m->edge;
+        double frac = (boundary - before) / (m->pos - before);
+        uint32_t pins = (uint32_t)(gray[next & 3] >> 1) << enc->pin_a | (uint32_t)(gray[next & 3] & 1) << enc->pin_b;
+
+        encoder_edge(enc, pins, now_us - SIM_STEP_US + (uint32_t)(frac * SIM_STEP_US));
+        m->edge = next;
+    }
+}
+
+/**
+ * @brief Runs the script at one loop rate; closed loop unless open
+ */
+static void run(const pid_gains_t *gains, uint hz, bool open, score_t *scores)
+{
+    pid_gains_t g = *gains;
+    pid_ctl_t pid;
+    encoder_t enc;
+    plant_t m = {0};
+    uint32_t period_us = 1000000 / hz;
+    uint32_t next_us = period_us;
+    int32_t level = 0;
+    size_t s = 0;
+    double seg_from = 0, peak = 0, t10 = -1, t90 = -1, err_sum = 0;
+    long err_n = 0;
+
+    memset(scores, 0, sizeof(score_t) * SEGMENTS);
+    if (open)
+        g.kp = g.ki = g.kd = 0;
+    pid_init(&pid, &g, period_us, PWM_WRAP);
+    encoder_init(&enc, ENC_RIGHT_A_PIN, ENC_RIGHT_B_PIN, 0);
+    srand(7);
+
+    for (uint32_t now = 0; now <= END_S * 1e6; now += SIM_STEP_US)
+    {
+        const segment_t *seg = &script[s];
+        double rpm = m.w * 60 / ENC_COUNTS_PER_REV;
+        double t = now / 1e6;
+
+        if (s + 1 < SEGMENTS && t >= script[s + 1].start_s)
+        {
+            scores[s].ss_err = seg->rpm ? err_sum / err_n / fabs(seg->rpm) * 100 : err_sum / err_n;
+            scores[s].final_rpm = rpm;
+            seg_from = rpm;
+            peak = rpm;
+            t10 = t90 = -1;
+            err_sum = 0;
+            err_n = 0;
+            seg = &script[++s];
+        }
+
+        plant_step(&m, seg, level, &enc, now);
+
+        // the control loop, as control_tick() runs it
+        if (now >= next_us)
+        {
+            int32_t sp = (int32_t)(CPS(seg->rpm) * (1 << ENC_VEL_SHIFT));
+
+            encoder_update(&enc, now);
+            if (!sp)
+            {
+                pid_reset(&pid);
+                level = 0;
+            }
+            else
+            {
+                level = pid_step(&pid, sp, enc.velocity);
+            }
+            next_us += period_us + (uint32_t)(rand() % (2 * TIMER_JITTER_US + 1)) - TIMER_JITTER_US;
+        }
+
+        // scoring, on the true speed
+        double step = s && seg->rpm == script[s - 1].rpm ? 0 : seg->rpm - seg_from;
+        if (step)
+        {
+            double progress = (rpm - seg_from) / step;
+            if (t10 < 0 && progress >= 0.1)
+                t10 = t;
+            if (t90 < 0 && progress >= 0.9)
+                t90 = t;
+            if ((step > 0 && rpm > peak) || (step < 0 && rpm < peak))
+                peak = rpm;
+            scores[s].overshoot = fmax(0, (peak - seg->rpm) / step * 100);
+            scores[s].rise_ms = t10 >= 0 && t90 >= 0 ? (t90 - t10) * 1000 : -1;
+        }
+        else
+        {
+            if (seg->rpm && fabs(rpm - seg->rpm) / fabs(seg->rpm) * 100 > scores[s].overshoot)
+                scores[s].overshoot = fabs(rpm - seg->rpm) / fabs(seg->rpm) * 100;
+            scores[s].rise_ms = -1;
+        }
+        double end = s + 1 < SEGMENTS ? script[s + 1].start_s : END_S;
+        if (t >= end - SCORE_MS / 1000.0)
+        {
+            err_sum += fabs(rpm - seg->rpm);
+            err_n++;
+        }
+    }
+    scores[s].ss_err = err_n ? err_sum / err_n : 0;
+    scores[s].final_rpm = m.w * 60 / ENC_COUNTS_PER_REV;
+}
+
+static void print_run(const char *name, const score_t *scores)
+{
+    printf("%-14s", name);
+    for (size_t i = 0; i < SEGMENTS; i++)
+        printf(" %5.1f/%-4.0f", scores[i].ss_err, scores[i].overshoot);
+    printf("\n%-14s", "  rise ms");
+    for (size_t i = 0; i < SEGMENTS; i++)
+    {
+        if (scores[i].rise_ms >= 0)
+            printf(" %10.0f", scores[i].rise_ms);
+        else
+            printf(" %10s", "-");
+    }
+    printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+    static const uint rates[] = { MOTOR_CTL_MIN_HZ, MOTOR_CTL_HZ, MOTOR_CTL_MAX_HZ };
+    pid_gains_t gains = wheel_gains;
+    score_t open[SEGMENTS], closed[SEGMENTS];
+    bool tracks = true, damped = true, stops = true;
+    char name[16];
+
+    if (argc == 5)
+    {
+        gains.kp = (int32_t)(atof(argv[1]) * (1 << PID_SHIFT) / (1 << ENC_VEL_SHIFT));
+        gains.ki = (int32_t)(atof(argv[2]) * (1 << PID_SHIFT) / (1 << ENC_VEL_SHIFT));
+        gains.kff = (int32_t)(atof(argv[3]) * (1 << PID_SHIFT) / (1 << ENC_VEL_SHIFT));
+        gains.kstatic = atoi(argv[4]);
+    }
+    printf("kp %.3f ki %.3f kff %.3f levels per count/s, kstatic %d levels\n",
+           gains.kp * 256.0 / (1 << PID_SHIFT), gains.ki * 256.0 / (1 << PID_SHIFT),
+           gains.kff * 256.0 / (1 << PID_SHIFT), gains.kstatic);
+    printf("plant: %.0f RPM free at %.0f V, tau %.0f ms, friction %.0f RPM; timer jitter +-%d us\n\n", FREE_RPM,
+           V_NOMINAL, TAU_S * 1000, FRICTION_RPM, TIMER_JITTER_US);
+
+    printf("steady-state error %% / overshoot %% per segment (hill, sag: worst dip %%; stop: RPM left)\n%-14s", "");
+    for (size_t i = 0; i < SEGMENTS; i++)
+        printf(" %10.10s", script[i].what);
+    printf("\n");
+
+    run(&gains, MOTOR_CTL_HZ, true, open);
+    print_run("open loop", open);
+
+    for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); r++)
+    {
+        run(&gains, rates[r], false, closed);
+        snprintf(name, sizeof(name), "PID %u Hz", rates[r]);
+        print_run(name, closed);
+        for (size_t i = 0; i + 1 < SEGMENTS; i++)
+        {
+            tracks &= closed[i].ss_err < 2;
+            // a disturbance is allowed a bigger dip than a setpoint step an overshoot
+            damped &= closed[i].overshoot < (script[i].rpm == script[i ? i - 1 : 0].rpm && i ? 25 : 15);
+        }
+        stops &= fabs(closed[SEGMENTS - 1].final_rpm) < 0.5;
+    }
+
+    printf("\n");
+    check(tracks, "steady-state error < 2% through load and battery sag");
+    check(damped, "overshoot < 15%");
+    check(stops, "setpoint 0 stops the wheel");
+
+    // the firmware's own loop on the host timer
+    configure_encoders();
+    if (configure_motor_control(MOTOR_CTL_HZ))
+    {
+        check(false, "control loop started");
+        return EXIT_FAILURE;
+    }
+    motor_ctl_stats_t stats;
+    get_motor_ctl_stats(&stats);
+    set_velocity(100, 100);
+    sleep_ms(1000);
+    get_motor_ctl_stats(&stats);
+    printf("\nhost timer at %u Hz for 1 s: %lu runs, jitter mean %lu us max %lu us, exec mean %lu us max %lu us\n",
+           stats.hz, (unsigned long)stats.runs, (unsigned long)(stats.jitter_sum_us / (stats.runs ? stats.runs : 1)),
+           (unsigned long)stats.jitter_max_us, (unsigned long)(stats.exec_sum_us / (stats.runs ? stats.runs : 1)),
+           (unsigned long)stats.exec_max_us);
+    check(stats.runs > MOTOR_CTL_HZ / 2, "control loop runs");
+
+    return check_summary();
+}
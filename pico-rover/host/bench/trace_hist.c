@@ -0,0 +1,249 @@
+/**
+ * @file trace_hist.c
+ * @brief Per-stage latency histograms from "$REQ TRACE" dumps
+ *
+ *     ./trace_hist [dump file]          (stdin if none)
+ *     ./bench_trace | ./trace_hist
+ *
+ * Takes every "$TRC <core> <t_us> <event> <arg>" line, ignores everything
+ * else, and merges the records of both cores into one timeline; events with the
+ * same timestamp are ordered as the path runs. Each command is then followed
+ * back from its last event: the stage before it is the latest earlier event of
+ * that kind, with the same source where the event carries one. A command the
+ * mailbox coalesced, or that lost records to a full ring, never reaches its
+ * last event, so it is not counted. For each path the time in every stage and
+ * end to end is reported as percentiles and a power-of-2 histogram in us.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace.h"
+#include "mtrbox.h"
+
+#define ANY_ARG             UINT32_MAX
+#define MAX_STEPS           5
+#define BUCKETS             24          // [0], [1], [2,3], [4,7], ... us
+#define BAR_WIDTH           40
+
+typedef struct step
+{
+    TRACE_EVENT event;
+    uint32_t arg;                       // ANY_ARG, or the MTR_SOURCE the event must carry
+} step_t;
+
+typedef struct path
+{
+    const char *name;
+    int steps;
+    step_t step[MAX_STEPS];
+} path_t;
+
+static const path_t paths[] = {
+    { "ground station $MTR", 5, { { TRACE_LORA_RCV, ANY_ARG }, { TRACE_LORA_FRAME, ANY_ARG },
+                                  { TRACE_MTR_POST, MTR_SOURCE_LORA }, { TRACE_MTR_TAKE, MTR_SOURCE_LORA },
+                                  { TRACE_MTR_APPLY, MTR_SOURCE_LORA } } },
+    { "SBC $MTR", 4, { { TRACE_USB_LINE, ANY_ARG }, { TRACE_MTR_POST, MTR_SOURCE_USB },
+                       { TRACE_MTR_TAKE, MTR_SOURCE_USB }, { TRACE_MTR_APPLY, MTR_SOURCE_USB } } },
+    { "ground station $CMD", 4, { { TRACE_LORA_RCV, ANY_ARG }, { TRACE_LORA_FRAME, ANY_ARG },
+                                  { TRACE_CMD_QUEUE, ANY_ARG }, { TRACE_CMD_DISPATCH, ANY_ARG } } },
+};
+
+typedef struct samples
+{
+    uint32_t *us;
+    size_t n;
+    size_t size;
+} samples_t;
+
+static trace_record_t *records;
+static size_t n_records;
+
+static void samples_add(samples_t *s, uint32_t us)
+{
+    if (s->n == s->size)
+    {
+        s->size = s->size ? 2 * s->size : 256;
+        s->us = realloc(s->us, s->size * sizeof(s->us[0]));
+    }
+    s->us[s->n++] = us;
+}
+
+static int by_value(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+// by time; at the same microsecond, in the order the path runs
+static int by_time(const void *a, const void *b)
+{
+    const trace_record_t *x = a, *y = b;
+
+    if (x->t_us != y->t_us)
+        return x->t_us < y->t_us ? -1 : 1;
+    return (x->event > y->event) - (x->event < y->event);
+}
+
+static bool matches(const trace_record_t *r, const step_t *step)
+{
+    return r->event == step->event && (step->arg == ANY_ARG || r->arg == step->arg);
+}
+
+static int bucket_of(uint32_t us)
+{
+    int b = 0;
+
+    while (us && b < BUCKETS - 1)
+    {
+        us >>= 1;
+        b++;
+    }
+    return b;
+}
+
+static void report(const char *stage, samples_t *s)
+{
+    uint32_t count[BUCKETS] = {0};
+    uint32_t peak = 0;
+    int first = BUCKETS, last = -1;
+
+    if (!s->n)
+    {
+        printf("  %-28s %8s\n", stage, "-");
+        return;
+    }
+    qsort(s->us, s->n, sizeof(s->us[0]), by_value);
+    printf("  %-28s %8zu %8u %8u %8u %8u\n", stage, s->n, s->us[s->n / 2], s->us[s->n * 9 / 10],
+           s->us[s->n * 99 / 100], s->us[s->n - 1]);
+
+    for (size_t i = 0; i < s->n; i++)
+        count[bucket_of(s->us[i])]++;
+    for (int b = 0; b < BUCKETS; b++)
+    {
+        if (!count[b])
+            continue;
+        first = b < first ? b : first;
+        last = b;
+        peak = count[b] > peak ? count[b] : peak;
+    }
+    for (int b = first; b <= last; b++)
+    {
+        uint32_t lo = b ? 1u << (b - 1) : 0;
+        uint32_t hi = b ? (1u << b) - 1 : 0;
+        int width = (int)((uint64_t)count[b] * BAR_WIDTH / peak);
+
+        printf("      %7u-%-7u %7u |%.*s\n", lo, hi, count[b], width, "########################################");
+    }
+}
+
+static void analyse(const path_t *path)
+{
+    samples_t stage[MAX_STEPS] = {0};
+    size_t used[MAX_STEPS];
+    size_t at[MAX_STEPS];
+    char name[64];
+    size_t complete = 0;
+
+    // no record is the start of two commands' stages
+    for (int k = 0; k < path->steps; k++)
+        used[k] = SIZE_MAX;
+
+    for (size_t i = 0; i < n_records; i++)
+    {
+        int k = path->steps - 1;
+
+        if (!matches(&records[i], &path->step[k]))
+            continue;
+        at[k] = i;
+        for (k--; k >= 0; k--)
+        {
+            size_t j = at[k + 1];
+
+            while (j-- > 0 && !matches(&records[j], &path->step[k]))
+                ;
+            if (j == SIZE_MAX || (used[k] != SIZE_MAX && j <= used[k]))
+                break;
+            at[k] = j;
+        }
+        if (k >= 0)
+            continue;
+
+        for (k = 0; k < path->steps; k++)
+            used[k] = at[k];
+        for (k = 1; k < path->steps; k++)
+            samples_add(&stage[k], (uint32_t)(records[at[k]].t_us - records[at[k - 1]].t_us));
+        samples_add(&stage[0], (uint32_t)(records[at[path->steps - 1]].t_us - records[at[0]].t_us));
+        complete++;
+    }
+
+    printf("\n%s: %zu complete\n", path->name, complete);
+    printf("  %-28s %8s %8s %8s %8s %8s\n", "stage (us)", "n", "p50", "p90", "p99", "max");
+    for (int k = 1; k < path->steps; k++)
+    {
+        snprintf(name, sizeof(name), "%s -> %s", trace_event_names[path->step[k - 1].event],
+                 trace_event_names[path->step[k].event]);
+        report(name, &stage[k]);
+    }
+    report("end to end", &stage[0]);
+
+    for (int k = 0; k < path->steps; k++)
+        free(stage[k].us);
+}
+
+int main(int argc, char **argv)
+{
+    FILE *in = argc > 1 ? fopen(argv[1], "r") : stdin;
+    char line[256];
+    char name[32];
+    unsigned core;
+    unsigned long long t_us;
+    unsigned long arg, sent, lost = 0, dumps = 0;
+    size_t size = 0;
+    TRACE_EVENT event;
+
+    if (!in)
+    {
+        perror(argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    while (fgets(line, sizeof(line), in))
+    {
+        if (sscanf(line, "$TRC END %lu %lu", &sent, &arg) == 2)
+        {
+            // lost is a running total since boot
+            lost = arg;
+            dumps++;
+            continue;
+        }
+        if (sscanf(line, "$TRC %u %llu %31s %lu", &core, &t_us, name, &arg) != 4 ||
+            (event = trace_event_from_name(name)) == TRACE_EVENTS)
+            continue;
+
+        if (n_records == size)
+        {
+            size = size ? 2 * size : 4096;
+            records = realloc(records, size * sizeof(records[0]));
+        }
+        records[n_records++] = (trace_record_t){ .t_us = t_us, .arg = (uint32_t)arg, .event = (uint8_t)event,
+                                                 .core = (uint8_t)core };
+    }
+    if (in != stdin)
+        fclose(in);
+
+    printf("%zu records from %lu dumps, %lu lost\n", n_records, dumps, lost);
+    qsort(records, n_records, sizeof(records[0]), by_time);
+    for (size_t p = 0; p < sizeof(paths) / sizeof(paths[0]); p++)
+        analyse(&paths[p]);
+
+    free(records);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,72 @@
+/**
+ * @file fake_modem.h
+ * @brief Scripted stand-in for the RYLR896 LoRa module on a host UART
+ *
+ * Reads the AT commands the firmware writes to the UART and answers each with
+ * the reply of the first script rule whose prefix it starts with, after that
+ * rule's delay. Unsolicited lines ("+RCV=...", "+READY") can be injected at any
+ * time, from any thread, including while a command waits for its answer.
+ * Drive it one command at a time with fake_modem_step(), or on its own thread
+ * with fake_modem_start().
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef FAKE_MODEM_H
+#define FAKE_MODEM_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pico/types.h"
+#include "hardware/uart.h"
+
+#define FAKE_MODEM_LINE_SIZE    300
+
+typedef struct fake_modem_rule
+{
+    const char *prefix;         // commands starting with this; NULL matches any
+    const char *reply;          // "\r\n" is appended; NULL: no answer, the command times out
+    uint32_t delay_us;          // before the reply: the module's processing time or airtime
+} fake_modem_rule_t;
+
+typedef struct fake_modem fake_modem_t;
+
+// called after each command has been answered; line has no terminator
+typedef void (*fake_modem_hook_t)(fake_modem_t *m, const char *line, void *ctx);
+
+struct fake_modem
+{
+    uart_inst_t *uart;
+    const fake_modem_rule_t *script;
+    size_t rules;
+    fake_modem_hook_t hook;
+    void *ctx;
+
+    char line[FAKE_MODEM_LINE_SIZE];
+    size_t len;
+
+    pthread_t thread;
+    volatile bool running;
+
+    // statistics
+    uint32_t commands;
+    uint32_t unmatched;         // answered with "+ERR=1", as the module does for unknown commands
+    uint32_t injected;
+};
+
+void fake_modem_init(fake_modem_t *m, uart_inst_t *uart, const fake_modem_rule_t *script, size_t rules,
+                     fake_modem_hook_t hook, void *ctx);
+const char *fake_modem_step(fake_modem_t *m, uint32_t timeout_us);
+void fake_modem_start(fake_modem_t *m);
+void fake_modem_stop(fake_modem_t *m);
+void fake_modem_push(fake_modem_t *m, const char *line);
+void fake_modem_receive(fake_modem_t *m, int address, const char *payload, int rssi, int snr);
+
+#endif
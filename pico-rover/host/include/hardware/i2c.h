@@ -0,0 +1,18 @@
+/**
+ * @file i2c.h
+ * @brief Host stand-in for hardware/i2c.h (no I2C peripherals are used yet)
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef HOST_HARDWARE_I2C_H
+#define HOST_HARDWARE_I2C_H
+
+#include "pico/types.h"
+
+typedef struct i2c_inst i2c_inst_t;
+
+#endif
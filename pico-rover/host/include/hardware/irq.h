@@ -0,0 +1,36 @@
+/**
+ * @file irq.h
+ * @brief Host stand-in for hardware/irq.h
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef HOST_HARDWARE_IRQ_H
+#define HOST_HARDWARE_IRQ_H
+
+#include "pico/types.h"
+
+typedef void (*irq_handler_t)(void);
+
+// RP2040 interrupt numbers
+#define TIMER_IRQ_0     0
+#define TIMER_IRQ_1     1
+#define TIMER_IRQ_2     2
+#define TIMER_IRQ_3     3
+#define IO_IRQ_BANK0    13
+#define SIO_IRQ_PROC0   15
+#define SIO_IRQ_PROC1   16
+#define UART0_IRQ       20
+#define UART1_IRQ       21
+
+#define NUM_IRQS        32
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler);
+irq_handler_t irq_get_exclusive_handler(uint num);
+void irq_set_enabled(uint num, bool enabled);
+bool irq_is_enabled(uint num);
+
+#endif
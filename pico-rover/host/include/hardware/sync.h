@@ -0,0 +1,30 @@
+/**
+ * @file sync.h
+ * @brief Host stand-in for hardware/sync.h
+ *
+ * "Disabling interrupts" takes the same recursive lock that simulated interrupt
+ * handlers run under, so a critical section is never interleaved with an ISR.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef HOST_HARDWARE_SYNC_H
+#define HOST_HARDWARE_SYNC_H
+
+#include "pico/types.h"
+
+uint32_t save_and_disable_interrupts(void);
+void restore_interrupts(uint32_t status);
+
+static inline void __dmb(void) { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+
+// one event latch shared by all threads: __sev() and any simulated interrupt set it,
+// __wfe() waits for it and clears it
+void __sev(void);
+void __wfe(void);
+
+#endif
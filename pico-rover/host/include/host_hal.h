@@ -0,0 +1,62 @@
+/**
+ * @file host_hal.h
+ * @brief Test-side view of the host HAL shim: feed the simulated peripherals and inspect what
+ *        the firmware did with them
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef HOST_HAL_H
+#define HOST_HAL_H
+
+#include "pico/types.h"
+#include "hardware/uart.h"
+
+// depth of each simulated UART RX FIFO; far deeper than the RP2040's 32 bytes so
+// a test can inject a whole burst before the firmware gets around to reading it
+#define HOST_UART_FIFO_SIZE     4096
+// the TX FIFO is as deep as the RP2040's, so the firmware sees the same backpressure;
+// host_uart_tx_pop() fires the TX interrupt, if enabled, as it makes room
+#define HOST_UART_TX_FIFO_SIZE  32
+#define HOST_STDIN_FIFO_SIZE    4096
+
+typedef struct host_pwm_slice
+{
+    uint16_t wrap;
+    uint16_t level[2];          // indexed by PWM_CHAN_A/PWM_CHAN_B
+    bool enabled;
+    uint32_t writes;            // number of level updates
+    absolute_time_t updated;    // time of the last level update
+} host_pwm_slice_t;
+
+// UART: bytes "on the wire" towards the Pico, fires the RX IRQ if it is enabled
+void host_uart_rx_push(uart_inst_t *uart, const void *data, size_t len);
+// UART: bytes the Pico transmitted; waits up to timeout_us for at least one byte
+size_t host_uart_tx_pop(uart_inst_t *uart, void *dst, size_t max, uint32_t timeout_us);
+size_t host_uart_rx_level(uart_inst_t *uart);
+uint32_t host_uart_rx_overruns(uart_inst_t *uart);
+
+// USB CDC stdin as seen by getchar_timeout_us()
+void host_stdin_push(const void *data, size_t len);
+
+// PWM/GPIO state as last written by the firmware
+host_pwm_slice_t host_pwm_get_slice(uint slice_num);
+uint16_t host_pwm_get_gpio_level(uint gpio);
+bool host_gpio_get_out(uint gpio);
+
+// drive an input pin; fires the GPIO IRQ callback on an enabled edge
+void host_gpio_set_in(uint gpio, bool value);
+
+// run the handler registered for an interrupt, if the interrupt is enabled
+void host_irq_raise(uint num);
+
+// 12-bit conversion result an ADC input (0-4) returns from now on
+void host_adc_set(uint input, uint16_t raw);
+
+// times the watchdog went unfed past its delay, i.e. would have reset the RP2040
+uint32_t host_watchdog_resets(void);
+
+#endif
@@ -0,0 +1,21 @@
+/**
+ * @file multicore.h
+ * @brief Host stand-in for pico/multicore.h; core 1 runs on a pthread
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef HOST_PICO_MULTICORE_H
+#define HOST_PICO_MULTICORE_H
+
+#include "pico/types.h"
+
+void multicore_launch_core1(void (*entry)(void));
+
+// 0 for the launching thread (and any other host thread), 1 for the core 1 thread
+uint get_core_num(void);
+
+#endif
@@ -0,0 +1,26 @@
+/**
+ * @file stdio_usb.h
+ * @brief Host stand-in for pico/stdio_usb.h: the USB CDC stdio driver is the process's stdout
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef HOST_PICO_STDIO_USB_H
+#define HOST_PICO_STDIO_USB_H
+
+#include "pico/types.h"
+
+typedef struct stdio_driver
+{
+    bool crlf_enabled;
+} stdio_driver_t;
+
+extern stdio_driver_t stdio_usb;
+
+// recorded only: the host never translates, see putchar_raw()
+void stdio_set_translate_crlf(stdio_driver_t *driver, bool translate);
+
+#endif
@@ -0,0 +1,33 @@
+/**
+ * @file stdlib.h
+ * @brief Host stand-in for pico/stdlib.h
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef HOST_PICO_STDLIB_H
+#define HOST_PICO_STDLIB_H
+
+#include <stdio.h>
+
+#include "pico/types.h"
+#include "pico/time.h"
+#include "hardware/gpio.h"
+#include "hardware/uart.h"
+
+bool stdio_init_all(void);
+
+// reads from the in-memory stdin FIFO, see host_stdin_push()
+int getchar_timeout_us(uint32_t timeout_us);
+
+// stdout is the process's stdout; no CR/LF translation is ever done
+int putchar_raw(int c);
+void stdio_flush(void);
+
+// yields the host CPU so a polling core doesn't starve the thread feeding it
+void tight_loop_contents(void);
+
+#endif
@@ -0,0 +1,30 @@
+/**
+ * @file types.h
+ * @brief Host stand-in for the pico-sdk base types
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef HOST_PICO_TYPES_H
+#define HOST_PICO_TYPES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef unsigned int uint;
+
+// microseconds since "boot" (process start on the host)
+typedef uint64_t absolute_time_t;
+
+#define PICO_OK             0
+#define PICO_ERROR_GENERIC  -1
+#define PICO_ERROR_TIMEOUT  -1
+
+#define __not_in_flash_func(func_name) func_name
+#define __time_critical_func(func_name) func_name
+
+#endif
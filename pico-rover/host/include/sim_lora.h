@@ -0,0 +1,186 @@
+/**
+ * @file sim_lora.h
+ * @brief Simulated LoRa channel and ground station behind an RYLR896 AT interface on a host UART
+ *
+ * Stands in for the rover's LoRa module, the air and the ground station at
+ * once, in real time, so comm_run() can be benchmarked end to end. The
+ * firmware's AT commands are answered as the module does: AT+NETWORKID,
+ * AT+ADDRESS and AT+PARAMETER with "+OK", AT+SEND once its frame has been on
+ * the air. The air is half duplex: one frame at a time, airtime = base +
+ * per-byte time. Each frame is then lost, delayed by jitter, or held back so
+ * a later one overtakes it, as the channel says; an outage loses every frame
+ * that starts within it. A frame is only heard by a module set to the same
+ * spreading factor and bandwidth as its sender's. Frames that get through to
+ * the rover arrive as "+RCV=..." lines.
+ *
+ * With channel.phy the air is LoRa's instead: airtime from the sender's
+ * AT+PARAMETER, and snr the SNR at 125 kHz, which sim_lora_set_snr() can
+ * change. A frame is lost with a probability that goes from none to all as
+ * the SNR goes from SIM_PHY_EDGE_DB above the demodulation floor of its
+ * setting to as far below, on top of channel.loss; +RCV reports the SNR at the
+ * setting's bandwidth, give or take SIM_PHY_NOISE_DB.
+ *
+ * The ground station speaks the rover's protocol with arq.c on its side: it
+ * answers a SYN, counts the connection as up on the rover's first ACK or data
+ * frame, acknowledges and delivers data, puts long $TXR messages back together
+ * with frag.c, sends a $CMD now and then, and on sim_lora_close() tears the
+ * connection down with FIN. A SYN on an established connection means the
+ * rover started over, and so does the ground station. It follows the rover's
+ * "RAT" rate changes and falls back to the base rate as linkq.h says, and goes
+ * back to it whenever it drops the connection.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef SIM_LORA_H
+#define SIM_LORA_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pico/types.h"
+#include "hardware/uart.h"
+#include "comms.h"
+#include "linkq.h"
+
+#define SIM_LORA_LINE_SIZE      300
+#define SIM_LORA_EVENTS         64      // frames on the air or on their way, and answers due
+#define SIM_LORA_NETWORK_ID     5       // the ground station's network; the rover must join it
+#define SIM_PHY_EDGE_DB         2
+#define SIM_PHY_NOISE_DB        1.5
+
+typedef struct sim_channel
+{
+    uint32_t airtime_base_us;   // preamble + header
+    uint32_t airtime_byte_us;
+    uint32_t latency_us;        // modem and UART, each way
+    double loss;                // probability a frame is lost
+    uint32_t jitter_us;         // added to each frame's latency, uniform in [0, jitter_us]
+    double reorder;             // probability a frame is held back reorder_us
+    uint32_t reorder_us;
+    int rssi;                   // reported in +RCV
+    int snr;                    // phy: dB at 125 kHz
+    bool phy;                   // LoRa airtime and SNR-driven loss, see above
+    uint32_t cmd_period_ms;     // ground station $CMD; 0: none
+    uint32_t seed;
+} sim_channel_t;
+
+typedef enum SIM_GS_STATE {
+    SIM_GS_LISTEN,
+    SIM_GS_SYN_RCVD,
+    SIM_GS_ESTABLISHED,
+    SIM_GS_FIN_WAIT
+} SIM_GS_STATE;
+
+typedef struct sim_lora_stats
+{
+    // channel; index 0: rover to ground station, 1: ground station to rover
+    uint32_t frames[2];         // put on the air
+    uint32_t lost[2];           // to loss or an outage
+    uint32_t reordered[2];
+    uint64_t air_us;            // time the air was busy
+
+    // module
+    uint32_t commands;
+    uint32_t errors;            // answered with +ERR
+
+    // ground station
+    SIM_GS_STATE state;
+    uint32_t handshakes;        // connections established
+    uint32_t resets;            // connections dropped: the ground station's ARQ gave up, or the rover started over
+    absolute_time_t established;    // when the last one came up
+    int64_t setup_us;           // the last one: first SYN heard from the rover to its ACK
+    int64_t teardown_us;        // our FIN on the air to the rover's FIN received; -1 until then
+    uint32_t bad_frames;        // didn't parse
+    uint64_t bytes;             // payload delivered in order, packed items counted one by one
+    uint64_t items;
+    absolute_time_t last_delivery;
+    uint32_t cmds;              // $CMD queued for the rover
+    uint32_t txr_messages;      // long $TXR messages put back together
+    uint64_t txr_bytes;         // their length
+    uint16_t txr_crc;           // CRC-16/CCITT-FALSE of the last one
+    absolute_time_t txr_last;   // when the last one was complete
+    uint32_t txr_errors;        // fragments dropped, and partial messages evicted or expired
+    linkq_t link;               // the ground station's rate, rate_us counted up to now
+    uint64_t rate_bytes[LORA_RATES];    // delivered while at each rate
+    uint32_t rate_ignored;      // "RAT" frames not from the rate the ground station was at
+    uint32_t rate_reverts;      // changes gone back on, nothing heard at the new rate
+    ARQ_STATS arq;              // the ground station's side of the link
+} sim_lora_stats_t;
+
+typedef enum SIM_EVENT {
+    SIM_EVENT_NONE,
+    SIM_EVENT_SENT,             // the rover's frame is off the air: "+OK"
+    SIM_EVENT_TO_GS,            // a frame reaches the ground station
+    SIM_EVENT_TO_ROVER          // a frame reaches the rover's module: "+RCV=..."
+} SIM_EVENT;
+
+typedef struct sim_event
+{
+    SIM_EVENT type;
+    absolute_time_t due;
+    absolute_time_t sent;       // went on the air
+    char data[SIM_LORA_LINE_SIZE];  // stuffed payload
+} sim_event_t;
+
+typedef struct sim_lora
+{
+    uart_inst_t *uart;
+    sim_channel_t channel;
+    uint32_t rng;
+
+    pthread_t thread;
+    volatile bool running;
+    pthread_mutex_t lock;       // stats, outage and close requests against the serving thread
+
+    // module
+    char line[SIM_LORA_LINE_SIZE];
+    size_t len;
+    int network_id;
+    int address;
+    lora_rate_t phy;            // AT+PARAMETER
+
+    // air
+    absolute_time_t air_free;
+    absolute_time_t outage_start;
+    absolute_time_t outage_end;
+    sim_event_t events[SIM_LORA_EVENTS];
+
+    // ground station
+    STATE gs;
+    absolute_time_t syn_at;     // first SYN of the handshake in progress
+    absolute_time_t next_cmd;
+    char control[LORA_SIZE];    // SYN, FIN or ACK waiting for the air
+    bool close;                 // sim_lora_close() asked for a FIN
+    absolute_time_t fin_at;
+    absolute_time_t fin_retry;
+    int fin_tries;
+    frag_rx_t txr;
+    linkq_t link;               // its rate; only heard and rate are used
+    int next_rate;              // agreed on, once the acknowledgement is on the air; -1 if none
+    absolute_time_t next_rate_at;   // nil_time until then
+    int prev_rate;              // changed from, until a frame is heard at the new rate; -1 if none
+
+    sim_lora_stats_t stats;
+} sim_lora_t;
+
+// a run for sim_run_child(): fills result from arg
+typedef void (*sim_child_fn)(const void *arg, void *result);
+
+// function prototypes
+void sim_lora_init(sim_lora_t *s, uart_inst_t *uart, const sim_channel_t *channel);
+void sim_lora_start(sim_lora_t *s);
+void sim_lora_stop(sim_lora_t *s);
+void sim_lora_outage(sim_lora_t *s, uint32_t ms);
+void sim_lora_set_snr(sim_lora_t *s, int snr);
+void sim_lora_close(sim_lora_t *s);
+void sim_lora_get_stats(sim_lora_t *s, sim_lora_stats_t *out);
+uint32_t sim_lora_airtime_us(const sim_channel_t *channel, size_t len);
+bool sim_run_child(sim_child_fn fn, const void *arg, void *result, size_t size, unsigned limit_s);
+
+#endif
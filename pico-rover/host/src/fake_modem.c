@@ -0,0 +1,140 @@
+/**
+ * @file fake_modem.c
+ * @brief Scripted stand-in for the RYLR896 LoRa module on a host UART
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include "fake_modem.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "host_hal.h"
+
+// how often the serving thread checks whether it should stop
+#define FAKE_MODEM_POLL_US      20000
+
+void fake_modem_init(fake_modem_t *m, uart_inst_t *uart, const fake_modem_rule_t *script, size_t rules,
+                     fake_modem_hook_t hook, void *ctx)
+{
+    memset(m, 0, sizeof(*m));
+    m->uart = uart;
+    m->script = script;
+    m->rules = rules;
+    m->hook = hook;
+    m->ctx = ctx;
+}
+
+// collects the firmware's next command; false if the line isn't complete within timeout_us
+static bool fake_modem_getline(fake_modem_t *m, uint32_t timeout_us)
+{
+    char c;
+
+    while (host_uart_tx_pop(m->uart, &c, 1, timeout_us))
+    {
+        if (c == '\r' || c == '\n')
+        {
+            if (!m->len)
+                continue;
+            m->line[m->len] = '\0';
+            m->len = 0;
+            return true;
+        }
+        if (m->len < sizeof(m->line) - 1)
+            m->line[m->len++] = c;
+    }
+    return false;
+}
+
+/**
+ * @brief Answers the firmware's next command as the script says
+ *
+ * @param m the modem
+ * @param timeout_us how long to wait for a command
+ * @return the command, without terminator, valid until the next call; NULL on timeout
+ */
+const char *fake_modem_step(fake_modem_t *m, uint32_t timeout_us)
+{
+    const fake_modem_rule_t *rule = NULL;
+
+    if (!fake_modem_getline(m, timeout_us))
+        return NULL;
+    m->commands++;
+
+    for (size_t i = 0; i < m->rules && !rule; i++)
+    {
+        if (!m->script[i].prefix || strncmp(m->line, m->script[i].prefix, strlen(m->script[i].prefix)) == 0)
+            rule = &m->script[i];
+    }
+
+    if (!rule)
+    {
+        m->unmatched++;
+        fake_modem_push(m, "+ERR=1");
+    }
+    else
+    {
+        if (rule->delay_us)
+            sleep_us(rule->delay_us);
+        if (rule->reply)
+            fake_modem_push(m, rule->reply);
+    }
+
+    if (m->hook)
+        m->hook(m, m->line, m->ctx);
+    return m->line;
+}
+
+static void *fake_modem_serve(void *arg)
+{
+    fake_modem_t *m = arg;
+
+    while (m->running)
+        fake_modem_step(m, FAKE_MODEM_POLL_US);
+    return NULL;
+}
+
+/**
+ * @brief Answers commands on a thread of its own until fake_modem_stop()
+ */
+void fake_modem_start(fake_modem_t *m)
+{
+    m->running = true;
+    pthread_create(&m->thread, NULL, fake_modem_serve, m);
+}
+
+void fake_modem_stop(fake_modem_t *m)
+{
+    if (!m->running)
+        return;
+    m->running = false;
+    pthread_join(m->thread, NULL);
+}
+
+/**
+ * @brief Sends a line to the firmware as the module would, "\r\n" appended
+ */
+void fake_modem_push(fake_modem_t *m, const char *line)
+{
+    char buf[FAKE_MODEM_LINE_SIZE + 2];
+    int len = snprintf(buf, sizeof(buf), "%s\r\n", line);
+
+    host_uart_rx_push(m->uart, buf, (size_t)len < sizeof(buf) ? (size_t)len : sizeof(buf) - 1);
+}
+
+/**
+ * @brief Delivers a frame from another node: "+RCV=<address>,<length>,<payload>,<rssi>,<snr>"
+ */
+void fake_modem_receive(fake_modem_t *m, int address, const char *payload, int rssi, int snr)
+{
+    char line[FAKE_MODEM_LINE_SIZE];
+
+    snprintf(line, sizeof(line), "+RCV=%d,%d,%s,%d,%d", address, (int)strlen(payload), payload, rssi, snr);
+    m->injected++;
+    fake_modem_push(m, line);
+}
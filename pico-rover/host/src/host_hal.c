@@ -0,0 +1,978 @@
+/**
+ * @file host_hal.c
+ * @brief Host (Linux) implementations of the pico-sdk calls used by the rover firmware
+ *
+ * UARTs and USB stdin are in-memory FIFOs, PWM/GPIO writes are recorded so a test can
+ * inspect them, queue_t is a mutex-protected ring and core 1 is a pthread. Interrupts
+ * are simulated by calling the registered handler from whichever thread raised them,
+ * serialized against each other and against save_and_disable_interrupts().
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pico/stdlib.h"
+#include "pico/stdio_usb.h"
+#include "pico/multicore.h"
+#include "pico/util/queue.h"
+#include "hardware/adc.h"
+#include "hardware/irq.h"
+#include "hardware/pwm.h"
+#include "hardware/sync.h"
+#include "hardware/watchdog.h"
+
+#include "host_hal.h"
+
+/*
+ * time
+ */
+
+static uint64_t monotonic_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+static uint64_t boot_us;
+static pthread_once_t boot_once = PTHREAD_ONCE_INIT;
+
+static void boot_init(void)
+{
+    boot_us = monotonic_us();
+}
+
+uint64_t time_us_64(void)
+{
+    pthread_once(&boot_once, boot_init);
+    return monotonic_us() - boot_us;
+}
+
+uint32_t time_us_32(void)
+{
+    return (uint32_t)time_us_64();
+}
+
+absolute_time_t get_absolute_time(void)
+{
+    return time_us_64();
+}
+
+void sleep_us(uint64_t us)
+{
+    struct timespec ts = { (time_t)(us / 1000000u), (long)(us % 1000000u) * 1000 };
+    while (nanosleep(&ts, &ts) && errno == EINTR);
+}
+
+void sleep_ms(uint32_t ms)
+{
+    sleep_us((uint64_t)ms * 1000);
+}
+
+void sleep_until(absolute_time_t t)
+{
+    absolute_time_t now = get_absolute_time();
+    if (t > now)
+        sleep_us(t - now);
+}
+
+void tight_loop_contents(void)
+{
+    sched_yield();
+}
+
+// absolute CLOCK_REALTIME deadline for pthread_cond_timedwait
+static struct timespec deadline_in(uint64_t us)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += (time_t)(us / 1000000u);
+    ts.tv_nsec += (long)(us % 1000000u) * 1000;
+    if (ts.tv_nsec >= 1000000000)
+    {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000;
+    }
+    return ts;
+}
+
+/*
+ * events (SEV/WFE)
+ */
+
+static pthread_mutex_t event_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t event_set = PTHREAD_COND_INITIALIZER;
+// one event register per core, as on the RP2040: a core that wakes must not
+// consume the event the other core is waiting for
+static bool event_latch[2];
+static int event_waiters;
+
+// the latches are set outside the lock so a __sev() nobody waits for stays cheap
+void __sev(void)
+{
+    __atomic_store_n(&event_latch[0], true, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&event_latch[1], true, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&event_waiters, __ATOMIC_SEQ_CST))
+    {
+        pthread_mutex_lock(&event_lock);
+        pthread_cond_broadcast(&event_set);
+        pthread_mutex_unlock(&event_lock);
+    }
+}
+
+void __wfe(void)
+{
+    bool *latch = &event_latch[get_core_num()];
+
+    pthread_mutex_lock(&event_lock);
+    __atomic_add_fetch(&event_waiters, 1, __ATOMIC_SEQ_CST);
+    while (!__atomic_load_n(latch, __ATOMIC_SEQ_CST))
+        pthread_cond_wait(&event_set, &event_lock);
+    __atomic_sub_fetch(&event_waiters, 1, __ATOMIC_SEQ_CST);
+    __atomic_store_n(latch, false, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&event_lock);
+}
+
+bool best_effort_wfe_or_timeout(absolute_time_t timeout_timestamp)
+{
+    bool *latch = &event_latch[get_core_num()];
+    absolute_time_t now = get_absolute_time();
+
+    pthread_mutex_lock(&event_lock);
+    __atomic_add_fetch(&event_waiters, 1, __ATOMIC_SEQ_CST);
+    while (!__atomic_load_n(latch, __ATOMIC_SEQ_CST) && now < timeout_timestamp)
+    {
+        struct timespec deadline = deadline_in(timeout_timestamp - now);
+        pthread_cond_timedwait(&event_set, &event_lock, &deadline);
+        now = get_absolute_time();
+    }
+    __atomic_sub_fetch(&event_waiters, 1, __ATOMIC_SEQ_CST);
+    __atomic_store_n(latch, false, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&event_lock);
+
+    return time_reached(timeout_timestamp);
+}
+
+/*
+ * interrupts
+ */
+
+static pthread_mutex_t irq_lock;
+static pthread_once_t irq_once = PTHREAD_ONCE_INIT;
+static irq_handler_t irq_handlers[NUM_IRQS];
+static bool irq_enabled[NUM_IRQS];
+
+static void irq_init(void)
+{
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&irq_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+uint32_t save_and_disable_interrupts(void)
+{
+    pthread_once(&irq_once, irq_init);
+    pthread_mutex_lock(&irq_lock);
+    return 0;
+}
+
+void restore_interrupts(uint32_t status)
+{
+    (void)status;
+    pthread_mutex_unlock(&irq_lock);
+}
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler)
+{
+    if (num < NUM_IRQS)
+        irq_handlers[num] = handler;
+}
+
+irq_handler_t irq_get_exclusive_handler(uint num)
+{
+    return num < NUM_IRQS ? irq_handlers[num] : NULL;
+}
+
+void irq_set_enabled(uint num, bool enabled)
+{
+    if (num < NUM_IRQS)
+        irq_enabled[num] = enabled;
+}
+
+bool irq_is_enabled(uint num)
+{
+    return num < NUM_IRQS && irq_enabled[num];
+}
+
+void host_irq_raise(uint num)
+{
+    if (num >= NUM_IRQS || !irq_enabled[num] || !irq_handlers[num])
+        return;
+
+    uint32_t status = save_and_disable_interrupts();
+    irq_handlers[num]();
+    restore_interrupts(status);
+    // taking an interrupt wakes a core from WFE
+    __sev();
+}
+
+/*
+ * repeating timers
+ */
+
+typedef struct host_timer
+{
+    pthread_t thread;
+    volatile bool running;
+} host_timer_t;
+
+static void *timer_thread(void *arg)
+{
+    repeating_timer_t *rt = arg;
+    host_timer_t *t = rt->host;
+    uint64_t period = (uint64_t)(rt->delay_us < 0 ? -rt->delay_us : rt->delay_us);
+    absolute_time_t next = delayed_by_us(get_absolute_time(), period);
+
+    while (t->running)
+    {
+        sleep_until(next);
+        if (!t->running)
+            break;
+
+        uint32_t status = save_and_disable_interrupts();
+        bool again = rt->callback(rt);
+        restore_interrupts(status);
+        __sev();
+
+        if (!again)
+            break;
+        // negative: the next run is due a period after this one was; positive: after it ended
+        next = rt->delay_us < 0 ? delayed_by_us(next, period) : delayed_by_us(get_absolute_time(), period);
+    }
+    return NULL;
+}
+
+bool add_repeating_timer_us(int64_t delay_us, repeating_timer_callback_t callback, void *user_data,
+                            repeating_timer_t *out)
+{
+    host_timer_t *t = calloc(1, sizeof(*t));
+
+    if (!t || !delay_us)
+    {
+        free(t);
+        return false;
+    }
+    out->delay_us = delay_us;
+    out->callback = callback;
+    out->user_data = user_data;
+    out->host = t;
+    t->running = true;
+    if (pthread_create(&t->thread, NULL, timer_thread, out))
+    {
+        free(t);
+        out->host = NULL;
+        return false;
+    }
+    return true;
+}
+
+// not from the timer's own callback: that returns false instead
+bool cancel_repeating_timer(repeating_timer_t *timer)
+{
+    host_timer_t *t = timer->host;
+
+    if (!t)
+        return false;
+    t->running = false;
+    pthread_join(t->thread, NULL);
+    free(t);
+    timer->host = NULL;
+    return true;
+}
+
+/*
+ * watchdog
+ */
+
+static uint32_t watchdog_delay_us;
+static absolute_time_t watchdog_fed;
+static uint32_t watchdog_resets;
+static pthread_mutex_t watchdog_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// counts a reset the first time the deadline is found passed, then starts over as the chip would
+static void watchdog_check(absolute_time_t now)
+{
+    if (watchdog_delay_us && now - watchdog_fed > watchdog_delay_us)
+    {
+        watchdog_resets++;
+        watchdog_fed = now;
+    }
+}
+
+void watchdog_enable(uint32_t delay_ms, bool pause_on_debug)
+{
+    (void)pause_on_debug;
+    pthread_mutex_lock(&watchdog_lock);
+    watchdog_delay_us = delay_ms * 1000u;
+    watchdog_fed = get_absolute_time();
+    pthread_mutex_unlock(&watchdog_lock);
+}
+
+void watchdog_update(void)
+{
+    pthread_mutex_lock(&watchdog_lock);
+    absolute_time_t now = get_absolute_time();
+    watchdog_check(now);
+    watchdog_fed = now;
+    pthread_mutex_unlock(&watchdog_lock);
+}
+
+bool watchdog_caused_reboot(void)
+{
+    return false;
+}
+
+uint32_t host_watchdog_resets(void)
+{
+    pthread_mutex_lock(&watchdog_lock);
+    watchdog_check(get_absolute_time());
+    uint32_t resets = watchdog_resets;
+    pthread_mutex_unlock(&watchdog_lock);
+    return resets;
+}
+
+/*
+ * ADC
+ */
+
+#define HOST_ADC_INPUTS     5
+
+static volatile uint16_t adc_value[HOST_ADC_INPUTS];
+static __thread uint adc_input;     // each core would take its own turn at the ADC
+
+void adc_init(void)
+{
+}
+
+void adc_gpio_init(uint gpio)
+{
+    (void)gpio;
+}
+
+void adc_select_input(uint input)
+{
+    adc_input = input < HOST_ADC_INPUTS ? input : 0;
+}
+
+uint16_t adc_read(void)
+{
+    return adc_value[adc_input];
+}
+
+void host_adc_set(uint input, uint16_t raw)
+{
+    if (input < HOST_ADC_INPUTS)
+        adc_value[input] = raw & 0x0FFF;
+}
+
+/*
+ * UART
+ */
+
+typedef struct host_fifo
+{
+    uint8_t data[HOST_UART_FIFO_SIZE];
+    size_t head;    // next byte to read
+    size_t count;
+} host_fifo_t;
+
+static bool fifo_put(host_fifo_t *f, uint8_t b)
+{
+    if (f->count == sizeof(f->data))
+        return false;
+    f->data[(f->head + f->count++) % sizeof(f->data)] = b;
+    return true;
+}
+
+static uint8_t fifo_get(host_fifo_t *f)
+{
+    uint8_t b = f->data[f->head];
+    f->head = (f->head + 1) % sizeof(f->data);
+    f->count--;
+    return b;
+}
+
+struct uart_inst
+{
+    pthread_mutex_t lock;
+    pthread_cond_t rx_ready;
+    pthread_cond_t tx_ready;
+    host_fifo_t rx;             // towards the Pico
+    host_fifo_t tx;             // from the Pico
+    uint baudrate;
+    bool rx_irq;
+    bool tx_irq;
+    uint32_t rx_overruns;
+};
+
+#define HOST_UART_INIT { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER }
+
+static uart_inst_t uarts[2] = { HOST_UART_INIT, HOST_UART_INIT };
+uart_inst_t *const host_uart_inst[2] = { &uarts[0], &uarts[1] };
+
+uint uart_init(uart_inst_t *uart, uint baudrate)
+{
+    pthread_mutex_lock(&uart->lock);
+    uart->baudrate = baudrate;
+    uart->rx.head = uart->rx.count = 0;
+    uart->tx.head = uart->tx.count = 0;
+    pthread_mutex_unlock(&uart->lock);
+    return baudrate;
+}
+
+void uart_deinit(uart_inst_t *uart)
+{
+    uart_set_irq_enables(uart, false, false);
+}
+
+uint uart_set_baudrate(uart_inst_t *uart, uint baudrate)
+{
+    uart->baudrate = baudrate;
+    return baudrate;
+}
+
+void uart_set_hw_flow(uart_inst_t *uart, bool cts, bool rts)
+{
+    (void)uart; (void)cts; (void)rts;
+}
+
+void uart_set_format(uart_inst_t *uart, uint data_bits, uint stop_bits, uart_parity_t parity)
+{
+    (void)uart; (void)data_bits; (void)stop_bits; (void)parity;
+}
+
+void uart_set_fifo_enabled(uart_inst_t *uart, bool enabled)
+{
+    (void)uart; (void)enabled;
+}
+
+void uart_set_irq_enables(uart_inst_t *uart, bool rx_has_data, bool tx_needs_data)
+{
+    uart->rx_irq = rx_has_data;
+    uart->tx_irq = tx_needs_data;
+}
+
+bool uart_is_writable(uart_inst_t *uart)
+{
+    pthread_mutex_lock(&uart->lock);
+    bool writable = uart->tx.count < HOST_UART_TX_FIFO_SIZE;
+    pthread_mutex_unlock(&uart->lock);
+    return writable;
+}
+
+bool uart_is_readable(uart_inst_t *uart)
+{
+    pthread_mutex_lock(&uart->lock);
+    bool readable = uart->rx.count > 0;
+    pthread_mutex_unlock(&uart->lock);
+    return readable;
+}
+
+bool uart_is_readable_within_us(uart_inst_t *uart, uint32_t us)
+{
+    struct timespec deadline = deadline_in(us);
+    pthread_mutex_lock(&uart->lock);
+    while (!uart->rx.count)
+    {
+        if (pthread_cond_timedwait(&uart->rx_ready, &uart->lock, &deadline) == ETIMEDOUT)
+            break;
+    }
+    bool readable = uart->rx.count > 0;
+    pthread_mutex_unlock(&uart->lock);
+    return readable;
+}
+
+void uart_tx_wait_blocking(uart_inst_t *uart)
+{
+    // the FIFO empties as the test side takes bytes with host_uart_tx_pop()
+    pthread_mutex_lock(&uart->lock);
+    while (uart->tx.count)
+        pthread_cond_wait(&uart->tx_ready, &uart->lock);
+    pthread_mutex_unlock(&uart->lock);
+}
+
+void uart_write_blocking(uart_inst_t *uart, const uint8_t *src, size_t len)
+{
+    pthread_mutex_lock(&uart->lock);
+    for (size_t i = 0; i < len; i++)
+    {
+        while (uart->tx.count >= HOST_UART_TX_FIFO_SIZE)
+            pthread_cond_wait(&uart->tx_ready, &uart->lock);
+        fifo_put(&uart->tx, src[i]);
+    }
+    pthread_cond_broadcast(&uart->tx_ready);
+    pthread_mutex_unlock(&uart->lock);
+}
+
+void uart_read_blocking(uart_inst_t *uart, uint8_t *dst, size_t len)
+{
+    pthread_mutex_lock(&uart->lock);
+    for (size_t i = 0; i < len; i++)
+    {
+        while (!uart->rx.count)
+            pthread_cond_wait(&uart->rx_ready, &uart->lock);
+        dst[i] = fifo_get(&uart->rx);
+    }
+    pthread_mutex_unlock(&uart->lock);
+}
+
+void uart_putc_raw(uart_inst_t *uart, char c)
+{
+    uart_write_blocking(uart, (const uint8_t *)&c, 1);
+}
+
+void uart_putc(uart_inst_t *uart, char c)
+{
+    uart_putc_raw(uart, c);
+}
+
+void uart_puts(uart_inst_t *uart, const char *s)
+{
+    uart_write_blocking(uart, (const uint8_t *)s, strlen(s));
+}
+
+char uart_getc(uart_inst_t *uart)
+{
+    char c;
+    uart_read_blocking(uart, (uint8_t *)&c, 1);
+    return c;
+}
+
+void host_uart_rx_push(uart_inst_t *uart, const void *data, size_t len)
+{
+    const uint8_t *src = data;
+    uint irq = uart == uart0 ? UART0_IRQ : UART1_IRQ;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        pthread_mutex_lock(&uart->lock);
+        if (!fifo_put(&uart->rx, src[i]))
+            uart->rx_overruns++;
+        pthread_cond_broadcast(&uart->rx_ready);
+        bool rx_irq = uart->rx_irq;
+        pthread_mutex_unlock(&uart->lock);
+
+        if (rx_irq)
+            host_irq_raise(irq);
+    }
+}
+
+size_t host_uart_tx_pop(uart_inst_t *uart, void *dst, size_t max, uint32_t timeout_us)
+{
+    uint8_t *out = dst;
+    size_t n = 0;
+    struct timespec deadline = deadline_in(timeout_us);
+
+    pthread_mutex_lock(&uart->lock);
+    while (!uart->tx.count && timeout_us)
+    {
+        if (pthread_cond_timedwait(&uart->tx_ready, &uart->lock, &deadline) == ETIMEDOUT)
+            break;
+    }
+    while (n < max && uart->tx.count)
+        out[n++] = fifo_get(&uart->tx);
+    pthread_cond_broadcast(&uart->tx_ready);
+    bool tx_irq = uart->tx_irq;
+    pthread_mutex_unlock(&uart->lock);
+
+    // the FIFO has room again
+    if (n && tx_irq)
+        host_irq_raise(uart == uart0 ? UART0_IRQ : UART1_IRQ);
+
+    return n;
+}
+
+size_t host_uart_rx_level(uart_inst_t *uart)
+{
+    pthread_mutex_lock(&uart->lock);
+    size_t level = uart->rx.count;
+    pthread_mutex_unlock(&uart->lock);
+    return level;
+}
+
+uint32_t host_uart_rx_overruns(uart_inst_t *uart)
+{
+    return uart->rx_overruns;
+}
+
+/*
+ * USB stdio
+ */
+
+static pthread_mutex_t stdin_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t stdin_ready = PTHREAD_COND_INITIALIZER;
+static uint8_t stdin_data[HOST_STDIN_FIFO_SIZE];
+static size_t stdin_head;
+static size_t stdin_count;
+
+stdio_driver_t stdio_usb = { .crlf_enabled = true };
+
+bool stdio_init_all(void)
+{
+    return true;
+}
+
+void stdio_set_translate_crlf(stdio_driver_t *driver, bool translate)
+{
+    driver->crlf_enabled = translate;
+}
+
+int getchar_timeout_us(uint32_t timeout_us)
+{
+    int c = PICO_ERROR_TIMEOUT;
+    struct timespec deadline = deadline_in(timeout_us);
+
+    pthread_mutex_lock(&stdin_lock);
+    while (!stdin_count && timeout_us)
+    {
+        if (pthread_cond_timedwait(&stdin_ready, &stdin_lock, &deadline) == ETIMEDOUT)
+            break;
+    }
+    if (stdin_count)
+    {
+        c = stdin_data[stdin_head];
+        stdin_head = (stdin_head + 1) % sizeof(stdin_data);
+        stdin_count--;
+    }
+    pthread_mutex_unlock(&stdin_lock);
+
+    return c;
+}
+
+int putchar_raw(int c)
+{
+    return putchar(c);
+}
+
+void stdio_flush(void)
+{
+    fflush(stdout);
+}
+
+void host_stdin_push(const void *data, size_t len)
+{
+    const uint8_t *src = data;
+
+    pthread_mutex_lock(&stdin_lock);
+    for (size_t i = 0; i < len && stdin_count < sizeof(stdin_data); i++)
+        stdin_data[(stdin_head + stdin_count++) % sizeof(stdin_data)] = src[i];
+    pthread_cond_broadcast(&stdin_ready);
+    pthread_mutex_unlock(&stdin_lock);
+
+    // the USB interrupt that delivers them wakes a core from WFE
+    __sev();
+}
+
+/*
+ * GPIO
+ */
+
+static uint8_t gpio_function[NUM_BANK0_GPIOS];
+static bool gpio_is_out[NUM_BANK0_GPIOS];
+static bool gpio_out_level[NUM_BANK0_GPIOS];
+static bool gpio_in_level[NUM_BANK0_GPIOS];
+static uint32_t gpio_irq_events[NUM_BANK0_GPIOS];
+static gpio_irq_callback_t gpio_callback;
+
+void gpio_init(uint gpio)
+{
+    gpio_set_dir(gpio, GPIO_IN);
+    gpio_put(gpio, 0);
+    gpio_set_function(gpio, GPIO_FUNC_SIO);
+}
+
+void gpio_set_function(uint gpio, enum gpio_function fn)
+{
+    if (gpio < NUM_BANK0_GPIOS)
+        gpio_function[gpio] = (uint8_t)fn;
+}
+
+void gpio_set_dir(uint gpio, bool out)
+{
+    if (gpio < NUM_BANK0_GPIOS)
+        gpio_is_out[gpio] = out;
+}
+
+void gpio_pull_up(uint gpio)
+{
+    if (gpio < NUM_BANK0_GPIOS)
+        gpio_in_level[gpio] = true;
+}
+
+void gpio_pull_down(uint gpio)
+{
+    if (gpio < NUM_BANK0_GPIOS)
+        gpio_in_level[gpio] = false;
+}
+
+void gpio_put(uint gpio, bool value)
+{
+    if (gpio < NUM_BANK0_GPIOS)
+        gpio_out_level[gpio] = value;
+}
+
+bool gpio_get(uint gpio)
+{
+    if (gpio >= NUM_BANK0_GPIOS)
+        return false;
+    return gpio_is_out[gpio] ? gpio_out_level[gpio] : gpio_in_level[gpio];
+}
+
+uint32_t gpio_get_all(void)
+{
+    uint32_t all = 0;
+    for (uint gpio = 0; gpio < NUM_BANK0_GPIOS; gpio++)
+        all |= (uint32_t)gpio_get(gpio) << gpio;
+    return all;
+}
+
+void gpio_set_irq_enabled(uint gpio, uint32_t events, bool enabled)
+{
+    if (gpio >= NUM_BANK0_GPIOS)
+        return;
+    if (enabled)
+        gpio_irq_events[gpio] |= events;
+    else
+        gpio_irq_events[gpio] &= ~events;
+}
+
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t events, bool enabled, gpio_irq_callback_t callback)
+{
+    gpio_set_irq_enabled(gpio, events, enabled);
+    gpio_callback = callback;
+}
+
+void host_gpio_set_in(uint gpio, bool value)
+{
+    if (gpio >= NUM_BANK0_GPIOS || gpio_in_level[gpio] == value)
+        return;
+
+    gpio_in_level[gpio] = value;
+
+    uint32_t event = value ? GPIO_IRQ_EDGE_RISE : GPIO_IRQ_EDGE_FALL;
+    if ((gpio_irq_events[gpio] & event) && gpio_callback)
+    {
+        uint32_t status = save_and_disable_interrupts();
+        gpio_callback(gpio, event);
+        restore_interrupts(status);
+    }
+}
+
+bool host_gpio_get_out(uint gpio)
+{
+    return gpio < NUM_BANK0_GPIOS && gpio_out_level[gpio];
+}
+
+/*
+ * PWM
+ */
+
+static host_pwm_slice_t pwm_slices[NUM_PWM_SLICES];
+
+void pwm_set_wrap(uint slice_num, uint16_t wrap)
+{
+    pwm_slices[slice_num & 7u].wrap = wrap;
+}
+
+void pwm_set_clkdiv(uint slice_num, float divider)
+{
+    (void)slice_num; (void)divider;
+}
+
+void pwm_set_chan_level(uint slice_num, uint chan, uint16_t level)
+{
+    host_pwm_slice_t *slice = &pwm_slices[slice_num & 7u];
+    slice->level[chan & 1u] = level;
+    slice->writes++;
+    slice->updated = get_absolute_time();
+}
+
+void pwm_set_gpio_level(uint gpio, uint16_t level)
+{
+    pwm_set_chan_level(pwm_gpio_to_slice_num(gpio), pwm_gpio_to_channel(gpio), level);
+}
+
+void pwm_set_enabled(uint slice_num, bool enabled)
+{
+    pwm_slices[slice_num & 7u].enabled = enabled;
+}
+
+host_pwm_slice_t host_pwm_get_slice(uint slice_num)
+{
+    return pwm_slices[slice_num & 7u];
+}
+
+uint16_t host_pwm_get_gpio_level(uint gpio)
+{
+    return pwm_slices[pwm_gpio_to_slice_num(gpio)].level[pwm_gpio_to_channel(gpio)];
+}
+
+/*
+ * queue_t
+ */
+
+void queue_init(queue_t *q, uint element_size, uint element_count)
+{
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->changed, NULL);
+    // one slot is kept free to tell "full" from "empty", same as the SDK
+    q->data = calloc(element_count + 1, element_size);
+    q->element_size = (uint16_t)element_size;
+    q->element_count = (uint16_t)element_count;
+    q->wptr = 0;
+    q->rptr = 0;
+}
+
+void queue_free(queue_t *q)
+{
+    free(q->data);
+    q->data = NULL;
+    pthread_cond_destroy(&q->changed);
+    pthread_mutex_destroy(&q->lock);
+}
+
+static uint16_t inc_index(queue_t *q, uint16_t index)
+{
+    return (uint16_t)(index == q->element_count ? 0 : index + 1);
+}
+
+static uint level_unsafe(queue_t *q)
+{
+    int32_t rc = (int32_t)q->wptr - (int32_t)q->rptr;
+    if (rc < 0)
+        rc += q->element_count + 1;
+    return (uint)rc;
+}
+
+uint queue_get_level(queue_t *q)
+{
+    pthread_mutex_lock(&q->lock);
+    uint level = level_unsafe(q);
+    pthread_mutex_unlock(&q->lock);
+    return level;
+}
+
+bool queue_is_empty(queue_t *q)
+{
+    return queue_get_level(q) == 0;
+}
+
+bool queue_is_full(queue_t *q)
+{
+    return queue_get_level(q) == q->element_count;
+}
+
+static bool queue_add_internal(queue_t *q, const void *data, bool block)
+{
+    pthread_mutex_lock(&q->lock);
+    while (level_unsafe(q) == q->element_count)
+    {
+        if (!block)
+        {
+            pthread_mutex_unlock(&q->lock);
+            return false;
+        }
+        pthread_cond_wait(&q->changed, &q->lock);
+    }
+    memcpy(q->data + (size_t)q->wptr * q->element_size, data, q->element_size);
+    q->wptr = inc_index(q, q->wptr);
+    pthread_cond_broadcast(&q->changed);
+    pthread_mutex_unlock(&q->lock);
+    return true;
+}
+
+static bool queue_remove_internal(queue_t *q, void *data, bool block, bool peek)
+{
+    pthread_mutex_lock(&q->lock);
+    while (level_unsafe(q) == 0)
+    {
+        if (!block)
+        {
+            pthread_mutex_unlock(&q->lock);
+            return false;
+        }
+        pthread_cond_wait(&q->changed, &q->lock);
+    }
+    if (data)
+        memcpy(data, q->data + (size_t)q->rptr * q->element_size, q->element_size);
+    if (!peek)
+    {
+        q->rptr = inc_index(q, q->rptr);
+        pthread_cond_broadcast(&q->changed);
+    }
+    pthread_mutex_unlock(&q->lock);
+    return true;
+}
+
+bool queue_try_add(queue_t *q, const void *data)
+{
+    return queue_add_internal(q, data, false);
+}
+
+bool queue_try_remove(queue_t *q, void *data)
+{
+    return queue_remove_internal(q, data, false, false);
+}
+
+bool queue_try_peek(queue_t *q, void *data)
+{
+    return queue_remove_internal(q, data, false, true);
+}
+
+void queue_add_blocking(queue_t *q, const void *data)
+{
+    queue_add_internal(q, data, true);
+}
+
+void queue_remove_blocking(queue_t *q, void *data)
+{
+    queue_remove_internal(q, data, true, false);
+}
+
+/*
+ * multicore
+ */
+
+static __thread uint core_num;
+
+static void *core1_trampoline(void *arg)
+{
+    void (*entry)(void) = (void (*)(void))arg;
+    core_num = 1;
+    entry();
+    return NULL;
+}
+
+void multicore_launch_core1(void (*entry)(void))
+{
+    pthread_t thread;
+    pthread_create(&thread, NULL, core1_trampoline, (void *)entry);
+    pthread_detach(thread);
+}
+
+uint get_core_num(void)
+{
+    return core_num;
+}
@@ -0,0 +1,646 @@
+/**
+ * @file sim_lora.c
+ * @brief Simulated LoRa channel and ground station behind an RYLR896 AT interface on a host UART
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include "sim_lora.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "pico/stdlib.h"
+#include "host_hal.h"
+#include "binproto.h"
+
+#define SIM_LORA_POLL_US        1000    // longest wait for the rover's next byte
+#define SIM_GS_ISN              0       // the ground station's first sequence number
+#define SIM_FIN_RETRY_MS        2000
+#define SIM_FIN_TRIES           5
+#define SIM_CMD                 "$MTR 1 50 1 50"
+
+#define SIM_TO_GS               0
+#define SIM_TO_ROVER            1
+
+// xorshift32: the same seed gives the same losses, whatever rand() is doing elsewhere
+static uint32_t sim_random(sim_lora_t *s)
+{
+    s->rng ^= s->rng << 13;
+    s->rng ^= s->rng >> 17;
+    s->rng ^= s->rng << 5;
+    return s->rng;
+}
+
+static double sim_uniform(sim_lora_t *s)
+{
+    return sim_random(s) / 4294967296.0;
+}
+
+// 10 log10(bandwidth / 125 kHz) in 0.1 dB, by the module's bandwidth code
+static const int sim_bandwidth_db10[] = { -120, -108, -90, -78, -60, -48, -30, 0, 30, 60 };
+
+// the probability a frame sent at rate is lost to noise, from the SNR's margin over its floor
+static double sim_phy_loss(const sim_lora_t *s, const lora_rate_t *rate)
+{
+    // floors are 2.5 dB apart, -7.5 dB at SF7, and rise with the bandwidth
+    int floor10 = 100 - 25 * rate->sf + sim_bandwidth_db10[rate->bw];
+    double margin = (s->channel.snr * 10 - floor10) / 10.0;
+    double p = 0.5 - margin / (2 * SIM_PHY_EDGE_DB);
+
+    return p < 0 ? 0 : p > 1 ? 1 : p;
+}
+
+// the SNR the rover's module reports: at its bandwidth, with some noise
+static int sim_phy_snr(sim_lora_t *s)
+{
+    double snr = s->channel.snr - sim_bandwidth_db10[s->phy.bw] / 10.0 + (2 * sim_uniform(s) - 1) * SIM_PHY_NOISE_DB;
+
+    return (int)(snr < 0 ? snr - 0.5 : snr + 0.5);
+}
+
+/**
+ * @brief Time a payload of len bytes spends on the air
+ */
+uint32_t sim_lora_airtime_us(const sim_channel_t *channel, size_t len)
+{
+    return channel->airtime_base_us + (uint32_t)len * channel->airtime_byte_us;
+}
+
+void sim_lora_init(sim_lora_t *s, uart_inst_t *uart, const sim_channel_t *channel)
+{
+    memset(s, 0, sizeof(*s));
+    s->uart = uart;
+    s->channel = *channel;
+    // a small seed starts xorshift on a run of small numbers, i.e. losses: spread it and warm up
+    s->rng = (channel->seed ? channel->seed : 1) * 2654435761u;
+    for (int i = 0; i < 16; i++)
+        sim_random(s);
+    s->network_id = -1;
+    s->address = -1;
+    // the module's own default, and the ground station at the base rate
+    s->phy = (lora_rate_t){ 12, 7, 1, 4, 0 };
+    linkq_init(&s->link, get_absolute_time());
+    s->next_rate = -1;
+    s->prev_rate = -1;
+    s->stats.teardown_us = -1;
+    pthread_mutex_init(&s->lock, NULL);
+}
+
+// sends a line to the firmware as the module would, "\r\n" appended
+static void sim_push(sim_lora_t *s, const char *line)
+{
+    char buf[SIM_LORA_LINE_SIZE + 32];
+    int len = snprintf(buf, sizeof(buf), "%s\r\n", line);
+
+    host_uart_rx_push(s->uart, buf, (size_t)len < sizeof(buf) ? (size_t)len : sizeof(buf) - 1);
+}
+
+static sim_event_t *sim_event_add(sim_lora_t *s, SIM_EVENT type, absolute_time_t due)
+{
+    for (int i = 0; i < SIM_LORA_EVENTS; i++)
+    {
+        if (s->events[i].type == SIM_EVENT_NONE)
+        {
+            s->events[i].type = type;
+            s->events[i].due = due;
+            return &s->events[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Puts a frame on the air once it is free, and decides its fate
+ *
+ * @param s the simulator
+ * @param dir SIM_TO_GS or SIM_TO_ROVER
+ * @param data stuffed payload
+ * @param heard false if nobody on the other end listens, e.g. the wrong address
+ * @param now time the frame is ready
+ * @return absolute_time_t when it is off the air
+ */
+static absolute_time_t sim_air(sim_lora_t *s, int dir, const char *data, bool heard, absolute_time_t now)
+{
+    const lora_rate_t *gs = &lora_rates[s->link.rate];
+    const lora_rate_t *from = dir == SIM_TO_GS ? &s->phy : gs;
+    absolute_time_t start = s->air_free > now ? s->air_free : now;
+    uint32_t airtime = s->channel.phy ? lora_airtime_us(from, strlen(data))
+                                      : sim_lora_airtime_us(&s->channel, strlen(data));
+    absolute_time_t end = start + airtime;
+    uint32_t delay = s->channel.latency_us;
+    sim_event_t *ev;
+
+    s->air_free = end;
+    s->stats.air_us += airtime;
+    s->stats.frames[dir]++;
+
+    // the draw is made either way, so an outage doesn't shift the losses that follow it
+    bool lost = sim_uniform(s) < s->channel.loss;
+    if (s->channel.phy)
+        lost = sim_uniform(s) < sim_phy_loss(s, from) || lost;
+    // the other end's module listens at its own setting
+    heard = heard && s->phy.sf == gs->sf && s->phy.bw == gs->bw;
+    if (lost || (start >= s->outage_start && start < s->outage_end) || !heard)
+    {
+        s->stats.lost[dir]++;
+        return end;
+    }
+
+    if (s->channel.jitter_us)
+        delay += sim_random(s) % (s->channel.jitter_us + 1);
+    if (s->channel.reorder > 0 && sim_uniform(s) < s->channel.reorder)
+    {
+        delay += s->channel.reorder_us;
+        s->stats.reordered[dir]++;
+    }
+
+    ev = sim_event_add(s, dir == SIM_TO_GS ? SIM_EVENT_TO_GS : SIM_EVENT_TO_ROVER, end + delay);
+    if (!ev)
+    {
+        s->stats.lost[dir]++;
+        return end;
+    }
+    ev->sent = start;
+    snprintf(ev->data, sizeof(ev->data), "%s", data);
+    return end;
+}
+
+// ground station: a control frame for the rover, sent before any data
+static void sim_gs_control(sim_lora_t *s, int seq, int ack, const char *flag)
+{
+    formatFrame(s->control, sizeof(s->control), seq, ack, 0, flag, NULL, 0);
+}
+
+// ground station: back to the base rate, where the rover goes too, see linkq.h
+static void sim_gs_fallback(sim_lora_t *s, absolute_time_t now)
+{
+    linkq_fallback(&s->link, now);
+    s->next_rate = -1;
+    s->next_rate_at = nil_time;
+    s->prev_rate = -1;
+}
+
+/**
+ * @brief Ground station: a frame from the rover got through
+ */
+static void sim_gs_receive(sim_lora_t *s, sim_event_t *ev, absolute_time_t now)
+{
+    FRAME frame;
+    const ARQ_SLOT *slot;
+    bool delivered = false;
+
+    if (parseData(&frame, ev->data))
+    {
+        s->stats.bad_frames++;
+        return;
+    }
+    linkq_heard(&s->link, s->channel.rssi, s->channel.snr, now);
+    // the rover is at our rate: the change, if any, holds
+    s->prev_rate = -1;
+
+    if (strcmp(frame.flag, "SYN") == 0)
+    {
+        // a SYN on a live connection: the rover gave up on it and starts over
+        if (s->stats.state == SIM_GS_ESTABLISHED || s->stats.state == SIM_GS_FIN_WAIT)
+            s->stats.resets++;
+        // a repeated SYN is answered again, the handshake is timed from the first
+        if (s->stats.state != SIM_GS_SYN_RCVD)
+            s->syn_at = ev->sent;
+        s->stats.state = SIM_GS_SYN_RCVD;
+        s->gs.seq = SIM_GS_ISN + 1;
+        s->gs.ack = frame.seq + 1;
+        arq_rtt_reset(&s->gs);
+        arq_start(&s->gs, ARQ_WINDOW);
+        sim_gs_control(s, SIM_GS_ISN, frame.seq + 1, "SYN");
+        return;
+    }
+
+    if (strcmp(frame.flag, "FIN") == 0)
+    {
+        if (s->stats.state == SIM_GS_FIN_WAIT)
+            s->stats.teardown_us = absolute_time_diff_us(s->fin_at, now);
+        // a repeated FIN means our ACK was lost: answer it again
+        sim_gs_control(s, s->gs.seq, s->gs.ack, "ACK");
+        s->stats.state = SIM_GS_LISTEN;
+        return;
+    }
+
+    if (s->stats.state == SIM_GS_LISTEN)
+        return;
+
+    // the rover's ACK, or its first data if that ACK was lost, completes the handshake
+    if (s->stats.state == SIM_GS_SYN_RCVD)
+    {
+        s->stats.state = SIM_GS_ESTABLISHED;
+        s->stats.handshakes++;
+        s->stats.established = now;
+        s->stats.setup_us = absolute_time_diff_us(s->syn_at, now);
+        s->next_cmd = delayed_by_ms(now, s->channel.cmd_period_ms);
+    }
+
+    arq_receive(&s->gs, &frame, now);
+    while ((slot = arq_peek(&s->gs)))
+    {
+        if (strcmp(slot->flag, "RAT") != 0)
+            s->stats.rate_bytes[s->link.rate] += slot->len;
+
+        if (strcmp(slot->flag, "RAT") == 0)
+        {
+            int from, to;
+
+            // taken only at the rate it was proposed from; a fallback since makes it stale
+            if (sscanf(slot->data, "%d %d", &from, &to) == 2 && from == s->link.rate && to >= 0 && to < LORA_RATES)
+                s->next_rate = to;
+            else
+                s->stats.rate_ignored++;
+        }
+        else if (strcmp(slot->flag, "FRG") == 0)
+        {
+            const uint8_t *message;
+            size_t size;
+
+            if (frag_receive(&s->txr, slot->data, slot->len, now, &message, &size) == FRAG_MESSAGE)
+            {
+                s->stats.txr_messages++;
+                s->stats.txr_bytes += size;
+                s->stats.txr_crc = crc16_ccitt(message, size, 0xFFFF);
+                s->stats.txr_last = now;
+            }
+        }
+        else if (strcmp(slot->flag, "AGG") == 0)
+        {
+            const char *cursor = slot->data;
+            char flag[FLAG_SIZE];
+            char item[LORA_SIZE];
+
+            while (aggNext(&cursor, flag, item, sizeof(item)) == EXIT_SUCCESS)
+            {
+                s->stats.bytes += strlen(item);
+                s->stats.items++;
+            }
+        }
+        else
+        {
+            s->stats.bytes += slot->len;
+            s->stats.items++;
+        }
+        arq_pop(&s->gs);
+        delivered = true;
+    }
+    if (delivered)
+        s->stats.last_delivery = now;
+}
+
+/**
+ * @brief Ground station: sends what it has, one frame at a time, whenever the air is free
+ */
+static void sim_gs_poll(sim_lora_t *s, absolute_time_t now)
+{
+    char out[LORA_SIZE];
+    absolute_time_t end;
+
+    // the rover's rate change, once our acknowledgement of it is off the air
+    if (s->next_rate_at != nil_time && now >= s->next_rate_at)
+    {
+        s->prev_rate = s->link.rate;
+        linkq_set(&s->link, s->next_rate, now);
+        s->next_rate = -1;
+        s->next_rate_at = nil_time;
+    }
+    // nothing at the new rate: the rover may have missed the acknowledgement, so
+    // go back to where it would send "RAT" again, and change after the next one
+    else if (s->prev_rate >= 0 && absolute_time_diff_us(s->link.heard, now) > (int64_t)LINKQ_PROBATION_MS * 1000)
+    {
+        s->next_rate = s->link.rate;
+        linkq_set(&s->link, s->prev_rate, now);
+        s->prev_rate = -1;
+        s->stats.rate_reverts++;
+    }
+    if (linkq_silent(&s->link, now))
+        sim_gs_fallback(s, now);
+
+    if (now < s->air_free)
+        return;
+
+    // no connection, or the last word of one is off the air: listen where a new one starts
+    if (s->stats.state == SIM_GS_LISTEN && !*s->control)
+        sim_gs_fallback(s, now);
+
+    if (*s->control)
+    {
+        sim_air(s, SIM_TO_ROVER, s->control, true, now);
+        *s->control = '\0';
+        return;
+    }
+
+    if (s->stats.state == SIM_GS_FIN_WAIT && time_reached(s->fin_retry))
+    {
+        if (s->fin_tries >= SIM_FIN_TRIES)
+        {
+            s->stats.state = SIM_GS_LISTEN;
+            s->stats.resets++;
+            return;
+        }
+        sim_gs_control(s, s->gs.seq, s->gs.ack, "FIN");
+        sim_air(s, SIM_TO_ROVER, s->control, true, now);
+        *s->control = '\0';
+        s->fin_tries++;
+        s->fin_retry = make_timeout_time_ms(SIM_FIN_RETRY_MS);
+        return;
+    }
+
+    if (s->stats.state != SIM_GS_ESTABLISHED)
+        return;
+
+    if (s->close)
+    {
+        s->close = false;
+        s->stats.state = SIM_GS_FIN_WAIT;
+        s->fin_at = now;
+        s->fin_tries = 0;
+        s->fin_retry = now;
+        sim_gs_poll(s, now);
+        return;
+    }
+
+    if (s->channel.cmd_period_ms && time_reached(s->next_cmd) && !arq_window_full(&s->gs))
+    {
+        arq_queue(&s->gs, "$CMD", SIM_CMD);
+        s->stats.cmds++;
+        s->next_cmd = delayed_by_ms(s->next_cmd, s->channel.cmd_period_ms);
+    }
+
+    switch (arq_poll(&s->gs, now, out, sizeof(out)))
+    {
+        case ARQ_SEND:
+            end = sim_air(s, SIM_TO_ROVER, out, true, now);
+            if (s->next_rate >= 0 && s->next_rate_at == nil_time)
+                s->next_rate_at = end;
+            break;
+        case ARQ_FAILED:
+            s->stats.state = SIM_GS_LISTEN;
+            s->stats.resets++;
+            break;
+        case ARQ_IDLE:
+            break;
+    }
+}
+
+// runs everything that is due, earliest first
+static void sim_run_events(sim_lora_t *s, absolute_time_t now)
+{
+    char line[SIM_LORA_LINE_SIZE + 32];
+
+    for (;;)
+    {
+        sim_event_t *ev = NULL;
+
+        for (int i = 0; i < SIM_LORA_EVENTS; i++)
+        {
+            if (s->events[i].type != SIM_EVENT_NONE && s->events[i].due <= now && (!ev || s->events[i].due < ev->due))
+                ev = &s->events[i];
+        }
+        if (!ev)
+            return;
+
+        switch (ev->type)
+        {
+            case SIM_EVENT_SENT:
+                sim_push(s, "+OK");
+                break;
+            case SIM_EVENT_TO_GS:
+                sim_gs_receive(s, ev, now);
+                break;
+            case SIM_EVENT_TO_ROVER:
+                // +RCV=<address>,<length>,<data>,<rssi>,<snr>
+                snprintf(line, sizeof(line), "+RCV=%d,%d,%s,%d,%d", GS_ADDRESS, (int)strlen(ev->data), ev->data,
+                         s->channel.rssi, s->channel.phy ? sim_phy_snr(s) : s->channel.snr);
+                sim_push(s, line);
+                break;
+            case SIM_EVENT_NONE:
+                break;
+        }
+        ev->type = SIM_EVENT_NONE;
+    }
+}
+
+/**
+ * @brief Module: answers one command from the rover
+ */
+static void sim_command(sim_lora_t *s, absolute_time_t now)
+{
+    const char *line = s->line;
+    const char *data;
+    int address, len;
+    int sf, bw, cr, preamble;
+    sim_event_t *ev;
+
+    s->stats.commands++;
+
+    if (strcmp(line, "AT") == 0)
+    {
+        sim_push(s, "+OK");
+    }
+    else if (sscanf(line, "AT+NETWORKID=%d", &s->network_id) == 1 || sscanf(line, "AT+ADDRESS=%d", &s->address) == 1)
+    {
+        sim_push(s, "+OK");
+    }
+    else if (sscanf(line, "AT+PARAMETER=%d,%d,%d,%d", &sf, &bw, &cr, &preamble) == 4)
+    {
+        if (sf < 7 || sf > 12 || bw < 0 || bw > 9 || cr < 1 || cr > 4 || preamble < 4 || preamble > 7)
+        {
+            s->stats.errors++;
+            sim_push(s, "+ERR=5");
+            return;
+        }
+        s->phy = (lora_rate_t){ (uint8_t)sf, (uint8_t)bw, (uint8_t)cr, (uint8_t)preamble, 0 };
+        sim_push(s, "+OK");
+    }
+    else if (strncmp(line, "AT+SEND=", 8) == 0)
+    {
+        // AT+SEND=<address>,<length>,<data>; the module refuses a length that doesn't match
+        data = strchr(line, ',') ? strchr(strchr(line, ',') + 1, ',') : NULL;
+        if (sscanf(line, "AT+SEND=%d,%d,", &address, &len) != 2 || !data || len != (int)strlen(data + 1) ||
+            len > LORA_SIZE)
+        {
+            s->stats.errors++;
+            sim_push(s, "+ERR=5");
+            return;
+        }
+        bool heard = s->network_id == SIM_LORA_NETWORK_ID && address == GS_ADDRESS;
+        absolute_time_t end = sim_air(s, SIM_TO_GS, data + 1, heard, now);
+        // "+OK" once the frame is off the air; nothing else is sent meanwhile
+        if ((ev = sim_event_add(s, SIM_EVENT_SENT, end)))
+            ev->sent = end;
+    }
+    else
+    {
+        s->stats.errors++;
+        sim_push(s, "+ERR=4");
+    }
+}
+
+// collects the firmware's next command; false if the line isn't complete within timeout_us
+static bool sim_getline(sim_lora_t *s, uint32_t timeout_us)
+{
+    char c;
+
+    while (host_uart_tx_pop(s->uart, &c, 1, timeout_us))
+    {
+        if (c == '\r' || c == '\n')
+        {
+            if (!s->len)
+                continue;
+            s->line[s->len] = '\0';
+            s->len = 0;
+            return true;
+        }
+        if (s->len < sizeof(s->line) - 1)
+            s->line[s->len++] = c;
+    }
+    return false;
+}
+
+static void *sim_lora_serve(void *arg)
+{
+    sim_lora_t *s = arg;
+
+    while (s->running)
+    {
+        pthread_mutex_lock(&s->lock);
+        absolute_time_t now = get_absolute_time();
+        absolute_time_t wake = delayed_by_us(now, SIM_LORA_POLL_US);
+        sim_run_events(s, now);
+        sim_gs_poll(s, now);
+        for (int i = 0; i < SIM_LORA_EVENTS; i++)
+        {
+            if (s->events[i].type != SIM_EVENT_NONE && s->events[i].due < wake)
+                wake = s->events[i].due;
+        }
+        if (s->air_free > now && s->air_free < wake)
+            wake = s->air_free;
+        pthread_mutex_unlock(&s->lock);
+
+        int64_t wait_us = absolute_time_diff_us(get_absolute_time(), wake);
+        if (sim_getline(s, wait_us > 0 ? (uint32_t)wait_us : 0))
+        {
+            pthread_mutex_lock(&s->lock);
+            sim_command(s, get_absolute_time());
+            pthread_mutex_unlock(&s->lock);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Serves the rover's module, the air and the ground station on a thread of its own
+ *        until sim_lora_stop()
+ */
+void sim_lora_start(sim_lora_t *s)
+{
+    s->running = true;
+    pthread_create(&s->thread, NULL, sim_lora_serve, s);
+}
+
+void sim_lora_stop(sim_lora_t *s)
+{
+    if (!s->running)
+        return;
+    s->running = false;
+    pthread_join(s->thread, NULL);
+}
+
+/**
+ * @brief Loses every frame, either way, that starts in the next ms milliseconds
+ */
+void sim_lora_outage(sim_lora_t *s, uint32_t ms)
+{
+    pthread_mutex_lock(&s->lock);
+    s->outage_start = get_absolute_time();
+    s->outage_end = delayed_by_ms(s->outage_start, ms);
+    pthread_mutex_unlock(&s->lock);
+}
+
+/**
+ * @brief Changes the SNR, dB at 125 kHz with channel.phy, for frames that start from now on
+ */
+void sim_lora_set_snr(sim_lora_t *s, int snr)
+{
+    pthread_mutex_lock(&s->lock);
+    s->channel.snr = snr;
+    pthread_mutex_unlock(&s->lock);
+}
+
+/**
+ * @brief Has the ground station end the connection with FIN once the air is free;
+ *        stats.teardown_us is set when the rover's FIN comes back
+ */
+void sim_lora_close(sim_lora_t *s)
+{
+    pthread_mutex_lock(&s->lock);
+    s->close = true;
+    s->stats.teardown_us = -1;
+    pthread_mutex_unlock(&s->lock);
+}
+
+void sim_lora_get_stats(sim_lora_t *s, sim_lora_stats_t *out)
+{
+    pthread_mutex_lock(&s->lock);
+    *out = s->stats;
+    out->arq = s->gs.stats;
+    out->txr_errors = s->txr.errors + s->txr.evicted + s->txr.expired;
+    out->link = s->link;
+    out->link.rate_us[s->link.rate] += absolute_time_diff_us(s->link.changed, get_absolute_time());
+    pthread_mutex_unlock(&s->lock);
+}
+
+/**
+ * @brief Runs fn(arg, result) in a child process and copies the size bytes of
+ *        *result back: comm_run() never returns and its state is static, so
+ *        each run needs a process of its own. The child is killed after
+ *        limit_s seconds.
+ *
+ * @return true if the child finished and handed back the whole result
+ */
+bool sim_run_child(sim_child_fn fn, const void *arg, void *result, size_t size, unsigned limit_s)
+{
+    int fds[2];
+    int st;
+    pid_t pid;
+    size_t got = 0;
+    ssize_t n;
+
+    fflush(stdout);
+    if (pipe(fds))
+        return false;
+    pid = fork();
+    if (pid < 0)
+    {
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+    if (pid == 0)
+    {
+        close(fds[0]);
+        alarm(limit_s);
+        fn(arg, result);
+        fflush(stdout);
+        _exit(write(fds[1], result, size) == (ssize_t)size ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    close(fds[1]);
+    while (got < size && (n = read(fds[0], (char *)result + got, size - got)) > 0)
+        got += (size_t)n;
+    close(fds[0]);
+    waitpid(pid, &st, 0);
+    return got == size && WIFEXITED(st) && WEXITSTATUS(st) == EXIT_SUCCESS;
+}
@@ -0,0 +1,101 @@
+/**
+ * @file atmodem.h
+ * @brief Non-blocking AT-command engine for the RYLR896 LoRa module
+ *
+ * Commands are queued with at_submit() and go out one at a time: the module
+ * answers each with "+OK" or "+ERR=<n>" and takes the next only after that.
+ * at_poll() does all the work without waiting: it hands the next command to
+ * the TX ring, classifies the lines the framer has assembled, completes the
+ * current command on its answer or its deadline, and hands unsolicited lines
+ * ("+RCV=...", "+READY") to a listener, so reception carries on while a
+ * command is outstanding.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef ATMODEM_H
+#define ATMODEM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pico/types.h"
+#include "hardware/uart.h"
+
+#include "framer.h"
+#include "txring.h"
+
+#define AT_QUEUE_DEPTH      4       // commands waiting or outstanding; must be a power of 2
+#define AT_COMMAND_SIZE     268     // "AT+SEND=101,240,<240 bytes>\r\n" + '\0'
+#define AT_CONFIG_TIMEOUT_MS    1000    // answer to a configuration command
+
+typedef enum AT_LINE {
+    AT_LINE_OK,             // "+OK": the current command succeeded
+    AT_LINE_ERR,            // "+ERR=<n>": the current command failed
+    AT_LINE_RCV,            // "+RCV=<address>,<length>,<data>,<rssi>,<snr>": a frame arrived
+    AT_LINE_READY,          // "+READY": the module (re)started
+    AT_LINE_OTHER           // anything else, e.g. the answer to a query
+} AT_LINE;
+
+typedef enum AT_RESULT {
+    AT_RESULT_OK,
+    AT_RESULT_ERR,          // the module answered "+ERR=<n>"
+    AT_RESULT_TIMEOUT       // no answer before the command's deadline
+} AT_RESULT;
+
+typedef struct at_command at_command_t;
+
+// called from at_poll() when a command completes; error is <n> of "+ERR=<n>", else 0
+typedef void (*at_done_t)(const at_command_t *cmd, AT_RESULT result, int error);
+// called from at_poll() for each line that doesn't answer a command; line is NUL-terminated
+typedef void (*at_listener_t)(AT_LINE type, const char *line, size_t len, void *ctx);
+
+struct at_command
+{
+    char text[AT_COMMAND_SIZE];     // including "\r\n"
+    uint16_t len;
+    uint32_t timeout_ms;            // from entering the TX ring to the answer
+    at_done_t done;                 // NULL if the caller doesn't care
+    void *ctx;
+};
+
+typedef struct at_engine
+{
+    tx_ring_t *tx;                  // drained by the UART's TX interrupt
+    line_framer_t *framer;          // filled by the UART's RX interrupt
+    at_listener_t listener;
+    void *ctx;
+
+    at_command_t queue[AT_QUEUE_DEPTH];
+    uint32_t head;                  // commands ever completed
+    uint32_t tail;                  // commands ever submitted
+    bool started;                   // queue[head] is in the TX ring or waits for its answer
+    absolute_time_t deadline;       // of queue[head], once started
+
+    // statistics
+    uint32_t commands;
+    uint32_t ok;
+    uint32_t errors;                // "+ERR" answers
+    uint32_t timeouts;
+    uint32_t rejected;              // at_submit() found the queue full
+    uint32_t unsolicited;           // lines given to the listener
+    uint32_t stray;                 // "+OK"/"+ERR" with no command outstanding
+    uint32_t overflows;             // lines too long for the framer
+    int last_error;
+} at_engine_t;
+
+// function prototypes
+void at_init(at_engine_t *at, tx_ring_t *tx, line_framer_t *framer, at_listener_t listener, void *ctx);
+AT_LINE at_classify(const char *line, int *error);
+bool at_submit(at_engine_t *at, const char *command, uint32_t timeout_ms, at_done_t done, void *ctx);
+bool at_poll(at_engine_t *at);
+bool at_busy(const at_engine_t *at);
+unsigned at_free(const at_engine_t *at);
+absolute_time_t at_deadline(const at_engine_t *at);
+
+#endif
@@ -0,0 +1,81 @@
+/**
+ * @file binproto.h
+ * @brief Binary framing for the SBC <-> Pico USB link: COBS + CRC-16 with a versioned header
+ *
+ * On the wire a frame is COBS(header | payload | crc16) followed by a 0x00 delimiter.
+ * The CRC is CRC-16/CCITT-FALSE over header and payload, little-endian. This file has
+ * no pico-sdk dependencies so the SBC side can build it as is.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef BINPROTO_H
+#define BINPROTO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define BIN_VERSION         1
+#define BIN_MAX_PAYLOAD     255
+#define BIN_HEADER_SIZE     3       // version, message id, payload length
+#define BIN_CRC_SIZE        2
+#define BIN_MAX_RAW         (BIN_HEADER_SIZE + BIN_MAX_PAYLOAD + BIN_CRC_SIZE)
+// COBS adds one byte per 254 plus the leading code byte; +1 for the delimiter
+#define BIN_MAX_WIRE        (BIN_MAX_RAW + BIN_MAX_RAW / 254 + 2)
+
+// message ids; the first five mirror the $XXX messages in definitions.h
+typedef enum BIN_MSG_ID {
+    BIN_MSG_MOTORS  = 0x01,     // mtr payload: dir1, pwm1, dir2, pwm2 (1 byte each, pwm 0-100), or 'V', int16 rpm1, rpm2 LE (+-WHEEL_MAX_RPM)
+    BIN_MSG_TX      = 0x02,     // text, no NUL bytes; a frame with one is refused
+    BIN_MSG_CMD     = 0x03,     // text, no NUL bytes
+    BIN_MSG_REQ     = 0x04,     // text, no NUL bytes
+    BIN_MSG_ACK     = 0x05,     // int32 seq, little-endian
+    BIN_MSG_FIX     = 0x10,     // packed gps_fix_t
+    BIN_MSG_ERR     = 0x11,     // text
+    BIN_MSG_CTL     = 0x12,     // packed motor_ctl_stats_t
+    BIN_MSG_MBOX    = 0x13,     // packed mtrbox_stats_t per source, in MTR_SOURCE order
+    BIN_MSG_TRACE   = 0x14,     // trace_record_t, as many as fit; one or more per dump
+    BIN_MSG_TRACE_END = 0x15,   // uint32 records sent, records lost since boot: the dump is complete
+    BIN_MSG_STATS   = 0x16      // packed rover_stats_t
+} BIN_MSG_ID;
+
+typedef struct bin_frame
+{
+    uint8_t version;
+    uint8_t id;
+    uint8_t len;
+    const uint8_t *payload;     // points into the decoder's buffer
+} bin_frame_t;
+
+typedef enum BIN_EVENT {
+    BIN_NONE,       // frame not complete yet
+    BIN_FRAME,      // a valid frame is available
+    BIN_ERROR       // a frame was dropped: bad COBS, bad CRC, bad header or too long
+} BIN_EVENT;
+
+// streaming receiver; feed it bytes as they arrive
+typedef struct bin_decoder
+{
+    uint8_t buf[BIN_MAX_WIRE];
+    size_t len;
+    bool overflow;
+
+    uint32_t frames;            // valid frames received
+    uint32_t errors;            // frames dropped
+} bin_decoder_t;
+
+// function prototypes
+uint16_t crc16_ccitt(const uint8_t *data, size_t len, uint16_t crc);
+size_t cobs_encode(const uint8_t *src, size_t len, uint8_t *dst);
+size_t cobs_decode(const uint8_t *src, size_t len, uint8_t *dst);
+
+size_t bin_encode(uint8_t id, const void *payload, size_t len, uint8_t *out);
+void bin_decoder_init(bin_decoder_t *d);
+BIN_EVENT bin_decoder_push(bin_decoder_t *d, uint8_t byte, bin_frame_t *frame);
+
+#endif
@@ -0,0 +1,63 @@
+/**
+ * @file commands.h
+ * @brief Table-driven parser/dispatcher for the $XXX command messages
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef COMMANDS_H
+#define COMMANDS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "binproto.h"
+#include "definitions.h"
+
+// $MTR <dir1> <pwm1> <dir2> <pwm2>, or $MTR V <rpm1> <rpm2> for closed-loop wheel speeds
+typedef struct mtr_cmd
+{
+    bool velocity;          // rpm1/rpm2 are set rather than dir/pwm
+    bool dir1;
+    int8_t pwm1;
+    bool dir2;
+    int8_t pwm2;
+    int16_t rpm1;           // signed, negative in reverse
+    int16_t rpm2;
+} mtr_cmd_t;
+
+// $ACK <seq>
+typedef struct ack_cmd
+{
+    int seq;
+} ack_cmd_t;
+
+// $CMD/$REQ/$TXR <free text>; points into the caller's buffer, never copied
+typedef struct text_arg
+{
+    const char *text;
+    size_t len;
+} text_arg_t;
+
+typedef struct command
+{
+    uint32_t tag;
+    union
+    {
+        mtr_cmd_t mtr;
+        ack_cmd_t ack;
+        text_arg_t text;
+    };
+} command_t;
+
+// function prototypes
+int parse_command(const char *in, command_t *cmd);
+int parse_frame(const bin_frame_t *frame, command_t *cmd);
+int dispatch_command(const command_t *cmd);
+bool apply_motor_commands(void);
+
+#endif
@@ -12,8 +12,29 @@
 #ifndef COMMS_H
 #define COMMS_H
 
+#include "pico/types.h"
 #include "pico/util/queue.h"
 
+#include "atmodem.h"
+#include "frag.h"
+#include "framer.h"
+#include "linkq.h"
+#include "msgring.h"
+#include "txsched.h"
+
+// define UART connection for LORA
+#define UART_ID_LORA        uart1
+#define BAUD_RATE_LORA      115200
+#define DATA_BITS_LORA      8
+#define STOP_BITS_LORA      1
+#define PARITY_LORA         UART_PARITY_NONE
+#define UART_TX_PIN_LORA    4
+#define UART_RX_PIN_LORA    5
+
+#define LORA_SIZE   240
+#define GS_ADDRESS  101
+#define LORA_SEND_TIMEOUT_MS    3000    // longest AT+SEND before its "+OK"
+
 typedef enum COMM_STATE {
     CLOSED,
     SYNSENT,
@@ -21,35 +42,148 @@ typedef enum COMM_STATE {
     LASTACK
 } COMM_STATE;
 
+// selective-repeat window on the LoRa link
+#ifndef ARQ_WINDOW
+#define ARQ_WINDOW          8       // frames in flight by default
+#endif
+#define ARQ_MAX_WINDOW      16      // slots per direction; power of two
+#define ARQ_RTO_INIT_MS     5000    // retransmission timeout until the first RTT sample
+#define ARQ_RTO_MIN_MS      500
+#define ARQ_RTO_MAX_MS      30000
+#define ARQ_RTO_GRANULARITY_MS  10  // floor for the variance term
+#define ARQ_MAX_BACKOFF     6
+#define ARQ_REPORT_MS       10000   // $LNK telemetry period
+#define ARQ_MAX_TRIES       5       // transmissions of one frame before the connection is dropped
+#define ARQ_ACK_DELAY_MS    100     // how long a bare ACK waits for data to ride on
+#define ARQ_HEADER_SIZE     32      // kind byte + seq, ack, sack varints, stuffed
+#define ARQ_DATA_SIZE       (LORA_SIZE - ARQ_HEADER_SIZE)   // payload budget after stuffing, NUL included
+
+#define FLAG_SIZE           5
+
+typedef struct ARQ_SLOT
+{
+    absolute_time_t sent;       // last transmission
+    absolute_time_t deadline;   // retransmit once reached
+    uint8_t tries;              // transmissions so far, 0 = not sent yet
+    bool acked;                 // TX: acknowledged by the peer
+    bool held;                  // RX: received, waiting for in-order delivery
+    bool fast;                  // TX: retransmit scheduled because a later frame got through
+    uint8_t len;                // bytes in data; text payloads are also NUL-terminated
+    char flag[FLAG_SIZE];
+    char data[ARQ_DATA_SIZE];
+} ARQ_SLOT;
+
+typedef struct ARQ_STATS
+{
+    uint32_t sent;          // data frames sent, retransmissions included
+    uint32_t retransmits;
+    uint32_t acks;          // bare ACK frames sent
+    uint32_t delivered;     // data frames handed up in order
+    uint32_t duplicates;
+    uint32_t out_of_order;
+    uint32_t failures;      // frames that ran out of tries
+    uint32_t timeouts;      // retransmissions because the RTO expired
+    uint32_t agg_frames;    // AGG frames queued
+    uint32_t agg_items;     // items packed into them
+    int32_t agg_saved;      // payload bytes kept off the air by packing; each packed item also saves a preamble
+} ARQ_STATS;
+
 typedef struct STATE
 {
     COMM_STATE state;      // connection status string
-    int seq;                // sequence number
-    int ack;                // ACK number
+    int seq;                // sequence number; the next one to assign
+    int ack;                // ACK number; the next sequence number expected from the peer
+
+    // ESTABLISHED only: frames base..seq-1 are in flight in tx, frames ack.. are held in rx
+    int base;               // oldest unacknowledged sequence number
+    int window;             // frames allowed in flight, at most ARQ_MAX_WINDOW
+    int max_tries;
+    bool ack_pending;
+    absolute_time_t ack_deadline;
+    ARQ_SLOT tx[ARQ_MAX_WINDOW];
+    ARQ_SLOT rx[ARQ_MAX_WINDOW];
+    int rx_items;           // items of the oldest held AGG frame already delivered
+    ARQ_STATS stats;
+
+    // retransmission timeout, adapted from round-trip samples; kept across the handshake
+    uint32_t srtt_us;       // smoothed RTT
+    uint32_t rttvar_us;     // RTT variation
+    uint32_t rto_us;        // SRTT + 4 RTTVAR, before backoff
+    uint8_t backoff;        // RTO doublings since the last acknowledgement
+    uint32_t rtt_samples;   // 0 until the first sample
+    absolute_time_t backoff_at;
 
 } STATE;
 
-// define UART connection for LORA
-#define UART_ID_LORA        uart1
-#define BAUD_RATE_LORA      115200
-#define DATA_BITS_LORA      8
-#define STOP_BITS_LORA      1
-#define PARITY_LORA         UART_PARITY_NONE
-#define UART_TX_PIN_LORA    4
-#define UART_RX_PIN_LORA    5
+// LoRa payload, before byte stuffing:
+//   <kind | LORA_F_*> <seq varint> <ack varint> [<sack varint>] [<data>]
+// The flag strings used inside the firmware map to the kind in the low bits.
+// Stuffing replaces each of NUL, CR, LF, ',', '=' and LORA_ESC with LORA_ESC,
+// byte ^ 0x40, so a frame is still one C string and one +RCV field.
+// Flag "AGG" packs several text items into data as "<n>:<flag> <data>" each,
+// n = length of "<flag> <data>". Flag "FRG" carries a piece of a long $TXR
+// message, see frag.h; flag "RAT" a data rate change, see linkq.h.
+#define LORA_KIND_MASK      0x07
+#define LORA_F_DATA         0x08    // data follows; the frame consumes seq
+#define LORA_F_SACK         0x10    // a sack varint follows ack
+#define LORA_ESC            0x1B
 
-#define LORA_SIZE   240
-#define GS_ADDRESS  101
+typedef struct FRAME
+{
+    int seq;
+    int ack;
+    uint32_t sack;          // bit i: ack + 1 + i was received
+    char flag[FLAG_SIZE];
+    char *data;             // NULL for bare ACK/SYN/FIN frames; NUL-terminated
+    size_t len;
+} FRAME;
+
+typedef enum ARQ_EVENT {
+    ARQ_IDLE,               // nothing to send now
+    ARQ_SEND,               // a frame was formatted
+    ARQ_FAILED              // a frame ran out of tries; the link is dead
+} ARQ_EVENT;
 
 // function prototypes
 void protocol(STATE *state, char *in, char *out);
-void write(char *tx);
 int parseMessage(char *in);
-int parseData(STATE *state, char *in, char *flag);
-int initLora(char *rx_buffer);
+int parseData(FRAME *frame, char *in);
+int formatFrame(char *out, size_t size, int seq, int ack, uint32_t sack, const char *flag, const void *data, size_t len);
+int loraStuff(const void *in, size_t len, char *out, size_t size);
+size_t loraStuffedSize(const void *data, size_t len);
+size_t loraUnstuff(char *buf);
+int aggAppend(char *out, size_t size, size_t len, const char *flag, const char *data);
+int aggNext(const char **cursor, char *flag, char *data, size_t size);
+int aggregateQueue(STATE *state, tx_sched_t *sched, const char *flag);
+int initLora(void);
 void comm_run();
 
-extern queue_t receive_queue;
-extern queue_t transmit_queue;
+// selective-repeat ARQ (arq.c)
+void arq_start(STATE *state, int window);
+void arq_rtt_reset(STATE *state);
+void arq_rtt_sample(STATE *state, uint32_t rtt_us);
+void arq_backoff(STATE *state);
+uint32_t arq_rto(const STATE *state);
+int arq_format_link(const STATE *state, char *out, size_t size);
+bool arq_window_full(const STATE *state);
+int arq_unsent(const STATE *state);
+int arq_queue(STATE *state, const char *flag, const char *data);
+int arq_queue_bytes(STATE *state, const char *flag, const void *data, size_t len);
+bool arq_acked(const STATE *state, int seq);
+void arq_receive(STATE *state, const FRAME *frame, absolute_time_t now);
+const ARQ_SLOT *arq_peek(const STATE *state);
+void arq_pop(STATE *state);
+uint32_t arq_sack(const STATE *state);
+ARQ_EVENT arq_poll(STATE *state, absolute_time_t now, char *out, size_t size);
+absolute_time_t arq_next_deadline(const STATE *state);
+
+extern line_framer_t lora_framer;
+extern tx_ring_t lora_tx;
+extern at_engine_t lora_modem;         // the LoRa module, driven by comm_run() on core 1
+extern msg_channel_t receive_queue;    // core 1 -> core 0: $CMD payloads from the ground station
+extern msg_channel_t error_queue;      // core 1 -> core 0: errors for usb_error(); core 1 never prints
+extern tx_sched_t transmit_queue;      // core 0 -> core 1: fault reports, $TX and telemetry for the ground station
+extern frag_tx_t txr_queue;            // core 0 -> core 1: $TXR messages too long for one frame
+extern linkq_t lora_quality;           // core 1: the link's quality and data rate
 
 #endif
\ No newline at end of file
@@ -7,6 +7,7 @@
 #include "hardware/irq.h"
 
 int configure_UART(uart_inst_t *UART_ID, uint BAUDRATE, uint TX_PIN, uint RX_PIN, uint DATA_BITS, uint STOP_BITS, uint PARITY, irq_handler_t IRQ_FUN, bool useIRQ);
+void configure_UART_IRQ(uart_inst_t *UART_ID, irq_handler_t IRQ_FUN);
 
 
 #endif
\ No newline at end of file
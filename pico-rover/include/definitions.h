@@ -16,11 +16,14 @@
 #define CR          13  // CARRIAGE RETURN
 
 // message definitions
-static const char * MSG_MOTORS = "$MTR\0";      // command for motor controller
-static const char * MSG_TX     = "$TXR\0";      // transmit a string on the LoRa
-static const char * MSG_CMD    = "$CMD\0";      // generic command, passed to SBC through serial
-static const char * MSG_REQ    = "$REQ\0";      // a request for data update, new rate, etc...
-static const char * MSG_ACK    = "$ACK\0";      // an acknowledgement that a message was received
+// each tag ("$MTR") is packed little-endian into one word so it compares in a single instruction
+#define MSG_TAG(a, b, c, d) ((uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+
+#define MSG_MOTORS  MSG_TAG('$', 'M', 'T', 'R')     // command for motor controller
+#define MSG_TX      MSG_TAG('$', 'T', 'X', 'R')     // transmit a string on the LoRa
+#define MSG_CMD     MSG_TAG('$', 'C', 'M', 'D')     // generic command, passed to SBC through serial
+#define MSG_REQ     MSG_TAG('$', 'R', 'E', 'Q')     // a request for data update, new rate, etc...
+#define MSG_ACK     MSG_TAG('$', 'A', 'C', 'K')     // an acknowledgement that a message was received
 // message buffer sizes
 #define NMEA_SIZE   83
 
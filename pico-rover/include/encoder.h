@@ -0,0 +1,95 @@
+/**
+ * @file encoder.h
+ * @brief Quadrature decoding and velocity estimation for the wheel encoders
+ *
+ * encoder_edge() is the whole interrupt-time work: it looks up the A/B
+ * transition in a 16-entry table, bumps the count and stamps the edge,
+ * integers only. Both edges of both channels count, so one count is a quarter
+ * of an encoder line. encoder_update() runs outside interrupt context at a
+ * fixed period and turns counts into a velocity. The four edges of a line are
+ * never evenly spaced on a real disc, so only spans of whole lines are used:
+ * with 4 or more counts since the last estimate it is the M/T method (whole
+ * lines over the time between the edges that bound them); with fewer it is the
+ * period of the last whole line. While no edge arrives the estimate decays as
+ * the time since the current line began grows, and reaches 0 after ENC_STOP_US.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef ENCODER_H
+#define ENCODER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pico/types.h"
+
+#define ENC_STOP_US         250000  // no edge for this long: stopped
+#define ENC_VEL_SHIFT       8       // velocity is counts/s << ENC_VEL_SHIFT
+
+typedef struct encoder
+{
+    uint8_t pin_a;
+    uint8_t pin_b;
+
+    // written by encoder_edge() only
+    uint8_t state;                  // last A/B levels, A in bit 1
+    int8_t dir;                     // last step
+    uint8_t run;                    // edges in a row in that direction, up to 5: a whole line is 5 edges
+    uint32_t seq;                   // odd while an edge is being recorded
+    int32_t count;
+    uint32_t stamp[4];              // time of the last edge that left count & 3 at each value
+    uint32_t line_us;               // time of the last 4 steps; valid once run is 5
+    uint32_t errors;                // transitions that skipped a state: an edge was missed
+
+    // written by encoder_update() only
+    int32_t ref_count;              // count and edge time the last M/T span ended at
+    uint32_t ref_edge_us;
+    bool ref_valid;
+    int32_t velocity;               // counts/s << ENC_VEL_SHIFT
+} encoder_t;
+
+extern const int8_t encoder_steps[16];
+
+/**
+ * @brief Interrupt side: records an edge on either channel; no floating point, no loops
+ *
+ * @param e the encoder
+ * @param pins all GPIO levels, as from gpio_get_all()
+ * @param now_us time_us_32() at the edge
+ */
+static inline void encoder_edge(encoder_t *e, uint32_t pins, uint32_t now_us)
+{
+    uint8_t state = (uint8_t)(((pins >> e->pin_a) & 1u) << 1 | ((pins >> e->pin_b) & 1u));
+    int8_t step = encoder_steps[e->state << 2 | state];
+
+    if (!step)
+    {
+        // both channels changed at once; a repeated level is just the other edge of a bounce
+        e->errors += (e->state ^ state) == 3;
+        e->state = state;
+        return;
+    }
+
+    __atomic_store_n(&e->seq, e->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    e->state = state;
+    e->run = step == e->dir ? e->run + (e->run < 5) : 1;
+    e->dir = step;
+    e->count += step;
+    // the slot held the edge 4 steps back: a whole line ago if the wheel kept going
+    e->line_us = now_us - e->stamp[e->count & 3];
+    e->stamp[e->count & 3] = now_us;
+    __atomic_store_n(&e->seq, e->seq + 1, __ATOMIC_RELEASE);
+}
+
+// function prototypes
+void encoder_init(encoder_t *e, uint pin_a, uint pin_b, uint32_t pins);
+void encoder_read(const encoder_t *e, int32_t *count, uint32_t *edge_us);
+void encoder_update(encoder_t *e, uint32_t now_us);
+
+#endif
@@ -0,0 +1,114 @@
+/**
+ * @file frag.h
+ * @brief $TXR messages longer than one LoRa frame: numbered fragments on the rover, reassembly at the ground station
+ *
+ * The SBC sends a long message as several $TXR lines, "$TXR + <piece>" for
+ * each piece but the last and "$TXR <piece>" for the last, up to
+ * FRAG_MAX_MESSAGE bytes in all; a piece that itself starts with "+ " or ". "
+ * goes as "$TXR . <piece>" if it is the last. A message that came in one line
+ * and stuffs into one frame still goes through transmit_queue as an item, so
+ * short messages sent after a long one may reach the ground station before it.
+ *
+ * Core 0 appends the pieces to a staging ring; core 1 sees a message only once
+ * its last piece is in, so it knows the total. A message that doesn't fit is
+ * refused whole, and so are the rest of its pieces. Core 1 cuts the oldest
+ * message into "FRG" frames as the ARQ window has room, after
+ * everything in transmit_queue; its space goes back to core 0 once the last
+ * fragment is queued. A fragment's data is
+ *
+ *   <message id varint> <offset varint> <total length varint> <bytes>
+ *
+ * The ARQ delivers fragments in order, so the ground station appends each to
+ * the buffer of its message and has the message with the last byte. A
+ * reassembly buffer with no fragment for FRAG_TIMEOUT_MS is dropped, and a new
+ * message with every buffer in use takes the one idle longest. On a new
+ * connection the rover cuts the message it was on again from offset 0, under
+ * the same id, and the ground station starts its buffer over; fragments still
+ * in the old connection's window when it dropped are lost with it.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef FRAG_H
+#define FRAG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pico/types.h"
+
+#define FRAG_MAX_MESSAGE    16384   // longest $TXR message, bytes
+#define FRAG_TX_SIZE        32768   // staging ring on the rover; a power of 2, room for two whole messages
+#define FRAG_LEN_SIZE       2       // each message in the ring starts with its length, little-endian
+#define FRAG_SLOTS          4       // reassembly buffers at the ground station
+#define FRAG_TIMEOUT_MS     60000   // a partial message with no fragment for this long is dropped
+
+_Static_assert((FRAG_TX_SIZE & (FRAG_TX_SIZE - 1)) == 0, "FRAG_TX_SIZE must be a power of 2");
+_Static_assert(FRAG_MAX_MESSAGE < 1u << (8 * FRAG_LEN_SIZE), "message length must fit its prefix");
+
+// rover: core 0 -> core 1
+typedef struct frag_tx
+{
+    uint8_t buf[FRAG_TX_SIZE];
+    uint32_t head;              // core 0: end of the last whole message
+    uint32_t tail;              // core 1: start of the message being cut; the space before it is free
+
+    // core 0
+    uint32_t open;              // end of the message being appended; head while there is none
+    bool refusing;              // the message being appended was refused: so are its other pieces
+    uint32_t messages;          // whole messages staged
+    uint32_t refused;           // messages dropped: too long, or no room
+
+    // core 1
+    uint32_t offset;            // bytes of the oldest message already cut
+    uint16_t id;                // of the oldest message
+    uint32_t sent;              // messages cut completely
+    uint32_t fragments;
+} frag_tx_t;
+
+typedef enum FRAG_EVENT {
+    FRAG_PARTIAL,               // the fragment was taken, the message isn't complete yet
+    FRAG_MESSAGE,               // a message is complete
+    FRAG_ERROR                  // the fragment was dropped: malformed, or not where its message stands
+} FRAG_EVENT;
+
+typedef struct frag_slot
+{
+    bool used;
+    uint16_t id;
+    uint32_t total;
+    uint32_t len;               // bytes received, in order
+    absolute_time_t last;       // when the last fragment came
+    uint8_t data[FRAG_MAX_MESSAGE];
+} frag_slot_t;
+
+// ground station
+typedef struct frag_rx
+{
+    frag_slot_t slot[FRAG_SLOTS];
+    uint32_t messages;          // complete
+    uint32_t fragments;
+    uint32_t evicted;           // partial messages dropped for a new one
+    uint32_t expired;           // partial messages dropped after FRAG_TIMEOUT_MS
+    uint32_t errors;
+} frag_rx_t;
+
+// function prototypes
+void frag_tx_init(frag_tx_t *tx);
+int frag_append(frag_tx_t *tx, const void *data, size_t len, bool more);
+bool frag_appending(const frag_tx_t *tx);
+uint32_t frag_pending(const frag_tx_t *tx);
+size_t frag_next(frag_tx_t *tx, uint8_t *out);
+void frag_restart(frag_tx_t *tx);
+
+void frag_rx_init(frag_rx_t *rx);
+FRAG_EVENT frag_receive(frag_rx_t *rx, const void *data, size_t len, absolute_time_t now,
+                        const uint8_t **message, size_t *size);
+void frag_expire(frag_rx_t *rx, absolute_time_t now);
+
+#endif
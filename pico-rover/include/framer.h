@@ -0,0 +1,78 @@
+/**
+ * @file framer.h
+ * @brief Lock-free byte ring + line framer shared by the GPS, LoRa and USB stdin inputs
+ *
+ * The producer (normally a UART RX interrupt) only copies bytes into the ring.
+ * The consumer assembles them into lines outside interrupt context with
+ * framer_poll(). One producer and one consumer per framer; they may run on
+ * different cores.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef FRAMER_H
+#define FRAMER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hardware/uart.h"
+
+#define FRAMER_RING_SIZE    512     // must be a power of 2
+#define FRAMER_LINE_SIZE    300     // longest line any port produces (+RCV with a full LORA_SIZE payload), incl. '\0'
+
+typedef enum FRAMER_EVENT {
+    FRAMER_EMPTY,       // no complete line yet
+    FRAMER_LINE,        // a complete line is available
+    FRAMER_OVERFLOW     // a line was too long or bytes were dropped; the partial line is returned and discarded
+} FRAMER_EVENT;
+
+typedef struct line_framer
+{
+    // producer side
+    uint8_t ring[FRAMER_RING_SIZE];
+    uint32_t head;              // bytes ever pushed
+    uint32_t dropped;           // bytes lost because the ring was full
+    uint32_t gap;               // value of head at the most recent drop
+
+    // consumer side
+    uint32_t tail;              // bytes ever consumed
+    uint32_t dropped_seen;
+    char line[FRAMER_LINE_SIZE];
+    size_t len;
+    size_t max_len;
+    bool discarding;            // skipping the rest of an overflowed line
+} line_framer_t;
+
+/**
+ * @brief Producer side: queues one byte, never blocks
+ *
+ * @return false if the ring was full and the byte was dropped
+ */
+static inline bool framer_push(line_framer_t *f, uint8_t byte)
+{
+    uint32_t head = f->head;
+
+    if (head - __atomic_load_n(&f->tail, __ATOMIC_ACQUIRE) == FRAMER_RING_SIZE)
+    {
+        f->gap = head;
+        __atomic_store_n(&f->dropped, f->dropped + 1, __ATOMIC_RELEASE);
+        return false;
+    }
+
+    f->ring[head & (FRAMER_RING_SIZE - 1)] = byte;
+    __atomic_store_n(&f->head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+// function prototypes
+void framer_init(line_framer_t *f, size_t max_line);
+void framer_push_uart(line_framer_t *f, uart_inst_t *uart);
+FRAMER_EVENT framer_poll(line_framer_t *f, const char **line, size_t *len);
+
+#endif
@@ -0,0 +1,118 @@
+/**
+ * @file linkq.h
+ * @brief LoRa link quality from +RCV RSSI/SNR and ARQ resends, and the data rate chosen from it
+ *
+ * Every frame heard adds its RSSI and SNR to an EWMA; every data frame sent
+ * adds whether the ground station's acknowledgements showed it lost, i.e. it
+ * went again as a fast retransmission. Timeouts are left out: at a slow rate a
+ * window of long frames sets them off with nothing lost, and a link that loses
+ * everything is caught by the silence below. The SNR is kept as it would read
+ * at 125 kHz, so it compares across bandwidths. The rates form a ladder from the
+ * most robust, LORA_RATE_BASE, to the shortest airtime. A rate is judged once
+ * LINKQ_SAMPLES frames have been heard at it:
+ *
+ *   - down a step when the SNR is within LINKQ_DOWN_MARGIN_DB of its floor or
+ *     more than LINKQ_PER_DOWN of the frames are lost
+ *   - up a step when the SNR clears the next rate's floor by LINKQ_UP_MARGIN_DB,
+ *     fewer than LINKQ_PER_UP are lost, and LINKQ_HOLD_MS has passed
+ *     since the last change, LINKQ_DOWN_HOLD_MS since a step down
+ *
+ * The rover proposes a change as a "RAT" frame, "<from> <to>", on the ARQ. Each
+ * end changes its module only while it is at <from>: the ground station once
+ * its acknowledgement is on the air, the rover once that acknowledgement is
+ * in. If that acknowledgement is lost, the rover sends "RAT" again at <from>;
+ * so the ground station, hearing nothing at <to> for LINKQ_PROBATION_MS, goes
+ * back to <from> and changes over again after its next frame, which
+ * acknowledges it once more. An end at any rate but LORA_RATE_BASE that hears
+ * nothing valid for LINKQ_SILENCE_MS goes back to LORA_RATE_BASE, and stays
+ * there at least LINKQ_FALLBACK_HOLD_MS; the other end hears nothing either and
+ * does the same, so they meet at the base whatever was lost. The rover sends a link report
+ * when it has sent nothing for LINKQ_KEEPALIVE_MS, so a quiet link isn't
+ * silence. A new connection starts at LORA_RATE_BASE.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef LINKQ_H
+#define LINKQ_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pico/types.h"
+
+#define LORA_RATES              5
+#define LORA_RATE_BASE          0       // the most robust; both ends start and fall back here
+
+#define LINKQ_EWMA_SHIFT        3       // each sample counts 1/8
+#define LINKQ_SAMPLES           4       // frames heard at a rate before it is judged
+#define LINKQ_UP_MARGIN_DB      8
+#define LINKQ_DOWN_MARGIN_DB    3
+#define LINKQ_PER_UP            6554    // 10%, in 1/65536
+#define LINKQ_PER_DOWN          16384   // 25%
+#define LINKQ_HOLD_MS           10000
+#define LINKQ_DOWN_HOLD_MS      30000
+#define LINKQ_FALLBACK_HOLD_MS  60000
+#define LINKQ_PROBATION_MS      5000
+#define LINKQ_SILENCE_MS        15000
+#define LINKQ_KEEPALIVE_MS      5000
+
+// one setting of the module: AT+PARAMETER=<sf>,<bw>,<cr>,<preamble>
+typedef struct lora_rate
+{
+    uint8_t sf;                 // spreading factor, 7 to 12
+    uint8_t bw;                 // bandwidth code: 7 = 125 kHz, 8 = 250 kHz, 9 = 500 kHz
+    uint8_t cr;                 // coding rate 4/(4 + cr)
+    uint8_t preamble;
+    int16_t snr_floor;          // lowest SNR it demodulates, 0.1 dB as read at 125 kHz
+} lora_rate_t;
+
+typedef struct linkq
+{
+    // quality
+    int32_t rssi;               // EWMA, 1/16 dBm
+    int32_t snr;                // EWMA, 1/16 dB at 125 kHz
+    uint32_t per;               // EWMA of data frames lost, 1/65536
+    bool primed;                // rssi and snr hold a sample
+    uint32_t sent;              // the ARQ's counters when last seen
+    uint32_t lost;
+    absolute_time_t heard;      // last frame heard
+
+    // rate
+    uint8_t rate;               // the module's, index into lora_rates
+    uint32_t samples;           // frames heard at it
+    absolute_time_t changed;
+    absolute_time_t hold;       // no step up before this
+
+    // the rover's proposal on the ARQ
+    bool proposed;
+    int proposal_seq;
+    uint8_t proposal_from;
+    uint8_t proposal_to;
+
+    uint32_t ups;
+    uint32_t downs;
+    uint32_t fallbacks;
+    uint64_t rate_us[LORA_RATES];   // time spent at each rate, up to changed
+} linkq_t;
+
+extern const lora_rate_t lora_rates[LORA_RATES];
+
+// function prototypes
+void linkq_init(linkq_t *q, absolute_time_t now);
+void linkq_heard(linkq_t *q, int rssi, int snr, absolute_time_t now);
+void linkq_sent(linkq_t *q, uint32_t sent, uint32_t lost);
+int linkq_choose(const linkq_t *q, absolute_time_t now);
+void linkq_set(linkq_t *q, int rate, absolute_time_t now);
+bool linkq_silent(const linkq_t *q, absolute_time_t now);
+void linkq_fallback(linkq_t *q, absolute_time_t now);
+int linkq_format_rate(int rate, char *out, size_t size);
+int linkq_find_rate(int sf, int bw);
+uint32_t lora_airtime_us(const lora_rate_t *rate, size_t len);
+
+#endif
@@ -25,17 +25,20 @@
 #include "hardware/irq.h"
 #include "hardware/i2c.h"
 #include "hardware/pwm.h"
+#include "hardware/watchdog.h"
+#include "hardware/adc.h"
 
 // callbacks
 void on_UART_GPS_rx();
-void on_UART_LORA_rx();
+void on_UART_LORA_irq();
 void tachometer_callback(uint gpio, uint32_t events);
 // int configure_UART(uart_inst_t *UART_ID, uint BAUDRATE, uint TX_PIN, uint RX_PIN, uint DATA_BITS, uint STOP_BITS, uint PARITY, irq_handler_t IRQ_FUN, bool useIRQ);
 
 int configure_PWM();
 void setPWM();
 
-int handle_input(char *in);
+int handle_input(const char *in);
+void get_gps_stats(uint32_t *sentences, uint32_t *rejected, uint32_t *dropped);
 
 #endif
 
@@ -12,16 +12,75 @@
 #ifndef MOTORS_H
 #define MOTORS_H
 
+#include "pid.h"
+
 // We are using pins 0 and 1, but see the GPIO function select table in the
 // datasheet for information on which other pins can be used.
 #define PWM_1_PIN           16
 #define PWM_2_PIN           17
 #define DIR_1_PIN           18
 #define DIR_2_PIN           19
+#define PWM_WRAP            12500   // cycles per PWM period: a level of PWM_WRAP is full on
+#define PWM_SPEED_MAX       100     // $MTR levels are percent of full on
+
+// quadrature encoders, A leading B when driving forward
+#define ENC_RIGHT_A_PIN     20
+#define ENC_RIGHT_B_PIN     21
+#define ENC_LEFT_A_PIN      26
+#define ENC_LEFT_B_PIN      27
+
+#define ENC_COUNTS_PER_REV  1200    // wheel revolution, both edges of both channels
+#define WHEEL_MAX_RPM       300
+
+// closed-loop wheel speed control, run from a repeating timer on core 0
+#define MOTOR_CTL_HZ        500
+#define MOTOR_CTL_MIN_HZ    200
+#define MOTOR_CTL_MAX_HZ    1000
+
+// failsafe: with no fresh $MTR for MOTOR_CMD_TIMEOUT_MS the control loop ramps both wheels to 0 over
+// MOTOR_STOP_RAMP_MS, so they stop within timeout + ramp + 2 control periods of the last command
+#define MOTOR_CMD_TIMEOUT_MS        500
+#define MOTOR_CMD_TIMEOUT_MIN_MS    50
+#define MOTOR_CMD_TIMEOUT_MAX_MS    5000
+#define MOTOR_STOP_RAMP_MS          200
+#define MOTOR_WATCHDOG_MS           100     // fed by the control loop; if it stops, the chip resets with PWM off
+
+typedef enum MOTOR_MODE {
+    MOTOR_MODE_STOPPED,     // no command since boot, or the failsafe ramp has finished
+    MOTOR_MODE_PWM,         // $MTR <dir1> <pwm1> <dir2> <pwm2>: levels as given, open loop
+    MOTOR_MODE_VELOCITY,    // $MTR V <rpm1> <rpm2>: PID per wheel on the encoder velocity
+    MOTOR_MODE_FAILSAFE     // commands stopped coming: ramping down to 0
+} MOTOR_MODE;
+
+// control loop timing since the last get_motor_ctl_stats(); sent as is in binary mode
+typedef struct __attribute__((packed)) motor_ctl_stats
+{
+    uint16_t hz;
+    uint32_t runs;
+    uint32_t jitter_max_us;         // worst |start-to-start time - period|
+    uint32_t jitter_sum_us;
+    uint32_t exec_max_us;           // worst time inside the timer callback
+    uint32_t exec_sum_us;
+    uint32_t saturated;             // wheel updates that hit full PWM
+    uint32_t failsafes;             // stops forced by the command timeout
+} motor_ctl_stats_t;
+
+// PID gains for both wheels, on counts/s << ENC_VEL_SHIFT to PWM levels
+extern const pid_gains_t wheel_gains;
 
 // function prototypes
+void enc_callback(uint gpio, uint32_t events);
+void left_enc_callback(uint gpio, uint32_t events);
 void right_enc_callback(uint gpio, uint32_t events);
 int configure_PWM();
+int configure_encoders();
+void update_encoders();
+int configure_motor_control(uint hz);
+int configure_command_timeout(uint ms);
+void set_velocity(int left_rpm, int right_rpm);
+void get_motor_ctl_stats(motor_ctl_stats_t *stats);
+uint32_t get_failsafe_count(void);
+MOTOR_MODE get_motor_mode(void);
 float get_vel_left();
 float get_vel_right();
 void set_PWM(bool left_dir, int left_speed, bool right_dir, int right_speed);
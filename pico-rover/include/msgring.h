@@ -0,0 +1,171 @@
+/**
+ * @file msgring.h
+ * @brief Zero-copy message channel between the cores: a pool of LORA_SIZE buffers passed by index
+ *
+ * Each channel has one producer and one consumer, normally on different cores.
+ * The producer takes a free buffer with msg_alloc(), writes the message in
+ * place and hands it over with msg_send(). The consumer takes it with
+ * msg_receive() and gives it back with msg_release() when done. Only 2-byte
+ * buffer indices move between the cores, through two lock-free single-producer/
+ * single-consumer rings: "full" (producer -> consumer) and "free" (back).
+ * Every buffer is in exactly one place at a time, so neither ring can overflow.
+ * msg_send() and msg_release() also ring the doorbell (SEV), so a consumer waiting
+ * in WFE for a message, or a producer waiting for a free buffer, wakes.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef MSGRING_H
+#define MSGRING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hardware/sync.h"
+
+#ifndef MSG_POOL_SIZE
+#define MSG_POOL_SIZE       8       // buffers per channel; must be a power of 2
+#endif
+#define MSG_BUFFER_SIZE     240     // LORA_SIZE
+
+typedef struct msg_ring
+{
+    uint16_t slot[MSG_POOL_SIZE];   // buffer index, and for "full" the message length in the high bits
+    uint32_t head;                  // written by the producer only
+    uint32_t tail;                  // written by the consumer only
+} msg_ring_t;
+
+typedef struct msg_channel
+{
+    char buffer[MSG_POOL_SIZE][MSG_BUFFER_SIZE];
+    msg_ring_t full;
+    msg_ring_t free;
+
+    // producer side
+    uint32_t sent;
+    uint32_t dropped;               // msg_alloc() found no free buffer
+
+    // consumer side
+    uint32_t received;
+} msg_channel_t;
+
+#define MSG_INDEX_BITS      4       // enough for MSG_POOL_SIZE <= 16; the length gets the other 12
+
+static inline bool msg_ring_put(msg_ring_t *r, uint16_t value)
+{
+    uint32_t head = r->head;
+
+    if (head - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) == MSG_POOL_SIZE)
+        return false;
+
+    r->slot[head & (MSG_POOL_SIZE - 1)] = value;
+    __atomic_store_n(&r->head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+static inline bool msg_ring_peek(const msg_ring_t *r, uint16_t *value)
+{
+    uint32_t tail = r->tail;
+
+    if (__atomic_load_n(&r->head, __ATOMIC_ACQUIRE) == tail)
+        return false;
+
+    *value = r->slot[tail & (MSG_POOL_SIZE - 1)];
+    return true;
+}
+
+static inline void msg_ring_drop(msg_ring_t *r)
+{
+    __atomic_store_n(&r->tail, r->tail + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Producer side: takes a free buffer to write a message into, never blocks
+ *
+ * @return MSG_BUFFER_SIZE bytes owned by the caller until msg_send(); NULL if all are in use
+ */
+static inline char *msg_alloc(msg_channel_t *c)
+{
+    uint16_t index;
+
+    if (!msg_ring_peek(&c->free, &index))
+    {
+        c->dropped++;
+        return NULL;
+    }
+    msg_ring_drop(&c->free);
+
+    return c->buffer[index];
+}
+
+/**
+ * @brief Producer side: hands a buffer from msg_alloc() to the consumer
+ *
+ * @param buf the buffer
+ * @param len length of the message in it, at most MSG_BUFFER_SIZE
+ */
+static inline void msg_send(msg_channel_t *c, char *buf, size_t len)
+{
+    uint16_t index = (uint16_t)((buf - c->buffer[0]) / MSG_BUFFER_SIZE);
+
+    c->sent++;
+    // can't fail: the buffer came out of the free ring, so the full ring has its slot
+    msg_ring_put(&c->full, (uint16_t)(len << MSG_INDEX_BITS | index));
+    __sev();
+}
+
+/**
+ * @brief Consumer side: looks at the oldest message without taking it
+ *
+ * @param len where the message length is stored
+ * @return the message; NULL if there is none
+ */
+static inline const char *msg_peek(const msg_channel_t *c, size_t *len)
+{
+    uint16_t value;
+
+    if (!msg_ring_peek(&c->full, &value))
+        return NULL;
+
+    *len = value >> MSG_INDEX_BITS;
+    return c->buffer[value & ((1u << MSG_INDEX_BITS) - 1)];
+}
+
+/**
+ * @brief Consumer side: takes the oldest message; the caller owns it until msg_release()
+ *
+ * @param len where the message length is stored
+ * @return the message; NULL if there is none
+ */
+static inline char *msg_receive(msg_channel_t *c, size_t *len)
+{
+    char *buf = (char *)msg_peek(c, len);
+
+    if (buf)
+    {
+        msg_ring_drop(&c->full);
+        c->received++;
+    }
+    return buf;
+}
+
+/**
+ * @brief Consumer side: returns a buffer from msg_receive() to the producer
+ */
+static inline void msg_release(msg_channel_t *c, char *buf)
+{
+    msg_ring_put(&c->free, (uint16_t)((buf - c->buffer[0]) / MSG_BUFFER_SIZE));
+    __sev();
+}
+
+// function prototypes
+void msg_channel_init(msg_channel_t *c);
+bool msg_send_text(msg_channel_t *c, const char *text);
+unsigned msg_level(const msg_channel_t *c);
+
+#endif
@@ -0,0 +1,76 @@
+/**
+ * @file mtrbox.h
+ * @brief Latest-wins mailbox for motor commands, one slot per source
+ *
+ * A source overwrites its slot with every command; nothing queues, so a burst
+ * of teleop updates leaves only the newest. Each slot has one writer (USB on
+ * core 0, LoRa on core 1) and is published under a seqlock. The control path
+ * calls mtrbox_take() once per pass and applies at most one command: the
+ * newest from the highest-priority source. A command that waited longer than
+ * MTRBOX_STALE_MS is dropped, and a source is shut out while a
+ * higher-priority one has commanded within MTRBOX_HOLD_MS.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef MTRBOX_H
+#define MTRBOX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "commands.h"
+
+#define MTRBOX_STALE_MS     250     // received longer ago than this: not applied
+#define MTRBOX_HOLD_MS      1000    // how long a source keeps the wheels from lower-priority ones
+
+// in priority order, highest first: the ground station operator overrides the SBC
+typedef enum MTR_SOURCE {
+    MTR_SOURCE_LORA,
+    MTR_SOURCE_USB,
+    MTR_SOURCES
+} MTR_SOURCE;
+
+typedef struct mtrbox_slot
+{
+    uint32_t seq;                   // odd while the writer is updating the slot
+    uint32_t posts;                 // commands ever posted
+    uint32_t received_us;           // time_us_32() of the newest
+    mtr_cmd_t cmd;
+} mtrbox_slot_t;
+
+// per source; sent as is in binary mode
+typedef struct __attribute__((packed)) mtrbox_stats
+{
+    uint32_t posted;
+    uint32_t applied;
+    uint32_t coalesced;             // overwritten by a newer one before the control path looked
+    uint32_t stale;                 // dropped for age
+    uint32_t preempted;             // dropped for a higher-priority source
+} mtrbox_stats_t;
+
+typedef struct mtrbox
+{
+    mtrbox_slot_t slot[MTR_SOURCES];
+
+    // consumer side
+    uint32_t taken[MTR_SOURCES];    // slot posts already looked at
+    int owner;                      // source of the last applied command, -1 for none
+    uint32_t owner_us;
+    mtrbox_stats_t stats[MTR_SOURCES];
+} mtrbox_t;
+
+// USB and LoRa $MTR commands, applied by apply_motor_commands() on core 0
+extern mtrbox_t motor_mailbox;
+
+// function prototypes
+void mtrbox_init(mtrbox_t *box);
+void mtrbox_post(mtrbox_t *box, MTR_SOURCE source, const mtr_cmd_t *cmd);
+bool mtrbox_take(mtrbox_t *box, uint32_t now_us, mtr_cmd_t *cmd, MTR_SOURCE *source);
+void mtrbox_get_stats(const mtrbox_t *box, MTR_SOURCE source, mtrbox_stats_t *stats);
+
+#endif
@@ -0,0 +1,81 @@
+/**
+ * @file nmea.h
+ * @brief Incremental NMEA-0183 decoder (GGA/RMC/VTG) producing fixed-point GPS fixes
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef NMEA_H
+#define NMEA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define NMEA_FIELD_SIZE     16      // longest field we need to look at, incl. '\0'
+
+// send an unchanged fix to the SBC at least this often
+#define GPS_FIX_HEARTBEAT_MS    5000
+
+typedef enum NMEA_SENTENCE {
+    NMEA_NONE = 0,          // nothing complete yet, or the sentence was rejected
+    NMEA_GGA,
+    NMEA_RMC,
+    NMEA_VTG,
+    NMEA_OTHER              // valid checksum, but not a sentence we decode
+} NMEA_SENTENCE;
+
+typedef struct __attribute__((packed)) gps_fix
+{
+    int32_t lat;            // 1e-7 degrees, north positive
+    int32_t lon;            // 1e-7 degrees, east positive
+    uint32_t time_ms;       // UTC time of day
+    uint16_t hdop;          // 0.01
+    uint16_t speed;         // cm/s over ground
+    uint16_t course;        // 0.01 degrees true
+    uint8_t quality;        // GGA fix quality, 0 = no fix
+    uint8_t sats;           // satellites used
+} gps_fix_t;
+
+typedef struct nmea_decoder
+{
+    uint8_t state;
+    uint8_t checksum;       // running XOR of the sentence body
+    uint8_t expected;       // checksum transmitted after '*'
+    uint8_t digits;         // checksum digits received so far
+    uint8_t field;          // index of the field being received, 0 = address
+    uint8_t len;
+    bool error;
+    bool active;            // cleared by an RMC with status 'V'; its position/speed are ignored
+    NMEA_SENTENCE type;
+    char buf[NMEA_FIELD_SIZE];
+    int32_t coord;          // latitude/longitude waiting for its hemisphere field
+    gps_fix_t work;         // fix being updated by the current sentence
+    gps_fix_t fix;          // fix as of the last valid sentence
+
+    uint32_t sentences;     // valid sentences decoded
+    uint32_t rejected;      // bad checksum, malformed or truncated sentences
+} nmea_decoder_t;
+
+// latest-fix register: a seqlock so readers on either core always see a whole fix
+typedef struct gps_fix_register
+{
+    uint32_t seq;           // odd while an update is in progress
+    gps_fix_t fix;
+} gps_fix_register_t;
+
+extern gps_fix_register_t gps_latest_fix;
+
+// function prototypes
+void nmea_init(nmea_decoder_t *d);
+NMEA_SENTENCE nmea_feed(nmea_decoder_t *d, char ch);
+
+void gps_fix_store(gps_fix_register_t *reg, const gps_fix_t *fix);
+uint32_t gps_fix_load(gps_fix_register_t *reg, gps_fix_t *fix);
+bool gps_fix_differs(const gps_fix_t *a, const gps_fix_t *b);
+int gps_fix_format(const gps_fix_t *fix, char *out, size_t size);
+
+#endif
@@ -0,0 +1,58 @@
+/**
+ * @file pid.h
+ * @brief Fixed-point PID controller with feed-forward and anti-windup
+ *
+ * Integers only, so it can run in a timer interrupt on a core without an FPU.
+ * Gains are Q16.16 and unit-agnostic: output units per input unit. The period
+ * is fixed at pid_init(), which folds it into the integral and derivative
+ * gains. The derivative acts on the measurement, so a setpoint step doesn't
+ * kick the output. The integral only grows while that doesn't drive the
+ * output further past its limit (conditional integration).
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef PID_H
+#define PID_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define PID_SHIFT           16
+#define PID_GAIN(x)         ((int32_t)((x) * (1 << PID_SHIFT)))     // constant expressions only
+
+typedef struct pid_gains
+{
+    int32_t kp;                     // Q16, per unit of error
+    int32_t ki;                     // Q16, per unit of error per second
+    int32_t kd;                     // Q16, per unit of measurement change per second
+    int32_t kff;                    // Q16, per unit of setpoint
+    int32_t kstatic;                // output units, towards the setpoint's sign: overcomes friction
+} pid_gains_t;
+
+typedef struct pid_ctl
+{
+    int32_t kp;
+    int32_t ki_dt;                  // ki over one period
+    int32_t kd_dt;                  // kd over one period
+    int32_t kff;
+    int32_t kstatic;
+    int32_t out_max;                // |output| limit
+
+    int64_t integral;               // Q16 output units
+    int32_t prev_measured;
+    bool primed;                    // prev_measured is valid
+    int32_t output;
+    uint32_t saturated;             // steps that hit the output limit
+} pid_ctl_t;
+
+// function prototypes
+void pid_init(pid_ctl_t *pid, const pid_gains_t *gains, uint32_t period_us, int32_t out_max);
+void pid_reset(pid_ctl_t *pid);
+int32_t pid_step(pid_ctl_t *pid, int32_t setpoint, int32_t measured);
+
+#endif
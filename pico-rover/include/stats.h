@@ -0,0 +1,149 @@
+/**
+ * @file stats.h
+ * @brief Per-core loop counters and the runtime statistics snapshot served by "$REQ STATS"
+ *
+ * Every counter has exactly one writer, the core that owns it, and is a plain
+ * 32-bit word: the hot paths never take a lock or mask an interrupt to count,
+ * and core 0 reads them without stopping the other core. Counters only grow;
+ * stats_snapshot() keeps the previous readings and reports rates and means
+ * over the interval since then. The worst tick lateness is the one figure that
+ * starts over: a snapshot bumps stats_epoch, and each core restarts its maximum
+ * the next time it sees a new epoch.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+
+#include "txsched.h"
+
+#define STATS_CORES         2
+
+// written only by the core they belong to
+typedef struct core_stats
+{
+    uint32_t passes;                // event loop passes
+    uint32_t idle_us;               // asleep in stats_wait(), interrupts taken meanwhile included; wraps
+    uint32_t ticks;                 // runs of the core's periodic work
+    uint32_t late_us;               // how far behind schedule they started, summed
+    uint32_t late_max_us;           // worst of them in late_epoch
+    uint32_t late_epoch;
+} core_stats_t;
+
+// counters of the LoRa link; written by core 1 only
+typedef struct link_stats
+{
+    uint32_t parse_errors;          // frames parseMessage()/parseData() rejected
+    uint32_t retransmits;           // data frames sent again
+    uint32_t resets;                // connections given up on
+    uint8_t rate;                   // index into lora_rates, see linkq.h
+    int16_t rssi;                   // EWMA, dBm
+    int16_t snr;                    // EWMA, 0.1 dB as read at 125 kHz
+    uint8_t per_pct;                // EWMA of data frames lost
+    uint32_t rate_ups;
+    uint32_t rate_downs;
+    uint32_t fallbacks;             // back to the base rate after a silence
+} link_stats_t;
+
+typedef struct __attribute__((packed)) stats_core
+{
+    uint8_t idle_pct;
+    uint32_t passes_per_s;
+    uint32_t tick_period_us;        // mean time between ticks; 0 if there were none
+    uint32_t late_mean_us;
+    uint32_t late_max_us;
+} stats_core_t;
+
+// one outbound class of transmit_queue
+typedef struct __attribute__((packed)) stats_tx
+{
+    uint8_t depth;                  // waiting now
+    uint32_t sent;
+    uint32_t dropped;               // refused at its depth limit, or no buffer
+    uint32_t delay_mean_us;         // queued to taken into a frame, over the items taken in the interval
+    uint32_t delay_max_us;
+} stats_tx_t;
+
+// one snapshot; sent as is in binary mode
+typedef struct __attribute__((packed)) rover_stats
+{
+    uint32_t interval_ms;           // since the previous snapshot, over which rates and means are taken
+    uint8_t rx_depth;               // receive_queue, core 1 -> core 0: waiting now, sent, dropped for lack of a buffer
+    uint32_t rx_sent;
+    uint32_t rx_dropped;
+    uint8_t tx_depth;               // transmit_queue, core 0 -> core 1: all classes together
+    uint32_t tx_sent;
+    uint32_t tx_dropped;
+    uint32_t parse_errors;
+    uint32_t retransmits;
+    uint32_t resets;
+    uint8_t rate;                   // LoRa data rate and what it was chosen from, see link_stats_t
+    int16_t rssi;
+    int16_t snr;
+    uint8_t per_pct;
+    uint32_t rate_ups;
+    uint32_t rate_downs;
+    uint32_t fallbacks;
+    uint16_t gps_per_s;             // valid sentences per second
+    uint32_t gps_sentences;
+    uint32_t gps_rejected;
+    uint32_t overruns[3];           // bytes lost with an RX ring full: GPS, LoRa, USB
+    stats_core_t core[STATS_CORES];
+    stats_tx_t tx[TX_CLASSES];
+} rover_stats_t;
+
+extern core_stats_t core_stats[STATS_CORES];
+extern link_stats_t lora_link_stats;
+extern volatile uint32_t stats_epoch;
+
+/**
+ * @brief Sleeps until an event or a deadline, like best_effort_wfe_or_timeout(), counting the time as idle
+ *
+ * @param until the deadline
+ */
+static inline void stats_wait(absolute_time_t until)
+{
+    core_stats_t *s = &core_stats[get_core_num()];
+    uint32_t start = time_us_32();
+
+    best_effort_wfe_or_timeout(until);
+    s->idle_us += time_us_32() - start;
+}
+
+/**
+ * @brief Counts a run of the calling core's periodic work
+ *
+ * @param due when it was scheduled
+ */
+static inline void stats_tick(absolute_time_t due)
+{
+    core_stats_t *s = &core_stats[get_core_num()];
+    int64_t late = absolute_time_diff_us(due, get_absolute_time());
+    uint32_t late_us = late > 0 ? (uint32_t)late : 0;
+    uint32_t epoch = stats_epoch;
+
+    if (s->late_epoch != epoch)
+    {
+        s->late_max_us = 0;
+        s->late_epoch = epoch;
+    }
+    if (late_us > s->late_max_us)
+        s->late_max_us = late_us;
+    s->late_us += late_us;
+    s->ticks++;
+}
+
+// function prototypes
+void stats_snapshot(rover_stats_t *stats);
+
+#endif
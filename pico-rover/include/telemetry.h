@@ -0,0 +1,92 @@
+/**
+ * @file telemetry.h
+ * @brief Delta-encoded telemetry snapshots for the LoRa link
+ *
+ * A snapshot is a fixed set of integer fields. Each TLM frame carries only the
+ * fields that changed since a reference snapshot the ground station is known to
+ * have, i.e. one whose frame the ARQ has seen acknowledged:
+ *
+ *     <distance varint> <changed-field mask varint> <zig-zag delta varint>...
+ *
+ * distance is how many sequence numbers back the reference frame is; 0 means a
+ * keyframe, with deltas against all-zero fields. The snapshots themselves are
+ * put together from the telemetry registers, see tlmreg.h.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "comms.h"
+#include "nmea.h"
+#include "varint.h"
+
+#define TLM_HISTORY         16      // snapshots kept on each side; a reference older than this forces a keyframe
+#define TLM_KEYFRAME_EVERY  30      // frames between forced keyframes, so a broken chain recovers
+
+typedef enum TLM_FIELD {
+    TLM_LAT,                // 1e-7 degrees
+    TLM_LON,
+    TLM_TIME,               // UTC ms of day
+    TLM_HDOP,               // 0.01
+    TLM_SPEED,              // cm/s
+    TLM_COURSE,             // 0.01 degrees
+    TLM_QUALITY,
+    TLM_SATS,
+    TLM_VEL_LEFT,           // 0.1 RPM, negative in reverse
+    TLM_VEL_RIGHT,
+    TLM_BATTERY,            // mV
+    TLM_STATUS,             // TLM_STATUS_* flags
+    TLM_FIELDS
+} TLM_FIELD;
+
+#define TLM_MAX_SIZE        (2 * VARINT_MAX_SIZE + TLM_FIELDS * VARINT_MAX_SIZE)
+
+typedef struct telemetry
+{
+    int32_t field[TLM_FIELDS];
+} telemetry_t;
+
+typedef struct tlm_snapshot
+{
+    int seq;                // ARQ sequence number of the frame that carried it
+    bool used;
+    telemetry_t tlm;
+} tlm_snapshot_t;
+
+typedef struct tlm_encoder
+{
+    tlm_snapshot_t ref;                 // newest acknowledged snapshot
+    tlm_snapshot_t sent[TLM_HISTORY];   // by seq % TLM_HISTORY
+    uint32_t since_key;
+
+    uint32_t frames;
+    uint32_t keyframes;
+    uint32_t bytes;
+} tlm_encoder_t;
+
+typedef struct tlm_decoder
+{
+    tlm_snapshot_t history[TLM_HISTORY];
+
+    uint32_t frames;
+    uint32_t errors;        // malformed, or the reference was never received
+} tlm_decoder_t;
+
+// function prototypes
+void tlm_from_fix(const gps_fix_t *fix, telemetry_t *tlm);
+void tlm_encoder_init(tlm_encoder_t *e);
+size_t tlm_encode(tlm_encoder_t *e, const STATE *state, const telemetry_t *tlm, uint8_t *out);
+void tlm_decoder_init(tlm_decoder_t *d);
+int tlm_decode(tlm_decoder_t *d, int seq, const void *in, size_t len, telemetry_t *tlm);
+
+#endif
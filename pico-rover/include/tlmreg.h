@@ -0,0 +1,91 @@
+/**
+ * @file tlmreg.h
+ * @brief Latest-value telemetry registers, and the change-driven, rate-limited publisher that reads them
+ *
+ * Each register holds the newest value of one group of telemetry fields and
+ * is overwritten in place by its one writer. A version counter moves only when
+ * the value does. The GPS group is gps_latest_fix; the wheel velocities,
+ * battery voltage and status flags are written by core 0 on its tick. Readers on
+ * either core get a whole value under a seqlock, as for the GPS fix.
+ *
+ * Core 1 polls the registers every TLM_POLL_MS with tlm_collect(), but only
+ * once the frames queued before are on the air, so a slow link gets fewer and
+ * fresher snapshots rather than a backlog. A register whose version moved is
+ * taken into the snapshot, unless it was last taken less than its period ago;
+ * then it waits for a later poll. Only when something was taken does a TLM
+ * frame go out. tlm_encode() then puts in only the fields that differ from the
+ * last snapshot the ground station acknowledged, so a field is resent until a
+ * frame carrying it gets through, and never while it holds still.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef TLMREG_H
+#define TLMREG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pico/stdlib.h"
+
+#include "telemetry.h"
+
+#define TLM_POLL_MS             100     // registers checked for changes this often
+#define TLM_REG_SIZE            2       // values per register, for those besides GPS
+
+// shortest time between two new values of a register on the air
+#define TLM_GPS_PERIOD_MS       1000
+#define TLM_WHEELS_PERIOD_MS    500
+#define TLM_BATTERY_PERIOD_MS   10000
+#define TLM_STATUS_PERIOD_MS    0       // every change, at the next poll
+
+#define TLM_BATTERY_STEP_MV     50      // battery readings are rounded to this, so ADC noise doesn't count as a change
+
+// TLM_STATUS flags
+#define TLM_STATUS_DRIVING      (1u << 0)   // $MTR commands are being applied
+#define TLM_STATUS_VELOCITY     (1u << 1)   // in velocity mode
+#define TLM_STATUS_FAILSAFE     (1u << 2)   // the command timeout is ramping the wheels down
+#define TLM_STATUS_WDT_RESET    (1u << 3)   // this boot was a watchdog reset
+
+typedef enum TLM_REG {
+    TLM_REG_GPS,            // TLM_LAT to TLM_SATS, from gps_latest_fix
+    TLM_REG_WHEELS,         // TLM_VEL_LEFT, TLM_VEL_RIGHT
+    TLM_REG_BATTERY,        // TLM_BATTERY
+    TLM_REG_STATUS,         // TLM_STATUS
+    TLM_REGS
+} TLM_REG;
+
+typedef struct tlm_reg
+{
+    uint32_t seq;           // odd while an update is in progress; the version is seq / 2
+    int32_t value[TLM_REG_SIZE];
+} tlm_reg_t;
+
+// core 1's side
+typedef struct tlm_publisher
+{
+    telemetry_t tlm;                    // every register as last taken
+    uint32_t version[TLM_REGS];         // their versions then
+    absolute_time_t taken[TLM_REGS];
+
+    uint32_t changes[TLM_REGS];         // new values taken
+    uint32_t deferred[TLM_REGS];        // polls that found a new value held back by the register's period
+    uint32_t snapshots;                 // polls that produced a TLM frame
+} tlm_publisher_t;
+
+// written by core 0 only
+extern tlm_reg_t tlm_wheels;
+extern tlm_reg_t tlm_battery;
+extern tlm_reg_t tlm_status;
+
+// function prototypes
+void tlm_reg_store(tlm_reg_t *reg, const int32_t *value);
+uint32_t tlm_reg_load(tlm_reg_t *reg, int32_t *value);
+void tlm_publisher_init(tlm_publisher_t *p);
+bool tlm_collect(tlm_publisher_t *p, absolute_time_t now, telemetry_t *tlm);
+
+#endif
@@ -0,0 +1,104 @@
+/**
+ * @file trace.h
+ * @brief Per-core ring of timestamped events along the command path, for latency breakdowns
+ *
+ * Each core writes only its own ring, from thread context only, so a trace
+ * point is a handful of stores and a release: no lock, no interrupt masking.
+ * Trace points must not be placed in interrupt handlers, which would make a
+ * second writer on the same ring. Core 0 drains both rings with trace_read()
+ * for "$REQ TRACE"; records the writer overwrote before they were read are
+ * counted as lost. Timestamps are time_us_64(), one timebase for both cores,
+ * so events from either side can be merged into one timeline. Build with
+ * ROVER_TRACE=0 (cmake -DROVER_TRACE=OFF) and every TRACE() compiles to nothing.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+
+#ifndef ROVER_TRACE
+#define ROVER_TRACE         1
+#endif
+
+#define TRACE_RING_SIZE     256     // records per core, must be a power of 2
+#define TRACE_CORES         2
+
+// where a command is on its way from a link to the wheels; arg in brackets
+typedef enum TRACE_EVENT {
+    TRACE_LORA_RCV,         // core 1: +RCV line taken from the LoRa framer [line length]
+    TRACE_LORA_FRAME,       // core 1: frame header and payload parsed [ground station seq]
+    TRACE_CMD_QUEUE,        // core 1: $CMD written into receive_queue [length]
+    TRACE_CMD_DISPATCH,     // core 0: $CMD taken from receive_queue and dispatched [length]
+    TRACE_USB_LINE,         // core 0: line or binary frame complete on USB stdin [length]
+    TRACE_MTR_POST,         // either: motor command posted to the mailbox [MTR_SOURCE]
+    TRACE_MTR_TAKE,         // core 0: motor command taken from the mailbox [MTR_SOURCE]
+    TRACE_MTR_APPLY,        // core 0: set_PWM()/set_velocity() returned [MTR_SOURCE]
+    TRACE_EVENTS
+} TRACE_EVENT;
+
+// one event; sent as is in binary mode
+typedef struct trace_record
+{
+    uint64_t t_us;
+    uint32_t arg;
+    uint8_t event;
+    uint8_t core;
+    uint16_t reserved;
+} trace_record_t;
+
+_Static_assert(sizeof(trace_record_t) == 16, "trace records are sent raw");
+
+typedef struct trace_ring
+{
+    uint32_t head;                  // records ever written; the core's own trace points only
+    uint32_t tail;                  // records ever read or lost; trace_read() only
+    uint32_t lost;                  // overwritten before they were read
+    trace_record_t record[TRACE_RING_SIZE];
+} trace_ring_t;
+
+extern trace_ring_t trace_rings[TRACE_CORES];
+extern const char *const trace_event_names[TRACE_EVENTS];
+
+/**
+ * @brief Records an event in the calling core's ring; never waits
+ *
+ * @param event what happened
+ * @param arg detail, see TRACE_EVENT
+ */
+static inline void trace_event(TRACE_EVENT event, uint32_t arg)
+{
+    uint core = get_core_num();
+    trace_ring_t *ring = &trace_rings[core];
+    uint32_t head = ring->head;
+    trace_record_t *record = &ring->record[head & (TRACE_RING_SIZE - 1)];
+
+    record->t_us = time_us_64();
+    record->arg = arg;
+    record->event = (uint8_t)event;
+    record->core = (uint8_t)core;
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+#if ROVER_TRACE
+#define TRACE(event, arg)   trace_event((event), (uint32_t)(arg))
+#else
+#define TRACE(event, arg)   ((void)0)
+#endif
+
+// function prototypes
+void trace_init(void);
+size_t trace_read(uint core, trace_record_t *out, size_t max);
+TRACE_EVENT trace_event_from_name(const char *name);
+
+#endif
@@ -0,0 +1,58 @@
+/**
+ * @file txring.h
+ * @brief UART transmit ring drained by the TX interrupt
+ *
+ * tx_ring_write() copies a whole message into the ring or refuses it, and
+ * returns at once either way; the caller never waits for the line. The UART
+ * interrupt handler calls tx_ring_drain() to refill the hardware FIFO as it
+ * empties and turns the TX interrupt off once the ring is empty. One producer,
+ * on the core that takes the UART's interrupt.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef TXRING_H
+#define TXRING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pico/types.h"
+#include "hardware/uart.h"
+
+#define TX_RING_SIZE        512     // two full AT+SEND commands; must be a power of 2
+
+typedef struct tx_ring
+{
+    uart_inst_t *uart;
+    uint8_t ring[TX_RING_SIZE];
+    uint32_t head;                  // bytes ever queued; written by the producer only
+    uint32_t tail;                  // bytes ever handed to the UART; written by tx_ring_drain() only
+
+    // statistics, producer side
+    uint32_t high_water;            // most bytes waiting at once
+    uint32_t rejected;              // writes refused for lack of room
+    uint64_t stall_us;              // time from a refused write to the next accepted one
+    bool stalled;
+    absolute_time_t stalled_since;
+} tx_ring_t;
+
+/**
+ * @brief Bytes queued and not yet in the UART's FIFO
+ */
+static inline uint32_t tx_ring_level(const tx_ring_t *r)
+{
+    return r->head - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+}
+
+// function prototypes
+void tx_ring_init(tx_ring_t *r, uart_inst_t *uart);
+bool tx_ring_write(tx_ring_t *r, const void *data, size_t len);
+void tx_ring_drain(tx_ring_t *r);
+
+#endif
@@ -0,0 +1,75 @@
+/**
+ * @file txsched.h
+ * @brief Outbound scheduler for the LoRa link: one zero-copy channel per priority class
+ *
+ * Core 0 writes each outbound item into a buffer of its class's msgring
+ * channel and stamps it with time_us_32(); core 1 builds frames from them.
+ * tx_peek() and tx_receive() always return the oldest item of the highest
+ * class that has one, so a fault report goes out in the next frame however
+ * many of the SBC's messages are waiting. Core 0 may queue a higher item at
+ * any time, so an item seen with tx_peek() is taken with tx_take() from its
+ * own class. Each class has a depth limit. Items are never dropped once
+ * queued: past the limit tx_alloc() refuses new ones, and the producer learns
+ * it right away. Periodic telemetry doesn't come through here at all: core 1
+ * reads it from the latest-value registers of tlmreg.h.
+ *
+ * Core 1 keeps each class's queueing delay, from tx_send() to being taken
+ * into a frame, like the loop counters of stats.h: summed, with a maximum
+ * that starts over with each statistics snapshot.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef TXSCHED_H
+#define TXSCHED_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "msgring.h"
+
+// in priority order, highest first
+typedef enum TX_CLASS {
+    TX_CONTROL,             // fault reports: every one goes, ahead of everything else
+    TX_STATUS,              // the SBC's $TX messages for the ground station
+    TX_CLASSES
+} TX_CLASS;
+
+#define TX_CONTROL_DEPTH    MSG_POOL_SIZE
+#define TX_STATUS_DEPTH     MSG_POOL_SIZE
+
+// written by core 1 only
+typedef struct tx_class_stats
+{
+    uint32_t taken;                 // items taken into frames
+    uint32_t delay_us;              // tx_send() to taken, summed; wraps
+    uint32_t delay_max_us;          // worst of them in delay_epoch
+    uint32_t delay_epoch;
+} tx_class_stats_t;
+
+typedef struct tx_sched
+{
+    msg_channel_t channel[TX_CLASSES];
+    uint32_t stamp[TX_CLASSES][MSG_POOL_SIZE];  // time_us_32() at tx_send(), by buffer index
+    tx_class_stats_t stats[TX_CLASSES];
+} tx_sched_t;
+
+extern const char *const tx_class_names[TX_CLASSES];
+
+// function prototypes
+void tx_sched_init(tx_sched_t *s);
+char *tx_alloc(tx_sched_t *s, TX_CLASS cls);
+void tx_send(tx_sched_t *s, TX_CLASS cls, char *buf, size_t len);
+bool tx_send_text(tx_sched_t *s, TX_CLASS cls, const char *text);
+const char *tx_peek(const tx_sched_t *s, TX_CLASS *cls, size_t *len);
+char *tx_take(tx_sched_t *s, TX_CLASS cls, size_t *len);
+char *tx_receive(tx_sched_t *s, TX_CLASS *cls, size_t *len);
+void tx_release(tx_sched_t *s, TX_CLASS cls, char *buf);
+unsigned tx_level(const tx_sched_t *s);
+
+#endif
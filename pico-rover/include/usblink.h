@@ -0,0 +1,40 @@
+/**
+ * @file usblink.h
+ * @brief SBC <-> Pico USB link: ASCII lines by default, binary COBS frames once negotiated
+ *
+ * The SBC switches to binary with the ASCII line "$REQ BIN"; the Pico answers
+ * "$ACK BIN <version>" and every byte after that line is framed. The line may end
+ * in CR, LF or CR LF: the LF of a CR LF is not taken as frame data. A binary REQ
+ * frame with the text "ASCII" switches back.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef USBLINK_H
+#define USBLINK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "binproto.h"
+
+typedef enum USB_MODE {
+    USB_MODE_ASCII,
+    USB_MODE_BINARY
+} USB_MODE;
+
+extern USB_MODE usb_mode;
+
+// function prototypes
+void usb_link_init();
+void usb_link_poll();
+void usb_set_mode(USB_MODE mode);
+void usb_send(BIN_MSG_ID id, const void *payload, size_t len);
+void usb_error(const char *fmt, ...);
+uint32_t usb_link_dropped();
+
+#endif
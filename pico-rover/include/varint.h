@@ -0,0 +1,76 @@
+/**
+ * @file varint.h
+ * @brief LEB128 varints and zig-zag mapping for the compact LoRa encodings
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#ifndef VARINT_H
+#define VARINT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define VARINT_MAX_SIZE     5       // a uint32_t in 7-bit groups
+
+// small magnitudes of either sign become small unsigned values: 0, -1, 1, -2, ... -> 0, 1, 2, 3, ...
+static inline uint32_t zigzag_encode(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t zigzag_decode(uint32_t v)
+{
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+/**
+ * @brief Writes v in 7-bit groups, least significant first, high bit set on all but the last
+ *
+ * @param v value
+ * @param out at least VARINT_MAX_SIZE bytes
+ * @return number of bytes written
+ */
+static inline size_t varint_put(uint32_t v, uint8_t *out)
+{
+    size_t n = 0;
+
+    while (v >= 0x80)
+    {
+        out[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+
+    return n;
+}
+
+/**
+ * @brief Reads a varint written by varint_put()
+ *
+ * @param in encoded bytes
+ * @param len bytes available
+ * @param v destination
+ * @return number of bytes read, 0 if truncated or too long
+ */
+static inline size_t varint_get(const uint8_t *in, size_t len, uint32_t *v)
+{
+    uint32_t value = 0;
+
+    for (size_t n = 0; n < len && n < VARINT_MAX_SIZE; n++)
+    {
+        value |= (uint32_t)(in[n] & 0x7F) << (7 * n);
+        if (!(in[n] & 0x80))
+        {
+            *v = value;
+            return n + 1;
+        }
+    }
+
+    return 0;
+}
+
+#endif
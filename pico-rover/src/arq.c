@@ -0,0 +1,515 @@
+/**
+ * @file arq.c
+ * @brief Selective-repeat ARQ for the LoRa link: a window of frames in flight, SACK, per-frame retransmission
+ *
+ * Data frames carry their own sequence number and are acknowledged by the peer's
+ * cumulative ack plus a bitmap (sack) of frames received beyond it, so one lost
+ * frame only costs its own retransmission. Bare ACK, SYN and FIN frames don't
+ * consume sequence numbers.
+ *
+ * The retransmission timeout follows Jacobson/Karels (RFC 6298): SRTT and RTTVAR
+ * from frames acknowledged on their first transmission only (Karn), doubled on
+ * each expiry and clamped to ARQ_RTO_MIN_MS..ARQ_RTO_MAX_MS. Any new
+ * acknowledgement, even of a retransmission, cancels the backoff: the link is
+ * alive, and waiting for an unambiguous sample at 30% loss kept the timer at
+ * its ceiling.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include "../include/comms.h"
+
+// general includes
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// hardware includes
+#include "pico/stdlib.h"
+
+_Static_assert((ARQ_MAX_WINDOW & (ARQ_MAX_WINDOW - 1)) == 0, "ARQ_MAX_WINDOW must be a power of two");
+_Static_assert(ARQ_MAX_WINDOW <= 32, "sack is a 32-bit map");
+
+#define SLOT(seq)   ((unsigned)(seq) & (ARQ_MAX_WINDOW - 1))
+
+/**
+ * @brief Empties both windows; called when the connection is established, after seq/ack are agreed
+ *
+ * @param state the STATE for this communication instance
+ * @param window frames allowed in flight, clamped to 1..ARQ_MAX_WINDOW
+ */
+void arq_start(STATE *state, int window)
+{
+    if (window < 1)
+        window = 1;
+    if (window > ARQ_MAX_WINDOW)
+        window = ARQ_MAX_WINDOW;
+
+    state->base = state->seq;
+    state->window = window;
+    state->max_tries = ARQ_MAX_TRIES;
+    state->ack_pending = false;
+    state->rx_items = 0;
+    memset(state->tx, 0, sizeof(state->tx));
+    memset(state->rx, 0, sizeof(state->rx));
+}
+
+static uint32_t clamp_rto(uint64_t rto_us)
+{
+    if (rto_us < ARQ_RTO_MIN_MS * 1000)
+        return ARQ_RTO_MIN_MS * 1000;
+    if (rto_us > ARQ_RTO_MAX_MS * 1000)
+        return ARQ_RTO_MAX_MS * 1000;
+    return (uint32_t)rto_us;
+}
+
+/**
+ * @brief Forgets the RTT estimate; for a new link or after the old one died
+ *
+ * @param state the STATE for this communication instance
+ */
+void arq_rtt_reset(STATE *state)
+{
+    state->srtt_us = 0;
+    state->rttvar_us = 0;
+    state->rto_us = ARQ_RTO_INIT_MS * 1000;
+    state->backoff = 0;
+    state->rtt_samples = 0;
+    state->backoff_at = nil_time;
+}
+
+/**
+ * @brief Folds one round-trip measurement into SRTT/RTTVAR and recomputes the RTO
+ *
+ * @param state the STATE for this communication instance
+ * @param rtt_us time from a frame's only transmission to its acknowledgement
+ */
+void arq_rtt_sample(STATE *state, uint32_t rtt_us)
+{
+    uint32_t var;
+
+    if (!state->rtt_samples)
+    {
+        state->srtt_us = rtt_us;
+        state->rttvar_us = rtt_us / 2;
+    }
+    else
+    {
+        uint32_t err = state->srtt_us > rtt_us ? state->srtt_us - rtt_us : rtt_us - state->srtt_us;
+        // beta = 1/4, alpha = 1/8
+        state->rttvar_us = state->rttvar_us - state->rttvar_us / 4 + err / 4;
+        state->srtt_us = state->srtt_us - state->srtt_us / 8 + rtt_us / 8;
+    }
+    state->rtt_samples++;
+
+    var = 4 * state->rttvar_us;
+    if (var < ARQ_RTO_GRANULARITY_MS * 1000)
+        var = ARQ_RTO_GRANULARITY_MS * 1000;
+    state->rto_us = clamp_rto((uint64_t)state->srtt_us + var);
+}
+
+/**
+ * @brief Doubles the RTO after a timeout, until the next acknowledgement
+ *
+ * @param state the STATE for this communication instance
+ */
+void arq_backoff(STATE *state)
+{
+    if (state->backoff < ARQ_MAX_BACKOFF)
+        state->backoff++;
+}
+
+/**
+ * @brief The retransmission timeout to arm now, backoff included
+ *
+ * @param state the STATE for this communication instance
+ * @return timeout in us
+ */
+uint32_t arq_rto(const STATE *state)
+{
+    return clamp_rto((uint64_t)state->rto_us << state->backoff);
+}
+
+/**
+ * @brief Formats the link statistics for telemetry:
+ *        "$LNK <srtt> <rttvar> <rto> <samples> <retransmits> <timeouts> <agg frames> <agg items> <agg bytes saved>"
+ *
+ * @param state the STATE for this communication instance
+ * @param out destination
+ * @param size size of out
+ * @return int length of the line; times are in ms
+ */
+int arq_format_link(const STATE *state, char *out, size_t size)
+{
+    return snprintf(out, size, "$LNK %lu %lu %lu %lu %lu %lu %lu %lu %ld",
+                    (unsigned long)(state->srtt_us / 1000), (unsigned long)(state->rttvar_us / 1000),
+                    (unsigned long)(arq_rto(state) / 1000), (unsigned long)state->rtt_samples,
+                    (unsigned long)state->stats.retransmits, (unsigned long)state->stats.timeouts,
+                    (unsigned long)state->stats.agg_frames, (unsigned long)state->stats.agg_items,
+                    (long)state->stats.agg_saved);
+}
+
+/**
+ * @brief Checks whether another frame may be queued
+ *
+ * @param state the STATE for this communication instance
+ * @return true if the window is full
+ */
+bool arq_window_full(const STATE *state)
+{
+    return state->seq - state->base >= state->window;
+}
+
+/**
+ * @brief Counts frames queued but not sent yet
+ *
+ * @param state the STATE for this communication instance
+ * @return number of frames
+ */
+int arq_unsent(const STATE *state)
+{
+    int unsent = 0;
+
+    for (int seq = state->base; seq != state->seq; seq++)
+    {
+        if (state->tx[SLOT(seq)].tries == 0)
+            unsent++;
+    }
+
+    return unsent;
+}
+
+/**
+ * @brief Assigns the next sequence number to a data frame; it goes out on a later arq_poll()
+ *
+ * @param state the STATE for this communication instance
+ * @param flag frame flag, e.g. "ACK" for telemetry or "$CMD"
+ * @param data payload; truncated to what stuffs into ARQ_DATA_SIZE - 1 characters
+ * @param len number of bytes in data
+ * @return status (EXIT_SUCCESS/EXIT_FAILURE if the window is full)
+ */
+int arq_queue_bytes(STATE *state, const char *flag, const void *data, size_t len)
+{
+    ARQ_SLOT *slot;
+    size_t stuffed;
+
+    if (arq_window_full(state))
+        return EXIT_FAILURE;
+
+    // escaped bytes take two on the air
+    stuffed = loraStuffedSize(data, len);
+    while (stuffed >= ARQ_DATA_SIZE)
+        stuffed -= loraStuffedSize((const uint8_t *)data + --len, 1);
+
+    slot = &state->tx[SLOT(state->seq)];
+    slot->tries = 0;
+    slot->acked = false;
+    slot->fast = false;
+    slot->len = (uint8_t)len;
+    snprintf(slot->flag, sizeof(slot->flag), "%s", flag);
+    memcpy(slot->data, data, len);
+    slot->data[len] = '\0';
+    state->seq++;
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Queues a text payload, see arq_queue_bytes()
+ *
+ * @param state the STATE for this communication instance
+ * @param flag frame flag, e.g. "ACK" for telemetry or "$CMD"
+ * @param data NUL-terminated payload
+ * @return status (EXIT_SUCCESS/EXIT_FAILURE if the window is full)
+ */
+int arq_queue(STATE *state, const char *flag, const char *data)
+{
+    return arq_queue_bytes(state, flag, data, strlen(data));
+}
+
+/**
+ * @brief Whether the peer has acknowledged a data frame, cumulatively or selectively
+ *
+ * @param state the STATE for this communication instance
+ * @param seq sequence number of the frame
+ * @return true once acknowledged; false while in flight or never queued
+ */
+bool arq_acked(const STATE *state, int seq)
+{
+    if (seq - state->base < 0)
+        return true;
+    if (seq - state->seq >= 0)
+        return false;
+    return state->tx[SLOT(seq)].acked;
+}
+
+// sender side: mark everything the peer has acknowledged, then slide the window
+static void arq_acknowledge(STATE *state, int ack, uint32_t sack, absolute_time_t now)
+{
+    absolute_time_t latest = nil_time;
+    absolute_time_t earliest = nil_time;
+    bool newly_acked = false;
+
+    // an ack for something never sent is bogus
+    if (ack - state->seq > 0)
+        return;
+
+    for (int seq = state->base; seq != state->seq; seq++)
+    {
+        ARQ_SLOT *slot = &state->tx[SLOT(seq)];
+        int ahead = seq - ack;
+
+        if (slot->acked || slot->tries == 0)
+            continue;
+        if (ahead < 0 || (ahead > 0 && ahead <= 32 && (sack & (1u << (ahead - 1)))))
+        {
+            slot->acked = true;
+            newly_acked = true;
+            // only a frame sent once says for sure which transmission got through
+            if (slot->tries == 1)
+            {
+                if (absolute_time_diff_us(latest, slot->sent) > 0)
+                    latest = slot->sent;
+                if (earliest == nil_time || absolute_time_diff_us(slot->sent, earliest) > 0)
+                    earliest = slot->sent;
+            }
+        }
+    }
+
+    if (newly_acked)
+        state->backoff = 0;
+
+    if (newly_acked && latest != nil_time)
+    {
+        // the oldest frame covered by this ack includes the time the ack waited for the channel
+        arq_rtt_sample(state, (uint32_t)absolute_time_diff_us(earliest, now));
+
+        // the link doesn't reorder: anything sent before a frame that got through was lost,
+        // so retransmit it now instead of waiting out the timer
+        for (int seq = state->base; seq != state->seq; seq++)
+        {
+            ARQ_SLOT *slot = &state->tx[SLOT(seq)];
+            if (!slot->acked && slot->tries && absolute_time_diff_us(slot->sent, latest) > 0)
+            {
+                slot->deadline = now;
+                slot->fast = true;
+            }
+        }
+    }
+
+    while (state->base != state->seq && state->tx[SLOT(state->base)].acked)
+        state->base++;
+}
+
+// receiver side: hold the frame until everything before it has arrived
+static void arq_accept(STATE *state, const FRAME *frame, absolute_time_t now)
+{
+    int ahead = frame->seq - state->ack;
+    ARQ_SLOT *slot;
+
+    // old or too far ahead: the peer missed our ack, repeat it right away
+    if (ahead < 0 || ahead >= ARQ_MAX_WINDOW)
+    {
+        state->stats.duplicates++;
+        state->ack_pending = true;
+        state->ack_deadline = now;
+        return;
+    }
+
+    slot = &state->rx[SLOT(frame->seq)];
+    if (slot->held)
+    {
+        state->stats.duplicates++;
+    }
+    else
+    {
+        slot->held = true;
+        snprintf(slot->flag, sizeof(slot->flag), "%s", frame->flag);
+        slot->len = frame->len < sizeof(slot->data) ? (uint8_t)frame->len : sizeof(slot->data) - 1;
+        memcpy(slot->data, frame->data, slot->len);
+        slot->data[slot->len] = '\0';
+    }
+
+    // a gap: tell the sender now so it can fill it; in order: give data a moment to carry the ack
+    if (ahead)
+    {
+        state->stats.out_of_order++;
+        state->ack_deadline = now;
+    }
+    else if (!state->ack_pending)
+    {
+        state->ack_deadline = delayed_by_ms(now, ARQ_ACK_DELAY_MS);
+    }
+    state->ack_pending = true;
+}
+
+/**
+ * @brief Processes the ack/sack of a received frame and holds its data, if any, for arq_peek()
+ *
+ * @param state the STATE for this communication instance
+ * @param frame the parsed frame
+ * @param now current time
+ */
+void arq_receive(STATE *state, const FRAME *frame, absolute_time_t now)
+{
+    arq_acknowledge(state, frame->ack, frame->sack, now);
+
+    if (frame->data)
+        arq_accept(state, frame, now);
+}
+
+/**
+ * @brief Returns the next in-order received frame without consuming it
+ *
+ * @param state the STATE for this communication instance
+ * @return the frame, NULL if the next one hasn't arrived
+ */
+const ARQ_SLOT *arq_peek(const STATE *state)
+{
+    const ARQ_SLOT *slot = &state->rx[SLOT(state->ack)];
+
+    return slot->held ? slot : NULL;
+}
+
+/**
+ * @brief Consumes the frame returned by arq_peek(); acknowledges it to the peer
+ *
+ * @param state the STATE for this communication instance
+ */
+void arq_pop(STATE *state)
+{
+    state->rx[SLOT(state->ack)].held = false;
+    state->ack++;
+    state->stats.delivered++;
+}
+
+/**
+ * @brief Bitmap of frames held beyond the cumulative ack
+ *
+ * @param state the STATE for this communication instance
+ * @return bit i set if ack + 1 + i was received
+ */
+uint32_t arq_sack(const STATE *state)
+{
+    uint32_t sack = 0;
+
+    for (int i = 0; i < ARQ_MAX_WINDOW - 1; i++)
+    {
+        if (state->rx[SLOT(state->ack + 1 + i)].held)
+            sack |= 1u << i;
+    }
+
+    return sack;
+}
+
+/**
+ * @brief Picks the next frame to put on the air: a due retransmission, then new data, then a bare ACK
+ *
+ * @param state the STATE for this communication instance
+ * @param now current time
+ * @param out destination of the formatted payload for AT+SEND
+ * @param size size of out, at least LORA_SIZE
+ * @return ARQ_EVENT
+ */
+ARQ_EVENT arq_poll(STATE *state, absolute_time_t now, char *out, size_t size)
+{
+    ARQ_SLOT *next = NULL;
+    int next_seq = 0;
+
+    for (int seq = state->base; seq != state->seq; seq++)
+    {
+        ARQ_SLOT *slot = &state->tx[SLOT(seq)];
+
+        if (slot->acked)
+            continue;
+
+        if (slot->tries == 0)
+        {
+            // new data only goes out if nothing needs retransmitting
+            if (!next)
+            {
+                next = slot;
+                next_seq = seq;
+            }
+            continue;
+        }
+
+        if (absolute_time_diff_us(slot->deadline, now) >= 0)
+        {
+            if (slot->tries >= state->max_tries)
+            {
+                state->stats.failures++;
+                return ARQ_FAILED;
+            }
+            state->stats.retransmits++;
+            if (!slot->fast)
+            {
+                // one backoff per RTO generation, not one per frame of a lost burst
+                state->stats.timeouts++;
+                if (absolute_time_diff_us(state->backoff_at, slot->sent) >= 0)
+                {
+                    arq_backoff(state);
+                    state->backoff_at = now;
+                }
+            }
+            slot->fast = false;
+            next = slot;
+            next_seq = seq;
+            break;
+        }
+    }
+
+    if (next)
+    {
+        next->tries++;
+        next->sent = now;
+        next->deadline = delayed_by_us(now, arq_rto(state));
+        state->stats.sent++;
+        state->ack_pending = false;
+        formatFrame(out, size, next_seq, state->ack, arq_sack(state), next->flag, next->data, next->len);
+        return ARQ_SEND;
+    }
+
+    if (state->ack_pending && absolute_time_diff_us(state->ack_deadline, now) >= 0)
+    {
+        state->stats.acks++;
+        state->ack_pending = false;
+        formatFrame(out, size, state->seq, state->ack, arq_sack(state), "ACK", NULL, 0);
+        return ARQ_SEND;
+    }
+
+    return ARQ_IDLE;
+}
+
+/**
+ * @brief When arq_poll() next has something to do if no frame arrives meanwhile
+ *
+ * @param state the STATE for this communication instance
+ * @return the earliest retransmission or delayed ACK; nil_time if new data is
+ *         waiting to go out; at_the_end_of_time if there is nothing
+ */
+absolute_time_t arq_next_deadline(const STATE *state)
+{
+    absolute_time_t next = at_the_end_of_time;
+
+    for (int seq = state->base; seq != state->seq; seq++)
+    {
+        const ARQ_SLOT *slot = &state->tx[SLOT(seq)];
+
+        if (slot->acked)
+            continue;
+        if (slot->tries == 0)
+            return nil_time;
+        if (absolute_time_diff_us(slot->deadline, next) > 0)
+            next = slot->deadline;
+    }
+
+    if (state->ack_pending && absolute_time_diff_us(state->ack_deadline, next) > 0)
+        next = state->ack_deadline;
+
+    return next;
+}
@@ -0,0 +1,228 @@
+/**
+ * @file atmodem.c
+ * @brief Non-blocking AT-command engine for the RYLR896 LoRa module
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include "../include/atmodem.h"
+
+// general includes
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// hardware includes
+#include "pico/stdlib.h"
+
+_Static_assert((AT_QUEUE_DEPTH & (AT_QUEUE_DEPTH - 1)) == 0, "AT_QUEUE_DEPTH must be a power of 2");
+
+/**
+ * @brief Resets an engine
+ *
+ * @param at the engine
+ * @param tx the TX ring of the UART the module is on
+ * @param framer filled from the UART's RX interrupt
+ * @param listener gets the lines that don't answer a command; may be NULL
+ * @param ctx passed to the listener
+ */
+void at_init(at_engine_t *at, tx_ring_t *tx, line_framer_t *framer, at_listener_t listener, void *ctx)
+{
+    memset(at, 0, sizeof(*at));
+    at->tx = tx;
+    at->framer = framer;
+    at->listener = listener;
+    at->ctx = ctx;
+}
+
+/**
+ * @brief Tells what a line from the module is
+ *
+ * @param line the line, without its terminator
+ * @param error set to <n> for "+ERR=<n>", else 0
+ * @return AT_LINE
+ */
+AT_LINE at_classify(const char *line, int *error)
+{
+    *error = 0;
+
+    if (line[0] != '+')
+        return AT_LINE_OTHER;
+    if (strcmp(line, "+OK") == 0)
+        return AT_LINE_OK;
+    if (strncmp(line, "+ERR=", 5) == 0)
+    {
+        *error = atoi(line + 5);
+        return AT_LINE_ERR;
+    }
+    if (strncmp(line, "+RCV=", 5) == 0)
+        return AT_LINE_RCV;
+    if (strcmp(line, "+READY") == 0)
+        return AT_LINE_READY;
+    return AT_LINE_OTHER;
+}
+
+// hands the current command to the TX ring unless it is there already; a full
+// ring leaves it waiting for the TX interrupt, whose event brings us back here
+static void at_write(at_engine_t *at)
+{
+    const at_command_t *cmd = &at->queue[at->head & (AT_QUEUE_DEPTH - 1)];
+
+    if (at->started || !tx_ring_write(at->tx, cmd->text, cmd->len))
+        return;
+    at->started = true;
+    at->deadline = make_timeout_time_ms(cmd->timeout_ms);
+}
+
+/**
+ * @brief Queues a command; it goes out once those before it are answered
+ *
+ * @param at the engine
+ * @param command the command without its "\r\n", e.g. "AT+ADDRESS=102"
+ * @param timeout_ms how long the module may take to answer once the command starts going out
+ * @param done called from at_poll() with the outcome; may be NULL
+ * @param ctx stored in the command for done
+ * @return false if the queue is full or the command too long; nothing is queued
+ */
+bool at_submit(at_engine_t *at, const char *command, uint32_t timeout_ms, at_done_t done, void *ctx)
+{
+    at_command_t *cmd;
+    int len;
+
+    if (at->tail - at->head == AT_QUEUE_DEPTH)
+    {
+        at->rejected++;
+        return false;
+    }
+
+    cmd = &at->queue[at->tail & (AT_QUEUE_DEPTH - 1)];
+    len = snprintf(cmd->text, sizeof(cmd->text), "%s\r\n", command);
+    if (len < 0 || (size_t)len >= sizeof(cmd->text))
+    {
+        at->rejected++;
+        return false;
+    }
+    cmd->len = (uint16_t)len;
+    cmd->timeout_ms = timeout_ms;
+    cmd->done = done;
+    cmd->ctx = ctx;
+    at->tail++;
+
+    // an idle engine starts writing right away rather than on the next at_poll()
+    if (at->tail - at->head == 1)
+        at_write(at);
+    return true;
+}
+
+// retires the current command and tells its owner
+static void at_complete(at_engine_t *at, AT_RESULT result, int error)
+{
+    const at_command_t *cmd = &at->queue[at->head & (AT_QUEUE_DEPTH - 1)];
+
+    switch (result)
+    {
+        case AT_RESULT_OK:
+            at->ok++;
+            break;
+        case AT_RESULT_ERR:
+            at->errors++;
+            at->last_error = error;
+            break;
+        case AT_RESULT_TIMEOUT:
+            at->timeouts++;
+            break;
+    }
+    at->commands++;
+    at->started = false;
+    // the slot is only given up afterwards, so done may read it and submit another command
+    if (cmd->done)
+        cmd->done(cmd, result, error);
+    at->head++;
+}
+
+/**
+ * @brief Does whatever the engine can do right now, without waiting
+ *
+ * Stops after handing one unsolicited line to the listener, so a listener that
+ * keeps only the latest line doesn't lose any.
+ *
+ * @param at the engine
+ * @return true if there may be more to do straight away: a line is still queued.
+ *         false means nothing happens until a UART interrupt or at_deadline()
+ */
+bool at_poll(at_engine_t *at)
+{
+    const char *line;
+    size_t len;
+    FRAMER_EVENT event;
+    AT_LINE type;
+    int error;
+
+    while ((event = framer_poll(at->framer, &line, &len)) != FRAMER_EMPTY)
+    {
+        if (event == FRAMER_OVERFLOW)
+        {
+            // counted only: this runs on core 1, which must not print, see comms.h
+            at->overflows++;
+            continue;
+        }
+
+        type = at_classify(line, &error);
+        if ((type == AT_LINE_OK || type == AT_LINE_ERR) && at->started)
+        {
+            at_complete(at, type == AT_LINE_OK ? AT_RESULT_OK : AT_RESULT_ERR, error);
+            continue;
+        }
+        if (type == AT_LINE_OK || type == AT_LINE_ERR)
+        {
+            // e.g. the answer to a command that already timed out
+            at->stray++;
+            continue;
+        }
+
+        at->unsolicited++;
+        if (at->listener)
+        {
+            at->listener(type, line, len, at->ctx);
+            break;
+        }
+    }
+
+    if (at->started && time_reached(at->deadline))
+        at_complete(at, AT_RESULT_TIMEOUT, 0);
+
+    if (at->head != at->tail)
+        at_write(at);
+
+    return event != FRAMER_EMPTY;
+}
+
+/**
+ * @brief Whether a command is waiting or outstanding
+ */
+bool at_busy(const at_engine_t *at)
+{
+    return at->head != at->tail;
+}
+
+/**
+ * @brief Number of commands at_submit() can take right now
+ */
+unsigned at_free(const at_engine_t *at)
+{
+    return AT_QUEUE_DEPTH - (at->tail - at->head);
+}
+
+/**
+ * @brief When at_poll() has to run next even if nothing arrives: the deadline of the
+ *        outstanding command
+ *
+ * @return the deadline; at_the_end_of_time if no command is outstanding
+ */
+absolute_time_t at_deadline(const at_engine_t *at)
+{
+    return at->started ? at->deadline : at_the_end_of_time;
+}
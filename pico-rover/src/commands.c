@@ -0,0 +1,528 @@
+/**
+ * @file commands.c
+ * @brief Single-pass, non-mutating parser and handler table for the $XXX command messages
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include "../include/commands.h"
+
+// general includes
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// hardware includes
+#include "pico/stdlib.h"
+
+#include "../include/comms.h"
+#include "../include/motors.h"
+#include "../include/mtrbox.h"
+#include "../include/stats.h"
+#include "../include/trace.h"
+#include "../include/usblink.h"
+
+mtrbox_t motor_mailbox;
+
+typedef int (*command_parser_t)(const char *args, command_t *cmd);
+typedef int (*command_handler_t)(const command_t *cmd);
+
+typedef struct command_entry
+{
+    uint32_t tag;
+    command_parser_t parse;
+    command_handler_t handle;
+} command_entry_t;
+
+// the second character of each tag is unique in its low 5 bits, so it indexes the table directly
+#define TAG_INDEX(tag)  (((tag) >> 8) & 0x1f)
+
+_Static_assert(__builtin_popcount((1u << TAG_INDEX(MSG_MOTORS)) | (1u << TAG_INDEX(MSG_TX)) |
+                                  (1u << TAG_INDEX(MSG_CMD)) | (1u << TAG_INDEX(MSG_REQ)) |
+                                  (1u << TAG_INDEX(MSG_ACK))) == 5,
+               "command tags collide in the dispatch table");
+
+static inline bool is_end(char ch)
+{
+    return ch == '\0' || ch == CR || ch == NL;
+}
+
+/**
+ * @brief Parses a space-delimited decimal integer field
+ *
+ * @param p start of the field (leading spaces are skipped)
+ * @param value where the integer is stored
+ * @return pointer just past the field, NULL if there is no valid integer or it doesn't fit an int
+ */
+static const char *parse_int(const char *p, int *value)
+{
+    bool negative = false;
+    int v = 0;
+
+    while (*p == ' ')
+        p++;
+
+    if (*p == '-' || *p == '+')
+        negative = (*p++ == '-');
+
+    if (*p < '0' || *p > '9')
+        return NULL;
+
+    while (*p >= '0' && *p <= '9')
+    {
+        if (v > (INT_MAX - (*p - '0')) / 10)
+            return NULL;
+        v = v * 10 + (*p++ - '0');
+    }
+
+    // reject trailing garbage such as "12x"
+    if (*p != ' ' && !is_end(*p))
+        return NULL;
+
+    *value = negative ? -v : v;
+    return p;
+}
+
+static bool pwm_valid(int pwm)
+{
+    return pwm >= 0 && pwm <= PWM_SPEED_MAX;
+}
+
+static bool rpm_valid(int rpm)
+{
+    return rpm >= -WHEEL_MAX_RPM && rpm <= WHEEL_MAX_RPM;
+}
+
+// out of range is refused rather than narrowed, which would wrap to a different speed or direction
+static int parse_mtr(const char *args, command_t *cmd)
+{
+    int dir1, pwm1, dir2, pwm2;
+    int rpm1, rpm2;
+
+    while (*args == ' ')
+        args++;
+    if (args[0] == 'V' && (args[1] == ' ' || is_end(args[1])))
+    {
+        if (!(args = parse_int(args + 1, &rpm1)) ||
+            !(args = parse_int(args, &rpm2)) ||
+            !rpm_valid(rpm1) || !rpm_valid(rpm2))
+        {
+            return EXIT_FAILURE;
+        }
+        cmd->mtr.velocity = true;
+        cmd->mtr.rpm1 = (int16_t)rpm1;
+        cmd->mtr.rpm2 = (int16_t)rpm2;
+        return EXIT_SUCCESS;
+    }
+
+    if (!(args = parse_int(args, &dir1)) ||
+        !(args = parse_int(args, &pwm1)) ||
+        !(args = parse_int(args, &dir2)) ||
+        !(args = parse_int(args, &pwm2)) ||
+        !pwm_valid(pwm1) || !pwm_valid(pwm2))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cmd->mtr.velocity = false;
+    cmd->mtr.dir1 = dir1 != 0;
+    cmd->mtr.pwm1 = (int8_t)pwm1;
+    cmd->mtr.dir2 = dir2 != 0;
+    cmd->mtr.pwm2 = (int8_t)pwm2;
+    return EXIT_SUCCESS;
+}
+
+static int parse_ack(const char *args, command_t *cmd)
+{
+    return parse_int(args, &cmd->ack.seq) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int parse_text(const char *args, command_t *cmd)
+{
+    const char *end;
+
+    if (*args == ' ')
+        args++;
+    for (end = args; !is_end(*end); end++);
+
+    cmd->text.text = args;
+    cmd->text.len = (size_t)(end - args);
+    return EXIT_SUCCESS;
+}
+
+// whether a text argument starts with the given word
+static bool text_word(const text_arg_t *arg, const char *word)
+{
+    size_t len = strlen(word);
+
+    return arg->len >= len && memcmp(arg->text, word, len) == 0 &&
+           (arg->len == len || arg->text[len] == ' ');
+}
+
+// ACK messages are used for confirmation that sent data was received
+static int handle_ack(const command_t *cmd)
+{
+    if (usb_mode == USB_MODE_ASCII)
+        printf("Got an ACK message. SEQ: %d\n", cmd->ack.seq);
+    return EXIT_SUCCESS;
+}
+
+// CMD messages come from the GS, are to be passed up to the SBC with printf
+static int handle_cmd(const command_t *cmd)
+{
+    if (usb_mode == USB_MODE_BINARY)
+        usb_send(BIN_MSG_CMD, cmd->text.text, cmd->text.len);
+    else
+        printf("$CMD %.*s\n", (int)cmd->text.len, cmd->text.text);
+    return EXIT_SUCCESS;
+}
+
+// MTR messages from the SBC; only the newest is applied, by apply_motor_commands()
+static int handle_mtr(const command_t *cmd)
+{
+    mtrbox_post(&motor_mailbox, MTR_SOURCE_USB, &cmd->mtr);
+    return EXIT_SUCCESS;
+}
+
+static int report_ctl(const text_arg_t *arg)
+{
+    motor_ctl_stats_t stats;
+    char rate[8];
+    int hz;
+
+    if (arg->len > 4 && arg->len - 4 < sizeof(rate))
+    {
+        memcpy(rate, arg->text + 4, arg->len - 4);
+        rate[arg->len - 4] = '\0';
+        if (!parse_int(rate, &hz) || configure_motor_control((uint)hz))
+        {
+            // reported here with the range, so not failed back to usblink.c for a second report
+            usb_error("control rate must be %d-%d Hz", MOTOR_CTL_MIN_HZ, MOTOR_CTL_MAX_HZ);
+        }
+        return EXIT_SUCCESS;
+    }
+
+    get_motor_ctl_stats(&stats);
+    if (usb_mode == USB_MODE_BINARY)
+    {
+        usb_send(BIN_MSG_CTL, &stats, sizeof(stats));
+    }
+    else
+    {
+        uint32_t runs = stats.runs ? stats.runs : 1;
+        printf("$CTL %u %lu %lu %lu %lu %lu %lu %lu\n", stats.hz, (unsigned long)stats.runs,
+               (unsigned long)stats.jitter_max_us, (unsigned long)(stats.jitter_sum_us / runs),
+               (unsigned long)stats.exec_max_us, (unsigned long)(stats.exec_sum_us / runs),
+               (unsigned long)stats.saturated, (unsigned long)stats.failsafes);
+    }
+    return EXIT_SUCCESS;
+}
+
+static int set_command_timeout(const text_arg_t *arg)
+{
+    char window[8];
+    int ms;
+
+    if (arg->len > 4 && arg->len - 4 < sizeof(window))
+    {
+        memcpy(window, arg->text + 4, arg->len - 4);
+        window[arg->len - 4] = '\0';
+        if (parse_int(window, &ms) && !configure_command_timeout((uint)ms))
+            return EXIT_SUCCESS;
+    }
+    // reported here with the range, so not failed back to usblink.c for a second report
+    usb_error("command timeout must be %d-%d ms", MOTOR_CMD_TIMEOUT_MIN_MS, MOTOR_CMD_TIMEOUT_MAX_MS);
+    return EXIT_SUCCESS;
+}
+
+static int report_mbox(void)
+{
+    static const char *const names[MTR_SOURCES] = { [MTR_SOURCE_LORA] = "LORA", [MTR_SOURCE_USB] = "USB" };
+    mtrbox_stats_t stats[MTR_SOURCES];
+
+    for (int src = 0; src < MTR_SOURCES; src++)
+        mtrbox_get_stats(&motor_mailbox, (MTR_SOURCE)src, &stats[src]);
+
+    if (usb_mode == USB_MODE_BINARY)
+    {
+        usb_send(BIN_MSG_MBOX, stats, sizeof(stats));
+        return EXIT_SUCCESS;
+    }
+    for (int src = 0; src < MTR_SOURCES; src++)
+    {
+        printf("$MBOX %s %lu %lu %lu %lu %lu\n", names[src], (unsigned long)stats[src].posted,
+               (unsigned long)stats[src].applied, (unsigned long)stats[src].coalesced,
+               (unsigned long)stats[src].stale, (unsigned long)stats[src].preempted);
+    }
+    return EXIT_SUCCESS;
+}
+
+static int report_stats(void)
+{
+    rover_stats_t stats;
+
+    stats_snapshot(&stats);
+    if (usb_mode == USB_MODE_BINARY)
+    {
+        usb_send(BIN_MSG_STATS, &stats, sizeof(stats));
+        return EXIT_SUCCESS;
+    }
+
+    printf("$STATS QUEUE %u %lu %lu %u %lu %lu\n", stats.rx_depth, (unsigned long)stats.rx_sent,
+           (unsigned long)stats.rx_dropped, stats.tx_depth, (unsigned long)stats.tx_sent,
+           (unsigned long)stats.tx_dropped);
+    printf("$STATS LINK %lu %lu %lu\n", (unsigned long)stats.parse_errors, (unsigned long)stats.retransmits,
+           (unsigned long)stats.resets);
+    printf("$STATS RATE %u %d %s%d.%d %u %lu %lu %lu\n", stats.rate, stats.rssi, stats.snr < 0 ? "-" : "",
+           abs(stats.snr) / 10, abs(stats.snr) % 10, stats.per_pct, (unsigned long)stats.rate_ups,
+           (unsigned long)stats.rate_downs, (unsigned long)stats.fallbacks);
+    printf("$STATS GPS %u %lu %lu\n", stats.gps_per_s, (unsigned long)stats.gps_sentences,
+           (unsigned long)stats.gps_rejected);
+    printf("$STATS OVERRUN %lu %lu %lu\n", (unsigned long)stats.overruns[0], (unsigned long)stats.overruns[1],
+           (unsigned long)stats.overruns[2]);
+    for (int core = 0; core < STATS_CORES; core++)
+    {
+        printf("$STATS CORE %d %u %lu %lu %lu %lu\n", core, stats.core[core].idle_pct,
+               (unsigned long)stats.core[core].passes_per_s, (unsigned long)stats.core[core].tick_period_us,
+               (unsigned long)stats.core[core].late_mean_us, (unsigned long)stats.core[core].late_max_us);
+    }
+    for (int cls = 0; cls < TX_CLASSES; cls++)
+    {
+        printf("$STATS TXQ %s %u %lu %lu %lu %lu\n", tx_class_names[cls], stats.tx[cls].depth,
+               (unsigned long)stats.tx[cls].sent, (unsigned long)stats.tx[cls].dropped,
+               (unsigned long)stats.tx[cls].delay_mean_us, (unsigned long)stats.tx[cls].delay_max_us);
+    }
+    printf("$STATS END %lu\n", (unsigned long)stats.interval_ms);
+    return EXIT_SUCCESS;
+}
+
+// both cores' trace rings, oldest first per core; draining them makes room for new events
+static int report_trace(void)
+{
+    trace_record_t records[BIN_MAX_PAYLOAD / sizeof(trace_record_t)];
+    uint32_t totals[2] = { 0, 0 };
+    size_t n;
+
+    for (uint core = 0; core < TRACE_CORES; core++)
+    {
+        while ((n = trace_read(core, records, sizeof(records) / sizeof(records[0]))))
+        {
+            totals[0] += (uint32_t)n;
+            if (usb_mode == USB_MODE_BINARY)
+            {
+                usb_send(BIN_MSG_TRACE, records, n * sizeof(records[0]));
+                continue;
+            }
+            for (size_t i = 0; i < n; i++)
+            {
+                printf("$TRC %u %llu %s %lu\n", records[i].core, (unsigned long long)records[i].t_us,
+                       trace_event_names[records[i].event], (unsigned long)records[i].arg);
+            }
+        }
+        totals[1] += trace_rings[core].lost;
+    }
+
+    // records sent, and records lost since boot
+    if (usb_mode == USB_MODE_BINARY)
+        usb_send(BIN_MSG_TRACE_END, totals, sizeof(totals));
+    else
+        printf("$TRC END %lu %lu\n", (unsigned long)totals[0], (unsigned long)totals[1]);
+    return EXIT_SUCCESS;
+}
+
+// REQ messages ask for a data update or a change of link settings
+static int handle_req(const command_t *cmd)
+{
+    // switch the USB link between ASCII lines and binary frames
+    if (text_word(&cmd->text, "BIN"))
+    {
+        usb_set_mode(USB_MODE_BINARY);
+        return EXIT_SUCCESS;
+    }
+    if (text_word(&cmd->text, "ASCII"))
+    {
+        usb_set_mode(USB_MODE_ASCII);
+        return EXIT_SUCCESS;
+    }
+
+    // "CTL": control loop timing since the last report; "CTL <hz>": its rate
+    if (text_word(&cmd->text, "CTL"))
+        return report_ctl(&cmd->text);
+
+    // "WDT <ms>": how long the motors run on without a fresh $MTR before the failsafe stops them
+    if (text_word(&cmd->text, "WDT"))
+        return set_command_timeout(&cmd->text);
+
+    // "STATS": queues, link, GPS, overruns, per-core load and outbound queueing delay since the last snapshot
+    if (text_word(&cmd->text, "STATS"))
+        return report_stats();
+
+    // "TRACE": the command path events recorded since the last dump
+    if (text_word(&cmd->text, "TRACE"))
+        return report_trace();
+
+    // "MBOX": motor command counters per source
+    if (text_word(&cmd->text, "MBOX"))
+        return report_mbox();
+
+    // anything else, e.g. a typo, is reported by the caller through usb_error()
+    return EXIT_FAILURE;
+}
+
+// TX messages are from the SBC, meant to be transmitted on LORA to the GS; core 0 only,
+// the producer side of transmit_queue and txr_queue. "+ <piece>" starts or continues a
+// message longer than one frame, ". <piece>" ends it, see frag.h
+static int handle_tx(const command_t *cmd)
+{
+    const char *text = cmd->text.text;
+    size_t len = cmd->text.len;
+    char *buf;
+
+    if (len >= 2 && (text[0] == '+' || text[0] == '.') && text[1] == ' ')
+        return frag_append(&txr_queue, text + 2, len - 2, text[0] == '+');
+    if (frag_appending(&txr_queue) || loraStuffedSize(text, len) >= ARQ_DATA_SIZE)
+        return frag_append(&txr_queue, text, len, false);
+
+    buf = tx_alloc(&transmit_queue, TX_STATUS);
+    if (!buf)
+        return EXIT_FAILURE;
+
+    memcpy(buf, text, len);
+    buf[len] = '\0';
+    tx_send(&transmit_queue, TX_STATUS, buf, len);
+    return EXIT_SUCCESS;
+}
+
+static const command_entry_t command_table[32] = {
+    [TAG_INDEX(MSG_ACK)]    = {MSG_ACK,    parse_ack,  handle_ack},
+    [TAG_INDEX(MSG_CMD)]    = {MSG_CMD,    parse_text, handle_cmd},
+    [TAG_INDEX(MSG_MOTORS)] = {MSG_MOTORS, parse_mtr,  handle_mtr},
+    [TAG_INDEX(MSG_REQ)]    = {MSG_REQ,    parse_text, handle_req},
+    [TAG_INDEX(MSG_TX)]     = {MSG_TX,     parse_text, handle_tx},
+};
+
+/**
+ * @brief Parses a command message into its typed form without modifying or copying the input
+ *
+ * @param in the input string, terminated by NUL, CR or LF
+ * @param cmd where the parsed command is stored; text arguments point into in
+ * @return status of parsing (EXIT_SUCCESS/EXIT_FAILURE)
+ */
+int parse_command(const char *in, command_t *cmd)
+{
+    uint32_t tag;
+    const command_entry_t *entry;
+
+    // checked byte by byte so a short string is never read past its terminator
+    if (!in[0] || !in[1] || !in[2] || !in[3])
+        return EXIT_FAILURE;
+    // the tag must be a whole token ("$MTRX" is not "$MTR")
+    if (in[4] != ' ' && !is_end(in[4]))
+        return EXIT_FAILURE;
+
+    // both the RP2040 and the host are little-endian, matching MSG_TAG()
+    memcpy(&tag, in, sizeof(tag));
+
+    entry = &command_table[TAG_INDEX(tag)];
+    if (entry->tag != tag)
+        return EXIT_FAILURE;
+
+    cmd->tag = tag;
+    return entry->parse(in + 4, cmd);
+}
+
+/**
+ * @brief Converts a binary frame from the SBC into the same typed command parse_command() produces
+ *
+ * @param frame a frame from bin_decoder_push()
+ * @param cmd where the command is stored; text arguments point into the frame
+ * @return status of parsing (EXIT_SUCCESS/EXIT_FAILURE)
+ */
+int parse_frame(const bin_frame_t *frame, command_t *cmd)
+{
+    const uint8_t *p = frame->payload;
+
+    switch (frame->id)
+    {
+        case BIN_MSG_MOTORS:
+            if (frame->len == 5 && p[0] == 'V')
+            {
+                cmd->tag = MSG_MOTORS;
+                cmd->mtr.velocity = true;
+                cmd->mtr.rpm1 = (int16_t)((uint16_t)p[1] | (uint16_t)p[2] << 8);
+                cmd->mtr.rpm2 = (int16_t)((uint16_t)p[3] | (uint16_t)p[4] << 8);
+                return rpm_valid(cmd->mtr.rpm1) && rpm_valid(cmd->mtr.rpm2) ? EXIT_SUCCESS : EXIT_FAILURE;
+            }
+            if (frame->len != 4 || !pwm_valid(p[1]) || !pwm_valid(p[3]))
+                return EXIT_FAILURE;
+            cmd->tag = MSG_MOTORS;
+            cmd->mtr.velocity = false;
+            cmd->mtr.dir1 = p[0] != 0;
+            cmd->mtr.pwm1 = (int8_t)p[1];
+            cmd->mtr.dir2 = p[2] != 0;
+            cmd->mtr.pwm2 = (int8_t)p[3];
+            return EXIT_SUCCESS;
+
+        case BIN_MSG_ACK:
+            if (frame->len != 4)
+                return EXIT_FAILURE;
+            cmd->tag = MSG_ACK;
+            cmd->ack.seq = (int32_t)((uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24);
+            return EXIT_SUCCESS;
+
+        case BIN_MSG_CMD:
+        case BIN_MSG_REQ:
+        case BIN_MSG_TX:
+            // text from here on is measured with strlen(), as far as the ground station; a NUL would cut it short
+            if (memchr(p, '\0', frame->len))
+                return EXIT_FAILURE;
+            cmd->tag = frame->id == BIN_MSG_CMD ? MSG_CMD : frame->id == BIN_MSG_REQ ? MSG_REQ : MSG_TX;
+            cmd->text.text = (const char *)p;
+            cmd->text.len = frame->len;
+            return EXIT_SUCCESS;
+    }
+
+    return EXIT_FAILURE;
+}
+
+/**
+ * @brief Runs the handler for a parsed command
+ *
+ * @param cmd a command filled in by parse_command() (or built directly by the caller)
+ * @return status of the handler (EXIT_SUCCESS/EXIT_FAILURE)
+ */
+int dispatch_command(const command_t *cmd)
+{
+    const command_entry_t *entry = &command_table[TAG_INDEX(cmd->tag)];
+
+    if (entry->tag != cmd->tag)
+        return EXIT_FAILURE;
+
+    return entry->handle(cmd);
+}
+
+/**
+ * @brief Applies the freshest motor command waiting in motor_mailbox, if there is one
+ *
+ * @return true if the motors were given a new command
+ */
+bool apply_motor_commands(void)
+{
+    mtr_cmd_t mtr;
+    MTR_SOURCE source;
+
+    if (!mtrbox_take(&motor_mailbox, time_us_32(), &mtr, &source))
+        return false;
+
+    TRACE(TRACE_MTR_TAKE, source);
+    if (mtr.velocity)
+        set_velocity(mtr.rpm1, mtr.rpm2);
+    else
+        set_PWM(mtr.dir1, mtr.pwm1, mtr.dir2, mtr.pwm2);
+    TRACE(TRACE_MTR_APPLY, source);
+    return true;
+}
@@ -12,6 +12,7 @@
 #include "../include/comms.h"
 
 // general includes
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -24,25 +25,134 @@
 #include "hardware/i2c.h"
 #include "hardware/pwm.h"
 
+#include "../include/commands.h"
+#include "../include/config.h"
+#include "../include/main.h"
+#include "../include/mtrbox.h"
+#include "../include/stats.h"
+#include "../include/telemetry.h"
+#include "../include/tlmreg.h"
+#include "../include/trace.h"
+#include "../include/varint.h"
+
+// filled/drained by on_UART_LORA_irq(); comm_run() uses them through lora_modem
+line_framer_t lora_framer;
+tx_ring_t lora_tx;
+at_engine_t lora_modem;
+
 // Data queues
 queue_t data_queue;
-queue_t receive_queue;
-queue_t transmit_queue;
+msg_channel_t receive_queue;
+msg_channel_t error_queue;
+tx_sched_t transmit_queue;
+frag_tx_t txr_queue;
+
+// +RCV signal reports and ARQ resends, and the data rate chosen from them
+linkq_t lora_quality;
+
+_Static_assert(MSG_BUFFER_SIZE == LORA_SIZE, "inter-core buffers hold one LoRa payload");
+
+/**
+ * @brief Reports an error from core 1: core 0 passes it on with usb_error(), so it can't
+ *        land in the middle of a binary frame; if core 0 is behind it is dropped and
+ *        counted in error_queue.dropped
+ * @param fmt printf-style format, without "$ERR"
+ */
+static void commError(const char *fmt, ...)
+{
+    char *text = msg_alloc(&error_queue);
+    va_list args;
+    int len;
+
+    if (!text)
+        return;
+    va_start(args, fmt);
+    len = vsnprintf(text, MSG_BUFFER_SIZE, fmt, args);
+    va_end(args);
+    if (len < 0)
+        len = 0;
+    else if (len >= MSG_BUFFER_SIZE)
+        len = MSG_BUFFER_SIZE - 1;
+    msg_send(&error_queue, text, (size_t)len);
+}
+
+// one item for core 0: $MTR replaces the ground station's motor command, $CMD is written
+// straight into a receive_queue buffer; false if none is free
+static bool deliverItem(const char *flag, const char *data)
+{
+    char line[FLAG_SIZE + LORA_SIZE + 1];
+    command_t cmd;
+    char *item;
+    int len;
+
+    if (strcmp(flag, "$MTR") == 0)
+    {
+        snprintf(line, sizeof(line), "%s %s", flag, data);
+        if (parse_command(line, &cmd))
+            commError("bad motor command from the ground station: %s", data);
+        else
+            mtrbox_post(&motor_mailbox, MTR_SOURCE_LORA, &cmd.mtr);
+    }
+    else if (strcmp(flag, "$CMD") == 0)
+    {
+        item = msg_alloc(&receive_queue);
+        if (!item)
+            return false;
+        len = snprintf(item, LORA_SIZE, "%s", data);
+        msg_send(&receive_queue, item, len);
+        TRACE(TRACE_CMD_QUEUE, len);
+    }
+    return true;
+}
 
+/**
+ * @brief Hands in-order frames from the ground station to core 0, unpacking aggregates;
+ *        stops when receive_queue is full and resumes at the same item next time
+ * @param state the STATE for this communication instance
+ */
+static void deliver(STATE *state)
+{
+    const ARQ_SLOT *slot;
+    const char *cursor;
+    char flag[FLAG_SIZE];
+    char data[LORA_SIZE];
+    int item;
+
+    while ((slot = arq_peek(state)))
+    {
+        if (strcmp(slot->flag, "AGG") == 0)
+        {
+            cursor = slot->data;
+            for (item = 0; aggNext(&cursor, flag, data, sizeof(data)) == EXIT_SUCCESS; item++)
+            {
+                if (item < state->rx_items)
+                    continue;
+                if (!deliverItem(flag, data))
+                    return;
+                state->rx_items++;
+            }
+        }
+        else if (!deliverItem(slot->flag, slot->data))
+        {
+            return;
+        }
+        state->rx_items = 0;
+        arq_pop(state);
+    }
+}
 
 /**  @brief  Steps through the communication protocol using input string and current state COMMS_STATE
  *   @param  state the STATE for this communication instance
  *   @param  in the input string
- *   @param  out destination of response
+ *   @param  out destination of response; empty if there is nothing to send. Data in
+ *           ESTABLISHED goes out through arq_poll() instead
  */    
 void protocol(STATE *state, char *in, char *out)
 {
     int status;
-    char flag[5];
-    char data[LORA_SIZE];
+    FRAME frame;
 
-    // clear flag
-    memset(flag, 0, sizeof(flag));
+    *out = '\0';
 
     switch(state->state)
     {
@@ -54,16 +164,21 @@ void protocol(STATE *state, char *in, char *out)
             // Parse message from ground station
             status = parseMessage(in);
             if(status) {
-                printf("$ERR failed to parse message: %s", in);
-                exit(-1);
+                commError("failed to parse message: %s", in);
+                lora_link_stats.parse_errors++;
+                break;
             }
             // Parse message payload
-            status = parseData(state, in, flag);
+            status = parseData(&frame, in);
             if(status) {
-                printf("$ERR failed to parse data: %s", in);
-                exit(-1);
+                commError("failed to parse data: %s", in);
+                lora_link_stats.parse_errors++;
+                break;
             }
-            if(strcmp(flag, "SYN") == 0) {
+            if(strcmp(frame.flag, "SYN") == 0) {
+                state->ack = frame.seq + 1;
+                state->seq = frame.ack;
+                arq_start(state, ARQ_WINDOW);
                 strcpy(out, "ACK");
                 state->state++;
             }
@@ -71,44 +186,44 @@ void protocol(STATE *state, char *in, char *out)
         case ESTABLISHED:
             status = parseMessage(in);
             if(status) {
-                printf("$ERR failed to parse message: %s", in);
-                exit(-1);
+                commError("failed to parse message: %s", in);
+                lora_link_stats.parse_errors++;
+                break;
             }
-            status = parseData(state, in, flag);
+            status = parseData(&frame, in);
             if(status) {
-                printf("$ERR failed to parse data: %s", in);
-                exit(-1);
+                commError("failed to parse data: %s", in);
+                lora_link_stats.parse_errors++;
+                break;
             }
-            if(strcmp(flag, "FIN") == 0) {
+            TRACE(TRACE_LORA_FRAME, frame.seq);
+            if(strcmp(frame.flag, "FIN") == 0) {
                 strcpy(out, "FIN");
                 state->state++;
-            } else if (strcmp(flag, "ACK") == 0) {
-                //if(queue_try_add(&receive_queue, in)) printf("CORE 1: SENT DATA\n");
+            } else if (strcmp(frame.flag, "SYN") == 0) {
+                // our handshake ACK was lost
                 strcpy(out, "ACK");
-                if(queue_try_remove(&transmit_queue, data)) printf("CORE 1: RECEIVED DATA: %s\n", data);
-                strcat(strcat(out, " "), data);
-            } else if (strcmp(flag, "$CMD") == 0) {
-                if(queue_try_add(&receive_queue, in)) printf("CORE 1: SENT DATA\n");
-                strcpy(out, "ACK");
-                if(queue_try_remove(&transmit_queue, data)) printf("CORE 1: RECEIVED DATA: %s\n", data);
-                strcat(strcat(out, " "), data);
+            } else {
+                // ACK and $CMD frames: take the acks, hold any data for in-order delivery
+                arq_receive(state, &frame, get_absolute_time());
+                deliver(state);
             }
             break;
         case LASTACK:
             status = parseMessage(in);
             if(status) {
-                printf("$ERR failed to parse message: %s\n", in);
-                // exit(-1);
+                commError("failed to parse message: %s", in);
+                lora_link_stats.parse_errors++;
+                break;
             }
-            status = parseData(state, in, flag);
+            status = parseData(&frame, in);
             if(status) {
-                printf("$ERR failed to parse data: %s\n", in);
-                // exit(-1);
+                commError("failed to parse data: %s", in);
+                lora_link_stats.parse_errors++;
+                break;
             }
-            if(strcmp(flag, "ACK") == 0) {
-                printf("\nConnection terminated successfully\n");
+            if(strcmp(frame.flag, "ACK") == 0) {
                 sleep_ms(3000);
-                *out = '\0';
                 state->seq = 0;
                 state->ack = 0;
                 state->state = CLOSED;
@@ -117,53 +232,189 @@ void protocol(STATE *state, char *in, char *out)
     }
 }
 
+// flags carried by the kind bits of a frame; the index is the code on the air
+static const char *const frame_kinds[] = { "ACK", "SYN", "FIN", "$CMD", "AGG", "TLM", "FRG", "RAT" };
+
+_Static_assert(sizeof(frame_kinds) / sizeof(frame_kinds[0]) <= LORA_KIND_MASK + 1, "too many frame kinds");
+
+// bytes that would end the AT+SEND line, the +RCV line or one of its fields
+static bool loraReserved(uint8_t b)
+{
+    return b == '\0' || b == '\r' || b == '\n' || b == ',' || b == '=' || b == LORA_ESC;
+}
+
 /**
- * @brief Parses data within a message 
- * @param state the STATE for this communication instance
- * @param in data for protocol()
- * @param flag communication flag
- * @return int status; 0 = failure; 1 = success
+ * @brief Escapes bytes the modem's text interface can't carry: each of NUL, CR, LF, ',', '='
+ *        and LORA_ESC becomes LORA_ESC, byte ^ 0x40
+ * @param in raw bytes
+ * @param len number of raw bytes
+ * @param out destination; NUL-terminated
+ * @param size size of out
+ * @return int length of out; -1 if it doesn't fit
  */
-int parseData(STATE *state, char *in, char *flag) 
+int loraStuff(const void *in, size_t len, char *out, size_t size)
 {
-    char *delim = " ";
-    char *token;
-    char data[LORA_SIZE];
-    
-    // get GS seq num
-    token = strtok(in, delim);
-    // set rover ack num
-    state->ack = atoi(token) + 1;
-    // get GS ack num
-    token = strtok(NULL, delim);
-    // set rover seq num
-    state->seq = atoi(token);
-    
-    // get flag
-    token = strtok(NULL, delim);
-    // printf("Flag: %s\n", token);
-    // check if flag is valid
-    if (*token) 
+    const uint8_t *b = in;
+    size_t n = 0;
+
+    for (size_t i = 0; i < len; i++)
     {
-        strcpy(flag, token);
-    } 
-    else 
+        if (loraReserved(b[i]))
+        {
+            if (n + 2 >= size)
+                return -1;
+            out[n++] = LORA_ESC;
+            out[n++] = (char)(b[i] ^ 0x40);
+        }
+        else
+        {
+            if (n + 1 >= size)
+                return -1;
+            out[n++] = (char)b[i];
+        }
+    }
+    out[n] = '\0';
+
+    return (int)n;
+}
+
+/**
+ * @brief Length of data once stuffed, see loraStuff()
+ */
+size_t loraStuffedSize(const void *data, size_t len)
+{
+    const uint8_t *b = data;
+    size_t n = len;
+
+    for (size_t i = 0; i < len; i++)
+        n += loraReserved(b[i]);
+
+    return n;
+}
+
+/**
+ * @brief Undoes loraStuff() in place
+ * @param buf stuffed string; NUL-terminated raw bytes on return
+ * @return size_t number of raw bytes
+ */
+size_t loraUnstuff(char *buf)
+{
+    size_t n = 0;
+
+    for (const char *in = buf; *in; in++)
     {
+        if (*in == LORA_ESC && in[1])
+            buf[n++] = *++in ^ 0x40;
+        else
+            buf[n++] = *in;
+    }
+    buf[n] = '\0';
+
+    return n;
+}
+
+/**
+ * @brief Parses the header and data within a message, see FRAME
+ * @param frame where the fields are stored; frame->data points into in
+ * @param in data for protocol(); unstuffed in place
+ * @return int status; 0 = success; 1 = failure
+ */
+int parseData(FRAME *frame, char *in) 
+{
+    const uint8_t *raw = (const uint8_t *)in;
+    size_t len = loraUnstuff(in);
+    size_t pos = 1;
+    size_t n;
+    uint32_t value;
+    uint8_t kind;
+
+    if (!len)
         return EXIT_FAILURE;
+    kind = raw[0] & LORA_KIND_MASK;
+    if (kind >= sizeof(frame_kinds) / sizeof(frame_kinds[0]))
+        return EXIT_FAILURE;
+    strcpy(frame->flag, frame_kinds[kind]);
+
+    // get GS seq num
+    if (!(n = varint_get(raw + pos, len - pos, &value)))
+        return EXIT_FAILURE;
+    frame->seq = (int)value;
+    pos += n;
+
+    // get GS ack num
+    if (!(n = varint_get(raw + pos, len - pos, &value)))
+        return EXIT_FAILURE;
+    frame->ack = (int)value;
+    pos += n;
+
+    // get GS selective ack bitmap
+    frame->sack = 0;
+    if (raw[0] & LORA_F_SACK)
+    {
+        if (!(n = varint_get(raw + pos, len - pos, &frame->sack)))
+            return EXIT_FAILURE;
+        pos += n;
     }
 
-    // if there is data, get it
-    token = strtok(NULL, "\r");
-    // check if data is valid
-    if (token) 
+    // if there is data, get it; unstuffing left it NUL-terminated
+    frame->data = NULL;
+    frame->len = 0;
+    if (raw[0] & LORA_F_DATA)
     {
-        printf("Data: %s\n", token);
-        strcpy(in, token);
+        frame->data = in + pos;
+        frame->len = len - pos;
     }
 
     return EXIT_SUCCESS;
 }
 
+/**
+ * @brief Formats a LoRa payload; the inverse of parseData()
+ * @param out destination
+ * @param size size of out
+ * @param seq sequence number of this frame
+ * @param ack next sequence number expected from the peer
+ * @param sack frames received beyond ack, see arq_sack()
+ * @param flag SYN, ACK, FIN, $CMD, AGG, TLM, FRG or RAT
+ * @param data payload, NULL if none
+ * @param len number of bytes in data
+ * @return int length of the payload; -1 if the flag is unknown or the frame doesn't fit
+ */
+int formatFrame(char *out, size_t size, int seq, int ack, uint32_t sack, const char *flag, const void *data, size_t len)
+{
+    uint8_t header[1 + 3 * VARINT_MAX_SIZE];
+    size_t n = 1;
+    int stuffed, payload;
+    uint8_t kind;
+
+    for (kind = 0; kind < sizeof(frame_kinds) / sizeof(frame_kinds[0]); kind++)
+    {
+        if (strcmp(flag, frame_kinds[kind]) == 0)
+            break;
+    }
+    if (kind == sizeof(frame_kinds) / sizeof(frame_kinds[0]))
+        return -1;
+
+    header[0] = kind;
+    if (data)
+        header[0] |= LORA_F_DATA;
+    if (sack)
+        header[0] |= LORA_F_SACK;
+    n += varint_put((uint32_t)seq, header + n);
+    n += varint_put((uint32_t)ack, header + n);
+    if (sack)
+        n += varint_put(sack, header + n);
+
+    stuffed = loraStuff(header, n, out, size);
+    if (stuffed < 0 || !data)
+        return stuffed;
+
+    payload = loraStuff(data, len, out + stuffed, size - stuffed);
+    if (payload < 0)
+        return -1;
+    return stuffed + payload;
+}
+
 /**
  * @brief Parses message from ground station; 
  * @param in message for protocol()
@@ -196,93 +447,410 @@ int parseMessage(char *in)
 }
 
 /**
- * @brief Sends rover telemetry to ground station by writing to LoRa's UART pins
- * @param tx message to be sent
+ * @brief Appends one item to an aggregate frame's data: "<n>:<flag> <data>", n = length of "<flag> <data>"
+ * @param out the aggregate
+ * @param size size of out
+ * @param len current length of out
+ * @param flag the item's flag
+ * @param data the item's payload
+ * @return int new length of out; -1 if the item doesn't fit, out is unchanged
  */
-void write(char *tx)
+int aggAppend(char *out, size_t size, size_t len, const char *flag, const char *data)
 {
-    printf("TX: %s", tx);
+    size_t n = strlen(flag) + 1 + strlen(data);
+    int written = snprintf(out + len, size - len, "%u:%s %s", (unsigned)n, flag, data);
 
-    // wait for TX fifo to be empty
-    uart_tx_wait_blocking(UART_ID_LORA);
-
-    if (uart_is_writable(UART_ID_LORA))
+    if (written < 0 || (size_t)written >= size - len)
     {
-        uart_puts(UART_ID_LORA, tx);
+        out[len] = '\0';
+        return -1;
     }
+    return (int)(len + written);
+}
 
+/**
+ * @brief Takes the next item out of an aggregate frame's data
+ * @param cursor position in the aggregate; advanced past the item
+ * @param flag destination of the item's flag, FLAG_SIZE bytes
+ * @param data destination of the item's payload
+ * @param size size of data
+ * @return int status; 0 = success; 1 = no more items or malformed
+ */
+int aggNext(const char **cursor, char *flag, char *data, size_t size)
+{
+    const char *in = *cursor;
+    const char *item;
+    const char *space;
+    char *end;
+    unsigned long n;
+
+    if (!*in)
+        return EXIT_FAILURE;
+
+    n = strtoul(in, &end, 10);
+    if (end == in || *end != ':' || n > strlen(end + 1))
+        return EXIT_FAILURE;
+    item = end + 1;
+
+    space = memchr(item, ' ', n);
+    if (!space || space - item >= FLAG_SIZE || (size_t)(item + n - space - 1) >= size)
+        return EXIT_FAILURE;
+
+    memcpy(flag, item, space - item);
+    flag[space - item] = '\0';
+    memcpy(data, space + 1, item + n - space - 1);
+    data[item + n - space - 1] = '\0';
+
+    *cursor = item + n;
+    return EXIT_SUCCESS;
 }
 
 /**
- * @brief Read from UART with timeout
- * 
- * @param buffer buffer where UART data is placed
- * @param timeout timeout (in us) before giving up on reading from UART
+ * @brief Queues everything waiting for the ground station as one ARQ frame: a lone item goes as is,
+ *        several go as one "AGG" frame of length-prefixed items up to ARQ_DATA_SIZE
+ *
+ * Items are taken in the scheduler's order, highest class first, until the next one doesn't fit.
+ * @param state the STATE for this communication instance
+ * @param sched items from the other core; their buffers are released once copied
+ * @param flag flag of the queued items
+ * @return int number of items taken
  */
-void read(char *buffer, int timeout) 
+int aggregateQueue(STATE *state, tx_sched_t *sched, const char *flag)
 {
-    char ch;
-    int i = 0;
-    
-    // zero the rx buffer
-    memset(buffer, 0, sizeof(buffer));
+    char item[LORA_SIZE];
+    char agg[ARQ_DATA_SIZE];
+    char item_flag[FLAG_SIZE];
+    char *first;
+    char *taken;
+    const char *next_item;
+    TX_CLASS first_cls;
+    TX_CLASS cls;
+    size_t item_len;
+    int header;
+    int len;
+    int next;
+    int items = 1;
+    int prefixes;
+
+    if (arq_window_full(state) || !(first = tx_receive(sched, &first_cls, &item_len)))
+        return 0;
 
-    while(uart_is_readable_within_us(UART_ID_LORA, timeout) && ch != '\n') 
+    len = aggAppend(agg, sizeof(agg), 0, flag, first);
+    while (len >= 0 && (next_item = tx_peek(sched, &cls, &item_len)))
     {
-        buffer[i++] = uart_getc(UART_ID_LORA);
+        next = aggAppend(agg, sizeof(agg), len, flag, next_item);
+        // the budget is for the frame as it goes on the air
+        if (next >= 0 && loraStuffedSize(agg, next) >= ARQ_DATA_SIZE)
+        {
+            agg[len] = '\0';
+            next = -1;
+        }
+        if (next < 0)
+            break;
+        // from the class peeked at: core 0 may have queued a higher item since
+        taken = tx_take(sched, cls, &item_len);
+        tx_release(sched, cls, taken);
+        len = next;
+        items++;
     }
-    buffer[i] = '\0';
-    
-    if(*buffer) 
-        printf("%s", buffer);
+
+    if (items == 1)
+    {
+        arq_queue(state, flag, first);
+        tx_release(sched, first_cls, first);
+        return 1;
+    }
+    tx_release(sched, first_cls, first);
+
+    arq_queue(state, "AGG", agg);
+
+    // on the air: one frame header instead of one per item, paid for with the "<n>:<flag> " prefixes
+    prefixes = len;
+    for (const char *cursor = agg; aggNext(&cursor, item_flag, item, sizeof(item)) == EXIT_SUCCESS; )
+        prefixes -= strlen(item);
+    header = formatFrame(item, sizeof(item), state->seq, state->ack, 0, flag, NULL, 0);
+    state->stats.agg_frames++;
+    state->stats.agg_items += items;
+    state->stats.agg_saved += (items - 1) * header - prefixes;
+    return items;
+}
+
+/**
+ * @brief Queues the next fragment of the oldest long $TXR message, if there is one and the window has room
+ * @param state the STATE for this communication instance
+ */
+static void fragmentQueue(STATE *state)
+{
+    uint8_t data[ARQ_DATA_SIZE];
+    size_t len;
+
+    if (arq_window_full(state) || !(len = frag_next(&txr_queue, data)))
+        return;
+    arq_queue_bytes(state, "FRG", data, len);
+}
+
+// an AT+SEND that failed only costs the frame; the ARQ retransmits it
+static void onSent(const at_command_t *cmd, AT_RESULT result, int error)
+{
+    if (result == AT_RESULT_ERR)
+        commError("LoRa send failed: +ERR=%d", error);
+    else if (result == AT_RESULT_TIMEOUT)
+        commError("LoRa send timed out");
+}
+
+/**
+ * @brief Wraps a formatted payload in AT+SEND and queues it for the LoRa module
+ * @param data payload from formatFrame()
+ * @return bool false if the module's command queue is full
+ */
+static bool frameTx(const char *data)
+{
+    char msg[AT_COMMAND_SIZE];
+    snprintf(msg, sizeof(msg), "AT+SEND=%d,%d,%s", GS_ADDRESS, (int)strlen(data), data);
+    return at_submit(&lora_modem, msg, LORA_SEND_TIMEOUT_MS, onSent, NULL);
 }
 
 /**
- * @brief Constructs a sendable message, then sends it to the ground station
+ * @brief Constructs a sendable control message (SYN/ACK/FIN), then sends it to the ground station
  * @param state the STATE for this communication instance
- * @param out data to be sent
+ * @param out flag to be sent
  */
 void msgTx(STATE *state, char *out) 
 {
     char data[LORA_SIZE]; 
-    char msg[260]; 
-    snprintf(data, sizeof(data), "%d %d %s", state->seq, state->ack, out);
-    snprintf(msg, sizeof(msg), "AT+SEND=%d,%d,%s\r\n", GS_ADDRESS, strlen(data), data);
-    write(msg);
+    formatFrame(data, sizeof(data), state->seq, state->ack, 0, out, NULL, 0);
+    frameTx(data);
 }
 
 /**
- * @brief Configures LoRa parameters
- * @param rx_buffer holds the incoming message
+ * @brief Takes the signal report off a +RCV line: +RCV=<address>,<length>,<data>,<rssi>,<snr>;
+ *        stuffed data has no ',' of its own, so they are the last two fields
+ * @param line the line
+ * @param rssi destination, dBm
+ * @param snr destination, dB
+ * @return int status; 0 = success; 1 = failure
  */
-int initLora(char *rx_buffer) {
-    
-    int status = 0;
-    
-    // flush rx fifo
-    read(rx_buffer, 1000000);
-    
-    // set network ID
-    write("AT+NETWORKID=5\r\n");
-    read(rx_buffer, 1000000);
-    status = strcmp(rx_buffer, "+OK\r\n");
-    if (status)
-    {
-        printf("$ERR failed to configure LoRa NETWORK ID\n");
+static int parseSignal(const char *line, int *rssi, int *snr)
+{
+    const char *field = strrchr(line, ',');
+
+    while (field && field > line && *--field != ',')
+        ;
+    if (!field || *field != ',' || sscanf(field, ",%d,%d", rssi, snr) != 2)
         return EXIT_FAILURE;
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Lines from the LoRa module that don't answer a command; a received frame
+ *        waits in ctx until comm_run() has passed it to protocol()
+ */
+static void onLoraLine(AT_LINE type, const char *line, size_t len, void *ctx)
+{
+    char *rx_buffer = ctx;
+    int rssi, snr;
+
+    switch (type)
+    {
+        case AT_LINE_RCV:
+            TRACE(TRACE_LORA_RCV, len);
+            memcpy(rx_buffer, line, len + 1);
+            if (!parseSignal(line, &rssi, &snr))
+                linkq_heard(&lora_quality, rssi, snr, get_absolute_time());
+            break;
+        case AT_LINE_READY:
+            commError("LoRa module restarted");
+            break;
+        default:
+            commError("unexpected line from LoRa: %s", line);
+            break;
     }
+}
+
+// records the first configuration command that fails
+static void onConfigured(const at_command_t *cmd, AT_RESULT result, int error)
+{
+    int *status = cmd->ctx;
+
+    if (result == AT_RESULT_OK)
+        return;
+    commError("failed to configure LoRa: %.*s -> %s %d", cmd->len - 2, cmd->text,
+              result == AT_RESULT_ERR ? "+ERR" : "timeout", error);
+    *status = EXIT_FAILURE;
+}
+
+// a rate the module refused leaves the two ends apart until both fall back, see linkq.h
+static void onRateSet(const at_command_t *cmd, AT_RESULT result, int error)
+{
+    if (result == AT_RESULT_OK)
+        return;
+    commError("LoRa rate change failed: %.*s -> %s %d", cmd->len - 2, cmd->text,
+              result == AT_RESULT_ERR ? "+ERR" : "timeout", error);
+}
+
+/**
+ * @brief Queues AT+PARAMETER for a rate; the module takes it after the command in progress
+ * @param rate index into lora_rates
+ */
+static void rateTx(int rate)
+{
+    char cmd[AT_COMMAND_SIZE];
+
+    linkq_format_rate(rate, cmd, sizeof(cmd));
+    if (!at_submit(&lora_modem, cmd, AT_CONFIG_TIMEOUT_MS, onRateSet, NULL))
+        commError("LoRa rate change not queued: %s", cmd);
+}
+
+/**
+ * @brief Configures LoRa parameters; sleeps until the module has answered, frames
+ *        that arrive meanwhile are kept by lora_modem's listener
+ * @return int status; 0 = success; 1 = failure
+ */
+int initLora(void) {
     
-    // set rover address
-    write("AT+ADDRESS=102\r\n");
-    read(rx_buffer, 1000000);
-    status = strcmp(rx_buffer, "+OK\r\n");
-    if (status)
-    {
-        printf("$ERR failed to configure LoRa ADDRESS\n");
+    int status = EXIT_SUCCESS;
+    char rate[AT_COMMAND_SIZE];
+    
+    // set network ID, rover address, then the base rate the ground station listens at
+    linkq_init(&lora_quality, get_absolute_time());
+    linkq_format_rate(LORA_RATE_BASE, rate, sizeof(rate));
+    if (!at_submit(&lora_modem, "AT+NETWORKID=5", AT_CONFIG_TIMEOUT_MS, onConfigured, &status) ||
+        !at_submit(&lora_modem, "AT+ADDRESS=102", AT_CONFIG_TIMEOUT_MS, onConfigured, &status) ||
+        !at_submit(&lora_modem, rate, AT_CONFIG_TIMEOUT_MS, onConfigured, &status))
         return EXIT_FAILURE;
+
+    while (at_busy(&lora_modem))
+    {
+        if (!at_poll(&lora_modem) && at_busy(&lora_modem))
+            best_effort_wfe_or_timeout(at_deadline(&lora_modem));
     }
 
-    return EXIT_SUCCESS;
+    return status;
+}
+
+/**
+ * @brief Gives up on the connection; the next pass through protocol() starts a new handshake
+ * @param state the STATE for this communication instance
+ */
+static void connectionLost(STATE *state)
+{
+    state->seq = 0;
+    state->ack = 0;
+    state->state = CLOSED;
+    arq_rtt_reset(state);
+    lora_link_stats.resets++;
+}
+
+/**
+ * @brief Back to the base rate, where the ground station goes too once it hears nothing;
+ *        a change in flight is forgotten
+ * @param state the STATE for this communication instance
+ * @param now the time
+ */
+static void rateFallback(STATE *state, absolute_time_t now)
+{
+    lora_quality.proposed = false;
+    if (lora_quality.rate == LORA_RATE_BASE)
+        return;
+    linkq_fallback(&lora_quality, now);
+    rateTx(LORA_RATE_BASE);
+    arq_rtt_reset(state);
+}
+
+/**
+ * @brief Moves the link to the rate its quality calls for, see linkq.h
+ * @param state the STATE for this communication instance
+ * @param now the time
+ * @return bool true while a change is waiting for the window to empty or to be acknowledged;
+ *         no new data goes out meanwhile
+ */
+static bool rateStep(STATE *state, absolute_time_t now)
+{
+    linkq_t *q = &lora_quality;
+    char data[LORA_SIZE];
+    int rate;
+
+    linkq_sent(q, state->stats.sent, state->stats.retransmits - state->stats.timeouts);
+    lora_link_stats.rate = q->rate;
+    lora_link_stats.rssi = (int16_t)(q->rssi / 16);
+    lora_link_stats.snr = (int16_t)(q->snr * 10 / 16);
+    lora_link_stats.per_pct = (uint8_t)(q->per * 100 / 65536);
+    lora_link_stats.rate_ups = q->ups;
+    lora_link_stats.rate_downs = q->downs;
+    lora_link_stats.fallbacks = q->fallbacks;
+
+    if (linkq_silent(q, now)) {
+        rateFallback(state, now);
+        return false;
+    }
+
+    // the ground station changed over once it acknowledged; so do we, unless a fallback came first
+    if (q->proposed) {
+        if (!arq_acked(state, q->proposal_seq))
+            return true;
+        q->proposed = false;
+        if (q->rate == q->proposal_from) {
+            rateTx(q->proposal_to);
+            // a slower rate would only time out on a round trip measured at the faster one
+            if (q->proposal_to < q->rate)
+                arq_rtt_reset(state);
+            linkq_set(q, q->proposal_to, now);
+        }
+        return false;
+    }
+
+    // proposed once nothing is in flight, so the ground station takes it as soon as it is heard
+    rate = linkq_choose(q, now);
+    if (rate != q->rate) {
+        if (state->base != state->seq)
+            return true;
+        snprintf(data, sizeof(data), "%d %d", q->rate, rate);
+        q->proposal_seq = state->seq;
+        q->proposal_from = q->rate;
+        q->proposal_to = (uint8_t)rate;
+        q->proposed = true;
+        arq_queue(state, "RAT", data);
+        return true;
+    }
+
+    // off the base rate, a quiet link must not look like a lost one
+    if (q->rate != LORA_RATE_BASE && state->base == state->seq &&
+        absolute_time_diff_us(q->heard, now) > (int64_t)LINKQ_KEEPALIVE_MS * 1000) {
+        arq_format_link(state, data, sizeof(data));
+        arq_queue(state, "ACK", data);
+    }
+    return false;
+}
+
+static absolute_time_t earliest(absolute_time_t a, absolute_time_t b)
+{
+    return absolute_time_diff_us(a, b) < 0 ? b : a;
+}
+
+/**
+ * @brief How long comm_run() may sleep if nothing arrives: bytes from the LoRa module
+ *        and messages from core 0 wake it earlier
+ * @param state the STATE for this communication instance
+ * @param timer handshake timeout
+ * @param report next link report
+ * @param tlm_timer next telemetry snapshot
+ */
+static absolute_time_t nextWake(const STATE *state, absolute_time_t timer, absolute_time_t report,
+                                absolute_time_t tlm_timer)
+{
+    absolute_time_t wake = at_deadline(&lora_modem);
+
+    if (state->state == CLOSED)
+        return nil_time;
+    if (state->state != ESTABLISHED)
+        return earliest(wake, timer);
+
+    // a full window only opens with an ACK, which wakes us anyway
+    if (!arq_window_full(state))
+        wake = earliest(wake, earliest(report, tlm_timer));
+    if (!at_busy(&lora_modem))
+        wake = earliest(wake, arq_next_deadline(state));
+    return wake;
 }
 
 /**
@@ -290,71 +858,143 @@ int initLora(char *rx_buffer) {
  */
 void comm_run()
 {
-    size_t buffer_size;
-    char rx_buffer[LORA_SIZE];
+    // the ARQ windows don't fit on core 1's stack
+    static STATE state;
+    char rx_buffer[FRAMER_LINE_SIZE];
     char tx_buffer[LORA_SIZE];
-    char ch;
-    int idx = 0;
+    char control[LORA_SIZE] = "";       // the last handshake message, sent again on a timeout
+    char data[LORA_SIZE];
     int status;
     int restart_connection = 0; 
-    absolute_time_t timer;
+    int tries;
+    COMM_STATE previous;
+    absolute_time_t timer = nil_time;
+    absolute_time_t control_sent = nil_time;
+    absolute_time_t report = nil_time;
+    absolute_time_t tlm_timer = nil_time;
+    static tlm_encoder_t tlm_encoder;
+    static tlm_publisher_t tlm_publisher;
+    telemetry_t tlm;
+    uint8_t tlm_data[TLM_MAX_SIZE];
+    size_t tlm_len;
+    bool more = false;                  // the modem has more for us right away
+    bool rate_change;                   // new data waits for it
 
     // initialize the communication instance
-    STATE state = {CLOSED, 0, 0};
-
-    // // configure UART for LORA
-    // status = configure_UART(UART_ID_LORA,
-    //                         BAUD_RATE_LORA,
-    //                         UART_TX_PIN_LORA, UART_RX_PIN_LORA,
-    //                         DATA_BITS_LORA, STOP_BITS_LORA, PARITY_LORA,
-    //                         on_UART_LORA_rx, 0);
-    // if (!status)
-    // {
-    //     printf("$ERR Failed to initialize UART for LoRa.");
-    //     // return EXIT_FAILURE;
-    // }
+    state.state = CLOSED;
+    state.seq = 0;
+    state.ack = 0;
+    arq_rtt_reset(&state);
+
+    // the UART itself is set up by core 0; take its interrupt here so the
+    // LoRa framer and TX ring are serviced on the core that uses them
+    *rx_buffer = '\0';
+    at_init(&lora_modem, &lora_tx, &lora_framer, onLoraLine, rx_buffer);
+    configure_UART_IRQ(UART_ID_LORA, on_UART_LORA_irq);
     
     // configure LoRa; if we fail, just kill this whole thread
-    status = initLora(rx_buffer);
+    status = initLora();
     if (status)
     {
-        printf("$ERR Failed to initialize LoRa. Killing LoRa core.\n");
+        commError("Failed to initialize LoRa. Killing LoRa core.");
         return;
     }
     
     while (1)
     { 
-        // poll rx fifo
-        read(rx_buffer, 1000);
-        // discard "+OK" messages
-        if(strcmp(rx_buffer, "+OK\r\n") == 0) continue;
+        // sleep until the LoRa UART, core 0 or the next deadline needs us
+        if(!more) stats_wait(nextWake(&state, timer, report, tlm_timer));
+        core_stats[1].passes++;
+
+        // answers to our commands, a received frame into rx_buffer, the next command's bytes
+        more = at_poll(&lora_modem);
+
         // check for valid data
         if(*rx_buffer || state.state == CLOSED) {
+            // a new connection starts at the base rate
+            if(state.state == CLOSED) rateFallback(&state, get_absolute_time());
+            previous = state.state;
+            tries = restart_connection;
             protocol(&state, rx_buffer, tx_buffer);
+            *rx_buffer = '\0';
             restart_connection = 0;
-            // check if there is something to send
+            // the SYN round trip is the first RTT sample, unless the SYN was repeated (Karn)
+            if(previous == SYNSENT && state.state == ESTABLISHED && !tries) {
+                arq_rtt_sample(&state, (uint32_t)absolute_time_diff_us(control_sent, get_absolute_time()));
+                report = make_timeout_time_ms(ARQ_REPORT_MS);
+            }
+            // sequence numbers start over, so do the telemetry references
+            if(previous == SYNSENT && state.state == ESTABLISHED) {
+                tlm_encoder_init(&tlm_encoder);
+                tlm_publisher_init(&tlm_publisher);
+                frag_restart(&txr_queue);
+            }
+            // check if there is a control message to send
             if(*tx_buffer) {
-                // send message
-                msgTx(&state, tx_buffer);
+                // send message; anything else heard meanwhile leaves it to be sent again
+                strcpy(control, tx_buffer);
+                msgTx(&state, control);
                 // start timeout timer
-                timer = make_timeout_time_ms(5000);
+                control_sent = get_absolute_time();
+                timer = delayed_by_us(control_sent, arq_rto(&state));
             }
-        } else {
-            // check for timeout
+        } else if(state.state != ESTABLISHED) {
+            // check for timeout on the handshake
             if(time_reached(timer)) {
                 restart_connection++;
+                arq_backoff(&state);
                 if(restart_connection >= 3) {
-                    state.seq = 0;
-                    state.ack = 0;
-                    state.state = CLOSED;
-                    printf("\nConnection terminated unsuccessfully\n");
+                    connectionLost(&state);
                 } else {
                     // retransmit last message
-                    msgTx(&state, tx_buffer);
+                    msgTx(&state, control);
                     // restart timer
-                    timer = make_timeout_time_ms(5000);
+                    timer = make_timeout_time_us(arq_rto(&state));
                 }
             }
         }
+
+        if(state.state != ESTABLISHED) continue;
+
+        // link timing for the ground station
+        if(time_reached(report) && !arq_window_full(&state)) {
+            arq_format_link(&state, data, sizeof(data));
+            arq_queue(&state, "ACK", data);
+            report = make_timeout_time_ms(ARQ_REPORT_MS);
+        }
+
+        // telemetry registers: a frame when one has a new value past its period, carrying only
+        // the fields that changed since a snapshot the ground station has; taken only once the
+        // frames before it are on the air, so a slow link sends fewer, fresher snapshots
+        if(time_reached(tlm_timer) && !arq_window_full(&state)) {
+            stats_tick(tlm_timer);
+            if(!arq_unsent(&state) && tlm_collect(&tlm_publisher, get_absolute_time(), &tlm)) {
+                tlm_len = tlm_encode(&tlm_encoder, &state, &tlm, tlm_data);
+                arq_queue_bytes(&state, "TLM", tlm_data, tlm_len);
+            }
+            tlm_timer = make_timeout_time_ms(TLM_POLL_MS);
+        }
+
+        deliver(&state);
+        lora_link_stats.retransmits = state.stats.retransmits;
+        rate_change = rateStep(&state, get_absolute_time());
+        // the module takes one AT+SEND at a time
+        if(at_busy(&lora_modem)) continue;
+
+        // data: once the radio is free, pack everything core 0 queued since the last frame
+        // into the next one, one AT+SEND at a time; long $TXR messages when there is nothing else,
+        // nothing new while a rate change is on its way
+        if(!rate_change && !arq_unsent(&state) && !aggregateQueue(&state, &transmit_queue, "ACK")) fragmentQueue(&state);
+
+        switch(arq_poll(&state, get_absolute_time(), tx_buffer, sizeof(tx_buffer))) {
+            case ARQ_SEND:
+                frameTx(tx_buffer);
+                break;
+            case ARQ_FAILED:
+                connectionLost(&state);
+                break;
+            case ARQ_IDLE:
+                break;
+        }
     }
 }
@@ -39,18 +39,29 @@ int configure_UART(uart_inst_t *UART_ID, uint BAUDRATE, uint TX_PIN, uint RX_PIN
 
     if (useIRQ)
     {
-        // Set up a RX interrupt
-        // We need to set up the handler first
-        // Select correct interrupt for the UART we are using
-        int UART_IRQ = UART_ID == uart0 ? UART0_IRQ : UART1_IRQ;
-
-        // And set up and enable the interrupt handlers
-        irq_set_exclusive_handler(UART_IRQ, IRQ_FUN);
-        irq_set_enabled(UART_IRQ, true);
-        
-        // Now enable the UART to send interrupts - RX only
-        uart_set_irq_enables(UART_ID, true, false);
+        configure_UART_IRQ(UART_ID, IRQ_FUN);
     }
 
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Installs an RX interrupt handler for a UART and enables it on the calling core
+ * 
+ * @param UART_ID   which UART (uart0, uart1) to use
+ * @param IRQ_FUN   the IRQ handler (function to call when something is received on UART)
+ */
+void configure_UART_IRQ(uart_inst_t *UART_ID, irq_handler_t IRQ_FUN)
+{
+    // Set up a RX interrupt
+    // We need to set up the handler first
+    // Select correct interrupt for the UART we are using
+    int UART_IRQ = UART_ID == uart0 ? UART0_IRQ : UART1_IRQ;
+
+    // And set up and enable the interrupt handlers
+    irq_set_exclusive_handler(UART_IRQ, IRQ_FUN);
+    irq_set_enabled(UART_IRQ, true);
+    
+    // Now enable the UART to send interrupts - RX only
+    uart_set_irq_enables(UART_ID, true, false);
+}
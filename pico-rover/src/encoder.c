@@ -0,0 +1,165 @@
+/**
+ * @file encoder.c
+ * @brief Quadrature decoding and velocity estimation for the wheel encoders
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include "../include/encoder.h"
+
+// general includes
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Count change for each transition, indexed by previous A/B << 2 | new A/B;
+ *        A leading B is forward. 0 for no change and for a skipped state
+ */
+const int8_t encoder_steps[16] = {
+    //  00  01  10  11      new
+         0, -1, +1,  0,  // from 00
+        +1,  0,  0, -1,  // from 01
+        -1,  0,  0, +1,  // from 10
+         0, +1, -1,  0,  // from 11
+};
+
+/**
+ * @brief Resets an encoder
+ *
+ * @param e the encoder
+ * @param pin_a GPIO of channel A
+ * @param pin_b GPIO of channel B
+ * @param pins current GPIO levels, as from gpio_get_all()
+ */
+void encoder_init(encoder_t *e, uint pin_a, uint pin_b, uint32_t pins)
+{
+    memset(e, 0, sizeof(*e));
+    e->pin_a = (uint8_t)pin_a;
+    e->pin_b = (uint8_t)pin_b;
+    e->state = (uint8_t)(((pins >> pin_a) & 1u) << 1 | ((pins >> pin_b) & 1u));
+}
+
+typedef struct snapshot
+{
+    int32_t count;
+    uint32_t stamp[4];
+    uint32_t line_us;
+    int8_t dir;
+    uint8_t run;
+} snapshot_t;
+
+/**
+ * @brief Copies what encoder_edge() writes, retrying if an edge is recorded meanwhile
+ */
+static void encoder_snapshot(const encoder_t *e, snapshot_t *s)
+{
+    uint32_t seq;
+
+    do
+    {
+        seq = __atomic_load_n(&e->seq, __ATOMIC_ACQUIRE);
+        s->count = e->count;
+        memcpy(s->stamp, (const void *)e->stamp, sizeof(s->stamp));
+        s->line_us = e->line_us;
+        s->dir = e->dir;
+        s->run = e->run;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1) || seq != __atomic_load_n(&e->seq, __ATOMIC_RELAXED));
+}
+
+/**
+ * @brief Consistent count and time of its last edge, from either core
+ *
+ * @param e the encoder
+ * @param count counts since encoder_init()
+ * @param edge_us time_us_32() of the last counted edge
+ */
+void encoder_read(const encoder_t *e, int32_t *count, uint32_t *edge_us)
+{
+    snapshot_t s;
+
+    encoder_snapshot(e, &s);
+    *count = s.count;
+    *edge_us = s.stamp[s.count & 3];
+}
+
+/**
+ * @brief counts/s << ENC_VEL_SHIFT for a number of counts over a time
+ */
+static int32_t rate(int32_t counts, uint32_t us)
+{
+    return (int32_t)(((int64_t)counts * 1000000 << ENC_VEL_SHIFT) / us);
+}
+
+/**
+ * @brief Updates the velocity estimate; call at a fixed period from one place
+ *
+ * @param e the encoder
+ * @param now_us time_us_32()
+ */
+void encoder_update(encoder_t *e, uint32_t now_us)
+{
+    snapshot_t s;
+    uint32_t last;
+    int32_t counts;
+    int32_t bound;
+
+    encoder_snapshot(e, &s);
+    last = s.stamp[s.count & 3];
+    counts = s.count - e->ref_count;
+
+    if (now_us - last >= ENC_STOP_US || !e->ref_valid)
+    {
+        // stopped; from a standstill the first edge only starts the measurement
+        e->velocity = 0;
+        e->ref_valid = counts && now_us - last < ENC_STOP_US;
+        e->ref_count = s.count;
+        e->ref_edge_us = last;
+        return;
+    }
+
+    if (counts >= 4 || counts <= -4)
+    {
+        // M/T over whole lines; the span ends at the last edge a multiple of 4 on from the reference
+        int32_t lines = counts - counts % 4;
+        int32_t end = e->ref_count + lines;
+        uint32_t end_us = s.stamp[end & 3];
+
+        // that stamp is the edge's own unless the wheel reversed since
+        if (end != s.count && (s.dir != (counts > 0 ? 1 : -1) || s.run <= (uint8_t)abs(counts - lines)))
+        {
+            end = s.count;
+            end_us = last;
+            lines = counts;
+        }
+        if (end_us != e->ref_edge_us)
+            e->velocity = rate(lines, end_us - e->ref_edge_us);
+        e->ref_count = end;
+        e->ref_edge_us = end_us;
+        return;
+    }
+
+    if (s.run >= 5)
+    {
+        // too few counts for M/T: the period of the last whole line, which can't be shorter
+        // than the time since the line in progress began
+        e->velocity = rate(4 * s.dir, s.line_us);
+        bound = rate(4, now_us - s.stamp[(s.count + s.dir) & 3]);
+    }
+    else
+    {
+        // starting or reversing: the counts so far, at most one count since the last edge
+        if (counts && last != e->ref_edge_us)
+            e->velocity = rate(counts, last - e->ref_edge_us);
+        bound = rate(1, now_us - last);
+    }
+    if (now_us == last)
+        return;
+    if (e->velocity > bound)
+        e->velocity = bound;
+    else if (e->velocity < -bound)
+        e->velocity = -bound;
+}
@@ -0,0 +1,305 @@
+/**
+ * @file frag.c
+ * @brief Fragmentation of long $TXR messages and their reassembly, see frag.h
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include "../include/frag.h"
+
+// general includes
+#include <stdlib.h>
+#include <string.h>
+
+// hardware includes
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+#include "../include/comms.h"
+#include "../include/varint.h"
+
+#define RING(pos)   ((pos) & (FRAG_TX_SIZE - 1))
+
+_Static_assert(ARQ_DATA_SIZE <= 255, "a fragment must fit an ARQ slot");
+
+static void ring_write(frag_tx_t *tx, uint32_t pos, const void *data, size_t len)
+{
+    size_t first = FRAG_TX_SIZE - RING(pos);
+
+    if (first > len)
+        first = len;
+    memcpy(&tx->buf[RING(pos)], data, first);
+    memcpy(tx->buf, (const uint8_t *)data + first, len - first);
+}
+
+/**
+ * @brief Empties the staging ring; before either core uses it
+ *
+ * @param tx the ring
+ */
+void frag_tx_init(frag_tx_t *tx)
+{
+    memset(tx, 0, sizeof(*tx));
+}
+
+/**
+ * @brief Core 0: appends a piece of a message; the last piece hands the whole message to core 1
+ *
+ * @param tx the ring
+ * @param data the piece
+ * @param len its length
+ * @param more true if more pieces of the same message follow
+ * @return status (EXIT_SUCCESS/EXIT_FAILURE if the message is refused: too long, no room, or refused before)
+ */
+int frag_append(frag_tx_t *tx, const void *data, size_t len, bool more)
+{
+    uint32_t tail = __atomic_load_n(&tx->tail, __ATOMIC_ACQUIRE);
+    uint32_t size;
+    uint8_t prefix[FRAG_LEN_SIZE];
+
+    if (tx->refusing)
+    {
+        tx->refusing = more;
+        return EXIT_FAILURE;
+    }
+
+    // a new message leaves room for its length
+    if (tx->open == tx->head)
+        tx->open += FRAG_LEN_SIZE;
+    size = tx->open - tx->head - FRAG_LEN_SIZE + (uint32_t)len;
+    if (size > FRAG_MAX_MESSAGE || tx->open + len - tail > FRAG_TX_SIZE)
+    {
+        tx->open = tx->head;
+        tx->refused++;
+        tx->refusing = more;
+        return EXIT_FAILURE;
+    }
+
+    ring_write(tx, tx->open, data, len);
+    tx->open += (uint32_t)len;
+    if (more)
+        return EXIT_SUCCESS;
+
+    prefix[0] = (uint8_t)size;
+    prefix[1] = (uint8_t)(size >> 8);
+    ring_write(tx, tx->head, prefix, sizeof(prefix));
+    tx->messages++;
+    __atomic_store_n(&tx->head, tx->open, __ATOMIC_RELEASE);
+    __sev();
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Core 0: whether a message is being appended, so the next piece belongs to it
+ */
+bool frag_appending(const frag_tx_t *tx)
+{
+    return tx->open != tx->head || tx->refusing;
+}
+
+/**
+ * @brief Core 1: bytes of whole messages waiting to be cut, length prefixes included
+ */
+uint32_t frag_pending(const frag_tx_t *tx)
+{
+    return __atomic_load_n(&tx->head, __ATOMIC_ACQUIRE) - tx->tail;
+}
+
+/**
+ * @brief Core 1: cuts the next fragment of the oldest message, as much as stuffs into one ARQ frame
+ *
+ * @param tx the ring
+ * @param out at least ARQ_DATA_SIZE bytes
+ * @return length of the fragment; 0 if there is no message
+ */
+size_t frag_next(frag_tx_t *tx, uint8_t *out)
+{
+    uint32_t head = __atomic_load_n(&tx->head, __ATOMIC_ACQUIRE);
+    uint32_t start, total, n;
+    size_t len, stuffed;
+    uint8_t b;
+
+    if (head == tx->tail)
+        return 0;
+
+    total = tx->buf[RING(tx->tail)] | (uint32_t)tx->buf[RING(tx->tail + 1)] << 8;
+    len = varint_put(tx->id, out);
+    len += varint_put(tx->offset, out + len);
+    len += varint_put(total, out + len);
+
+    // the budget is for the frame as it goes on the air, see arq_queue_bytes()
+    stuffed = loraStuffedSize(out, len);
+    start = tx->tail + FRAG_LEN_SIZE + tx->offset;
+    for (n = 0; tx->offset + n < total; n++)
+    {
+        b = tx->buf[RING(start + n)];
+        stuffed += loraStuffedSize(&b, 1);
+        if (stuffed >= ARQ_DATA_SIZE)
+            break;
+        out[len++] = b;
+    }
+    tx->offset += n;
+    tx->fragments++;
+
+    if (tx->offset == total)
+    {
+        tx->offset = 0;
+        tx->id++;
+        tx->sent++;
+        __atomic_store_n(&tx->tail, tx->tail + FRAG_LEN_SIZE + total, __ATOMIC_RELEASE);
+        __sev();
+    }
+    return len;
+}
+
+/**
+ * @brief Core 1: on a new connection, cuts the message it was on again from the start
+ */
+void frag_restart(frag_tx_t *tx)
+{
+    tx->offset = 0;
+}
+
+/**
+ * @brief Empties the reassembly buffers
+ *
+ * @param rx the reassembler
+ */
+void frag_rx_init(frag_rx_t *rx)
+{
+    memset(rx, 0, sizeof(*rx));
+}
+
+/**
+ * @brief Drops partial messages with no fragment for FRAG_TIMEOUT_MS
+ *
+ * @param rx the reassembler
+ * @param now the time
+ */
+void frag_expire(frag_rx_t *rx, absolute_time_t now)
+{
+    for (int i = 0; i < FRAG_SLOTS; i++)
+    {
+        if (rx->slot[i].used && absolute_time_diff_us(rx->slot[i].last, now) > (int64_t)FRAG_TIMEOUT_MS * 1000)
+        {
+            rx->slot[i].used = false;
+            rx->expired++;
+        }
+    }
+}
+
+// the buffer of message id; a new one if there is none, taking the one idle longest if all are in use
+static frag_slot_t *frag_slot(frag_rx_t *rx, uint16_t id, bool create)
+{
+    frag_slot_t *unused = NULL;
+    frag_slot_t *oldest = NULL;
+
+    for (int i = 0; i < FRAG_SLOTS; i++)
+    {
+        frag_slot_t *slot = &rx->slot[i];
+
+        if (!slot->used)
+        {
+            if (!unused)
+                unused = slot;
+        }
+        else if (slot->id == id)
+        {
+            return slot;
+        }
+        else if (!oldest || absolute_time_diff_us(slot->last, oldest->last) > 0)
+        {
+            oldest = slot;
+        }
+    }
+    if (!create)
+        return NULL;
+    if (!unused)
+    {
+        unused = oldest;
+        rx->evicted++;
+    }
+    unused->used = true;
+    unused->id = id;
+    return unused;
+}
+
+// the fragment header, see frag.h; the bytes start at *pos
+static int frag_parse(const uint8_t *in, size_t len, uint32_t *id, uint32_t *offset, uint32_t *total, size_t *pos)
+{
+    size_t n;
+
+    *pos = 0;
+    if (!(n = varint_get(in, len, id)))
+        return EXIT_FAILURE;
+    *pos += n;
+    if (!(n = varint_get(in + *pos, len - *pos, offset)))
+        return EXIT_FAILURE;
+    *pos += n;
+    if (!(n = varint_get(in + *pos, len - *pos, total)))
+        return EXIT_FAILURE;
+    *pos += n;
+
+    if (*id > UINT16_MAX || *total > FRAG_MAX_MESSAGE || *offset > *total || len - *pos > *total - *offset)
+        return EXIT_FAILURE;
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Takes one fragment, in the order the ARQ delivers them
+ *
+ * @param rx the reassembler
+ * @param data the fragment, an "FRG" frame's data
+ * @param len its length
+ * @param now the time
+ * @param message on FRAG_MESSAGE, the message; valid until the next call
+ * @param size on FRAG_MESSAGE, its length
+ * @return FRAG_EVENT
+ */
+FRAG_EVENT frag_receive(frag_rx_t *rx, const void *data, size_t len, absolute_time_t now,
+                        const uint8_t **message, size_t *size)
+{
+    const uint8_t *in = data;
+    uint32_t id, offset, total;
+    size_t pos, n;
+    frag_slot_t *slot;
+
+    frag_expire(rx, now);
+
+    // a message whose start never came can't be put together
+    if (frag_parse(in, len, &id, &offset, &total, &pos) ||
+        !(slot = frag_slot(rx, (uint16_t)id, offset == 0)))
+    {
+        rx->errors++;
+        return FRAG_ERROR;
+    }
+
+    if (offset == 0)
+    {
+        slot->total = total;
+        slot->len = 0;
+    }
+    else if (offset != slot->len || total != slot->total)
+    {
+        slot->used = false;
+        rx->errors++;
+        return FRAG_ERROR;
+    }
+
+    n = len - pos;
+    memcpy(slot->data + offset, in + pos, n);
+    slot->len += (uint32_t)n;
+    slot->last = now;
+    rx->fragments++;
+    if (slot->len < slot->total)
+        return FRAG_PARTIAL;
+
+    slot->used = false;
+    rx->messages++;
+    *message = slot->data;
+    *size = slot->total;
+    return FRAG_MESSAGE;
+}
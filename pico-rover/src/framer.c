@@ -0,0 +1,124 @@
+/**
+ * @file framer.c
+ * @brief Line assembly on top of the per-port byte rings filled by the RX interrupts
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include "../include/framer.h"
+
+// general includes
+#include <string.h>
+
+// hardware includes
+#include "pico/stdlib.h"
+
+#include "../include/definitions.h"
+
+/**
+ * @brief Resets a framer
+ *
+ * @param f the framer
+ * @param max_line longest line (without terminator) accepted before reporting an overflow;
+ *                 0 or anything that doesn't fit in FRAMER_LINE_SIZE means FRAMER_LINE_SIZE - 1
+ */
+void framer_init(line_framer_t *f, size_t max_line)
+{
+    memset(f, 0, sizeof(*f));
+    f->max_len = (max_line && max_line < FRAMER_LINE_SIZE) ? max_line : FRAMER_LINE_SIZE - 1;
+}
+
+/**
+ * @brief Producer side for a UART RX interrupt: empties the hardware FIFO into the ring
+ *
+ * Runs from RAM and does nothing but copy, so it is bounded by the 32-byte FIFO.
+ * Bytes are read even when the ring is full so the interrupt is cleared.
+ *
+ * @param f the framer
+ * @param uart the UART that raised the interrupt
+ */
+void __not_in_flash_func(framer_push_uart)(line_framer_t *f, uart_inst_t *uart)
+{
+    while (uart_is_readable(uart))
+        framer_push(f, (uint8_t)uart_getc(uart));
+}
+
+/**
+ * @brief Consumer side: assembles queued bytes into the next line
+ *
+ * Lines end at CR or LF; the terminator is not included and blank lines (e.g. the
+ * LF of a CRLF pair) are skipped. On FRAMER_OVERFLOW the partial line is returned
+ * for reporting and the rest of it, up to the next terminator, is thrown away.
+ *
+ * @param f the framer
+ * @param line set to the NUL-terminated line, valid until the next call
+ * @param len set to the length of the line
+ * @return FRAMER_EVENT
+ */
+FRAMER_EVENT framer_poll(line_framer_t *f, const char **line, size_t *len)
+{
+    uint32_t dropped = __atomic_load_n(&f->dropped, __ATOMIC_ACQUIRE);
+    uint32_t head = __atomic_load_n(&f->head, __ATOMIC_ACQUIRE);
+    bool gap = false;
+
+    while (f->tail != head)
+    {
+        // the producer lost bytes right here, so whatever line spans this point is corrupt
+        if (dropped != f->dropped_seen && f->tail == f->gap)
+        {
+            f->dropped_seen = dropped;
+            if (!f->discarding)
+            {
+                f->discarding = true;
+                gap = true;
+                break;
+            }
+        }
+
+        char ch = (char)f->ring[f->tail & (FRAMER_RING_SIZE - 1)];
+        __atomic_store_n(&f->tail, f->tail + 1, __ATOMIC_RELEASE);
+
+        if (ch == CR || ch == NL)
+        {
+            bool skip = f->discarding || !f->len;
+            f->discarding = false;
+            if (skip)
+            {
+                f->len = 0;
+                continue;
+            }
+
+            f->line[f->len] = '\0';
+            *line = f->line;
+            *len = f->len;
+            f->len = 0;
+            return FRAMER_LINE;
+        }
+
+        if (f->discarding)
+            continue;
+
+        if (f->len == f->max_len)
+        {
+            f->discarding = true;
+            gap = true;
+            break;
+        }
+
+        f->line[f->len++] = ch;
+    }
+
+    if (gap)
+    {
+        f->line[f->len] = '\0';
+        *line = f->line;
+        *len = f->len;
+        f->len = 0;
+        return FRAMER_OVERFLOW;
+    }
+
+    return FRAMER_EMPTY;
+}
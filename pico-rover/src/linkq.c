@@ -0,0 +1,246 @@
+/**
+ * @file linkq.c
+ * @brief LoRa link quality and the data rate chosen from it, see linkq.h
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include "../include/linkq.h"
+
+// general includes
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// hardware includes
+#include "pico/stdlib.h"
+
+// SF10 at 125 kHz is the most robust that still carries a full frame in
+// about 2 s; the module's own default, SF12, takes over 8. Floors are the
+// demodulator's for the spreading factor, plus 10 log10(bandwidth / 125 kHz)
+// for the noise a wider receiver lets in.
+const lora_rate_t lora_rates[LORA_RATES] = {
+    { 10, 7, 1, 4, -150 },
+    {  9, 7, 1, 4, -125 },
+    {  8, 7, 1, 4, -100 },
+    {  7, 7, 1, 4,  -75 },
+    {  7, 9, 1, 4,  -15 },
+};
+
+// the module's bandwidth codes 0 to 9
+static const uint32_t bandwidth_hz[] = { 7800, 10400, 15600, 20800, 31250, 41700, 62500, 125000, 250000, 500000 };
+
+// 10 log10(bandwidth / 125 kHz) in 0.1 dB, for the codes of the ladder
+static int bandwidth_db10(uint8_t bw)
+{
+    return bw == 9 ? 60 : bw == 8 ? 30 : 0;
+}
+
+/**
+ * @brief Starts at LORA_RATE_BASE with no samples
+ *
+ * @param q the link
+ * @param now the time
+ */
+void linkq_init(linkq_t *q, absolute_time_t now)
+{
+    memset(q, 0, sizeof(*q));
+    q->rate = LORA_RATE_BASE;
+    q->heard = now;
+    q->changed = now;
+    q->hold = now;
+}
+
+/**
+ * @brief Takes the RSSI and SNR of a frame heard, as +RCV reports them
+ *
+ * @param q the link
+ * @param rssi dBm
+ * @param snr dB at the current rate's bandwidth
+ * @param now the time
+ */
+void linkq_heard(linkq_t *q, int rssi, int snr, absolute_time_t now)
+{
+    // in 1/16 dB, read as if at 125 kHz
+    int32_t rssi16 = rssi * 16;
+    int32_t snr16 = snr * 16 + bandwidth_db10(lora_rates[q->rate].bw) * 16 / 10;
+
+    if (!q->primed)
+    {
+        q->rssi = rssi16;
+        q->snr = snr16;
+        q->primed = true;
+    }
+    else
+    {
+        q->rssi += (rssi16 - q->rssi) / (1 << LINKQ_EWMA_SHIFT);
+        q->snr += (snr16 - q->snr) / (1 << LINKQ_EWMA_SHIFT);
+    }
+    q->samples++;
+    q->heard = now;
+}
+
+/**
+ * @brief Takes the ARQ's counters: each data frame sent since the last call is a sample, 1 for
+ *        as many as were lost
+ *
+ * @param q the link
+ * @param sent ARQ_STATS sent
+ * @param lost ARQ_STATS retransmits less timeouts: frames the peer's acknowledgements showed lost
+ */
+void linkq_sent(linkq_t *q, uint32_t sent, uint32_t lost)
+{
+    uint32_t frames = sent - q->sent;
+    uint32_t again = lost - q->lost;
+
+    // a new connection's counters don't start over, so they can only grow
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        int32_t sample = i < again ? 65536 : 0;
+        q->per += (sample - (int32_t)q->per) / (1 << LINKQ_EWMA_SHIFT);
+    }
+    q->sent = sent;
+    q->lost = lost;
+}
+
+/**
+ * @brief The rate the link should be at, see linkq.h
+ *
+ * @param q the link
+ * @param now the time
+ * @return the current rate if it should stay, else one step up or down
+ */
+int linkq_choose(const linkq_t *q, absolute_time_t now)
+{
+    int snr = q->snr * 10 / 16;
+
+    if (q->samples < LINKQ_SAMPLES)
+        return q->rate;
+
+    if (q->rate > LORA_RATE_BASE &&
+        (snr < lora_rates[q->rate].snr_floor + LINKQ_DOWN_MARGIN_DB * 10 || q->per > LINKQ_PER_DOWN))
+        return q->rate - 1;
+
+    if (q->rate + 1 < LORA_RATES && snr >= lora_rates[q->rate + 1].snr_floor + LINKQ_UP_MARGIN_DB * 10 &&
+        q->per < LINKQ_PER_UP && absolute_time_diff_us(q->hold, now) >= 0)
+        return q->rate + 1;
+
+    return q->rate;
+}
+
+// the module is at rate from now on: its samples and resend rate start over
+static void linkq_switch(linkq_t *q, int rate, absolute_time_t now)
+{
+    q->rate_us[q->rate] += absolute_time_diff_us(q->changed, now);
+    q->rate = (uint8_t)rate;
+    q->samples = 0;
+    q->per = 0;
+    q->changed = now;
+    // nothing heard yet is no reason to fall back before LINKQ_SILENCE_MS at the new rate
+    q->heard = now;
+}
+
+/**
+ * @brief Records that the module is now at rate, after both ends agreed on it
+ *
+ * @param q the link
+ * @param rate index into lora_rates
+ * @param now the time
+ */
+void linkq_set(linkq_t *q, int rate, absolute_time_t now)
+{
+    if (rate == q->rate)
+        return;
+
+    if (rate > q->rate)
+    {
+        q->ups++;
+        q->hold = delayed_by_ms(now, LINKQ_HOLD_MS);
+    }
+    else
+    {
+        q->downs++;
+        q->hold = delayed_by_ms(now, LINKQ_DOWN_HOLD_MS);
+    }
+    linkq_switch(q, rate, now);
+}
+
+/**
+ * @brief Whether the link is off the base rate and has heard nothing for LINKQ_SILENCE_MS
+ */
+bool linkq_silent(const linkq_t *q, absolute_time_t now)
+{
+    return q->rate != LORA_RATE_BASE && absolute_time_diff_us(q->heard, now) > (int64_t)LINKQ_SILENCE_MS * 1000;
+}
+
+/**
+ * @brief Back to LORA_RATE_BASE without a word with the other end, and held there LINKQ_FALLBACK_HOLD_MS
+ *
+ * @param q the link
+ * @param now the time
+ */
+void linkq_fallback(linkq_t *q, absolute_time_t now)
+{
+    if (q->rate == LORA_RATE_BASE)
+        return;
+
+    linkq_switch(q, LORA_RATE_BASE, now);
+    q->fallbacks++;
+    q->hold = delayed_by_ms(now, LINKQ_FALLBACK_HOLD_MS);
+    q->proposed = false;
+}
+
+/**
+ * @brief The module's command for a rate
+ *
+ * @param rate index into lora_rates
+ * @param out destination
+ * @param size size of out
+ * @return length of the command
+ */
+int linkq_format_rate(int rate, char *out, size_t size)
+{
+    const lora_rate_t *r = &lora_rates[rate];
+
+    return snprintf(out, size, "AT+PARAMETER=%u,%u,%u,%u", r->sf, r->bw, r->cr, r->preamble);
+}
+
+/**
+ * @brief The rate with this spreading factor and bandwidth code
+ *
+ * @return index into lora_rates; -1 if it isn't on the ladder
+ */
+int linkq_find_rate(int sf, int bw)
+{
+    for (int i = 0; i < LORA_RATES; i++)
+    {
+        if (lora_rates[i].sf == sf && lora_rates[i].bw == bw)
+            return i;
+    }
+    return -1;
+}
+
+/**
+ * @brief Time on the air of a payload at a rate: explicit header, CRC on, low data rate
+ *        optimisation where a symbol takes over 16 ms, as in Semtech's AN1200.13
+ *
+ * @param rate the setting
+ * @param len payload bytes
+ * @return microseconds
+ */
+uint32_t lora_airtime_us(const lora_rate_t *rate, size_t len)
+{
+    uint32_t hz = bandwidth_hz[rate->bw < sizeof(bandwidth_hz) / sizeof(bandwidth_hz[0]) ? rate->bw : 7];
+    uint64_t chips = 1ull << rate->sf;
+    int de = chips * 1000000 / hz > 16000;
+    int num = 8 * (int)len - 4 * rate->sf + 28 + 16;
+    int den = 4 * (rate->sf - 2 * de);
+    int payload = 8 + (num > 0 ? (num + den - 1) / den * (rate->cr + 4) : 0);
+    // in quarter symbols: the preamble ends with 4.25 of them
+    uint64_t quarters = 4 * (uint64_t)rate->preamble + 17 + 4 * (uint64_t)payload;
+
+    return (uint32_t)(quarters * chips * 1000000 / (4 * (uint64_t)hz));
+}
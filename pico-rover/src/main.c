@@ -2,48 +2,145 @@
 #include "../include/definitions.h"
 #include "../include/comms.h"
 #include "../include/motors.h"
+#include "../include/mtrbox.h"
 #include "../include/config.h"
+#include "../include/commands.h"
+#include "../include/framer.h"
+#include "../include/nmea.h"
+#include "../include/stats.h"
+#include "../include/tlmreg.h"
+#include "../include/trace.h"
+#include "../include/usblink.h"
+
+// periodic core 0 work: telemetry for core 1
+#define CORE0_TICK_MS       20
+// GPS sentences decoded per pass of the main loop before commands are checked again
+#define GPS_LINES_PER_PASS  4
+// battery: VSYS through the Pico board's 1/3 divider; a pack above 5.5 V needs a divider of its own
+#define BATTERY_ADC_GPIO    29
+#define BATTERY_ADC_INPUT   3
+#define BATTERY_DIVIDER     3
+#define BATTERY_FILTER      4           // shift of the reading's exponential average
+
+// input framers; filled by the RX interrupts, drained by the main loop
+static line_framer_t gps_framer;
+
+static nmea_decoder_t gps_decoder;
 
 /**
- * @brief RX interrupt for GPS over UART, blocks until message is terminated
+ * @brief RX interrupt for GPS over UART; only moves bytes into the GPS framer
  * 
  */
 void on_UART_GPS_rx()
 {
-    // printf("HERE");
-    char buffer[83];    // max size of NMEA sentence is 82 bytes (according to NMEA-0183) + 1 for termination (\0)
-    int idx = 0;
-    while (uart_is_readable(UART_ID_GPS)) // TODO: replace with timeout version?
+    framer_push_uart(&gps_framer, UART_ID_GPS);
+}
+
+/**
+ * @brief Runs a framed GPS sentence through the NMEA decoder and updates the latest-fix register
+ * 
+ * @param line the sentence, without its terminator
+ * @param len length of line
+ */
+static void gps_decode_line(const char *line, size_t len)
+{
+    NMEA_SENTENCE type;
+
+    for (size_t i = 0; i < len; i++)
     {
-        // printf("HERE 2");
-        uint8_t ch = uart_getc(UART_ID_GPS); 
-        while (ch != ENDSTDIN)
-        {
-            buffer[idx++] = ch;
+        nmea_feed(&gps_decoder, line[i]);
+    }
+    type = nmea_feed(&gps_decoder, NL);
 
-            // if the string ends or we run out of space, we're done with this string
-            if (ch == CR || ch == NL || idx == (sizeof(buffer)-1))
-            {
-                buffer[idx] = 0; // terminate the string
-                idx = 0;    // reset index
-                // printf("This is the string I received: %s\n", in_string);
-                
-                break;
-            }
-            ch = uart_getc(UART_ID_GPS);
+    if (type != NMEA_NONE && type != NMEA_OTHER)
+    {
+        gps_fix_store(&gps_latest_fix, &gps_decoder.fix);
+    }
+}
 
-        }
-        // printf("HERE 3");
-        // don't send empty buffers
-        if (strlen(buffer) > 1)
-        {
-            printf("$GPS %s\n", buffer);
-        }
+/**
+ * @brief Sends the latest fix to the SBC when it changed, or every GPS_FIX_HEARTBEAT_MS if it didn't
+ * 
+ */
+static void gps_publish_fix()
+{
+    static uint32_t published_version;
+    static gps_fix_t published;
+    static absolute_time_t heartbeat;
+
+    gps_fix_t fix;
+    char out[96];
+    uint32_t version = gps_fix_load(&gps_latest_fix, &fix);
+
+    if (version == published_version)
+        return;
+    published_version = version;
+
+    if (!gps_fix_differs(&fix, &published) && !time_reached(heartbeat))
+        return;
+
+    if (usb_mode == USB_MODE_BINARY)
+    {
+        usb_send(BIN_MSG_FIX, &fix, sizeof(fix));
+    }
+    else
+    {
+        gps_fix_format(&fix, out, sizeof(out));
+        printf("%s", out);
     }
+    published = fix;
+    heartbeat = make_timeout_time_ms(GPS_FIX_HEARTBEAT_MS);
+}
 
-    // printf("HERE 4");
+/**
+ * @brief Updates core 0's telemetry registers: wheel speeds, battery voltage and status flags; a
+ *        register's version moves only when its value does, so core 1 sends only what changed
+ *
+ * @param wdt_reset whether this boot was a watchdog reset
+ */
+static void tlm_update(bool wdt_reset)
+{
+    static int32_t battery_avg = -1;    // ADC reading << BATTERY_FILTER
+    int32_t value[TLM_REG_SIZE] = { 0 };
+    MOTOR_MODE mode = get_motor_mode();
+    float left = get_vel_left() * 10;
+    float right = get_vel_right() * 10;
+    int32_t raw;
+
+    value[0] = (int32_t)(left < 0 ? left - 0.5f : left + 0.5f);
+    value[1] = (int32_t)(right < 0 ? right - 0.5f : right + 0.5f);
+    tlm_reg_store(&tlm_wheels, value);
+
+    raw = adc_read();
+    if (battery_avg < 0)
+        battery_avg = raw << BATTERY_FILTER;
+    battery_avg += raw - (battery_avg >> BATTERY_FILTER);
+    // 3.3 V full scale over 12 bits, rounded to TLM_BATTERY_STEP_MV
+    value[0] = (int32_t)((int64_t)battery_avg * 3300 * BATTERY_DIVIDER / (4096 << BATTERY_FILTER));
+    value[0] = (value[0] + TLM_BATTERY_STEP_MV / 2) / TLM_BATTERY_STEP_MV * TLM_BATTERY_STEP_MV;
+    value[1] = 0;
+    tlm_reg_store(&tlm_battery, value);
+
+    value[0] = (mode == MOTOR_MODE_PWM || mode == MOTOR_MODE_VELOCITY ? TLM_STATUS_DRIVING : 0) |
+               (mode == MOTOR_MODE_VELOCITY ? TLM_STATUS_VELOCITY : 0) |
+               (mode == MOTOR_MODE_FAILSAFE ? TLM_STATUS_FAILSAFE : 0) |
+               (wdt_reset ? TLM_STATUS_WDT_RESET : 0);
+    tlm_reg_store(&tlm_status, value);
 }
 
+/**
+ * @brief GPS counters for the statistics snapshot; core 0 only
+ *
+ * @param sentences valid sentences decoded
+ * @param rejected sentences the decoder threw away
+ * @param dropped bytes lost with the GPS RX ring full
+ */
+void get_gps_stats(uint32_t *sentences, uint32_t *rejected, uint32_t *dropped)
+{
+    *sentences = gps_decoder.sentences;
+    *rejected = gps_decoder.rejected;
+    *dropped = __atomic_load_n(&gps_framer.dropped, __ATOMIC_ACQUIRE);
+}
 
 static absolute_time_t tach_interrupt_stamp = 0;
 static int revolutions = 0;
@@ -65,127 +162,30 @@ void tachometer_callback(uint gpio, uint32_t events)
 }
 
 /**
- * @brief RX interrupt for LORA over UART, blocks until message is terminated
+ * @brief Interrupt for LORA over UART; only moves bytes into the LoRa framer and
+ *        out of the LoRa TX ring
  * 
  */
-void on_UART_LORA_rx()
+void on_UART_LORA_irq()
 {
-    // // larger than the max size of a LoRa transmission
-    char buffer[255];
-    int idx = 0;
-    int status;
-    char ch;
-    
-    // 0 if no bytes available, otherwise the size
-    // int size = uart_is_readable(UART_ID_LORA);
-    // printf("THIS IS THE SIZE I GOT RIGHT HERE, JOSH: %d\n", size);
-    // if (size)
-    // {
-    //     // make sure to completely read the UART before allowing interrupts
-    //     uart_read_blocking(UART_ID_LORA, buffer, LORA_SIZE);
-    //     printf("Received this buffer from LORA: %s\n", buffer);
-    //     handle_input(buffer);
-    // }
-    // printf("$LRA %s\n", buffer);
-
-    ch = getchar_timeout_us(0);
-    while (ch != ENDSTDIN)
-        {
-            buffer[idx++] = ch;
-
-            // if the string ends or we run out of space, we're done with this string
-            if (ch == CR || ch == NL || idx == (sizeof(buffer)-1))
-            {
-                buffer[idx] = 0; // terminate the string
-                idx = 0;    // reset index
-                // printf("This is the string I received: %s\n", buffer);
-                
-                status = handle_input(buffer);
-                if (status)
-                {
-                    printf("Failed to process string: %s\n", buffer);
-                }
-                break;
-            }
-
-            ch = getchar_timeout_us(0);
-    }
-    // printf("$LRA %s\n", buffer);
-
+    framer_push_uart(&lora_framer, UART_ID_LORA);
+    tx_ring_drain(&lora_tx);
 }
 
 /**
  * @brief   process a given string, dispatch based on contents
  * 
- * @param in the input string
+ * @param in the input string; not modified, so it is safe to call from either core
  * @return status of input handling (EXIT_SUCCESS/EXIT_FAILURE)
  */
-int handle_input(char *in)
+int handle_input(const char *in)
 {
-    // for tokenizing input string
-    char * delim = " ";
-    char * token;
-
-    int seq;
+    command_t cmd;
 
-    // for $MTR commands
-    bool dir1, dir2;
-    int8_t pwm1, pwm2;
-
-    // tokenize string (strtok modifies the original string)
-    token = strtok(in, delim);
-    // printf("Got this as first token: %s\n", token);
-
-    // "switch" on first token == message type
-    // ACK messages are used for confirmation that sent data was received
-    if (strcmp(token, MSG_ACK) == 0)
-    {
-        // check the seq number
-        token = strtok(NULL, delim);
-        printf("Next token: %s", token);
-        seq = atoi(token);
-        printf("Got an ACK message. SEQ: %d\n", seq);
-        return EXIT_SUCCESS;
-    }
-    // CMD messages come from the GS, are to be passed up to the SBC with printf
-    else if (strcmp(token, MSG_CMD) == 0)
-    {        
-        token = strtok(NULL, "");
-        // to avoid having to copy the string, just re-adding '$CMD' manually
-        printf("$CMD %s\n", token);
-        return EXIT_SUCCESS;
-    }
-    // MTR messages are used for PWM commands through the Pico
-    else if (strcmp(token, MSG_MOTORS) == 0)
-    {
-        // unpack message to vars
-        token = strtok(NULL, delim);
-        dir1 = (strcmp(token, "0") != 0);   // DIR1
-        token = strtok(NULL, delim);
-        pwm1 = atoi(token);                 // PWM1
-        token = strtok(NULL, delim);
-        dir2 = (strcmp(token, "0") != 0);   // DIR2
-        token = strtok(NULL, delim);
-        pwm2 = atoi(token);                 // PWM2
-
-        printf("DIR1: %d\nPWM1: %d\nDIR2: %d\nPWM2: %d\n", dir1, pwm1, dir2, pwm2);
-        set_PWM(dir1, pwm1, dir2, pwm2);
-        return EXIT_SUCCESS;
-    }
-    else if (strcmp(token, MSG_REQ) == 0)
-    {
-        // will depend
-        return EXIT_SUCCESS;
-    }
-    // TX messages are from the SBC, meant to be transmitted on LORA to the GS
-    else if (strcmp(token, MSG_TX) == 0)
-    {
-        // transmit over UART
-        return EXIT_SUCCESS;
-    }
+    if (parse_command(in, &cmd))
+        return EXIT_FAILURE;
 
-    // something went wrong
-    return EXIT_FAILURE;
+    return dispatch_command(&cmd);
 }
 
 /**
@@ -201,16 +201,30 @@ int main()
     // queue_t transmit_queue;
 
     // STDIN/STDOUT IO
-    char ch;
-    int idx;
-    char in_string[255];
-    char out_string[255];
-    char received_data[LORA_SIZE];
-    char sent_data[LORA_SIZE] = "data";
+    const char *line;
+    size_t len;
+    FRAMER_EVENT event;
+    char *received_data;
+    size_t received_len;
+    int gps_lines;
+    uint32_t failsafes = 0;
+    bool wdt_reset = watchdog_caused_reboot();
+    absolute_time_t tick;
     int status;
 
     sleep_ms(2000);
 
+    if (wdt_reset)
+        printf("$ERR Reset by the watchdog: the motor control loop stopped.\n");
+
+    // framers must be ready before their interrupts are enabled
+    trace_init();
+    framer_init(&gps_framer, NMEA_SIZE - 1);
+    usb_link_init();
+    framer_init(&lora_framer, 0);
+    tx_ring_init(&lora_tx, UART_ID_LORA);
+    nmea_init(&gps_decoder);
+
     // configure UART for GPS
     status = configure_UART(UART_ID_GPS,
                             BAUD_RATE_GPS,
@@ -228,7 +242,7 @@ int main()
                             BAUD_RATE_LORA,
                             UART_TX_PIN_LORA, UART_RX_PIN_LORA,
                             DATA_BITS_LORA, STOP_BITS_LORA, PARITY_LORA,
-                            on_UART_LORA_rx, 0);
+                            on_UART_LORA_irq, 0);
     if (status)
     {
         printf("$ERR Failed to initialize UART for LoRa.\n");
@@ -236,8 +250,14 @@ int main()
     }
 
     // init inter-core queues
-    queue_init(&receive_queue, LORA_SIZE, 5);
-    queue_init(&transmit_queue, LORA_SIZE, 5);
+    msg_channel_init(&receive_queue);
+    msg_channel_init(&error_queue);
+    tx_sched_init(&transmit_queue);
+    frag_tx_init(&txr_queue);
+    mtrbox_init(&motor_mailbox);
+    // faults go to the ground station too, ahead of any telemetry
+    if (wdt_reset)
+        tx_send_text(&transmit_queue, TX_CONTROL, "$ERR Reset by the watchdog");
     // Start core 1 - Do this before any interrupt configuration
     multicore_launch_core1(comm_run); 
 
@@ -253,53 +273,98 @@ int main()
     // gpio_set_dir(28, GPIO_IN);
     // gpio_set_irq_enabled_with_callback(28, GPIO_IRQ_EDGE_FALL, true, &tachometer_callback);
 
-    // configure encoder interrupts
-    // gpio_set_irq_enabled_with_callback(20, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, true, &right_enc_callback);
-    // gpio_set_irq_enabled(21, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, true);
+    // configure encoder interrupts; they are taken on core 0, away from the LoRa link
+    configure_encoders();
+
+    // battery voltage for telemetry; nothing else uses the ADC, so its input stays selected
+    adc_init();
+    adc_gpio_init(BATTERY_ADC_GPIO);
+    adc_select_input(BATTERY_ADC_INPUT);
+
+    // wheel speed control runs from a timer interrupt on core 0
+    status = configure_motor_control(MOTOR_CTL_HZ);
+    if (status)
+    {
+        printf("$ERR Failed to start the motor control loop.\n");
+    }
+    else
+    {
+        // the loop feeds it: if the timer ever stops, the chip resets and the PWM outputs come up off
+        watchdog_enable(MOTOR_WATCHDOG_MS, true);
+    }
+
     // configure status LED
     // gpio_init(LED_PIN);
     // gpio_set_dir(LED_PIN, GPIO_OUT);
 
-    // spin
+    // event loop: handle whatever is ready, then sleep until something else is
+    tick = get_absolute_time();
     while (1)
     {
-        if (queue_try_remove(&receive_queue, received_data)) 
+        core_stats[0].passes++;
+
+        // commands first
+        while ((received_data = msg_receive(&receive_queue, &received_len))) 
         {
-            // everything from CORE 1 is a $CMD
+            // everything from CORE 1 is a $CMD; dispatch it as one without re-parsing
             // printf("CORE 0 RECEIVED DATA: %s\n", received_data); 
-            char cmd[LORA_SIZE] = "$CMD ";
-            strcat(cmd, received_data);
-            handle_input(cmd);
+            command_t cmd = { .tag = MSG_CMD, .text = { received_data, received_len } };
+            TRACE(TRACE_CMD_DISPATCH, received_len);
+            dispatch_command(&cmd);
+            msg_release(&receive_queue, received_data);
         }
-        if (!queue_try_add(&transmit_queue, sent_data)) 
+        // core 1's errors, in whichever mode the USB link is in
+        while ((received_data = msg_receive(&error_queue, &received_len)))
         {
-            printf("$ERR Failed to add data to transmit queue: %s\n", sent_data); 
+            usb_error("%.*s", (int)received_len, received_data);
+            msg_release(&error_queue, received_data);
         }
-        // attempt to read char from stdin
-        // no timeout makes it non-blocking
-        ch = getchar_timeout_us(0);
-        while (ch != ENDSTDIN)
-        {
-            in_string[idx++] = ch;
+        // commands from the SBC
+        usb_link_poll();
+        // then the newest motor command from either link; a burst of them is applied once
+        apply_motor_commands();
 
-            // if the string ends or we run out of space, we're done with this string
-            if (ch == CR || ch == NL || idx == (sizeof(in_string)-1))
+        // a burst of GPS sentences is decoded a few per pass, so it can't hold up a command
+        for (gps_lines = 0; gps_lines < GPS_LINES_PER_PASS; gps_lines++)
+        {
+            event = framer_poll(&gps_framer, &line, &len);
+            if (event == FRAMER_EMPTY)
             {
-                in_string[idx] = 0; // terminate the string
-                idx = 0;    // reset index
-                
-                status = handle_input(in_string);
-                if (status)
-                {
-                    printf("$ERR Failed to process string: %s\n", in_string);
-                }
                 break;
             }
+            if (event == FRAMER_OVERFLOW)
+            {
+                usb_error("GPS sentence too long, discarded");
+            }
+            else
+            {
+                gps_decode_line(line, len);
+            }
+        }
+        gps_publish_fix();
 
-            ch = getchar_timeout_us(0);
+        if (time_reached(tick))
+        {
+            if (get_failsafe_count() != failsafes)
+            {
+                failsafes = get_failsafe_count();
+                tx_send_text(&transmit_queue, TX_CONTROL, "$ERR Command timeout: motors stopped");
+            }
+            // telemetry is only the newest value of each register; core 1 sends what changed
+            tlm_update(wdt_reset);
+            stats_tick(tick);
+            tick = delayed_by_ms(tick, CORE0_TICK_MS);
+            if (time_reached(tick))
+            {
+                tick = make_timeout_time_ms(CORE0_TICK_MS);
+            }
         }
 
-        sleep_ms(20);
-        // tight_loop_contents();
+        // sleep until an interrupt (USB, GPS), core 1's doorbell or the next tick; anything
+        // that arrived since it was polled above has set the event latch, so WFE returns at once
+        if (gps_lines < GPS_LINES_PER_PASS)
+        {
+            stats_wait(tick);
+        }
     }
 }
@@ -18,9 +18,48 @@
 
 // hardware includes
 #include "hardware/pwm.h"
+#include "hardware/sync.h"
+#include "hardware/watchdog.h"
 #include "pico/stdlib.h"
 
 #include "motors.h"
+#include "encoder.h"
+
+// output per (counts/s << ENC_VEL_SHIFT), from PWM levels per count/s
+#define VEL_GAIN(x)         PID_GAIN((x) / (1 << ENC_VEL_SHIFT))
+
+// tuned against the plant model in host/bench/sim_motor.c: full PWM is about WHEEL_MAX_RPM unloaded
+const pid_gains_t wheel_gains = {
+    .kp = VEL_GAIN(6.0),
+    .ki = VEL_GAIN(60.0),
+    .kd = 0,
+    .kff = VEL_GAIN((double)PWM_WRAP / (WHEEL_MAX_RPM * ENC_COUNTS_PER_REV / 60)),
+    .kstatic = 150,
+};
+
+static encoder_t left_encoder;
+static encoder_t right_encoder;
+
+// written by the command handlers with interrupts off, read by the control loop
+static volatile MOTOR_MODE motor_mode = MOTOR_MODE_STOPPED;
+static volatile int32_t left_setpoint;      // counts/s << ENC_VEL_SHIFT
+static volatile int32_t right_setpoint;
+static volatile uint32_t command_us;        // time_us_32() of the last set_PWM() or set_velocity()
+static volatile uint32_t command_timeout_us = MOTOR_CMD_TIMEOUT_MS * 1000;
+
+// PWM levels last written, negative in reverse; the failsafe ramps down from these
+static int32_t left_level;
+static int32_t right_level;
+static int32_t ramp_step;
+
+static pid_ctl_t left_pid;
+static pid_ctl_t right_pid;
+static repeating_timer_t control_timer;
+static bool control_running;
+static uint32_t control_period_us;
+static uint32_t control_last_start;
+static motor_ctl_stats_t control_stats;
+static volatile uint32_t failsafes_total;   // never reset, unlike control_stats
 
 /**
  * @brief 
@@ -48,7 +87,7 @@ int configure_PWM()
     }
 
     // set "wrap": number of cycles for each pulse
-    pwm_set_wrap(slice1, 12500);
+    pwm_set_wrap(slice1, PWM_WRAP);
 
     // start PWMs at 0 = STOP
     pwm_set_chan_level(slice1, PWM_CHAN_A, 0);     // right
@@ -57,35 +96,395 @@ int configure_PWM()
     // set the PWM running
     pwm_set_enabled(slice1, true);
 
-    // gpio_set_dir(20, GPIO_IN);
-    // gpio_set_dir(21, GPIO_IN);
+    return EXIT_SUCCESS;
+}
 
-    // gpio_pull_down(20);
+/**
+ * @brief Writes the DIR pins and PWM levels
+ *
+ * @param left_dir true for forward
+ * @param left_level 0-PWM_WRAP
+ * @param right_dir true for forward
+ * @param right_level 0-PWM_WRAP
+ */
+static void __not_in_flash_func(write_PWM)(bool left_dir, uint16_t left_level, bool right_dir, uint16_t right_level)
+{
+    // set DIR pins
+    gpio_put(DIR_1_PIN, left_dir);
+    gpio_put(DIR_2_PIN, right_dir);
 
-    // prevA = gpio_get(20);
-    // prevB = gpio_get(21);
+    // set PWM pins
+    pwm_set_gpio_level(PWM_1_PIN, left_level);
+    pwm_set_gpio_level(PWM_2_PIN, right_level);
+}
 
-    return EXIT_SUCCESS;
+/**
+ * @brief Writes signed PWM levels and keeps them for the failsafe ramp
+ *
+ * @param left -PWM_WRAP-PWM_WRAP, negative in reverse
+ * @param right -PWM_WRAP-PWM_WRAP, negative in reverse
+ */
+static void __not_in_flash_func(drive)(int32_t left, int32_t right)
+{
+    // past full on the level would wrap, or read as the other direction
+    left = left > PWM_WRAP ? PWM_WRAP : left < -PWM_WRAP ? -PWM_WRAP : left;
+    right = right > PWM_WRAP ? PWM_WRAP : right < -PWM_WRAP ? -PWM_WRAP : right;
+    left_level = left;
+    right_level = right;
+    write_PWM(left >= 0, (uint16_t)(left < 0 ? -left : left), right >= 0, (uint16_t)(right < 0 ? -right : right));
 }
 
 /**
- * @brief 
+ * @brief Open-loop drive; takes the wheels out of velocity mode
  * 
  * @param left_dir true for forward, false for reverse
- * @param left_speed 0-100
+ * @param left_speed 0-PWM_SPEED_MAX, clamped
  * @param right_dir true for forward, false for reverse
- * @param right_speed 0-100
+ * @param right_speed 0-PWM_SPEED_MAX, clamped
  */
 void set_PWM(bool left_dir, int left_speed, bool right_dir, int right_speed)
 {
-    // set DIR pins
-    gpio_put(DIR_1_PIN, left_dir);
-    gpio_put(DIR_2_PIN, right_dir);
+    uint32_t status;
 
-    // set PWM pins
-    pwm_set_gpio_level(PWM_1_PIN, (int16_t)left_speed * 125);
-    pwm_set_gpio_level(PWM_2_PIN, (int16_t)right_speed * 125);
+    // the direction comes from the dir flags only, so a negative speed is 0
+    left_speed = left_speed < 0 ? 0 : left_speed > PWM_SPEED_MAX ? PWM_SPEED_MAX : left_speed;
+    right_speed = right_speed < 0 ? 0 : right_speed > PWM_SPEED_MAX ? PWM_SPEED_MAX : right_speed;
+
+    status = save_and_disable_interrupts();
+    motor_mode = MOTOR_MODE_PWM;
+    command_us = time_us_32();
+    drive((left_dir ? 1 : -1) * left_speed * (PWM_WRAP / PWM_SPEED_MAX),
+          (right_dir ? 1 : -1) * right_speed * (PWM_WRAP / PWM_SPEED_MAX));
+    restore_interrupts(status);
+}
+
+/**
+ * @brief Closed-loop drive: the control loop holds these wheel speeds
+ *
+ * @param left_rpm wheel RPM, negative in reverse; 0 lets the wheel coast to a stop
+ * @param right_rpm wheel RPM, negative in reverse
+ */
+void set_velocity(int left_rpm, int right_rpm)
+{
+    int32_t left = (int32_t)((int64_t)left_rpm * ENC_COUNTS_PER_REV * (1 << ENC_VEL_SHIFT) / 60);
+    int32_t right = (int32_t)((int64_t)right_rpm * ENC_COUNTS_PER_REV * (1 << ENC_VEL_SHIFT) / 60);
+    uint32_t status = save_and_disable_interrupts();
+
+    // from open loop the controllers start clean, not from whatever they held last time
+    if (motor_mode != MOTOR_MODE_VELOCITY)
+    {
+        pid_reset(&left_pid);
+        pid_reset(&right_pid);
+    }
+    left_setpoint = left;
+    right_setpoint = right;
+    motor_mode = MOTOR_MODE_VELOCITY;
+    command_us = time_us_32();
+    restore_interrupts(status);
+}
+
+/**
+ * @brief Encoder interrupt for the left wheel
+ *
+ * @param gpio pin that changed
+ * @param events edge(s) seen
+ */
+void __not_in_flash_func(left_enc_callback)(uint gpio, uint32_t events)
+{
+    encoder_edge(&left_encoder, gpio_get_all(), time_us_32());
+}
+
+/**
+ * @brief Encoder interrupt for the right wheel
+ *
+ * @param gpio pin that changed
+ * @param events edge(s) seen
+ */
+void __not_in_flash_func(right_enc_callback)(uint gpio, uint32_t events)
+{
+    encoder_edge(&right_encoder, gpio_get_all(), time_us_32());
+}
+
+/**
+ * @brief GPIO interrupt callback; there is one per core, so it dispatches on the pin
+ *
+ * @param gpio pin that changed
+ * @param events edge(s) seen
+ */
+void __not_in_flash_func(enc_callback)(uint gpio, uint32_t events)
+{
+    if (gpio == ENC_RIGHT_A_PIN || gpio == ENC_RIGHT_B_PIN)
+        right_enc_callback(gpio, events);
+    else if (gpio == ENC_LEFT_A_PIN || gpio == ENC_LEFT_B_PIN)
+        left_enc_callback(gpio, events);
+}
+
+/**
+ * @brief Configures the encoder pins and their interrupts on the calling core
+ *
+ * @return int
+ */
+int configure_encoders()
+{
+    static const uint pins[] = { ENC_LEFT_A_PIN, ENC_LEFT_B_PIN, ENC_RIGHT_A_PIN, ENC_RIGHT_B_PIN };
+
+    for (size_t i = 0; i < sizeof(pins) / sizeof(pins[0]); i++)
+    {
+        gpio_init(pins[i]);
+        gpio_set_dir(pins[i], GPIO_IN);
+        gpio_pull_up(pins[i]);
+    }
+
+    // starting states are read before the first edge can be counted
+    encoder_init(&left_encoder, ENC_LEFT_A_PIN, ENC_LEFT_B_PIN, gpio_get_all());
+    encoder_init(&right_encoder, ENC_RIGHT_A_PIN, ENC_RIGHT_B_PIN, gpio_get_all());
+
+    gpio_set_irq_enabled_with_callback(ENC_LEFT_A_PIN, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, true, &enc_callback);
+    for (size_t i = 1; i < sizeof(pins) / sizeof(pins[0]); i++)
+        gpio_set_irq_enabled(pins[i], GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, true);
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Refreshes both velocity estimates; called by the control loop at its rate
+ */
+void update_encoders()
+{
+    uint32_t now = time_us_32();
+
+    encoder_update(&left_encoder, now);
+    encoder_update(&right_encoder, now);
+}
+
+/**
+ * @brief Left wheel speed from the last update_encoders()
+ *
+ * @return float RPM, negative in reverse
+ */
+float get_vel_left()
+{
+    return left_encoder.velocity * (60.0f / (1 << ENC_VEL_SHIFT)) / ENC_COUNTS_PER_REV;
+}
+
+/**
+ * @brief Right wheel speed from the last update_encoders()
+ *
+ * @return float RPM, negative in reverse
+ */
+float get_vel_right()
+{
+    return right_encoder.velocity * (60.0f / (1 << ENC_VEL_SHIFT)) / ENC_COUNTS_PER_REV;
+}
+
+/**
+ * @brief Right wheel position
+ *
+ * @return int64_t counts since configure_encoders()
+ */
+int64_t getEncCounter()
+{
+    int32_t count;
+    uint32_t edge_us;
+
+    encoder_read(&right_encoder, &count, &edge_us);
+    return count;
+}
+
+/**
+ * @brief One wheel's control step
+ *
+ * @param pid the wheel's controller
+ * @param setpoint counts/s << ENC_VEL_SHIFT
+ * @param measured counts/s << ENC_VEL_SHIFT
+ * @return signed PWM level
+ */
+static int32_t __not_in_flash_func(wheel_step)(pid_ctl_t *pid, int32_t setpoint, int32_t measured)
+{
+    int32_t level;
+
+    // 0 is a stop: the wheel coasts rather than being driven against its own overshoot
+    if (!setpoint)
+    {
+        pid_reset(pid);
+        return 0;
+    }
+    level = pid_step(pid, setpoint, measured);
+    if (level == PWM_WRAP || level == -PWM_WRAP)
+        control_stats.saturated++;
+    return level;
+}
+
+/**
+ * @brief Moves a signed PWM level a step towards 0
+ *
+ * @param level current level
+ * @param step how far, > 0
+ * @return the new level
+ */
+static inline int32_t ramp_down(int32_t level, int32_t step)
+{
+    if (level > step)
+        return level - step;
+    if (level < -step)
+        return level + step;
+    return 0;
+}
+
+/**
+ * @brief Starts the failsafe ramp if the last command is older than the timeout
+ *
+ * @param now time_us_32() at the start of this tick
+ */
+static void __not_in_flash_func(check_command_timeout)(uint32_t now)
+{
+    int32_t left, right, peak;
+
+    if ((motor_mode != MOTOR_MODE_PWM && motor_mode != MOTOR_MODE_VELOCITY) || now - command_us <= command_timeout_us)
+        return;
+
+    left = left_level < 0 ? -left_level : left_level;
+    right = right_level < 0 ? -right_level : right_level;
+    peak = left > right ? left : right;
+    if (!peak)
+    {
+        // already standing still: nothing to ramp, and not worth counting
+        motor_mode = MOTOR_MODE_STOPPED;
+        return;
+    }
+
+    // rounded up, so the ramp takes MOTOR_STOP_RAMP_MS at most whatever the starting level
+    ramp_step = (int32_t)(((int64_t)peak * control_period_us + MOTOR_STOP_RAMP_MS * 1000 - 1) / (MOTOR_STOP_RAMP_MS * 1000));
+    pid_reset(&left_pid);
+    pid_reset(&right_pid);
+    motor_mode = MOTOR_MODE_FAILSAFE;
+    control_stats.failsafes++;
+    failsafes_total++;
+}
+
+/**
+ * @brief The control loop: feeds the watchdog, enforces the command timeout, then velocity
+ * estimates and a PID step per wheel in velocity mode
+ *
+ * @param rt the timer
+ * @return true to keep running
+ */
+static bool __not_in_flash_func(control_tick)(repeating_timer_t *rt)
+{
+    uint32_t start = time_us_32();
+    uint32_t exec;
+    int32_t left, right;
+
+    watchdog_update();
+
+    if (control_stats.runs)
+    {
+        int32_t jitter = (int32_t)(start - control_last_start - control_period_us);
+        uint32_t magnitude = (uint32_t)(jitter < 0 ? -jitter : jitter);
 
+        if (magnitude > control_stats.jitter_max_us)
+            control_stats.jitter_max_us = magnitude;
+        control_stats.jitter_sum_us += magnitude;
+    }
+    control_last_start = start;
+
+    update_encoders();
+    check_command_timeout(start);
+    if (motor_mode == MOTOR_MODE_VELOCITY)
+    {
+        left = wheel_step(&left_pid, left_setpoint, left_encoder.velocity);
+        right = wheel_step(&right_pid, right_setpoint, right_encoder.velocity);
+        drive(left, right);
+    }
+    else if (motor_mode == MOTOR_MODE_FAILSAFE)
+    {
+        drive(ramp_down(left_level, ramp_step), ramp_down(right_level, ramp_step));
+        if (!left_level && !right_level)
+            motor_mode = MOTOR_MODE_STOPPED;
+    }
+
+    exec = time_us_32() - start;
+    if (exec > control_stats.exec_max_us)
+        control_stats.exec_max_us = exec;
+    control_stats.exec_sum_us += exec;
+    control_stats.runs++;
+    return true;
+}
+
+/**
+ * @brief Starts the control loop on the calling core, or restarts it at a new rate
+ *
+ * @param hz MOTOR_CTL_MIN_HZ-MOTOR_CTL_MAX_HZ
+ * @return int
+ */
+int configure_motor_control(uint hz)
+{
+    uint32_t status;
+
+    if (hz < MOTOR_CTL_MIN_HZ || hz > MOTOR_CTL_MAX_HZ)
+        return EXIT_FAILURE;
+
+    if (control_running)
+        cancel_repeating_timer(&control_timer);
+
+    status = save_and_disable_interrupts();
+    control_period_us = 1000000 / hz;
+    pid_init(&left_pid, &wheel_gains, control_period_us, PWM_WRAP);
+    pid_init(&right_pid, &wheel_gains, control_period_us, PWM_WRAP);
+    memset(&control_stats, 0, sizeof(control_stats));
+    control_stats.hz = (uint16_t)hz;
+    restore_interrupts(status);
+
+    // negative: start to start, so the period doesn't stretch by the callback's own time
+    control_running = add_repeating_timer_us(-(int64_t)control_period_us, control_tick, NULL, &control_timer);
+    return control_running ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * @brief Sets how long the wheels keep going without a fresh command
+ *
+ * @param ms MOTOR_CMD_TIMEOUT_MIN_MS-MOTOR_CMD_TIMEOUT_MAX_MS
+ * @return int
+ */
+int configure_command_timeout(uint ms)
+{
+    if (ms < MOTOR_CMD_TIMEOUT_MIN_MS || ms > MOTOR_CMD_TIMEOUT_MAX_MS)
+        return EXIT_FAILURE;
+    command_timeout_us = ms * 1000;
+    return EXIT_SUCCESS;
 }
 
+/**
+ * @brief Control loop timing since the last call, which starts a new interval
+ *
+ * @param stats where the figures are stored
+ */
+void get_motor_ctl_stats(motor_ctl_stats_t *stats)
+{
+    uint32_t status = save_and_disable_interrupts();
+
+    *stats = control_stats;
+    memset(&control_stats, 0, sizeof(control_stats));
+    control_stats.hz = stats->hz;
+    restore_interrupts(status);
+}
 
+/**
+ * @brief What the control loop is doing with the wheels
+ *
+ * @return MOTOR_MODE
+ */
+MOTOR_MODE get_motor_mode(void)
+{
+    return motor_mode;
+}
+
+/**
+ * @brief Stops the command timeout has forced since boot
+ *
+ * @return uint32_t
+ */
+uint32_t get_failsafe_count(void)
+{
+    return failsafes_total;
+}
@@ -0,0 +1,71 @@
+/**
+ * @file msgring.c
+ * @brief Zero-copy message channel between the cores, see msgring.h
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include "../include/msgring.h"
+
+// general includes
+#include <string.h>
+
+_Static_assert((MSG_POOL_SIZE & (MSG_POOL_SIZE - 1)) == 0, "MSG_POOL_SIZE must be a power of 2");
+_Static_assert(MSG_POOL_SIZE <= (1 << MSG_INDEX_BITS), "buffer index doesn't fit a ring slot");
+_Static_assert(MSG_BUFFER_SIZE < (1 << (16 - MSG_INDEX_BITS)), "message length doesn't fit a ring slot");
+
+/**
+ * @brief Empties a channel and puts every buffer on its free ring; before either side uses it
+ *
+ * @param c the channel
+ */
+void msg_channel_init(msg_channel_t *c)
+{
+    memset(&c->full, 0, sizeof(c->full));
+    memset(&c->free, 0, sizeof(c->free));
+    c->sent = 0;
+    c->dropped = 0;
+    c->received = 0;
+
+    for (uint16_t i = 0; i < MSG_POOL_SIZE; i++)
+        msg_ring_put(&c->free, i);
+}
+
+/**
+ * @brief Producer side: sends a copy of a string, for producers that don't build their message in place
+ *
+ * @param c the channel
+ * @param text the message; truncated to MSG_BUFFER_SIZE - 1 characters
+ * @return false if no buffer was free
+ */
+bool msg_send_text(msg_channel_t *c, const char *text)
+{
+    char *buf = msg_alloc(c);
+    size_t len;
+
+    if (!buf)
+        return false;
+
+    len = strlen(text);
+    if (len >= MSG_BUFFER_SIZE)
+        len = MSG_BUFFER_SIZE - 1;
+    memcpy(buf, text, len);
+    buf[len] = '\0';
+    msg_send(c, buf, len);
+
+    return true;
+}
+
+/**
+ * @brief Number of messages sent and not yet received; exact on either side, a snapshot on the other
+ *
+ * @param c the channel
+ * @return unsigned
+ */
+unsigned msg_level(const msg_channel_t *c)
+{
+    return __atomic_load_n(&c->full.head, __ATOMIC_ACQUIRE) - __atomic_load_n(&c->full.tail, __ATOMIC_ACQUIRE);
+}
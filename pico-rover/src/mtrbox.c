@@ -0,0 +1,128 @@
+/**
+ * @file mtrbox.c
+ * @brief Latest-wins mailbox for motor commands, one slot per source
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include "../include/mtrbox.h"
+
+// general includes
+#include <string.h>
+
+// hardware includes
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+#include "../include/trace.h"
+
+/**
+ * @brief Empties a mailbox
+ */
+void mtrbox_init(mtrbox_t *box)
+{
+    memset(box, 0, sizeof(*box));
+    box->owner = -1;
+}
+
+/**
+ * @brief Replaces a source's command with a newer one and wakes the control path; never waits
+ *
+ * @param box the mailbox
+ * @param source the only caller that writes this slot
+ * @param cmd the command
+ */
+void mtrbox_post(mtrbox_t *box, MTR_SOURCE source, const mtr_cmd_t *cmd)
+{
+    mtrbox_slot_t *slot = &box->slot[source];
+
+    __atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    slot->cmd = *cmd;
+    slot->received_us = time_us_32();
+    slot->posts++;
+    __atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_RELEASE);
+    TRACE(TRACE_MTR_POST, source);
+
+    // the control path may be in WFE on the other core
+    __sev();
+}
+
+// consistent copy of a slot, retried if its writer was in the middle of a post
+static void read_slot(const mtrbox_slot_t *slot, mtrbox_slot_t *copy)
+{
+    uint32_t seq;
+
+    do
+    {
+        seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        copy->posts = slot->posts;
+        copy->received_us = slot->received_us;
+        copy->cmd = slot->cmd;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1) || seq != __atomic_load_n(&slot->seq, __ATOMIC_RELAXED));
+}
+
+/**
+ * @brief Picks the command to apply, if any; one consumer only
+ *
+ * Every new command is accounted for exactly once: applied, coalesced, stale or preempted.
+ *
+ * @param box the mailbox
+ * @param now_us time_us_32()
+ * @param cmd where the command is stored
+ * @param source where its source is stored
+ * @return true if there is a command to apply
+ */
+bool mtrbox_take(mtrbox_t *box, uint32_t now_us, mtr_cmd_t *cmd, MTR_SOURCE *source)
+{
+    mtrbox_slot_t copy;
+    int best = -1;
+    uint32_t fresh;
+
+    for (int src = 0; src < MTR_SOURCES; src++)
+    {
+        mtrbox_stats_t *stats = &box->stats[src];
+
+        if (__atomic_load_n(&box->slot[src].posts, __ATOMIC_ACQUIRE) == box->taken[src])
+            continue;
+        read_slot(&box->slot[src], &copy);
+        fresh = copy.posts - box->taken[src];
+        box->taken[src] = copy.posts;
+        stats->coalesced += fresh - 1;
+
+        // signed: a command posted after the caller read the clock is newer than now_us, not stale
+        if ((int32_t)(now_us - copy.received_us) > MTRBOX_STALE_MS * 1000)
+            stats->stale++;
+        // the sources are in priority order, so a winner so far outranks this one
+        else if (best >= 0 ||
+                 (box->owner >= 0 && box->owner < src && (int32_t)(now_us - box->owner_us) < MTRBOX_HOLD_MS * 1000))
+            stats->preempted++;
+        else
+        {
+            best = src;
+            *cmd = copy.cmd;
+        }
+    }
+
+    if (best < 0)
+        return false;
+
+    box->owner = best;
+    box->owner_us = now_us;
+    box->stats[best].applied++;
+    *source = (MTR_SOURCE)best;
+    return true;
+}
+
+/**
+ * @brief Counters for one source; call from the consumer's core
+ */
+void mtrbox_get_stats(const mtrbox_t *box, MTR_SOURCE source, mtrbox_stats_t *stats)
+{
+    *stats = box->stats[source];
+    stats->posted = __atomic_load_n(&box->slot[source].posts, __ATOMIC_ACQUIRE);
+}
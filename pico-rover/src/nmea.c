@@ -0,0 +1,404 @@
+/**
+ * @file nmea.c
+ * @brief Byte-at-a-time NMEA-0183 state machine with checksum validation
+ *
+ * Fields are decoded as they complete, straight into fixed-point values, so a
+ * sentence is never stored whole. A sentence only updates the fix once its
+ * checksum has been verified.
+ *
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include "../include/nmea.h"
+
+// general includes
+#include <stdio.h>
+#include <string.h>
+
+#include "../include/definitions.h"
+
+enum {
+    NMEA_WAIT,      // waiting for '$'
+    NMEA_BODY,      // address and data fields
+    NMEA_CSUM,      // the two hex digits after '*'
+    NMEA_END        // waiting for CR/LF
+};
+
+gps_fix_register_t gps_latest_fix;
+
+/**
+ * @brief Parses an unsigned decimal into a fixed-point integer
+ *
+ * @param s the field
+ * @param decimals number of fractional digits to keep (extra digits are truncated)
+ * @param out the value scaled by 10^decimals
+ * @return false if the field is empty or not a number
+ */
+static bool parse_fixed(const char *s, int decimals, int32_t *out)
+{
+    int32_t v = 0;
+    bool digits = false;
+
+    for (; *s >= '0' && *s <= '9'; s++, digits = true)
+        v = v * 10 + (*s - '0');
+
+    if (*s == '.')
+        s++;
+
+    for (; decimals > 0; decimals--)
+    {
+        v *= 10;
+        if (*s >= '0' && *s <= '9')
+        {
+            v += *s++ - '0';
+            digits = true;
+        }
+    }
+
+    while (*s >= '0' && *s <= '9')
+        s++;
+
+    if (!digits || *s)
+        return false;
+
+    *out = v;
+    return true;
+}
+
+// ddmm.mmmmm / dddmm.mmmmm to 1e-7 degrees
+static bool parse_coord(const char *s, int32_t *out)
+{
+    int32_t v;
+
+    if (!parse_fixed(s, 5, &v))
+        return false;
+
+    int32_t degrees = v / 10000000;
+    int32_t minutes_e5 = v % 10000000;
+    // 1e-5 minutes -> 1e-7 degrees is * 100 / 60, rounded
+    *out = degrees * 10000000 + (minutes_e5 * 5 + 1) / 3;
+    return true;
+}
+
+// hhmmss.sss to milliseconds since midnight
+static bool parse_time(const char *s, uint32_t *out)
+{
+    int32_t v;
+
+    if (!parse_fixed(s, 3, &v))
+        return false;
+
+    *out = (uint32_t)(v / 10000000) * 3600000u + (uint32_t)(v / 100000 % 100) * 60000u + (uint32_t)(v % 100000);
+    return true;
+}
+
+// knots with 3 decimals to cm/s
+static bool parse_knots(const char *s, uint16_t *out)
+{
+    int32_t v;
+
+    if (!parse_fixed(s, 3, &v))
+        return false;
+
+    int64_t cms = ((int64_t)v * 514444 + 5000000) / 10000000;
+    *out = cms > UINT16_MAX ? UINT16_MAX : (uint16_t)cms;
+    return true;
+}
+
+static bool parse_u16(const char *s, int decimals, uint16_t *out)
+{
+    int32_t v;
+
+    if (!parse_fixed(s, decimals, &v) || v > UINT16_MAX)
+        return false;
+
+    *out = (uint16_t)v;
+    return true;
+}
+
+static bool parse_u8(const char *s, uint8_t *out)
+{
+    int32_t v;
+
+    if (!parse_fixed(s, 0, &v) || v > UINT8_MAX)
+        return false;
+
+    *out = (uint8_t)v;
+    return true;
+}
+
+static NMEA_SENTENCE sentence_type(const char *address, size_t len)
+{
+    // talker (GP, GN, GL, ...) followed by the sentence formatter
+    if (len != 5)
+        return NMEA_OTHER;
+    if (memcmp(address + 2, "GGA", 3) == 0)
+        return NMEA_GGA;
+    if (memcmp(address + 2, "RMC", 3) == 0)
+        return NMEA_RMC;
+    if (memcmp(address + 2, "VTG", 3) == 0)
+        return NMEA_VTG;
+    return NMEA_OTHER;
+}
+
+// gps_fix_t is packed, so fields are parsed into locals rather than through (possibly unaligned) member pointers
+static void field_gga(nmea_decoder_t *d, const char *f)
+{
+    gps_fix_t *w = &d->work;
+    uint32_t time_ms;
+    uint16_t hdop;
+    uint8_t count;
+
+    switch (d->field)
+    {
+        case 1: if (parse_time(f, &time_ms)) w->time_ms = time_ms; break;
+        case 2: case 4: if (!parse_coord(f, &d->coord)) d->coord = INT32_MIN; break;
+        case 3: if (d->coord != INT32_MIN) w->lat = (*f == 'S') ? -d->coord : d->coord; break;
+        case 5: if (d->coord != INT32_MIN) w->lon = (*f == 'W') ? -d->coord : d->coord; break;
+        case 6: if (parse_u8(f, &count)) w->quality = count; break;
+        case 7: if (parse_u8(f, &count)) w->sats = count; break;
+        case 8: if (parse_u16(f, 2, &hdop)) w->hdop = hdop; break;
+    }
+}
+
+static void field_rmc(nmea_decoder_t *d, const char *f)
+{
+    gps_fix_t *w = &d->work;
+    uint32_t time_ms;
+    uint16_t value;
+
+    if (d->field == 1)
+    {
+        if (parse_time(f, &time_ms))
+            w->time_ms = time_ms;
+        return;
+    }
+    if (d->field == 2)
+    {
+        d->active = (*f == 'A');
+        return;
+    }
+    if (!d->active)
+        return;
+
+    switch (d->field)
+    {
+        case 3: case 5: if (!parse_coord(f, &d->coord)) d->coord = INT32_MIN; break;
+        case 4: if (d->coord != INT32_MIN) w->lat = (*f == 'S') ? -d->coord : d->coord; break;
+        case 6: if (d->coord != INT32_MIN) w->lon = (*f == 'W') ? -d->coord : d->coord; break;
+        case 7: if (parse_knots(f, &value)) w->speed = value; break;
+        case 8: if (parse_u16(f, 2, &value)) w->course = value; break;
+    }
+}
+
+static void field_vtg(nmea_decoder_t *d, const char *f)
+{
+    uint16_t value;
+
+    switch (d->field)
+    {
+        case 1: if (parse_u16(f, 2, &value)) d->work.course = value; break;
+        case 5: if (parse_knots(f, &value)) d->work.speed = value; break;
+    }
+}
+
+static void end_field(nmea_decoder_t *d)
+{
+    d->buf[d->len] = '\0';
+
+    if (d->field == 0)
+    {
+        d->type = sentence_type(d->buf, d->len);
+        return;
+    }
+
+    switch (d->type)
+    {
+        case NMEA_GGA: field_gga(d, d->buf); break;
+        case NMEA_RMC: field_rmc(d, d->buf); break;
+        case NMEA_VTG: field_vtg(d, d->buf); break;
+        default: break;
+    }
+}
+
+static void start_sentence(nmea_decoder_t *d)
+{
+    d->state = NMEA_BODY;
+    d->checksum = 0;
+    d->expected = 0;
+    d->digits = 0;
+    d->field = 0;
+    d->len = 0;
+    d->error = false;
+    d->active = true;
+    d->type = NMEA_NONE;
+    d->coord = INT32_MIN;
+    d->work = d->fix;
+}
+
+static int hex_value(char ch)
+{
+    if (ch >= '0' && ch <= '9') return ch - '0';
+    if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+    if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+    return -1;
+}
+
+static NMEA_SENTENCE reject(nmea_decoder_t *d)
+{
+    d->rejected++;
+    d->state = NMEA_WAIT;
+    return NMEA_NONE;
+}
+
+/**
+ * @brief Resets a decoder, including its fix
+ *
+ * @param d the decoder
+ */
+void nmea_init(nmea_decoder_t *d)
+{
+    memset(d, 0, sizeof(*d));
+    d->state = NMEA_WAIT;
+}
+
+/**
+ * @brief Feeds one received byte to the decoder
+ *
+ * @param d the decoder
+ * @param ch the byte
+ * @return the type of sentence this byte completed (d->fix has been updated), otherwise NMEA_NONE
+ */
+NMEA_SENTENCE nmea_feed(nmea_decoder_t *d, char ch)
+{
+    int digit;
+
+    // a '$' always starts over, whatever state a broken sentence left us in
+    if (ch == '$')
+    {
+        if (d->state != NMEA_WAIT)
+            d->rejected++;
+        start_sentence(d);
+        return NMEA_NONE;
+    }
+
+    switch (d->state)
+    {
+        case NMEA_WAIT:
+            return NMEA_NONE;
+
+        case NMEA_BODY:
+            if (ch == '*')
+            {
+                end_field(d);
+                d->state = NMEA_CSUM;
+                return NMEA_NONE;
+            }
+            // a sentence without a checksum is not trusted
+            if (ch == CR || ch == NL)
+                return reject(d);
+
+            d->checksum ^= (uint8_t)ch;
+
+            if (ch == ',')
+            {
+                end_field(d);
+                d->field++;
+                d->len = 0;
+            }
+            else if (d->len < NMEA_FIELD_SIZE - 1)
+            {
+                d->buf[d->len++] = ch;
+            }
+            else
+            {
+                d->error = true;
+            }
+            return NMEA_NONE;
+
+        case NMEA_CSUM:
+            if ((digit = hex_value(ch)) < 0)
+                return reject(d);
+            d->expected = (uint8_t)(d->expected << 4 | digit);
+            if (++d->digits == 2)
+                d->state = NMEA_END;
+            return NMEA_NONE;
+
+        case NMEA_END:
+            if (ch != CR && ch != NL)
+                return reject(d);
+            if (d->error || d->expected != d->checksum)
+                return reject(d);
+
+            d->state = NMEA_WAIT;
+            d->sentences++;
+            d->fix = d->work;
+            return d->type;
+    }
+
+    return NMEA_NONE;
+}
+
+/**
+ * @brief Publishes a fix to a latest-fix register (single writer)
+ *
+ * @param reg the register
+ * @param fix the new fix
+ */
+void gps_fix_store(gps_fix_register_t *reg, const gps_fix_t *fix)
+{
+    uint32_t seq = reg->seq;
+
+    __atomic_store_n(&reg->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(&reg->fix, fix, sizeof(*fix));
+    __atomic_store_n(&reg->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Reads a consistent copy of the latest fix; safe from any core or context but the writer's ISR
+ *
+ * @param reg the register
+ * @param fix where the fix is copied
+ * @return version of the fix; 0 if nothing has been stored yet
+ */
+uint32_t gps_fix_load(gps_fix_register_t *reg, gps_fix_t *fix)
+{
+    uint32_t before, after;
+
+    do
+    {
+        while ((before = __atomic_load_n(&reg->seq, __ATOMIC_ACQUIRE)) & 1u);
+        memcpy(fix, &reg->fix, sizeof(*fix));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        after = __atomic_load_n(&reg->seq, __ATOMIC_RELAXED);
+    } while (before != after);
+
+    return before / 2;
+}
+
+/**
+ * @brief Whether two fixes differ in anything but their timestamp
+ */
+bool gps_fix_differs(const gps_fix_t *a, const gps_fix_t *b)
+{
+    return a->lat != b->lat || a->lon != b->lon || a->quality != b->quality || a->sats != b->sats ||
+           a->hdop != b->hdop || a->speed != b->speed || a->course != b->course;
+}
+
+/**
+ * @brief Formats a fix for the SBC:
+ *        $FIX <lat 1e-7 deg> <lon 1e-7 deg> <quality> <sats> <hdop 0.01> <speed cm/s> <course 0.01 deg> <UTC ms>
+ *
+ * @return number of characters written (as snprintf)
+ */
+int gps_fix_format(const gps_fix_t *fix, char *out, size_t size)
+{
+    return snprintf(out, size, "$FIX %ld %ld %u %u %u %u %u %lu\n",
+                    (long)fix->lat, (long)fix->lon, fix->quality, fix->sats,
+                    fix->hdop, fix->speed, fix->course, (unsigned long)fix->time_ms);
+}
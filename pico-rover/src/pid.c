@@ -0,0 +1,89 @@
+/**
+ * @file pid.c
+ * @brief Fixed-point PID controller with feed-forward and anti-windup
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include "../include/pid.h"
+
+// general includes
+#include <string.h>
+
+/**
+ * @brief Sets up a controller and clears its state
+ *
+ * @param pid the controller
+ * @param gains the gains
+ * @param period_us time between pid_step() calls
+ * @param out_max output limit, either sign
+ */
+void pid_init(pid_ctl_t *pid, const pid_gains_t *gains, uint32_t period_us, int32_t out_max)
+{
+    memset(pid, 0, sizeof(*pid));
+    pid->kp = gains->kp;
+    pid->ki_dt = (int32_t)((int64_t)gains->ki * period_us / 1000000);
+    pid->kd_dt = (int32_t)((int64_t)gains->kd * 1000000 / period_us);
+    pid->kff = gains->kff;
+    pid->kstatic = gains->kstatic;
+    pid->out_max = out_max;
+}
+
+/**
+ * @brief Clears the integral and derivative history, e.g. when the loop was open
+ */
+void pid_reset(pid_ctl_t *pid)
+{
+    pid->integral = 0;
+    pid->primed = false;
+    pid->output = 0;
+}
+
+/**
+ * @brief One control period
+ *
+ * @param pid the controller
+ * @param setpoint wanted value
+ * @param measured current value, same units
+ * @return the output, within +-out_max
+ */
+int32_t pid_step(pid_ctl_t *pid, int32_t setpoint, int32_t measured)
+{
+    int32_t error = setpoint - measured;
+    int64_t limit = (int64_t)pid->out_max << PID_SHIFT;
+    int64_t fixed;
+    int64_t integral;
+    int64_t out;
+
+    // everything but the integral
+    fixed = (int64_t)pid->kff * setpoint + (int64_t)pid->kp * error;
+    if (setpoint)
+        fixed += (int64_t)(setpoint > 0 ? pid->kstatic : -pid->kstatic) << PID_SHIFT;
+    if (pid->primed)
+        fixed -= (int64_t)pid->kd_dt * (measured - pid->prev_measured);
+    pid->prev_measured = measured;
+    pid->primed = true;
+
+    // anti-windup: keep the integral where it was if growing it would push further past the limit
+    integral = pid->integral + (int64_t)pid->ki_dt * error;
+    if (integral > limit)
+        integral = limit;
+    else if (integral < -limit)
+        integral = -limit;
+    out = fixed + integral;
+    if ((out > limit && integral > pid->integral) || (out < -limit && integral < pid->integral))
+        out = fixed + pid->integral;
+    else
+        pid->integral = integral;
+
+    if (out > limit || out < -limit)
+    {
+        out = out > 0 ? limit : -limit;
+        pid->saturated++;
+    }
+    pid->output = (int32_t)(out >> PID_SHIFT);
+    return pid->output;
+}
@@ -0,0 +1,114 @@
+/**
+ * @file stats.c
+ * @brief Runtime statistics snapshot served by "$REQ STATS"
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include "../include/stats.h"
+
+// general includes
+#include <string.h>
+
+#include "../include/comms.h"
+#include "../include/main.h"
+#include "../include/usblink.h"
+
+core_stats_t core_stats[STATS_CORES];
+link_stats_t lora_link_stats;
+volatile uint32_t stats_epoch;
+
+// readings at the previous snapshot; core 0 only
+static uint32_t last_us;
+static uint32_t last_gps;
+static core_stats_t last_core[STATS_CORES];
+static tx_class_stats_t last_tx[TX_CLASSES];
+
+/**
+ * @brief Reads every counter and works out rates and means since the previous call; core 0 only
+ *
+ * @param stats where the snapshot is stored
+ */
+void stats_snapshot(rover_stats_t *stats)
+{
+    uint32_t now = time_us_32();
+    uint32_t interval_us = now - last_us;
+    uint32_t epoch = stats_epoch;
+    uint32_t gps_sentences, gps_rejected, gps_dropped;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->interval_ms = interval_us / 1000;
+    if (!interval_us)
+        interval_us = 1;
+
+    stats->rx_depth = (uint8_t)msg_level(&receive_queue);
+    stats->rx_sent = receive_queue.sent;
+    stats->rx_dropped = receive_queue.dropped;
+    stats->tx_depth = (uint8_t)tx_level(&transmit_queue);
+    for (int cls = 0; cls < TX_CLASSES; cls++)
+    {
+        const msg_channel_t *c = &transmit_queue.channel[cls];
+        tx_class_stats_t now_tx = transmit_queue.stats[cls];
+        tx_class_stats_t *last = &last_tx[cls];
+        stats_tx_t *out = &stats->tx[cls];
+        uint32_t taken = now_tx.taken - last->taken;
+
+        out->depth = (uint8_t)msg_level(c);
+        out->sent = c->sent;
+        out->dropped = c->dropped;
+        if (taken)
+            out->delay_mean_us = (now_tx.delay_us - last->delay_us) / taken;
+        out->delay_max_us = now_tx.delay_epoch == epoch ? now_tx.delay_max_us : 0;
+        *last = now_tx;
+
+        stats->tx_sent += out->sent;
+        stats->tx_dropped += out->dropped;
+    }
+
+    stats->parse_errors = lora_link_stats.parse_errors;
+    stats->retransmits = lora_link_stats.retransmits;
+    stats->resets = lora_link_stats.resets;
+    stats->rate = lora_link_stats.rate;
+    stats->rssi = lora_link_stats.rssi;
+    stats->snr = lora_link_stats.snr;
+    stats->per_pct = lora_link_stats.per_pct;
+    stats->rate_ups = lora_link_stats.rate_ups;
+    stats->rate_downs = lora_link_stats.rate_downs;
+    stats->fallbacks = lora_link_stats.fallbacks;
+
+    get_gps_stats(&gps_sentences, &gps_rejected, &gps_dropped);
+    stats->gps_sentences = gps_sentences;
+    stats->gps_rejected = gps_rejected;
+    stats->gps_per_s = (uint16_t)((uint64_t)(gps_sentences - last_gps) * 1000000 / interval_us);
+    last_gps = gps_sentences;
+
+    stats->overruns[0] = gps_dropped;
+    stats->overruns[1] = __atomic_load_n(&lora_framer.dropped, __ATOMIC_ACQUIRE);
+    stats->overruns[2] = usb_link_dropped();
+
+    for (int core = 0; core < STATS_CORES; core++)
+    {
+        core_stats_t now_core = core_stats[core];
+        core_stats_t *last = &last_core[core];
+        stats_core_t *out = &stats->core[core];
+        uint32_t ticks = now_core.ticks - last->ticks;
+        uint32_t idle = now_core.idle_us - last->idle_us;
+
+        out->idle_pct = (uint8_t)((uint64_t)(idle < interval_us ? idle : interval_us) * 100 / interval_us);
+        out->passes_per_s = (uint32_t)((uint64_t)(now_core.passes - last->passes) * 1000000 / interval_us);
+        if (ticks)
+        {
+            out->tick_period_us = interval_us / ticks;
+            out->late_mean_us = (now_core.late_us - last->late_us) / ticks;
+        }
+        // a maximum from an older epoch belongs to an interval already reported
+        out->late_max_us = now_core.late_epoch == epoch ? now_core.late_max_us : 0;
+        *last = now_core;
+    }
+
+    last_us = now;
+    stats_epoch = epoch + 1;
+}
@@ -0,0 +1,177 @@
+/**
+ * @file telemetry.c
+ * @brief Delta-encoded telemetry snapshots for the LoRa link, see telemetry.h
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include "../include/telemetry.h"
+
+// general includes
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+_Static_assert(TLM_FIELDS <= 32, "the changed-field mask is a uint32_t");
+
+#define HIST(seq)   ((unsigned)(seq) % TLM_HISTORY)
+
+/**
+ * @brief Copies a GPS fix into a telemetry snapshot
+ *
+ * @param fix the fix
+ * @param tlm destination
+ */
+void tlm_from_fix(const gps_fix_t *fix, telemetry_t *tlm)
+{
+    tlm->field[TLM_LAT] = fix->lat;
+    tlm->field[TLM_LON] = fix->lon;
+    tlm->field[TLM_TIME] = (int32_t)fix->time_ms;
+    tlm->field[TLM_HDOP] = fix->hdop;
+    tlm->field[TLM_SPEED] = fix->speed;
+    tlm->field[TLM_COURSE] = fix->course;
+    tlm->field[TLM_QUALITY] = fix->quality;
+    tlm->field[TLM_SATS] = fix->sats;
+}
+
+/**
+ * @brief Forgets all references; for a new connection, whose sequence numbers start over
+ *
+ * @param e the encoder
+ */
+void tlm_encoder_init(tlm_encoder_t *e)
+{
+    memset(e, 0, sizeof(*e));
+}
+
+/**
+ * @brief Encodes a snapshot for the next data frame of state; the caller queues it right away
+ *        with arq_queue_bytes(state, "TLM", out, n)
+ *
+ * @param e the encoder
+ * @param state the connection; decides which sent snapshots the ground station has
+ * @param tlm the snapshot
+ * @param out at least TLM_MAX_SIZE bytes
+ * @return size_t number of bytes written
+ */
+size_t tlm_encode(tlm_encoder_t *e, const STATE *state, const telemetry_t *tlm, uint8_t *out)
+{
+    const int32_t *base = NULL;
+    uint32_t distance = 0;
+    uint32_t mask = 0;
+    size_t n;
+    int seq = state->seq;
+
+    // newest acknowledged snapshot becomes the reference
+    for (int i = 0; i < TLM_HISTORY; i++)
+    {
+        tlm_snapshot_t *s = &e->sent[i];
+
+        if (!s->used || !arq_acked(state, s->seq))
+            continue;
+        if (!e->ref.used || s->seq - e->ref.seq > 0)
+            e->ref = *s;
+        s->used = false;
+    }
+
+    if (e->ref.used && seq - e->ref.seq < TLM_HISTORY && e->since_key < TLM_KEYFRAME_EVERY)
+    {
+        base = e->ref.tlm.field;
+        distance = (uint32_t)(seq - e->ref.seq);
+        e->since_key++;
+    }
+    else
+    {
+        e->since_key = 0;
+        e->keyframes++;
+    }
+
+    for (int f = 0; f < TLM_FIELDS; f++)
+    {
+        if (tlm->field[f] != (base ? base[f] : 0))
+            mask |= 1u << f;
+    }
+
+    n = varint_put(distance, out);
+    n += varint_put(mask, out + n);
+    for (int f = 0; f < TLM_FIELDS; f++)
+    {
+        if (mask & (1u << f))
+            n += varint_put(zigzag_encode((int32_t)((uint32_t)tlm->field[f] - (uint32_t)(base ? base[f] : 0))),
+                            out + n);
+    }
+
+    e->sent[HIST(seq)] = (tlm_snapshot_t){ seq, true, *tlm };
+    e->frames++;
+    e->bytes += n;
+
+    return n;
+}
+
+/**
+ * @brief Forgets all received snapshots
+ *
+ * @param d the decoder
+ */
+void tlm_decoder_init(tlm_decoder_t *d)
+{
+    memset(d, 0, sizeof(*d));
+}
+
+static int tlm_reject(tlm_decoder_t *d)
+{
+    d->errors++;
+    return EXIT_FAILURE;
+}
+
+/**
+ * @brief Decodes a TLM frame's data; frames must be decoded in sequence order, as the ARQ delivers them
+ *
+ * @param d the decoder
+ * @param seq sequence number of the frame
+ * @param in the frame's data
+ * @param len number of bytes in data
+ * @param tlm destination
+ * @return int status; 0 = success; 1 = malformed, or its reference is missing
+ */
+int tlm_decode(tlm_decoder_t *d, int seq, const void *in, size_t len, telemetry_t *tlm)
+{
+    const uint8_t *b = in;
+    const tlm_snapshot_t *ref = NULL;
+    uint32_t distance, mask, delta;
+    size_t pos, n;
+
+    d->frames++;
+
+    if (!(pos = varint_get(b, len, &distance)) || !(n = varint_get(b + pos, len - pos, &mask)))
+        return tlm_reject(d);
+    pos += n;
+    if (mask >> TLM_FIELDS)
+        return tlm_reject(d);
+
+    if (distance)
+    {
+        ref = &d->history[HIST(seq - (int)distance)];
+        if (distance >= TLM_HISTORY || !ref->used || ref->seq != seq - (int)distance)
+            return tlm_reject(d);
+    }
+
+    for (int f = 0; f < TLM_FIELDS; f++)
+    {
+        tlm->field[f] = ref ? ref->tlm.field[f] : 0;
+        if (!(mask & (1u << f)))
+            continue;
+        if (!(n = varint_get(b + pos, len - pos, &delta)))
+            return tlm_reject(d);
+        pos += n;
+        tlm->field[f] = (int32_t)((uint32_t)tlm->field[f] + (uint32_t)zigzag_decode(delta));
+    }
+    if (pos != len)
+        return tlm_reject(d);
+
+    d->history[HIST(seq)] = (tlm_snapshot_t){ seq, true, *tlm };
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,136 @@
+/**
+ * @file tlmreg.c
+ * @brief Latest-value telemetry registers and their publisher, see tlmreg.h
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include "../include/tlmreg.h"
+
+// general includes
+#include <string.h>
+
+#include "../include/nmea.h"
+
+tlm_reg_t tlm_wheels;
+tlm_reg_t tlm_battery;
+tlm_reg_t tlm_status;
+
+static tlm_reg_t *const registers[TLM_REGS] = { NULL, &tlm_wheels, &tlm_battery, &tlm_status };
+
+static const uint32_t period_ms[TLM_REGS] = {
+    TLM_GPS_PERIOD_MS, TLM_WHEELS_PERIOD_MS, TLM_BATTERY_PERIOD_MS, TLM_STATUS_PERIOD_MS
+};
+
+// the snapshot fields behind each register but GPS, which tlm_from_fix() fills in
+static const struct
+{
+    uint8_t first;
+    uint8_t count;
+} fields[TLM_REGS] = {
+    [TLM_REG_WHEELS]  = { TLM_VEL_LEFT, 2 },
+    [TLM_REG_BATTERY] = { TLM_BATTERY, 1 },
+    [TLM_REG_STATUS]  = { TLM_STATUS, 1 },
+};
+
+_Static_assert(TLM_VEL_RIGHT == TLM_VEL_LEFT + 1, "wheel fields must be adjacent");
+
+/**
+ * @brief Publishes a value to a register (single writer); its version moves only if the value changed
+ *
+ * @param reg the register
+ * @param value TLM_REG_SIZE values; unused ones should be left 0
+ */
+void tlm_reg_store(tlm_reg_t *reg, const int32_t *value)
+{
+    uint32_t seq = reg->seq;
+
+    // the writer's own copy is stable: no lock needed to compare
+    if (seq && memcmp(reg->value, value, sizeof(reg->value)) == 0)
+        return;
+
+    __atomic_store_n(&reg->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(reg->value, value, sizeof(reg->value));
+    __atomic_store_n(&reg->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Reads a consistent copy of a register; safe from any core or context but the writer's
+ *
+ * @param reg the register
+ * @param value where TLM_REG_SIZE values are copied
+ * @return version of the value; 0 if nothing has been stored yet
+ */
+uint32_t tlm_reg_load(tlm_reg_t *reg, int32_t *value)
+{
+    uint32_t before, after;
+
+    do
+    {
+        while ((before = __atomic_load_n(&reg->seq, __ATOMIC_ACQUIRE)) & 1u);
+        memcpy(value, reg->value, sizeof(reg->value));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        after = __atomic_load_n(&reg->seq, __ATOMIC_RELAXED);
+    } while (before != after);
+
+    return before / 2;
+}
+
+/**
+ * @brief Forgets what was taken; for a new connection, so its first snapshot has every register
+ *
+ * @param p the publisher
+ */
+void tlm_publisher_init(tlm_publisher_t *p)
+{
+    memset(p, 0, sizeof(*p));
+}
+
+/**
+ * @brief Takes every register with a new value whose period has passed into the snapshot
+ *
+ * @param p the publisher
+ * @param now the time
+ * @param tlm where the snapshot is copied if anything was taken
+ * @return true if it was: a TLM frame should go out
+ */
+bool tlm_collect(tlm_publisher_t *p, absolute_time_t now, telemetry_t *tlm)
+{
+    int32_t value[TLM_REG_SIZE];
+    gps_fix_t fix;
+    uint32_t version;
+    bool taken = false;
+
+    for (int r = 0; r < TLM_REGS; r++)
+    {
+        version = r == TLM_REG_GPS ? gps_fix_load(&gps_latest_fix, &fix) : tlm_reg_load(registers[r], value);
+        if (!version || version == p->version[r])
+            continue;
+        // the first value since the connection came up goes at once
+        if (p->version[r] && absolute_time_diff_us(p->taken[r], now) < (int64_t)period_ms[r] * 1000)
+        {
+            p->deferred[r]++;
+            continue;
+        }
+
+        if (r == TLM_REG_GPS)
+            tlm_from_fix(&fix, &p->tlm);
+        else
+            memcpy(&p->tlm.field[fields[r].first], value, fields[r].count * sizeof(value[0]));
+        p->version[r] = version;
+        p->taken[r] = now;
+        p->changes[r]++;
+        taken = true;
+    }
+
+    if (taken)
+    {
+        p->snapshots++;
+        *tlm = p->tlm;
+    }
+    return taken;
+}
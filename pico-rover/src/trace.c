@@ -0,0 +1,98 @@
+/**
+ * @file trace.c
+ * @brief Per-core ring of timestamped events along the command path, for latency breakdowns
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include "../include/trace.h"
+
+// general includes
+#include <string.h>
+
+trace_ring_t trace_rings[TRACE_CORES];
+
+const char *const trace_event_names[TRACE_EVENTS] = {
+    [TRACE_LORA_RCV]        = "LORA_RCV",
+    [TRACE_LORA_FRAME]      = "LORA_FRAME",
+    [TRACE_CMD_QUEUE]       = "CMD_QUEUE",
+    [TRACE_CMD_DISPATCH]    = "CMD_DISPATCH",
+    [TRACE_USB_LINE]        = "USB_LINE",
+    [TRACE_MTR_POST]        = "MTR_POST",
+    [TRACE_MTR_TAKE]        = "MTR_TAKE",
+    [TRACE_MTR_APPLY]       = "MTR_APPLY",
+};
+
+/**
+ * @brief Empties both rings; before core 1 is launched
+ */
+void trace_init(void)
+{
+    memset(trace_rings, 0, sizeof(trace_rings));
+}
+
+/**
+ * @brief Takes the oldest unread records of a core's ring, oldest first; core 0 only
+ *
+ * The writer keeps going meanwhile. Records it may have overwritten while they
+ * were being copied are dropped from the result and counted in the ring's lost.
+ *
+ * @param core whose ring
+ * @param out destination
+ * @param max records out can hold
+ * @return size_t records stored in out; 0 once the ring is drained
+ */
+size_t trace_read(uint core, trace_record_t *out, size_t max)
+{
+    trace_ring_t *ring = &trace_rings[core];
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    uint32_t tail = ring->tail;
+    uint32_t skip;
+    size_t n;
+
+    // lapped since the last read: only the newest TRACE_RING_SIZE - 1 are still whole
+    if (head - tail >= TRACE_RING_SIZE)
+    {
+        ring->lost += head - tail - (TRACE_RING_SIZE - 1);
+        tail = head - (TRACE_RING_SIZE - 1);
+    }
+    n = head - tail < max ? head - tail : max;
+    for (size_t i = 0; i < n; i++)
+        out[i] = ring->record[(tail + i) & (TRACE_RING_SIZE - 1)];
+
+    // the slot of record head is being written, so anything at or before head - TRACE_RING_SIZE is suspect
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    skip = head - tail >= TRACE_RING_SIZE ? head - tail - (TRACE_RING_SIZE - 1) : 0;
+    if (skip > n)
+        skip = (uint32_t)n;
+    if (skip)
+    {
+        memmove(out, out + skip, (n - skip) * sizeof(out[0]));
+        ring->lost += skip;
+        n -= skip;
+        tail += skip;
+    }
+
+    ring->tail = tail + (uint32_t)n;
+    return n;
+}
+
+/**
+ * @brief The event a dump line names
+ *
+ * @param name as in trace_event_names
+ * @return TRACE_EVENT TRACE_EVENTS if there is no such event
+ */
+TRACE_EVENT trace_event_from_name(const char *name)
+{
+    for (int event = 0; event < TRACE_EVENTS; event++)
+    {
+        if (strcmp(name, trace_event_names[event]) == 0)
+            return (TRACE_EVENT)event;
+    }
+    return TRACE_EVENTS;
+}
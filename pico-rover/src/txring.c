@@ -0,0 +1,103 @@
+/**
+ * @file txring.c
+ * @brief UART transmit ring drained by the TX interrupt
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include "../include/txring.h"
+
+// general includes
+#include <string.h>
+
+// hardware includes
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+_Static_assert((TX_RING_SIZE & (TX_RING_SIZE - 1)) == 0, "TX_RING_SIZE must be a power of 2");
+
+/**
+ * @brief Resets a ring; the UART's interrupt handler must call tx_ring_drain()
+ *
+ * @param r the ring
+ * @param uart the UART it feeds
+ */
+void tx_ring_init(tx_ring_t *r, uart_inst_t *uart)
+{
+    memset(r, 0, sizeof(*r));
+    r->uart = uart;
+}
+
+/**
+ * @brief Moves queued bytes into the UART's TX FIFO while it has room
+ *
+ * Called from the UART interrupt, and by tx_ring_write() with interrupts off.
+ * Leaves the TX interrupt enabled only while bytes are left. The RX interrupt
+ * stays enabled throughout: the rings are only used on UARTs that receive too.
+ *
+ * @param r the ring
+ */
+void __not_in_flash_func(tx_ring_drain)(tx_ring_t *r)
+{
+    uint32_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+    uint32_t tail = r->tail;
+
+    while (tail != head && uart_is_writable(r->uart))
+        uart_putc_raw(r->uart, (char)r->ring[tail++ & (TX_RING_SIZE - 1)]);
+    __atomic_store_n(&r->tail, tail, __ATOMIC_RELEASE);
+
+    uart_set_irq_enables(r->uart, true, tail != head);
+}
+
+/**
+ * @brief Queues a message for the UART, all of it or none of it; never waits
+ *
+ * @param r the ring
+ * @param data the bytes
+ * @param len number of bytes
+ * @return false if the ring hasn't room for all of them (backpressure); try again
+ *         once the TX interrupt has drained some
+ */
+bool tx_ring_write(tx_ring_t *r, const void *data, size_t len)
+{
+    const uint8_t *b = data;
+    uint32_t head = r->head;
+    uint32_t level = tx_ring_level(r);
+    uint32_t at = head & (TX_RING_SIZE - 1);
+    size_t first;
+    uint32_t status;
+
+    if (len > TX_RING_SIZE - level)
+    {
+        if (!r->stalled)
+        {
+            r->stalled = true;
+            r->stalled_since = get_absolute_time();
+        }
+        r->rejected++;
+        return false;
+    }
+    if (r->stalled)
+    {
+        r->stall_us += (uint64_t)absolute_time_diff_us(r->stalled_since, get_absolute_time());
+        r->stalled = false;
+    }
+
+    first = len < TX_RING_SIZE - at ? len : TX_RING_SIZE - at;
+    memcpy(&r->ring[at], b, first);
+    memcpy(r->ring, b + first, len - first);
+    __atomic_store_n(&r->head, head + (uint32_t)len, __ATOMIC_RELEASE);
+
+    if (level + len > r->high_water)
+        r->high_water = level + (uint32_t)len;
+
+    // the TX interrupt only fires as the FIFO drains, so an idle UART is primed from here
+    status = save_and_disable_interrupts();
+    tx_ring_drain(r);
+    restore_interrupts(status);
+
+    return true;
+}
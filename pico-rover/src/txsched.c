@@ -0,0 +1,203 @@
+/**
+ * @file txsched.c
+ * @brief Outbound scheduler for the LoRa link, see txsched.h
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include "../include/txsched.h"
+
+// general includes
+#include <string.h>
+
+#include "pico/stdlib.h"
+
+#include "../include/stats.h"
+
+const char *const tx_class_names[TX_CLASSES] = { "CONTROL", "STATUS" };
+
+static const unsigned depth[TX_CLASSES] = { TX_CONTROL_DEPTH, TX_STATUS_DEPTH };
+
+_Static_assert(TX_CONTROL_DEPTH <= MSG_POOL_SIZE && TX_STATUS_DEPTH <= MSG_POOL_SIZE, "depth past the pool");
+
+static inline unsigned buffer_index(const msg_channel_t *c, const char *buf)
+{
+    return (unsigned)((buf - c->buffer[0]) / MSG_BUFFER_SIZE);
+}
+
+/**
+ * @brief Empties every class; before either side uses it
+ *
+ * @param s the scheduler
+ */
+void tx_sched_init(tx_sched_t *s)
+{
+    for (int cls = 0; cls < TX_CLASSES; cls++)
+        msg_channel_init(&s->channel[cls]);
+    memset(s->stamp, 0, sizeof(s->stamp));
+    memset(s->stats, 0, sizeof(s->stats));
+}
+
+/**
+ * @brief Producer side: takes a free buffer of a class to write an item into, never blocks
+ *
+ * @param s the scheduler
+ * @param cls the item's class
+ * @return MSG_BUFFER_SIZE bytes owned by the caller until tx_send(); NULL if the class
+ *         is at its depth limit or out of buffers, counted as dropped
+ */
+char *tx_alloc(tx_sched_t *s, TX_CLASS cls)
+{
+    msg_channel_t *c = &s->channel[cls];
+
+    if (msg_level(c) >= depth[cls])
+    {
+        c->dropped++;
+        return NULL;
+    }
+    return msg_alloc(c);
+}
+
+/**
+ * @brief Producer side: stamps a buffer from tx_alloc() and hands it to core 1
+ *
+ * @param s the scheduler
+ * @param cls the class it was taken from
+ * @param buf the buffer
+ * @param len length of the item in it
+ */
+void tx_send(tx_sched_t *s, TX_CLASS cls, char *buf, size_t len)
+{
+    msg_channel_t *c = &s->channel[cls];
+
+    // published with the buffer: msg_send() releases it to the consumer
+    s->stamp[cls][buffer_index(c, buf)] = time_us_32();
+    msg_send(c, buf, len);
+}
+
+/**
+ * @brief Producer side: sends a copy of a string
+ *
+ * @param s the scheduler
+ * @param cls the item's class
+ * @param text the item; truncated to MSG_BUFFER_SIZE - 1 characters
+ * @return false if tx_alloc() had no buffer
+ */
+bool tx_send_text(tx_sched_t *s, TX_CLASS cls, const char *text)
+{
+    char *buf = tx_alloc(s, cls);
+    size_t len;
+
+    if (!buf)
+        return false;
+
+    len = strlen(text);
+    if (len >= MSG_BUFFER_SIZE)
+        len = MSG_BUFFER_SIZE - 1;
+    memcpy(buf, text, len);
+    buf[len] = '\0';
+    tx_send(s, cls, buf, len);
+
+    return true;
+}
+
+/**
+ * @brief Consumer side: looks at the next item to send without taking it
+ *
+ * @param s the scheduler
+ * @param cls where its class is stored
+ * @param len where its length is stored
+ * @return the oldest item of the highest class that has one; NULL if all are empty
+ */
+const char *tx_peek(const tx_sched_t *s, TX_CLASS *cls, size_t *len)
+{
+    const char *buf;
+
+    for (int i = 0; i < TX_CLASSES; i++)
+    {
+        if ((buf = msg_peek(&s->channel[i], len)))
+        {
+            *cls = (TX_CLASS)i;
+            return buf;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Consumer side: takes the oldest item of one class and counts its queueing delay;
+ *        after tx_peek(), the item it showed, whatever core 0 has queued since
+ *
+ * @param s the scheduler
+ * @param cls the class to take it from; pass it back to tx_release()
+ * @param len where its length is stored
+ * @return the item, owned by the caller until tx_release(); NULL if the class is empty
+ */
+char *tx_take(tx_sched_t *s, TX_CLASS cls, size_t *len)
+{
+    tx_class_stats_t *st;
+    uint32_t epoch = stats_epoch;
+    uint32_t delay;
+    char *buf;
+
+    if (!(buf = msg_receive(&s->channel[cls], len)))
+        return NULL;
+    delay = time_us_32() - s->stamp[cls][buffer_index(&s->channel[cls], buf)];
+
+    st = &s->stats[cls];
+    if (st->delay_epoch != epoch)
+    {
+        st->delay_max_us = 0;
+        st->delay_epoch = epoch;
+    }
+    if (delay > st->delay_max_us)
+        st->delay_max_us = delay;
+    st->delay_us += delay;
+    st->taken++;
+    return buf;
+}
+
+/**
+ * @brief Consumer side: takes the next item to send, see tx_take()
+ *
+ * @param s the scheduler
+ * @param cls where its class is stored; pass it back to tx_release()
+ * @param len where its length is stored
+ * @return the item, owned by the caller until tx_release(); NULL if all classes are empty
+ */
+char *tx_receive(tx_sched_t *s, TX_CLASS *cls, size_t *len)
+{
+    if (!tx_peek(s, cls, len))
+        return NULL;
+    return tx_take(s, *cls, len);
+}
+
+/**
+ * @brief Consumer side: returns a buffer from tx_receive() to core 0
+ *
+ * @param s the scheduler
+ * @param cls the class tx_receive() gave
+ * @param buf the buffer
+ */
+void tx_release(tx_sched_t *s, TX_CLASS cls, char *buf)
+{
+    msg_release(&s->channel[cls], buf);
+}
+
+/**
+ * @brief Items waiting in every class; a snapshot from either side
+ *
+ * @param s the scheduler
+ * @return unsigned
+ */
+unsigned tx_level(const tx_sched_t *s)
+{
+    unsigned level = 0;
+
+    for (int cls = 0; cls < TX_CLASSES; cls++)
+        level += msg_level(&s->channel[cls]);
+    return level;
+}
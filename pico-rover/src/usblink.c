@@ -0,0 +1,215 @@
+/**
+ * @file usblink.c
+ * @brief Routes USB stdin to the ASCII line framer or the binary frame decoder, and
+ *        sends typed messages back to the SBC in whichever mode is active
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include "../include/usblink.h"
+
+// general includes
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// hardware includes
+#include "pico/stdlib.h"
+#include "pico/stdio_usb.h"
+
+#include "../include/main.h"
+#include "../include/definitions.h"
+#include "../include/commands.h"
+#include "../include/framer.h"
+#include "../include/trace.h"
+
+USB_MODE usb_mode = USB_MODE_ASCII;
+
+static line_framer_t stdin_framer;
+static bin_decoder_t stdin_decoder;
+static bool skip_lf;                // the LF of a "$REQ BIN\r\n" that switched on its CR
+
+/**
+ * @brief Resets the USB link to ASCII mode
+ * 
+ */
+void usb_link_init()
+{
+    framer_init(&stdin_framer, 0);
+    bin_decoder_init(&stdin_decoder);
+    usb_mode = USB_MODE_ASCII;
+    skip_lf = false;
+}
+
+static void handle_lines()
+{
+    const char *line;
+    size_t len;
+    FRAMER_EVENT event;
+
+    while ((event = framer_poll(&stdin_framer, &line, &len)) != FRAMER_EMPTY)
+    {
+        TRACE(TRACE_USB_LINE, len);
+        if (event == FRAMER_OVERFLOW)
+        {
+            usb_error("Input line too long, discarded: %s", line);
+        }
+        else if (handle_input(line))
+        {
+            usb_error("Failed to process string: %s", line);
+        }
+    }
+}
+
+static void handle_frame_byte(uint8_t byte)
+{
+    bin_frame_t frame;
+    command_t cmd;
+
+    switch (bin_decoder_push(&stdin_decoder, byte, &frame))
+    {
+        case BIN_FRAME:
+            TRACE(TRACE_USB_LINE, frame.len);
+            if (parse_frame(&frame, &cmd) || dispatch_command(&cmd))
+            {
+                usb_error("Failed to process frame 0x%02x", frame.id);
+            }
+            break;
+        case BIN_ERROR:
+            usb_error("Dropped corrupt frame");
+            break;
+        case BIN_NONE:
+            break;
+    }
+}
+
+/**
+ * @brief Drains USB stdin and dispatches every complete line or frame
+ * 
+ */
+void usb_link_poll()
+{
+    int ch;
+
+    // no timeout makes it non-blocking
+    while ((ch = getchar_timeout_us(0)) != PICO_ERROR_TIMEOUT)
+    {
+        if (usb_mode == USB_MODE_BINARY)
+        {
+            if (skip_lf && ch == NL)
+            {
+                skip_lf = false;
+                continue;
+            }
+            skip_lf = false;
+            handle_frame_byte((uint8_t)ch);
+            continue;
+        }
+
+        framer_push(&stdin_framer, (uint8_t)ch);
+        // handle a line as soon as it ends, it may switch the link to binary for the bytes after it
+        if (ch == CR || ch == NL)
+        {
+            handle_lines();
+            // only after a CR: with a bare LF ending, the next byte is the frame's, and may be 0x0A
+            skip_lf = ch == CR && usb_mode == USB_MODE_BINARY;
+        }
+    }
+
+    if (usb_mode == USB_MODE_ASCII)
+    {
+        handle_lines();
+    }
+}
+
+/**
+ * @brief Bytes lost with the USB stdin ring full, for the statistics snapshot
+ *
+ * @return uint32_t bytes since boot
+ */
+uint32_t usb_link_dropped()
+{
+    return __atomic_load_n(&stdin_framer.dropped, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief Acknowledges a mode change request in the current mode, then switches
+ * 
+ * @param mode the new mode
+ */
+void usb_set_mode(USB_MODE mode)
+{
+    int32_t ack = BIN_VERSION;
+
+    if (usb_mode == USB_MODE_ASCII)
+    {
+        printf("$ACK %s %d\n", mode == USB_MODE_BINARY ? "BIN" : "ASCII", BIN_VERSION);
+        stdio_flush();
+    }
+    else
+    {
+        usb_send(BIN_MSG_ACK, &ack, sizeof(ack));
+    }
+
+    if (mode != usb_mode)
+    {
+        framer_init(&stdin_framer, 0);
+        bin_decoder_init(&stdin_decoder);
+        // frames are written through stdio whole, and a 0x0A in one must stay one byte
+        stdio_set_translate_crlf(&stdio_usb, mode == USB_MODE_ASCII);
+        usb_mode = mode;
+    }
+}
+
+/**
+ * @brief Sends one binary frame to the SBC
+ * 
+ * @param id message id
+ * @param payload message payload (multi-byte fields little-endian)
+ * @param len payload length, at most BIN_MAX_PAYLOAD
+ */
+void usb_send(BIN_MSG_ID id, const void *payload, size_t len)
+{
+    uint8_t wire[1 + BIN_MAX_WIRE];
+    size_t n = bin_encode(id, payload, len, wire + 1);
+
+    // a leading delimiter resynchronises the SBC after any stray ASCII output
+    wire[0] = 0;
+    // one write: the frame goes out under a single take of the stdio mutex, not one per byte
+    fwrite(wire, 1, n + 1, stdout);
+    fflush(stdout);
+}
+
+/**
+ * @brief Reports an error to the SBC: "$ERR ..." in ASCII mode, an ERR frame in binary mode
+ * 
+ * @param fmt printf-style format
+ */
+void usb_error(const char *fmt, ...)
+{
+    char text[BIN_MAX_PAYLOAD + 1];
+    va_list args;
+    int len;
+
+    va_start(args, fmt);
+    len = vsnprintf(text, sizeof(text), fmt, args);
+    va_end(args);
+
+    if (len < 0)
+        return;
+    if (len > BIN_MAX_PAYLOAD)
+        len = BIN_MAX_PAYLOAD;
+
+    if (usb_mode == USB_MODE_BINARY)
+    {
+        usb_send(BIN_MSG_ERR, text, (size_t)len);
+    }
+    else
+    {
+        printf("$ERR %s\n", text);
+    }
+}